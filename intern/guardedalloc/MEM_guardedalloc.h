@@ -222,6 +222,49 @@ extern void (*MEM_callbackmemlist)(void (*func)(void *));
 /** Print statistics about memory usage */
 extern void (*MEM_printmemlist_stats)(void);
 
+/** Memory used by all blocks that were allocated with the same name. */
+typedef struct MEM_NameUsage {
+  const char *name;
+  size_t mem_in_use;
+  size_t blocks_in_use;
+  /** Number of allocations since tracking was enabled, including blocks that were freed. */
+  size_t allocations_num;
+} MEM_NameUsage;
+
+typedef struct MEM_NameUsageSnapshot {
+  /** Sorted by memory usage, largest first. */
+  MEM_NameUsage *items;
+  int items_num;
+  /** Sums of all items. */
+  size_t mem_in_use;
+  size_t blocks_in_use;
+} MEM_NameUsageSnapshot;
+
+/**
+ * Enable or disable accounting of the memory usage per allocation name. This is cheap enough to
+ * be used in release builds, but only blocks that are allocated while it is enabled are counted.
+ * Only the lockfree allocator supports it, the fully guarded allocator keeps track of the names
+ * of all blocks anyway (see #MEM_printmemlist_stats). #MEM_get_name_usage_tracking returns false
+ * while the fully guarded allocator is used.
+ */
+void MEM_set_name_usage_tracking(bool enable);
+bool MEM_get_name_usage_tracking(void);
+
+/**
+ * Get the current memory usage per allocation name. Names with the same content are merged,
+ * names that were never used since tracking was enabled are not included.
+ */
+MEM_NameUsageSnapshot *MEM_name_usage_snapshot(void) ATTR_WARN_UNUSED_RESULT;
+void MEM_name_usage_snapshot_free(MEM_NameUsageSnapshot *snapshot);
+
+/**
+ * Print the \a items_num names with the highest memory usage. When \a previous is given, the
+ * names whose memory usage changed the most since that snapshot are printed instead.
+ */
+void MEM_name_usage_print(const MEM_NameUsageSnapshot *snapshot,
+                          const MEM_NameUsageSnapshot *previous,
+                          int items_num) ATTR_NONNULL(1);
+
 /** Set the callback function for error output. */
 extern void (*MEM_set_error_callback)(void (*func)(const char *));
 
@@ -287,6 +330,16 @@ void MEM_enable_fail_on_memleak(void);
  */
 void MEM_use_lockfree_allocator(void);
 
+/**
+ * Switch allocator to fast mode like #MEM_use_lockfree_allocator, but serve small allocations from
+ * per-thread pools of fixed size blocks instead of the system allocator. This avoids most of the
+ * synchronization between threads that allocate and free many small blocks at the same time.
+ * Statistics about the used size classes are printed by #MEM_printmemlist_stats.
+ *
+ * \note The switch between allocator types can only happen before any allocation did happen.
+ */
+void MEM_use_size_class_allocator(void);
+
 /**
  * Switch allocator to slow fully guarded mode.
  *
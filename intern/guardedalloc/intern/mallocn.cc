@@ -194,6 +194,7 @@ void MEM_use_lockfree_allocator()
   MEM_get_peak_memory = MEM_lockfree_get_peak_memory;
 
   mem_clearmemlist = mem_lockfree_clearmemlist;
+  mem_lockfree_use_size_classes(false);
 
 #ifndef NDEBUG
   MEM_name_ptr = MEM_lockfree_name_ptr;
@@ -201,6 +202,12 @@ void MEM_use_lockfree_allocator()
 #endif
 }
 
+void MEM_use_size_class_allocator()
+{
+  MEM_use_lockfree_allocator();
+  mem_lockfree_use_size_classes(true);
+}
+
 void MEM_use_guarded_allocator()
 {
   assert_for_allocator_change();
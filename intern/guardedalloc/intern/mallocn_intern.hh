@@ -78,6 +78,9 @@ size_t malloc_usable_size(void *ptr);
 /* Real pointer returned by the `malloc` or `aligned_alloc`. */
 #define MEMHEAD_REAL_PTR(memh) ((char *)memh - MEMHEAD_ALIGN_PADDING(memh->alignment))
 
+#include <atomic>
+#include <cstdint>
+
 #include "mallocn_inline.hh"
 
 #define ALIGNED_MALLOC_MINIMUM_ALIGNMENT sizeof(void *)
@@ -91,6 +94,11 @@ extern char free_after_leak_detection_message[];
 void memory_usage_init(void);
 void memory_usage_block_alloc(size_t size);
 void memory_usage_block_free(size_t size);
+/**
+ * Count memory that is used without being part of a block, e.g. the chunks of the size class
+ * allocator. \a size is negative when the memory is released.
+ */
+void memory_usage_overhead_add(int64_t size);
 size_t memory_usage_block_num(void);
 size_t memory_usage_current(void);
 /**
@@ -115,6 +123,23 @@ void memory_usage_peak_reset(void);
  */
 extern void (*mem_clearmemlist)(void);
 
+/* Thread-local size class allocator that is used by the lockfree allocator for small blocks, see
+ * `mallocn_size_classes.cc`. */
+#define MEM_SIZE_CLASS_MAX_SIZE 1024
+#define MEM_SIZE_CLASS_MAX_ALIGNMENT 16
+
+void *mem_size_class_malloc(size_t size) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT ATTR_ALLOC_SIZE(1);
+void mem_size_class_free(void *ptr) ATTR_NONNULL(1);
+void mem_size_class_print_stats(void);
+
+/* Accounting of the memory usage per allocation name, see `mallocn_name_usage.cc`. A name index
+ * of zero means that a block is not tracked. */
+extern std::atomic<bool> mem_name_usage_enabled;
+
+uint32_t mem_name_usage_block_alloc(const char *name, size_t len);
+void mem_name_usage_block_free(uint32_t name_index, size_t len);
+const char *mem_name_usage_block_name(uint32_t name_index);
+
 /* Prototypes for counted allocator functions */
 size_t MEM_lockfree_allocN_len(const void *vmemh) ATTR_WARN_UNUSED_RESULT;
 void MEM_lockfree_freeN(void *vmemh, mem_guarded::internal::AllocationType allocation_type);
@@ -167,6 +192,7 @@ void MEM_lockfree_reset_peak_memory(void);
 size_t MEM_lockfree_get_peak_memory(void) ATTR_WARN_UNUSED_RESULT;
 
 void mem_lockfree_clearmemlist(void);
+void mem_lockfree_use_size_classes(bool use);
 
 #ifndef NDEBUG
 const char *MEM_lockfree_name_ptr(void *vmemh);
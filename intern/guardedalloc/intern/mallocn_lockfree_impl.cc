@@ -42,6 +42,8 @@ static_assert(MEM_MIN_CPP_ALIGNMENT <= sizeof(MemHead), "Bad size of MemHead");
 
 typedef struct MemHeadAligned {
   short alignment;
+  /** Slot of the block name when the usage per name is tracked, zero otherwise. */
+  uint32_t name_index;
   size_t len;
 } MemHeadAligned;
 static_assert(MEM_MIN_CPP_ALIGNMENT <= alignof(MemHeadAligned), "Bad alignment of MemHeadAligned");
@@ -51,6 +53,9 @@ static_assert(MEM_MIN_CPP_ALIGNMENT <= sizeof(MemHeadAligned), "Bad size of MemH
 
 static bool malloc_debug_memset = false;
 
+/** Allocate small blocks with the thread-local size class allocator (#mem_size_class_malloc). */
+static bool use_size_classes = false;
+
 static void (*error_callback)(const char *) = nullptr;
 
 /**
@@ -71,12 +76,21 @@ enum {
   MEMHEAD_FLAG_MASK = (1 << 2) - 1
 };
 
+/**
+ * This block has been allocated by the size class allocator. It has to be recorded per block,
+ * because the allocation mode may change while blocks are still in use, e.g. in tests. The lower
+ * bits are taken already, but the highest bit of the length is never used in practice.
+ */
+#define MEMHEAD_FLAG_SIZE_CLASS (size_t(1) << (sizeof(size_t) * 8 - 1))
+
 #define MEMHEAD_FROM_PTR(ptr) (((MemHead *)ptr) - 1)
 #define PTR_FROM_MEMHEAD(memhead) (memhead + 1)
 #define MEMHEAD_ALIGNED_FROM_PTR(ptr) (((MemHeadAligned *)ptr) - 1)
 #define MEMHEAD_IS_ALIGNED(memhead) ((memhead)->len & size_t(MEMHEAD_FLAG_ALIGN))
 #define MEMHEAD_IS_FROM_CPP_NEW(memhead) ((memhead)->len & size_t(MEMHEAD_FLAG_FROM_CPP_NEW))
-#define MEMHEAD_LEN(memhead) ((memhead)->len & ~size_t(MEMHEAD_FLAG_MASK))
+#define MEMHEAD_IS_SIZE_CLASS(memhead) ((memhead)->len & MEMHEAD_FLAG_SIZE_CLASS)
+#define MEMHEAD_LEN(memhead) \
+  ((memhead)->len & ~(size_t(MEMHEAD_FLAG_MASK) | MEMHEAD_FLAG_SIZE_CLASS))
 
 #ifdef __GNUC__
 __attribute__((format(printf, 1, 0)))
@@ -135,6 +149,18 @@ report_error_on_address(const void *vmemh, const char *message, ...)
   MEM_trigger_error_on_memory_block(address, size);
 }
 
+/** Name of the block if its memory usage is tracked per name, otherwise \a fallback. */
+static const char *block_name(const void *vmemh, const char *fallback)
+{
+  if (MEMHEAD_IS_ALIGNED(MEMHEAD_FROM_PTR(vmemh))) {
+    const MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
+    if (memh_aligned->name_index) {
+      return mem_name_usage_block_name(memh_aligned->name_index);
+    }
+  }
+  return fallback;
+}
+
 size_t MEM_lockfree_allocN_len(const void *vmemh)
 {
   if (LIKELY(vmemh)) {
@@ -164,14 +190,26 @@ void MEM_lockfree_freeN(void *vmemh, AllocationType allocation_type)
         "Attempt to use C-style MEM_freeN on a pointer created with CPP-style MEM_new or new\n");
   }
 
-  memory_usage_block_free(len);
+  /* The memory of size class blocks is counted per chunk. */
+  memory_usage_block_free(MEMHEAD_IS_SIZE_CLASS(memh) ? 0 : len);
 
   if (UNLIKELY(malloc_debug_memset && len)) {
     memset(memh + 1, 255, len);
   }
   if (UNLIKELY(MEMHEAD_IS_ALIGNED(memh))) {
     MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
-    aligned_free(MEMHEAD_REAL_PTR(memh_aligned));
+    if (memh_aligned->name_index) {
+      mem_name_usage_block_free(memh_aligned->name_index, len);
+    }
+    if (MEMHEAD_IS_SIZE_CLASS(memh)) {
+      mem_size_class_free(MEMHEAD_REAL_PTR(memh_aligned));
+    }
+    else {
+      aligned_free(MEMHEAD_REAL_PTR(memh_aligned));
+    }
+  }
+  else if (MEMHEAD_IS_SIZE_CLASS(memh)) {
+    mem_size_class_free(memh);
   }
   else {
     free(memh);
@@ -193,8 +231,10 @@ void *MEM_lockfree_dupallocN(const void *vmemh)
 
     if (UNLIKELY(MEMHEAD_IS_ALIGNED(memh))) {
       const MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
-      newp = MEM_lockfree_mallocN_aligned(
-          prev_size, size_t(memh_aligned->alignment), "dupli_malloc", AllocationType::ALLOC_FREE);
+      newp = MEM_lockfree_mallocN_aligned(prev_size,
+                                          size_t(memh_aligned->alignment),
+                                          block_name(vmemh, "dupli_malloc"),
+                                          AllocationType::ALLOC_FREE);
     }
     else {
       newp = MEM_lockfree_mallocN(prev_size, "dupli_malloc");
@@ -219,12 +259,14 @@ void *MEM_lockfree_reallocN_id(void *vmemh, size_t len, const char *str)
     }
 
     if (LIKELY(!MEMHEAD_IS_ALIGNED(memh))) {
-      newp = MEM_lockfree_mallocN(len, "realloc");
+      newp = MEM_lockfree_mallocN(len, str);
     }
     else {
       const MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
-      newp = MEM_lockfree_mallocN_aligned(
-          len, size_t(memh_aligned->alignment), "realloc", AllocationType::ALLOC_FREE);
+      newp = MEM_lockfree_mallocN_aligned(len,
+                                          size_t(memh_aligned->alignment),
+                                          block_name(vmemh, str),
+                                          AllocationType::ALLOC_FREE);
     }
 
     if (newp) {
@@ -262,12 +304,14 @@ void *MEM_lockfree_recallocN_id(void *vmemh, size_t len, const char *str)
     }
 
     if (LIKELY(!MEMHEAD_IS_ALIGNED(memh))) {
-      newp = MEM_lockfree_mallocN(len, "recalloc");
+      newp = MEM_lockfree_mallocN(len, str);
     }
     else {
       const MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
-      newp = MEM_lockfree_mallocN_aligned(
-          len, size_t(memh_aligned->alignment), "recalloc", AllocationType::ALLOC_FREE);
+      newp = MEM_lockfree_mallocN_aligned(len,
+                                          size_t(memh_aligned->alignment),
+                                          block_name(vmemh, str),
+                                          AllocationType::ALLOC_FREE);
     }
 
     if (newp) {
@@ -299,13 +343,33 @@ void *MEM_lockfree_callocN(size_t len, const char *str)
 {
   MemHead *memh;
 
+  if (UNLIKELY(mem_name_usage_enabled.load(std::memory_order_relaxed))) {
+    /* Only the aligned header has space for the name slot. */
+    void *ptr = MEM_lockfree_mallocN_aligned(
+        len, ALIGNED_MALLOC_MINIMUM_ALIGNMENT, str, AllocationType::ALLOC_FREE);
+    if (LIKELY(ptr)) {
+      memset(ptr, 0, len);
+    }
+    return ptr;
+  }
+
   len = SIZET_ALIGN_4(len);
 
-  memh = (MemHead *)calloc(1, len + sizeof(MemHead));
+  size_t flags = 0;
+  if (use_size_classes && len + sizeof(MemHead) <= MEM_SIZE_CLASS_MAX_SIZE) {
+    memh = (MemHead *)mem_size_class_malloc(len + sizeof(MemHead));
+    if (LIKELY(memh)) {
+      memset(memh, 0, len + sizeof(MemHead));
+    }
+    flags = MEMHEAD_FLAG_SIZE_CLASS;
+  }
+  else {
+    memh = (MemHead *)calloc(1, len + sizeof(MemHead));
+  }
 
   if (LIKELY(memh)) {
-    memh->len = len;
-    memory_usage_block_alloc(len);
+    memh->len = len | flags;
+    memory_usage_block_alloc((flags & MEMHEAD_FLAG_SIZE_CLASS) ? 0 : len);
 
     return PTR_FROM_MEMHEAD(memh);
   }
@@ -338,12 +402,25 @@ void *MEM_lockfree_mallocN(size_t len, const char *str)
 {
   MemHead *memh;
 
+  if (UNLIKELY(mem_name_usage_enabled.load(std::memory_order_relaxed))) {
+    /* Only the aligned header has space for the name slot. */
+    return MEM_lockfree_mallocN_aligned(
+        len, ALIGNED_MALLOC_MINIMUM_ALIGNMENT, str, AllocationType::ALLOC_FREE);
+  }
+
 #ifdef WITH_MEM_VALGRIND
   const size_t len_unaligned = len;
 #endif
   len = SIZET_ALIGN_4(len);
 
-  memh = (MemHead *)malloc(len + sizeof(MemHead));
+  size_t flags = 0;
+  if (use_size_classes && len + sizeof(MemHead) <= MEM_SIZE_CLASS_MAX_SIZE) {
+    memh = (MemHead *)mem_size_class_malloc(len + sizeof(MemHead));
+    flags = MEMHEAD_FLAG_SIZE_CLASS;
+  }
+  else {
+    memh = (MemHead *)malloc(len + sizeof(MemHead));
+  }
 
   if (LIKELY(memh)) {
 
@@ -361,8 +438,8 @@ void *MEM_lockfree_mallocN(size_t len, const char *str)
 #endif /* WITH_MEM_VALGRIND */
     }
 
-    memh->len = len;
-    memory_usage_block_alloc(len);
+    memh->len = len | flags;
+    memory_usage_block_alloc((flags & MEMHEAD_FLAG_SIZE_CLASS) ? 0 : len);
 
     return PTR_FROM_MEMHEAD(memh);
   }
@@ -421,8 +498,18 @@ void *MEM_lockfree_mallocN_aligned(size_t len,
 #endif
   len = SIZET_ALIGN_4(len);
 
-  MemHeadAligned *memh = (MemHeadAligned *)aligned_malloc(
-      len + extra_padding + sizeof(MemHeadAligned), alignment);
+  const size_t size = len + extra_padding + sizeof(MemHeadAligned);
+  size_t flags = MEMHEAD_FLAG_ALIGN;
+  MemHeadAligned *memh;
+  if (use_size_classes && size <= MEM_SIZE_CLASS_MAX_SIZE &&
+      alignment <= MEM_SIZE_CLASS_MAX_ALIGNMENT)
+  {
+    memh = (MemHeadAligned *)mem_size_class_malloc(size);
+    flags |= MEMHEAD_FLAG_SIZE_CLASS;
+  }
+  else {
+    memh = (MemHeadAligned *)aligned_malloc(size, alignment);
+  }
 
   if (LIKELY(memh)) {
     /* We keep padding in the beginning of MemHead,
@@ -445,11 +532,14 @@ void *MEM_lockfree_mallocN_aligned(size_t len,
 #endif /* WITH_MEM_VALGRIND */
     }
 
-    memh->len = len | size_t(MEMHEAD_FLAG_ALIGN) |
+    memh->len = len | flags |
                 size_t(allocation_type == AllocationType::NEW_DELETE ? MEMHEAD_FLAG_FROM_CPP_NEW :
                                                                        0);
     memh->alignment = short(alignment);
-    memory_usage_block_alloc(len);
+    memh->name_index = mem_name_usage_enabled.load(std::memory_order_relaxed) ?
+                           mem_name_usage_block_alloc(str, len) :
+                           0;
+    memory_usage_block_alloc((flags & MEMHEAD_FLAG_SIZE_CLASS) ? 0 : len);
 
     return PTR_FROM_MEMHEAD(memh);
   }
@@ -519,6 +609,11 @@ void MEM_lockfree_printmemlist() {}
 
 void mem_lockfree_clearmemlist() {}
 
+void mem_lockfree_use_size_classes(const bool use)
+{
+  use_size_classes = use;
+}
+
 /* Unused. */
 
 void MEM_lockfree_callbackmemlist(void (*func)(void *))
@@ -534,6 +629,15 @@ void MEM_lockfree_printmemlist_stats()
       "\nFor more detailed per-block statistics run Blender with memory debugging command line "
       "argument.\n");
 
+  if (use_size_classes) {
+    mem_size_class_print_stats();
+  }
+  if (mem_name_usage_enabled.load(std::memory_order_relaxed)) {
+    MEM_NameUsageSnapshot *snapshot = MEM_name_usage_snapshot();
+    MEM_name_usage_print(snapshot, nullptr, 30);
+    MEM_name_usage_snapshot_free(snapshot);
+  }
+
 #ifdef HAVE_MALLOC_STATS
   printf("System Statistics:\n");
   malloc_stats();
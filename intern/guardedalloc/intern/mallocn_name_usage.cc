@@ -0,0 +1,281 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup intern_mem
+ *
+ * Accounting of the memory usage per allocation name for the lockfree allocator, see
+ * #MEM_set_name_usage_tracking.
+ *
+ * Every name pointer gets a slot in a fixed size hash table, whose index is stored in the header
+ * of tracked blocks. Slots are claimed with a compare-and-swap and are never released, so that
+ * blocks can update the counters of their slot when they are freed without any locking. Names are
+ * usually string literals, so the same name may be stored at different addresses. These are
+ * merged when creating a snapshot.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdio.h> /* printf */
+#include <stdlib.h>
+#include <vector>
+
+#include "MEM_guardedalloc.h"
+#include "mallocn_intern.hh"
+
+/* to ensure strict conversions */
+#include "../../source/blender/blenlib/BLI_strict_flags.h"
+
+namespace {
+
+struct NameSlot {
+  std::atomic<const char *> name;
+  std::atomic<int64_t> mem_in_use;
+  std::atomic<int64_t> blocks_in_use;
+  std::atomic<int64_t> allocations_num;
+};
+
+constexpr uint32_t SLOTS_NUM = 1 << 14;
+/** Used when no free slot is found in reasonable time. */
+constexpr uint32_t OTHER_NAMES_SLOT = 1;
+constexpr uint32_t FIRST_NAME_SLOT = 2;
+constexpr uint32_t MAX_PROBES = 64;
+
+}  // namespace
+
+std::atomic<bool> mem_name_usage_enabled = false;
+
+/** Slot 0 is never used, so that zero can mean that a block is not tracked. */
+static NameSlot name_slots[SLOTS_NUM];
+static const char *other_names_str = "(other names)";
+/** Blocks without a name are counted together, a null slot name would mean that it is free. */
+static const char *unnamed_str = "(unnamed)";
+
+static uint32_t name_slot_find_or_add(const char *name)
+{
+  /* Hashing the pointer is much cheaper than hashing the string. */
+  const uint64_t hash = (uint64_t(uintptr_t(name)) >> 3) * 0x9E3779B97F4A7C15ull;
+  const uint32_t start = uint32_t(hash >> 40);
+  for (uint32_t probe = 0; probe < MAX_PROBES; probe++) {
+    const uint32_t index = (start + probe) & (SLOTS_NUM - 1);
+    if (index < FIRST_NAME_SLOT) {
+      continue;
+    }
+    NameSlot &slot = name_slots[index];
+    const char *slot_name = slot.name.load(std::memory_order_acquire);
+    if (slot_name == nullptr) {
+      if (slot.name.compare_exchange_strong(slot_name, name, std::memory_order_acq_rel)) {
+        return index;
+      }
+    }
+    if (slot_name == name) {
+      return index;
+    }
+  }
+  name_slots[OTHER_NAMES_SLOT].name.store(other_names_str, std::memory_order_release);
+  return OTHER_NAMES_SLOT;
+}
+
+uint32_t mem_name_usage_block_alloc(const char *name, const size_t len)
+{
+  const uint32_t index = name_slot_find_or_add(name ? name : unnamed_str);
+  NameSlot &slot = name_slots[index];
+  slot.mem_in_use.fetch_add(int64_t(len), std::memory_order_relaxed);
+  slot.blocks_in_use.fetch_add(1, std::memory_order_relaxed);
+  slot.allocations_num.fetch_add(1, std::memory_order_relaxed);
+  return index;
+}
+
+void mem_name_usage_block_free(const uint32_t name_index, const size_t len)
+{
+  NameSlot &slot = name_slots[name_index];
+  slot.mem_in_use.fetch_sub(int64_t(len), std::memory_order_relaxed);
+  slot.blocks_in_use.fetch_sub(1, std::memory_order_relaxed);
+}
+
+const char *mem_name_usage_block_name(const uint32_t name_index)
+{
+  return name_slots[name_index].name.load(std::memory_order_relaxed);
+}
+
+void MEM_set_name_usage_tracking(const bool enable)
+{
+  mem_name_usage_enabled.store(enable, std::memory_order_relaxed);
+}
+
+bool MEM_get_name_usage_tracking()
+{
+  /* Only the lockfree allocator counts the names of the blocks. */
+  return mem_name_usage_enabled.load(std::memory_order_relaxed) &&
+         MEM_allocN_len == MEM_lockfree_allocN_len;
+}
+
+static bool name_less(const MEM_NameUsage &a, const MEM_NameUsage &b)
+{
+  return strcmp(a.name, b.name) < 0;
+}
+
+MEM_NameUsageSnapshot *MEM_name_usage_snapshot()
+{
+  std::vector<MEM_NameUsage> items;
+  for (uint32_t i = OTHER_NAMES_SLOT; i < SLOTS_NUM; i++) {
+    const NameSlot &slot = name_slots[i];
+    const char *name = slot.name.load(std::memory_order_acquire);
+    if (name == nullptr) {
+      continue;
+    }
+    MEM_NameUsage item;
+    item.name = name;
+    /* The counters are not updated together, so they can be slightly off temporarily. */
+    item.mem_in_use = size_t(
+        std::max<int64_t>(slot.mem_in_use.load(std::memory_order_relaxed), 0));
+    item.blocks_in_use = size_t(
+        std::max<int64_t>(slot.blocks_in_use.load(std::memory_order_relaxed), 0));
+    item.allocations_num = size_t(slot.allocations_num.load(std::memory_order_relaxed));
+    items.push_back(item);
+  }
+
+  /* Merge names that are equal but stored at different addresses. */
+  std::sort(items.begin(), items.end(), name_less);
+  std::vector<MEM_NameUsage> merged_items;
+  for (const MEM_NameUsage &item : items) {
+    if (!merged_items.empty() && strcmp(merged_items.back().name, item.name) == 0) {
+      MEM_NameUsage &merged_item = merged_items.back();
+      merged_item.mem_in_use += item.mem_in_use;
+      merged_item.blocks_in_use += item.blocks_in_use;
+      merged_item.allocations_num += item.allocations_num;
+    }
+    else {
+      merged_items.push_back(item);
+    }
+  }
+  std::stable_sort(merged_items.begin(),
+                   merged_items.end(),
+                   [](const MEM_NameUsage &a, const MEM_NameUsage &b) {
+                     return a.mem_in_use > b.mem_in_use;
+                   });
+
+  /* Use the system allocator, so that snapshots don't show up in the statistics themselves. */
+  MEM_NameUsageSnapshot *snapshot = static_cast<MEM_NameUsageSnapshot *>(
+      malloc(sizeof(MEM_NameUsageSnapshot)));
+  snapshot->items_num = int(merged_items.size());
+  snapshot->items = static_cast<MEM_NameUsage *>(
+      malloc(sizeof(MEM_NameUsage) * std::max<size_t>(merged_items.size(), 1)));
+  std::copy(merged_items.begin(), merged_items.end(), snapshot->items);
+  snapshot->mem_in_use = 0;
+  snapshot->blocks_in_use = 0;
+  for (const MEM_NameUsage &item : merged_items) {
+    snapshot->mem_in_use += item.mem_in_use;
+    snapshot->blocks_in_use += item.blocks_in_use;
+  }
+  return snapshot;
+}
+
+void MEM_name_usage_snapshot_free(MEM_NameUsageSnapshot *snapshot)
+{
+  if (snapshot) {
+    free(snapshot->items);
+    free(snapshot);
+  }
+}
+
+static double to_megabytes(const double bytes)
+{
+  return bytes / double(1024 * 1024);
+}
+
+static void name_usage_print(const MEM_NameUsageSnapshot &snapshot, const int items_num)
+{
+  printf("\nMemory usage by allocation name: %.3f MB in %zu blocks\n",
+         to_megabytes(double(snapshot.mem_in_use)),
+         snapshot.blocks_in_use);
+  printf("%12s %10s %14s  %s\n", "MB", "blocks", "allocations", "name");
+  for (int i = 0; i < std::min(items_num, snapshot.items_num); i++) {
+    const MEM_NameUsage &item = snapshot.items[i];
+    printf("%12.3f %10zu %14zu  %s\n",
+           to_megabytes(double(item.mem_in_use)),
+           item.blocks_in_use,
+           item.allocations_num,
+           item.name);
+  }
+}
+
+namespace {
+struct NameUsageChange {
+  const char *name;
+  int64_t mem_in_use;
+  int64_t blocks_in_use;
+  size_t allocations_num;
+};
+}  // namespace
+
+static void name_usage_print_changes(const MEM_NameUsageSnapshot &snapshot,
+                                     const MEM_NameUsageSnapshot &previous,
+                                     const int items_num)
+{
+  std::vector<MEM_NameUsage> previous_items(previous.items, previous.items + previous.items_num);
+  std::sort(previous_items.begin(), previous_items.end(), name_less);
+
+  std::vector<NameUsageChange> changes;
+  std::vector<bool> previous_found(previous_items.size(), false);
+  for (int i = 0; i < snapshot.items_num; i++) {
+    const MEM_NameUsage &item = snapshot.items[i];
+    NameUsageChange change = {item.name,
+                              int64_t(item.mem_in_use),
+                              int64_t(item.blocks_in_use),
+                              item.allocations_num};
+    const auto previous_item = std::lower_bound(
+        previous_items.begin(), previous_items.end(), item, name_less);
+    if (previous_item != previous_items.end() && strcmp(previous_item->name, item.name) == 0) {
+      previous_found[size_t(previous_item - previous_items.begin())] = true;
+      change.mem_in_use -= int64_t(previous_item->mem_in_use);
+      change.blocks_in_use -= int64_t(previous_item->blocks_in_use);
+      change.allocations_num -= std::min(change.allocations_num, previous_item->allocations_num);
+    }
+    changes.push_back(change);
+  }
+  for (size_t i = 0; i < previous_items.size(); i++) {
+    if (!previous_found[i]) {
+      const MEM_NameUsage &item = previous_items[i];
+      changes.push_back(
+          {item.name, -int64_t(item.mem_in_use), -int64_t(item.blocks_in_use), 0});
+    }
+  }
+  changes.erase(std::remove_if(changes.begin(),
+                               changes.end(),
+                               [](const NameUsageChange &change) {
+                                 return change.mem_in_use == 0 && change.blocks_in_use == 0;
+                               }),
+                changes.end());
+  std::stable_sort(
+      changes.begin(), changes.end(), [](const NameUsageChange &a, const NameUsageChange &b) {
+        return std::abs(a.mem_in_use) > std::abs(b.mem_in_use);
+      });
+
+  printf("\nMemory usage changes by allocation name: %+.3f MB in %+lld blocks\n",
+         to_megabytes(double(snapshot.mem_in_use) - double(previous.mem_in_use)),
+         (long long)(int64_t(snapshot.blocks_in_use) - int64_t(previous.blocks_in_use)));
+  printf("%12s %10s %14s  %s\n", "MB", "blocks", "allocations", "name");
+  for (size_t i = 0; i < std::min(size_t(std::max(items_num, 0)), changes.size()); i++) {
+    const NameUsageChange &change = changes[i];
+    printf("%+12.3f %+10lld %14zu  %s\n",
+           to_megabytes(double(change.mem_in_use)),
+           (long long)change.blocks_in_use,
+           change.allocations_num,
+           change.name);
+  }
+}
+
+void MEM_name_usage_print(const MEM_NameUsageSnapshot *snapshot,
+                          const MEM_NameUsageSnapshot *previous,
+                          const int items_num)
+{
+  if (previous) {
+    name_usage_print_changes(*snapshot, *previous, items_num);
+  }
+  else {
+    name_usage_print(*snapshot, items_num);
+  }
+}
@@ -0,0 +1,448 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup intern_mem
+ *
+ * Thread-local, size-segregated allocator for small memory blocks. This is an optional backend of
+ * the lockfree allocator, see #MEM_use_size_class_allocator. Most allocations in Blender are small
+ * and many of them are done from multiple threads at the same time, which is where general
+ * purpose system allocators tend to spend a lot of time synchronizing.
+ *
+ * Memory is requested from the system in chunks of #CHUNK_SIZE bytes which are aligned to their
+ * size, so that the chunk of a block can be found by masking its address. A chunk only contains
+ * blocks of a single size class and belongs to a single heap. Every thread has its own heap, so
+ * allocating blocks and freeing blocks that were allocated on the same thread does not require
+ * any synchronization. Blocks that are freed on another thread are pushed onto a lock-free list
+ * of the owning heap. The owner reclaims them once it runs out of free blocks.
+ *
+ * The heaps of threads that exit are kept in a pool and are reused by new threads. Blocks that
+ * are allocated after that, while the thread local data of the exiting thread is destructed, come
+ * from a heap that is shared by all threads and protected by a mutex.
+ *
+ * The memory usage includes every chunk that contains at least one block, instead of the size of
+ * the blocks. Empty chunks that are kept for reuse are not counted.
+ */
+
+#include <atomic>
+#include <cassert>
+#include <mutex>
+#include <new>
+#include <stdio.h> /* printf */
+
+#include "MEM_guardedalloc.h"
+#include "mallocn_intern.hh"
+
+/* to ensure strict conversions */
+#include "../../source/blender/blenlib/BLI_strict_flags.h"
+
+namespace {
+
+constexpr size_t CHUNK_SIZE = 64 * 1024;
+/** Space reserved for the #Chunk header at the start of every chunk. */
+constexpr size_t CHUNK_HEADER_SIZE = 64;
+
+constexpr int SIZE_CLASSES_NUM = 20;
+/**
+ * Block sizes of all size classes. They are all multiples of #MEM_SIZE_CLASS_MAX_ALIGNMENT, so
+ * that every block is aligned to it. Above 128 bytes, there are four size classes per power of
+ * two, which limits the wasted space to 25%.
+ */
+constexpr size_t class_sizes[SIZE_CLASSES_NUM] = {16,  32,  48,  64,  80,  96,  112,
+                                                  128, 160, 192, 224, 256, 320, 384,
+                                                  448, 512, 640, 768, 896, 1024};
+static_assert(class_sizes[SIZE_CLASSES_NUM - 1] == MEM_SIZE_CLASS_MAX_SIZE,
+              "Largest size class has to match the maximum size");
+
+/** Maps `(size + 15) / 16` to the smallest size class that fits `size` bytes. */
+struct SizeClassLookup {
+  uint8_t classes[MEM_SIZE_CLASS_MAX_SIZE / 16 + 1];
+
+  constexpr SizeClassLookup() : classes()
+  {
+    size_t size_class = 0;
+    for (size_t i = 0; i < sizeof(classes); i++) {
+      while (class_sizes[size_class] < i * 16) {
+        size_class++;
+      }
+      classes[i] = uint8_t(size_class);
+    }
+  }
+};
+constexpr SizeClassLookup size_class_lookup;
+
+struct FreeBlock {
+  FreeBlock *next;
+};
+
+struct Heap;
+
+/** Header at the start of every chunk. Except for #heap, it is only accessed by its owner. */
+struct Chunk {
+  /** The heap that allocates from this chunk, it never changes. */
+  Heap *heap;
+  /** Neighbors in the list of available or full chunks of the size class in the heap. */
+  Chunk *prev;
+  Chunk *next;
+  /** Blocks that have been freed and can be reused. */
+  FreeBlock *free_list;
+  /** Part of the chunk that has not been used by any block yet. */
+  char *unused_begin;
+  char *unused_end;
+  uint32_t used_blocks_num;
+  uint8_t size_class;
+  /** True when the chunk is in the list of full chunks. */
+  bool is_full;
+};
+static_assert(sizeof(Chunk) <= CHUNK_HEADER_SIZE, "Chunk header does not fit");
+
+/**
+ * Statistics of a size class in one heap. Only the owner of the heap writes them, but other
+ * threads may read them when printing statistics.
+ */
+struct SizeClassStats {
+  std::atomic<int64_t> allocations_num = 0;
+  std::atomic<int64_t> frees_num = 0;
+  std::atomic<int64_t> remote_frees_num = 0;
+
+  static void increment(std::atomic<int64_t> &value)
+  {
+    value.store(value.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+};
+
+/** Align to cache line size to avoid false sharing of #remote_frees. */
+struct alignas(64) Heap {
+  /**
+   * Chunks that have free or unused blocks, per size class. New blocks are always allocated from
+   * the first chunk, which is the only one in the list that may become full.
+   */
+  Chunk *available_chunks[SIZE_CLASSES_NUM] = {};
+  /** Chunks where all blocks are allocated. They are not accessed until a block is freed. */
+  Chunk *full_chunks[SIZE_CLASSES_NUM] = {};
+  /** Blocks allocated from this heap that have been freed by other threads. */
+  std::atomic<FreeBlock *> remote_frees = nullptr;
+  SizeClassStats stats[SIZE_CLASSES_NUM];
+  /** Next heap in the pool of heaps that are not used by any thread. */
+  Heap *next_unused = nullptr;
+  /** Next heap in the list of all heaps, used to gather statistics. */
+  Heap *next = nullptr;
+};
+
+}  // namespace
+
+/** Number of chunks per size class that are currently allocated. */
+static std::atomic<int64_t> chunks_num[SIZE_CLASSES_NUM];
+
+/**
+ * Heaps are never freed, because blocks may outlive the thread that allocated them. The mutex is
+ * only locked when a thread starts or stops using a heap.
+ */
+static std::mutex heaps_mutex;
+static Heap *unused_heaps = nullptr;
+static Heap *all_heaps = nullptr;
+
+/**
+ * Heap for threads that allocate after their own heap has been given back to the pool, e.g. from
+ * destructors of other thread local data. Blocks are only allocated from it with the mutex locked.
+ */
+static std::mutex shared_heap_mutex;
+static Heap *shared_heap = nullptr;
+
+static thread_local Heap *thread_heap = nullptr;
+/** Set when the thread local data below has been destructed, to avoid accessing it again. */
+static thread_local bool thread_heap_released = false;
+
+/** Gives the heap of a thread back to the pool when the thread exits. */
+struct ThreadHeapReleaser {
+  bool is_registered = false;
+
+  ~ThreadHeapReleaser()
+  {
+    thread_heap_released = true;
+    if (thread_heap == nullptr) {
+      return;
+    }
+    std::lock_guard lock{heaps_mutex};
+    thread_heap->next_unused = unused_heaps;
+    unused_heaps = thread_heap;
+    thread_heap = nullptr;
+  }
+};
+static thread_local ThreadHeapReleaser thread_heap_releaser;
+
+static Heap *acquire_thread_heap()
+{
+  assert(!thread_heap_released);
+  {
+    std::lock_guard lock{heaps_mutex};
+    if (unused_heaps) {
+      thread_heap = unused_heaps;
+      unused_heaps = unused_heaps->next_unused;
+    }
+    else {
+      thread_heap = new Heap();
+      thread_heap->next = all_heaps;
+      all_heaps = thread_heap;
+    }
+  }
+  thread_heap_releaser.is_registered = true;
+  return thread_heap;
+}
+
+static Chunk *chunk_from_block(const void *block)
+{
+  return reinterpret_cast<Chunk *>(uintptr_t(block) & ~uintptr_t(CHUNK_SIZE - 1));
+}
+
+static void chunk_list_remove(Chunk *&list, Chunk *chunk)
+{
+  if (chunk->prev) {
+    chunk->prev->next = chunk->next;
+  }
+  else {
+    list = chunk->next;
+  }
+  if (chunk->next) {
+    chunk->next->prev = chunk->prev;
+  }
+}
+
+static void chunk_list_insert_after(Chunk *&list, Chunk *prev, Chunk *chunk)
+{
+  chunk->prev = prev;
+  Chunk *&link = prev ? prev->next : list;
+  chunk->next = link;
+  if (link) {
+    link->prev = chunk;
+  }
+  link = chunk;
+}
+
+static Chunk *chunk_create(Heap &heap, const uint8_t size_class)
+{
+  char *memory = static_cast<char *>(aligned_malloc(CHUNK_SIZE, CHUNK_SIZE));
+  if (UNLIKELY(memory == nullptr)) {
+    return nullptr;
+  }
+  const size_t block_size = class_sizes[size_class];
+  Chunk *chunk = reinterpret_cast<Chunk *>(memory);
+  chunk->heap = &heap;
+  chunk->prev = nullptr;
+  chunk->next = nullptr;
+  chunk->free_list = nullptr;
+  chunk->unused_begin = memory + CHUNK_HEADER_SIZE;
+  chunk->unused_end = memory + CHUNK_SIZE - (CHUNK_SIZE - CHUNK_HEADER_SIZE) % block_size;
+  chunk->used_blocks_num = 0;
+  chunk->size_class = size_class;
+  chunk->is_full = false;
+  chunks_num[size_class].fetch_add(1, std::memory_order_relaxed);
+  return chunk;
+}
+
+static void chunk_free(Chunk *chunk)
+{
+  chunks_num[chunk->size_class].fetch_sub(1, std::memory_order_relaxed);
+  aligned_free(chunk);
+}
+
+static void chunk_add_used_block(Chunk &chunk)
+{
+  if (chunk.used_blocks_num++ == 0) {
+    memory_usage_overhead_add(int64_t(CHUNK_SIZE));
+  }
+}
+
+static void *chunk_alloc_block(Chunk &chunk)
+{
+  if (FreeBlock *block = chunk.free_list) {
+    chunk.free_list = block->next;
+    chunk_add_used_block(chunk);
+    return block;
+  }
+  if (chunk.unused_begin != chunk.unused_end) {
+    void *block = chunk.unused_begin;
+    chunk.unused_begin += class_sizes[chunk.size_class];
+    chunk_add_used_block(chunk);
+    return block;
+  }
+  return nullptr;
+}
+
+/** Free a block of a chunk that belongs to the heap of the current thread. */
+static void free_local_block(Heap &heap, Chunk *chunk, void *ptr)
+{
+  FreeBlock *block = static_cast<FreeBlock *>(ptr);
+  block->next = chunk->free_list;
+  chunk->free_list = block;
+  if (--chunk->used_blocks_num == 0) {
+    memory_usage_overhead_add(-int64_t(CHUNK_SIZE));
+  }
+
+  const uint8_t size_class = chunk->size_class;
+  if (chunk->is_full) {
+    /* Make the chunk available again, but keep allocating from the current first chunk. */
+    chunk_list_remove(heap.full_chunks[size_class], chunk);
+    chunk->is_full = false;
+    Chunk *&available = heap.available_chunks[size_class];
+    chunk_list_insert_after(available, available, chunk);
+  }
+  else if (chunk->used_blocks_num == 0 && chunk != heap.available_chunks[size_class]) {
+    /* The first chunk is kept even when it is empty, to avoid freeing and allocating chunks all
+     * the time when a single block is allocated and freed repeatedly. */
+    chunk_list_remove(heap.available_chunks[size_class], chunk);
+    chunk_free(chunk);
+  }
+}
+
+static void reclaim_remote_frees(Heap &heap)
+{
+  FreeBlock *block = heap.remote_frees.exchange(nullptr, std::memory_order_acquire);
+  while (block) {
+    FreeBlock *next = block->next;
+    Chunk *chunk = chunk_from_block(block);
+    SizeClassStats &stats = heap.stats[chunk->size_class];
+    SizeClassStats::increment(stats.frees_num);
+    SizeClassStats::increment(stats.remote_frees_num);
+    free_local_block(heap, chunk, block);
+    block = next;
+  }
+}
+
+static void *mem_size_class_malloc_slow(Heap &heap, const uint8_t size_class)
+{
+  reclaim_remote_frees(heap);
+
+  Chunk *&available = heap.available_chunks[size_class];
+  while (Chunk *chunk = available) {
+    if (void *block = chunk_alloc_block(*chunk)) {
+      return block;
+    }
+    /* Only the first chunk can be full, so the next one is guaranteed to have space. */
+    chunk_list_remove(available, chunk);
+    chunk->is_full = true;
+    chunk_list_insert_after(heap.full_chunks[size_class], nullptr, chunk);
+  }
+
+  Chunk *chunk = chunk_create(heap, size_class);
+  if (UNLIKELY(chunk == nullptr)) {
+    return nullptr;
+  }
+  chunk_list_insert_after(available, nullptr, chunk);
+  return chunk_alloc_block(*chunk);
+}
+
+static void *heap_alloc_block(Heap &heap, const uint8_t size_class)
+{
+  void *block = nullptr;
+  if (Chunk *chunk = heap.available_chunks[size_class]) {
+    block = chunk_alloc_block(*chunk);
+  }
+  if (UNLIKELY(block == nullptr)) {
+    block = mem_size_class_malloc_slow(heap, size_class);
+    if (UNLIKELY(block == nullptr)) {
+      return nullptr;
+    }
+  }
+  SizeClassStats::increment(heap.stats[size_class].allocations_num);
+  return block;
+}
+
+/**
+ * The heap of the thread would never be given back to the pool after its releaser has run, so
+ * allocate from the shared heap instead. Since it is not the heap of any thread, all blocks are
+ * freed through #Heap::remote_frees.
+ */
+static void *mem_size_class_malloc_shared(const uint8_t size_class)
+{
+  std::lock_guard lock{shared_heap_mutex};
+  if (shared_heap == nullptr) {
+    shared_heap = new Heap();
+    std::lock_guard heaps_lock{heaps_mutex};
+    shared_heap->next = all_heaps;
+    all_heaps = shared_heap;
+  }
+  return heap_alloc_block(*shared_heap, size_class);
+}
+
+void *mem_size_class_malloc(const size_t size)
+{
+  assert(size > 0 && size <= MEM_SIZE_CLASS_MAX_SIZE);
+  const uint8_t size_class = size_class_lookup.classes[(size + 15) / 16];
+  Heap *heap = thread_heap;
+  if (UNLIKELY(heap == nullptr)) {
+    if (UNLIKELY(thread_heap_released)) {
+      return mem_size_class_malloc_shared(size_class);
+    }
+    heap = acquire_thread_heap();
+  }
+  return heap_alloc_block(*heap, size_class);
+}
+
+void mem_size_class_free(void *ptr)
+{
+  Chunk *chunk = chunk_from_block(ptr);
+  Heap *heap = chunk->heap;
+  if (LIKELY(heap == thread_heap)) {
+    SizeClassStats::increment(heap->stats[chunk->size_class].frees_num);
+    free_local_block(*heap, chunk, ptr);
+    return;
+  }
+  /* The block belongs to another thread, it is reclaimed by that thread later. */
+  FreeBlock *block = static_cast<FreeBlock *>(ptr);
+  FreeBlock *head = heap->remote_frees.load(std::memory_order_relaxed);
+  do {
+    block->next = head;
+  } while (!heap->remote_frees.compare_exchange_weak(
+      head, block, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void mem_size_class_print_stats()
+{
+  int64_t allocations_num[SIZE_CLASSES_NUM] = {};
+  int64_t frees_num[SIZE_CLASSES_NUM] = {};
+  int64_t remote_frees_num[SIZE_CLASSES_NUM] = {};
+  {
+    std::lock_guard lock{heaps_mutex};
+    for (const Heap *heap = all_heaps; heap; heap = heap->next) {
+      for (int i = 0; i < SIZE_CLASSES_NUM; i++) {
+        allocations_num[i] += heap->stats[i].allocations_num.load(std::memory_order_relaxed);
+        frees_num[i] += heap->stats[i].frees_num.load(std::memory_order_relaxed);
+        remote_frees_num[i] += heap->stats[i].remote_frees_num.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  printf("\nSize class allocator statistics:\n");
+  printf("%6s %8s %10s %10s %14s %14s\n",
+         "size",
+         "chunks",
+         "blocks",
+         "usage",
+         "allocations",
+         "remote frees");
+  int64_t total_chunks_num = 0;
+  for (int i = 0; i < SIZE_CLASSES_NUM; i++) {
+    const int64_t class_chunks_num = chunks_num[i].load(std::memory_order_relaxed);
+    if (class_chunks_num == 0 && allocations_num[i] == 0) {
+      continue;
+    }
+    total_chunks_num += class_chunks_num;
+    const int64_t blocks_num = allocations_num[i] - frees_num[i];
+    const size_t blocks_per_chunk = (CHUNK_SIZE - CHUNK_HEADER_SIZE) / class_sizes[i];
+    const double usage = class_chunks_num > 0 ?
+                             double(blocks_num) / double(size_t(class_chunks_num) *
+                                                         blocks_per_chunk) :
+                             0.0;
+    printf("%6zu %8lld %10lld %9.1f%% %14lld %14lld\n",
+           class_sizes[i],
+           (long long)class_chunks_num,
+           (long long)blocks_num,
+           usage * 100.0,
+           (long long)allocations_num[i],
+           (long long)remote_frees_num[i]);
+  }
+  printf("total chunk memory: %.3f MB\n",
+         double(total_chunks_num) * double(CHUNK_SIZE) / double(1024 * 1024));
+}
@@ -226,6 +226,21 @@ void memory_usage_block_free(const size_t size)
   }
 }
 
+void memory_usage_overhead_add(const int64_t size)
+{
+  if (LIKELY(use_local_counters.load(std::memory_order_relaxed))) {
+    Local &local = get_local_data();
+    local.mem_in_use.fetch_add(size, std::memory_order_relaxed);
+    if (local.mem_in_use - local.mem_in_use_during_peak_update > peak_update_threshold) {
+      update_global_peak();
+    }
+  }
+  else {
+    Global &global = get_global();
+    global.mem_in_use_outside_locals.fetch_add(size, std::memory_order_relaxed);
+  }
+}
+
 size_t memory_usage_block_num()
 {
   Global &global = get_global();
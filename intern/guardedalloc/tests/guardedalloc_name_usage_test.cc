@@ -0,0 +1,198 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0 */
+
+#include "testing/testing.h"
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "MEM_guardedalloc.h"
+
+#include "guardedalloc_test_base.h"
+
+namespace {
+
+class NameUsageTest : public LockFreeAllocatorTest {
+ protected:
+  void SetUp() override
+  {
+    LockFreeAllocatorTest::SetUp();
+    MEM_set_name_usage_tracking(true);
+  }
+
+  void TearDown() override
+  {
+    MEM_set_name_usage_tracking(false);
+  }
+};
+
+const MEM_NameUsage *FindName(const MEM_NameUsageSnapshot *snapshot, const char *name)
+{
+  for (int i = 0; i < snapshot->items_num; i++) {
+    if (strcmp(snapshot->items[i].name, name) == 0) {
+      return &snapshot->items[i];
+    }
+  }
+  return nullptr;
+}
+
+size_t MemInUse(const MEM_NameUsageSnapshot *snapshot, const char *name)
+{
+  const MEM_NameUsage *item = FindName(snapshot, name);
+  return item ? item->mem_in_use : 0;
+}
+
+}  // namespace
+
+TEST_F(NameUsageTest, AllocFree)
+{
+  void *a = MEM_mallocN(100, "NameUsageTest a");
+  void *b = MEM_callocN(200, "NameUsageTest b");
+  void *c = MEM_mallocN_aligned(300, 64, "NameUsageTest c");
+  EXPECT_EQ(size_t(c) % 64, 0);
+  EXPECT_EQ(MEM_allocN_len(a), 100);
+
+  MEM_NameUsageSnapshot *snapshot = MEM_name_usage_snapshot();
+  EXPECT_EQ(MemInUse(snapshot, "NameUsageTest a"), 100);
+  EXPECT_EQ(MemInUse(snapshot, "NameUsageTest b"), 200);
+  EXPECT_EQ(MemInUse(snapshot, "NameUsageTest c"), 300);
+  EXPECT_EQ(FindName(snapshot, "NameUsageTest a")->blocks_in_use, 1);
+  for (int i = 1; i < snapshot->items_num; i++) {
+    EXPECT_GE(snapshot->items[i - 1].mem_in_use, snapshot->items[i].mem_in_use);
+  }
+  MEM_name_usage_snapshot_free(snapshot);
+
+  MEM_freeN(a);
+  MEM_freeN(b);
+  MEM_freeN(c);
+  snapshot = MEM_name_usage_snapshot();
+  EXPECT_EQ(MemInUse(snapshot, "NameUsageTest a"), 0);
+  EXPECT_EQ(FindName(snapshot, "NameUsageTest a")->allocations_num, 1);
+  MEM_name_usage_snapshot_free(snapshot);
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), 0);
+}
+
+TEST_F(NameUsageTest, ReallocKeepsName)
+{
+  void *a = MEM_mallocN(16, "NameUsageTest realloc");
+  memset(a, 7, 16);
+  a = MEM_reallocN(a, 1000);
+  EXPECT_EQ(static_cast<char *>(a)[15], 7);
+  void *b = MEM_dupallocN(a);
+
+  MEM_NameUsageSnapshot *snapshot = MEM_name_usage_snapshot();
+  EXPECT_EQ(MemInUse(snapshot, "NameUsageTest realloc"), 2000);
+  MEM_name_usage_snapshot_free(snapshot);
+  MEM_freeN(a);
+  MEM_freeN(b);
+}
+
+TEST_F(NameUsageTest, MergeEqualNames)
+{
+  /* Equal names at different addresses are reported together. */
+  static const char name1[] = "NameUsageTest merged";
+  static const char name2[] = "NameUsageTest merged";
+  ASSERT_NE(static_cast<const void *>(name1), static_cast<const void *>(name2));
+  void *a = MEM_mallocN(10, name1);
+  void *b = MEM_mallocN(20, name2);
+
+  MEM_NameUsageSnapshot *snapshot = MEM_name_usage_snapshot();
+  EXPECT_EQ(MemInUse(snapshot, name1), 32);
+  EXPECT_EQ(FindName(snapshot, name1)->blocks_in_use, 2);
+  MEM_name_usage_snapshot_free(snapshot);
+  MEM_freeN(a);
+  MEM_freeN(b);
+}
+
+TEST_F(NameUsageTest, UntrackedBlocks)
+{
+  /* Blocks allocated before tracking was enabled can still be freed. */
+  MEM_set_name_usage_tracking(false);
+  void *a = MEM_mallocN(100, "NameUsageTest untracked");
+  MEM_set_name_usage_tracking(true);
+  a = MEM_reallocN(a, 200);
+  void *b = MEM_mallocN(100, "NameUsageTest untracked");
+  MEM_set_name_usage_tracking(false);
+
+  MEM_NameUsageSnapshot *snapshot = MEM_name_usage_snapshot();
+  EXPECT_EQ(MemInUse(snapshot, "NameUsageTest untracked"), 100);
+  MEM_name_usage_snapshot_free(snapshot);
+  MEM_freeN(a);
+  MEM_freeN(b);
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), 0);
+}
+
+TEST_F(NameUsageTest, UnnamedBlocks)
+{
+  MEM_NameUsageSnapshot *before = MEM_name_usage_snapshot();
+  void *a = MEM_mallocN(100, nullptr);
+  void *b = MEM_mallocN(200, nullptr);
+  MEM_NameUsageSnapshot *after = MEM_name_usage_snapshot();
+  EXPECT_EQ(MemInUse(after, "(unnamed)") - MemInUse(before, "(unnamed)"), 300);
+  MEM_name_usage_snapshot_free(before);
+  MEM_name_usage_snapshot_free(after);
+  MEM_freeN(a);
+  MEM_freeN(b);
+}
+
+TEST_F(NameUsageTest, Threads)
+{
+  std::vector<std::vector<void *>> blocks_by_thread(4);
+  std::vector<std::thread> threads;
+  for (std::vector<void *> &blocks : blocks_by_thread) {
+    threads.emplace_back([&blocks]() {
+      for (int i = 0; i < 10000; i++) {
+        void *ptr = MEM_mallocN(8, "NameUsageTest threads");
+        if (i % 2 == 0) {
+          MEM_freeN(ptr);
+        }
+        else {
+          blocks.push_back(ptr);
+        }
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  MEM_NameUsageSnapshot *snapshot = MEM_name_usage_snapshot();
+  const MEM_NameUsage *item = FindName(snapshot, "NameUsageTest threads");
+  EXPECT_EQ(item->mem_in_use, 4 * 5000 * 8);
+  EXPECT_EQ(item->blocks_in_use, 4 * 5000);
+  EXPECT_EQ(item->allocations_num, 4 * 10000);
+  MEM_name_usage_snapshot_free(snapshot);
+  for (std::vector<void *> &blocks : blocks_by_thread) {
+    for (void *ptr : blocks) {
+      MEM_freeN(ptr);
+    }
+  }
+}
+
+TEST_F(NameUsageTest, PrintChanges)
+{
+  MEM_NameUsageSnapshot *before = MEM_name_usage_snapshot();
+  void *a = MEM_mallocN(1024 * 1024, "NameUsageTest grows");
+  MEM_NameUsageSnapshot *after = MEM_name_usage_snapshot();
+  EXPECT_EQ(after->mem_in_use - before->mem_in_use, 1024 * 1024);
+  MEM_name_usage_print(after, nullptr, 5);
+  MEM_name_usage_print(after, before, 5);
+  MEM_name_usage_snapshot_free(before);
+  MEM_name_usage_snapshot_free(after);
+  MEM_freeN(a);
+}
+
+class NameUsageGuardedTest : public GuardedAllocatorTest {
+  void TearDown() override
+  {
+    MEM_set_name_usage_tracking(false);
+  }
+};
+
+TEST_F(NameUsageGuardedTest, NotSupported)
+{
+  /* The fully guarded allocator does not count names, so tracking is never reported. */
+  MEM_set_name_usage_tracking(true);
+  EXPECT_FALSE(MEM_get_name_usage_tracking());
+}
@@ -0,0 +1,233 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0 */
+
+#include "testing/testing.h"
+
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BLI_timeit.hh"
+
+#include "MEM_guardedalloc.h"
+
+#include "guardedalloc_test_base.h"
+
+namespace {
+
+/** Fill the block with a pattern that depends on \a seed, so that overlapping blocks are found. */
+void FillBlock(void *ptr, const size_t len, const int seed)
+{
+  for (size_t i = 0; i < len; i++) {
+    static_cast<unsigned char *>(ptr)[i] = (unsigned char)(seed + int(i));
+  }
+}
+
+bool CheckBlock(const void *ptr, const size_t len, const int seed)
+{
+  for (size_t i = 0; i < len; i++) {
+    if (static_cast<const unsigned char *>(ptr)[i] != (unsigned char)(seed + int(i))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/** Allocates and frees many small blocks on multiple threads. */
+void AllocFreeManyBlocks(const int threads_num, const int blocks_num, const int rounds_num)
+{
+  std::vector<std::thread> threads;
+  for (int thread_i = 0; thread_i < threads_num; thread_i++) {
+    threads.emplace_back([&, thread_i]() {
+      std::vector<void *> blocks(size_t(blocks_num), nullptr);
+      for (int round = 0; round < rounds_num; round++) {
+        for (int i = 0; i < blocks_num; i++) {
+          blocks[size_t(i)] = MEM_mallocN(size_t(8 + (i + thread_i) % 200), __func__);
+        }
+        for (int i = 0; i < blocks_num; i++) {
+          MEM_freeN(blocks[size_t(i)]);
+        }
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+}
+
+}  // namespace
+
+TEST_F(SizeClassAllocatorTest, MallocFree)
+{
+  std::vector<void *> blocks;
+  for (int size = 0; size < 2000; size++) {
+    void *ptr = MEM_mallocN(size_t(size), __func__);
+    EXPECT_NE(ptr, nullptr);
+    EXPECT_EQ(size_t(ptr) % MEM_MIN_CPP_ALIGNMENT, 0);
+    EXPECT_GE(MEM_allocN_len(ptr), size_t(size));
+    FillBlock(ptr, size_t(size), size);
+    blocks.push_back(ptr);
+  }
+  for (int size = 0; size < 2000; size++) {
+    EXPECT_TRUE(CheckBlock(blocks[size_t(size)], size_t(size), size));
+    MEM_freeN(blocks[size_t(size)]);
+  }
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), 0);
+  EXPECT_EQ(MEM_get_memory_in_use(), 0);
+}
+
+TEST_F(SizeClassAllocatorTest, MemoryInUseCountsChunks)
+{
+  /* The whole chunk of a small block is in use, but it's released once the block is freed. */
+  void *ptr = MEM_mallocN(10, __func__);
+  EXPECT_GE(MEM_get_memory_in_use(), size_t(64 * 1024));
+  MEM_freeN(ptr);
+  EXPECT_EQ(MEM_get_memory_in_use(), 0);
+
+  /* Large blocks are not allocated in chunks. */
+  ptr = MEM_mallocN(100000, __func__);
+  EXPECT_EQ(MEM_get_memory_in_use(), 100000);
+  MEM_freeN(ptr);
+}
+
+TEST_F(SizeClassAllocatorTest, CallocReuse)
+{
+  /* Freed blocks are reused, make sure that they are cleared nevertheless. */
+  for (int i = 0; i < 100; i++) {
+    void *ptr = MEM_mallocN(100, __func__);
+    memset(ptr, 0xff, 100);
+    MEM_freeN(ptr);
+    unsigned char *zeroed = static_cast<unsigned char *>(MEM_callocN(100, __func__));
+    for (int j = 0; j < 100; j++) {
+      EXPECT_EQ(zeroed[j], 0);
+    }
+    MEM_freeN(zeroed);
+  }
+}
+
+TEST_F(SizeClassAllocatorTest, Realloc)
+{
+  void *ptr = MEM_mallocN(10, __func__);
+  FillBlock(ptr, 10, 3);
+  /* Grow from a small block to one that is allocated by the system allocator. */
+  for (const size_t len : {20, 500, 1000, 5000, 40}) {
+    ptr = MEM_reallocN(ptr, len);
+    EXPECT_TRUE(CheckBlock(ptr, 10, 3));
+    EXPECT_EQ(MEM_allocN_len(ptr), len);
+  }
+  MEM_freeN(ptr);
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), 0);
+}
+
+TEST_F(SizeClassAllocatorTest, CppNewDelete)
+{
+  struct Item {
+    std::string name;
+    int value;
+  };
+  std::vector<Item *> items;
+  for (int i = 0; i < 1000; i++) {
+    items.push_back(MEM_new<Item>(__func__, Item{std::to_string(i), i}));
+  }
+  for (int i = 0; i < 1000; i++) {
+    EXPECT_EQ(items[size_t(i)]->name, std::to_string(i));
+    EXPECT_EQ(items[size_t(i)]->value, i);
+    MEM_delete(items[size_t(i)]);
+  }
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), 0);
+}
+
+TEST_F(SizeClassAllocatorTest, FreeOnOtherThread)
+{
+  constexpr int blocks_num = 20000;
+  std::vector<void *> blocks(blocks_num, nullptr);
+  std::thread producer([&]() {
+    for (int i = 0; i < blocks_num; i++) {
+      blocks[size_t(i)] = MEM_mallocN(size_t(1 + i % 300), __func__);
+      FillBlock(blocks[size_t(i)], size_t(1 + i % 300), i);
+    }
+  });
+  producer.join();
+
+  /* Free every second block on another thread, and the rest on this thread. The producer has
+   * exited already, so its heap is reused by one of the threads. */
+  std::thread consumer([&]() {
+    for (int i = 0; i < blocks_num; i += 2) {
+      EXPECT_TRUE(CheckBlock(blocks[size_t(i)], size_t(1 + i % 300), i));
+      MEM_freeN(blocks[size_t(i)]);
+    }
+  });
+  for (int i = 1; i < blocks_num; i += 2) {
+    EXPECT_TRUE(CheckBlock(blocks[size_t(i)], size_t(1 + i % 300), i));
+    MEM_freeN(blocks[size_t(i)]);
+  }
+  consumer.join();
+
+  /* Blocks that were freed remotely are reused. */
+  AllocFreeManyBlocks(2, 1000, 10);
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), 0);
+}
+
+TEST_F(SizeClassAllocatorTest, AllocDuringThreadExit)
+{
+  struct LateAllocator {
+    std::vector<void *> *blocks = nullptr;
+    ~LateAllocator()
+    {
+      for (int i = 0; i < 100; i++) {
+        void *ptr = MEM_mallocN(size_t(1 + i), __func__);
+        FillBlock(ptr, size_t(1 + i), i);
+        if (i % 2 == 0) {
+          MEM_freeN(ptr);
+        }
+        else {
+          blocks->push_back(ptr);
+        }
+      }
+    }
+  };
+  std::vector<void *> blocks;
+  std::thread thread([&]() {
+    /* Large blocks don't use a heap, but make sure that the memory usage counters of the thread
+     * outlive the allocator below. */
+    MEM_freeN(MEM_mallocN(100000, __func__));
+    /* Constructed before the heap of the thread, so it's destructed after it is given back. */
+    static thread_local LateAllocator late_allocator;
+    late_allocator.blocks = &blocks;
+    MEM_freeN(MEM_mallocN(10, __func__));
+  });
+  thread.join();
+
+  EXPECT_EQ(blocks.size(), 50);
+  for (int i = 0; i < 50; i++) {
+    EXPECT_TRUE(CheckBlock(blocks[size_t(i)], size_t(2 + i * 2), 1 + i * 2));
+    MEM_freeN(blocks[size_t(i)]);
+  }
+  AllocFreeManyBlocks(2, 1000, 10);
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), 0);
+}
+
+TEST_F(SizeClassAllocatorTest, ConcurrentAllocFree)
+{
+  AllocFreeManyBlocks(8, 1000, 20);
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), 0);
+}
+
+/* Compares the size class allocator with the system allocator used by the lockfree allocator. */
+
+/* Disable benchmark by default. */
+#if 0
+TEST_F(SizeClassAllocatorTest, Benchmark)
+{
+  SCOPED_TIMER("size class allocator");
+  AllocFreeManyBlocks(4, 10000, 20);
+}
+
+TEST_F(LockFreeAllocatorTest, Benchmark)
+{
+  SCOPED_TIMER("system allocator");
+  AllocFreeManyBlocks(4, 10000, 20);
+}
+#endif
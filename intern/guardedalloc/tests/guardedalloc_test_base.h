@@ -17,6 +17,14 @@ class LockFreeAllocatorTest : public ::testing::Test {
   }
 };
 
+class SizeClassAllocatorTest : public ::testing::Test {
+ protected:
+  virtual void SetUp()
+  {
+    MEM_use_size_class_allocator();
+  }
+};
+
 class GuardedAllocatorTest : public ::testing::Test {
  protected:
   virtual void SetUp()
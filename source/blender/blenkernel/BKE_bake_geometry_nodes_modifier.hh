@@ -21,6 +21,7 @@ struct NodesModifierData;
 struct Main;
 struct Object;
 struct Scene;
+struct TaskPool;
 
 namespace blender::bke::bake {
 
@@ -41,6 +42,7 @@ enum class CacheStatus {
  */
 struct FrameCache {
   SubFrame frame;
+  /** State that is kept in memory, empty if the frame is loaded lazily, see #load_frame_state. */
   BakeState state;
   /**
    * Used when the baked data is loaded lazily. The meta data either has to be loaded from a file
@@ -75,6 +77,24 @@ struct NodeBakeCache {
   /** Used to avoid checking if a bake exists many times. */
   bool failed_finding_bake = false;
 
+  /** Identifies the frames of this cache that are loaded into the global #memory_cache. */
+  uint64_t memory_cache_id;
+  /** Index of the frame that was loaded most recently, used to detect playback. */
+  std::optional<int> last_loaded_frame_index;
+  /** Frames before this index have been prefetched already. */
+  int prefetch_end_index = 0;
+  /** Loads upcoming frames in the background during playback. */
+  TaskPool *prefetch_pool = nullptr;
+
+  NodeBakeCache();
+  ~NodeBakeCache();
+
+  /** The cache owns the prefetch pool and the frames in the #memory_cache with its identifier. */
+  NodeBakeCache(const NodeBakeCache &other) = delete;
+  NodeBakeCache(NodeBakeCache &&other) = delete;
+  NodeBakeCache &operator=(const NodeBakeCache &other) = delete;
+  NodeBakeCache &operator=(NodeBakeCache &&other) = delete;
+
   /** Range spanning from the first to the last baked frame. */
   IndexRange frame_range() const;
 
@@ -115,6 +135,15 @@ struct ModifierCache {
   void reset_cache(int id);
 };
 
+/**
+ * Get the state of a frame. Baked frames that are loaded lazily are stored in the global
+ * #memory_cache, so that they are freed again when it is full. When frames are loaded in
+ * increasing order during playback, the next frames from disk are loaded in the background.
+ *
+ * \return Null if the baked data can't be loaded.
+ */
+std::shared_ptr<const BakeState> load_frame_state(NodeBakeCache &bake_cache, int frame_index);
+
 /**
  * Reset all simulation caches in the scene, for use when some fundamental change made them
  * impossible to reuse.
@@ -48,9 +48,15 @@ struct BakeState {
 /** Same as #BakeState, but does not own the bake items. */
 struct BakeStateRef {
   Map<int, const BakeItem *> items_by_id;
+  /**
+   * Optionally keeps the referenced state alive, e.g. when it is owned by a cache that may free it
+   * at any time.
+   */
+  std::shared_ptr<const BakeState> owner;
 
   BakeStateRef() = default;
   BakeStateRef(const BakeState &bake_state);
+  BakeStateRef(std::shared_ptr<const BakeState> bake_state);
 };
 
 class GeometryBakeItem : public BakeItem {
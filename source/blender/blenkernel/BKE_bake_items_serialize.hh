@@ -15,6 +15,8 @@
 
 #include "BKE_bake_items.hh"
 
+struct BLI_mmap_file;
+
 namespace blender::bke::bake {
 
 /**
@@ -29,6 +31,21 @@ struct BlobSlice {
   static std::optional<BlobSlice> deserialize(const io::serialize::DictionaryValue &io_slice);
 };
 
+/**
+ * Reversible transformation that is applied to data before it is compressed, to make it more
+ * compressible. See #BlobWriter::write_encoded.
+ */
+enum class BlobFilter : int8_t {
+  None,
+  /** Group the bytes of all components by their significance. */
+  Shuffle,
+  /**
+   * Store the difference to the previous value of 32 bit integer components before shuffling.
+   * Works well for sorted data like offsets.
+   */
+  DeltaShuffle,
+};
+
 /**
  * Abstract base class for loading binary data.
  */
@@ -48,6 +65,25 @@ class BlobReader {
    */
   [[nodiscard]] virtual bool read_as_stream(const BlobSlice &slice,
                                             FunctionRef<bool(std::istream &)> fn) const;
+
+  /**
+   * Get direct access to the data of the given slice without copying it. The data must not be
+   * modified unless the returned sharing info is mutable.
+   * \return Shared ownership to the data, or none if the reader does not support this for the
+   *   slice. In that case #read has to be used instead.
+   */
+  [[nodiscard]] virtual std::optional<ImplicitSharingInfoAndData> read_shared_no_copy(
+      const BlobSlice &slice) const;
+
+  /**
+   * Read and decode data written with #BlobWriter::write_encoded. Compressed data is decompressed
+   * in parallel.
+   * \param size: Expected size of the decoded data in bytes.
+   * \return True on success, otherwise false.
+   */
+  [[nodiscard]] bool read_encoded(const io::serialize::DictionaryValue &io_data,
+                                  int64_t size,
+                                  void *r_data) const;
 };
 
 /**
@@ -56,6 +92,7 @@ class BlobReader {
 class BlobWriter {
  protected:
   int64_t total_written_size_ = 0;
+  bool use_compression_ = false;
 
  public:
   virtual ~BlobWriter() = default;
@@ -75,6 +112,22 @@ class BlobWriter {
   virtual BlobSlice write_as_stream(StringRef file_extension,
                                     FunctionRef<void(std::ostream &)> fn);
 
+  /**
+   * Write the data, compressing it if enabled with #set_use_compression. Compression works on
+   * independent chunks of the data which are compressed in parallel.
+   * \param component_size: Size of the individual values in the data, used by the filter.
+   * \return Identifier for the stored data, to be read with #BlobReader::read_encoded.
+   */
+  std::shared_ptr<io::serialize::DictionaryValue> write_encoded(const void *data,
+                                                                int64_t size,
+                                                                int64_t component_size,
+                                                                BlobFilter filter);
+
+  void set_use_compression(const bool use_compression)
+  {
+    use_compression_ = use_compression;
+  }
+
   int64_t written_size() const
   {
     return total_written_size_;
@@ -107,10 +160,10 @@ class BlobWriteSharing : NonCopyable, NonMovable {
   Map<const ImplicitSharingInfo *, StoredByRuntimeValue> stored_by_runtime_;
 
   /**
-   * Remembers where data was stored based on the hash of the data. This allows us to skip writing
-   * the same array again if it has the same hash.
+   * Remembers where and how data was stored based on the hash of the data. This allows us to skip
+   * writing the same array again if it has the same hash.
    */
-  Map<uint64_t, BlobSlice> slice_by_content_hash_;
+  Map<uint64_t, std::shared_ptr<io::serialize::DictionaryValue>> io_data_by_content_hash_;
 
  public:
   ~BlobWriteSharing();
@@ -131,7 +184,11 @@ class BlobWriteSharing : NonCopyable, NonMovable {
    * Its hash is remembered so that the same data won't be written again.
    */
   [[nodiscard]] std::shared_ptr<io::serialize::DictionaryValue> write_deduplicated(
-      BlobWriter &writer, const void *data, int64_t size_in_bytes);
+      BlobWriter &writer,
+      const void *data,
+      int64_t size_in_bytes,
+      int64_t component_size = 1,
+      BlobFilter filter = BlobFilter::None);
 };
 
 /**
@@ -159,24 +216,49 @@ class BlobReadSharing : NonCopyable, NonMovable {
   [[nodiscard]] std::optional<ImplicitSharingInfoAndData> read_shared(
       const io::serialize::DictionaryValue &io_data,
       FunctionRef<std::optional<ImplicitSharingInfoAndData>()> read_fn) const;
+
+  /**
+   * Free data that is not used anywhere else anymore, e.g. because the frames that used it have
+   * been freed. It is read again when it is needed later.
+   */
+  void remove_unused();
 };
 
 /**
  * A specific #BlobReader that reads from disk.
+ *
+ * Blob files written by #DiskBlobWriter are memory-mapped, so that their data can be referenced
+ * directly with #read_shared_no_copy. Blob files without the binary container header (written by
+ * older versions) are read with regular file IO.
  */
 class DiskBlobReader : public BlobReader {
  private:
   const std::string blobs_dir_;
   mutable Mutex mutex_;
   mutable Map<std::string, std::unique_ptr<fstream>> open_input_streams_;
+  /** Mapped blob files by path, null if the file can't be mapped. */
+  mutable Map<std::string, BLI_mmap_file *> mapped_files_;
 
  public:
   DiskBlobReader(std::string blobs_dir);
+  ~DiskBlobReader() override;
+
   [[nodiscard]] bool read(const BlobSlice &slice, void *r_data) const override;
+  [[nodiscard]] std::optional<ImplicitSharingInfoAndData> read_shared_no_copy(
+      const BlobSlice &slice) const override;
+
+ private:
+  BLI_mmap_file *ensure_mapped_file(StringRefNull blob_path) const;
 };
 
 /**
  * A specific #BlobWriter that writes to a file on disk.
+ *
+ * The blob file is a binary container: a fixed size header, followed by the blobs which are
+ * padded to an alignment suitable for any attribute type, followed by a table with the offset and
+ * size of every blob. The header stores the location of the table. Since slices still use
+ * absolute offsets into the file, the metadata can be read by readers that don't know about the
+ * container.
  */
 class DiskBlobWriter : public BlobWriter {
  private:
@@ -189,16 +271,23 @@ class DiskBlobWriter : public BlobWriter {
   std::fstream blob_stream_;
   /** Current position in the file. */
   int64_t current_offset_ = 0;
+  /** Ranges of all blobs written so far, they are stored in the table at the end of the file. */
+  Vector<IndexRange> blob_ranges_;
   /** Used to generate file names for bake data that is stored in independent files. */
   int independent_file_count_ = 0;
 
  public:
   DiskBlobWriter(std::string blob_dir, std::string base_name);
+  /** Writes the blob table and finalizes the header. */
+  ~DiskBlobWriter() override;
 
   BlobSlice write(const void *data, int64_t size) override;
 
   BlobSlice write_as_stream(StringRef file_extension,
                             FunctionRef<void(std::ostream &)> fn) override;
+
+ private:
+  void write_padding();
 };
 
 /**
@@ -272,6 +272,8 @@ enum {
 
   G_DEBUG_GHOST = (1 << 24),  /* Debug GHOST module. */
   G_DEBUG_WINTAB = (1 << 25), /* Debug Wintab. */
+
+  G_DEBUG_MEMORY_SUMMARY = (1 << 26), /* Print memory usage per allocation name. */
 };
 
 #define G_DEBUG_ALL \
@@ -8,6 +8,7 @@
  * \ingroup bke
  */
 
+#include <array>
 #include <memory>
 #include <variant>
 
@@ -147,6 +148,25 @@ struct MeshGroup {
   int corners_count;
 };
 
+/**
+ * A cached BVH tree of mesh elements. When only positions change, the tree is refit to the new
+ * positions instead of being rebuilt, see #Mesh::tag_positions_changed_no_normals.
+ */
+struct MeshBVHCache {
+  std::unique_ptr<BVHTree, BVHTreeDeleter> tree;
+  /**
+   * The #BLI_bvhtree_surface_area_cost of the tree when it was built, used to decide whether a
+   * refit tree has become too inefficient.
+   */
+  float built_surface_area_cost = 0.0f;
+  /**
+   * The vertex, edge, face, corner and legacy face counts of the mesh the tree was built for. The
+   * tree is only refit when they are unchanged, otherwise its leaves may reference elements that
+   * don't exist anymore.
+   */
+  std::array<int, 5> domain_sizes = {};
+};
+
 struct MeshRuntime {
   /**
    * "Evaluated" mesh owned by this mesh. Used for objects which don't have effective modifiers, so
@@ -195,15 +215,15 @@ struct MeshRuntime {
   /** Cache for triangle to original face index map, accessed with #Mesh::corner_tri_faces(). */
   SharedCache<Array<int>> corner_tri_faces_cache;
 
-  SharedCache<std::unique_ptr<BVHTree, BVHTreeDeleter>> bvh_cache_verts;
-  SharedCache<std::unique_ptr<BVHTree, BVHTreeDeleter>> bvh_cache_edges;
-  SharedCache<std::unique_ptr<BVHTree, BVHTreeDeleter>> bvh_cache_faces;
-  SharedCache<std::unique_ptr<BVHTree, BVHTreeDeleter>> bvh_cache_corner_tris;
-  SharedCache<std::unique_ptr<BVHTree, BVHTreeDeleter>> bvh_cache_corner_tris_no_hidden;
-  SharedCache<std::unique_ptr<BVHTree, BVHTreeDeleter>> bvh_cache_loose_verts;
-  SharedCache<std::unique_ptr<BVHTree, BVHTreeDeleter>> bvh_cache_loose_verts_no_hidden;
-  SharedCache<std::unique_ptr<BVHTree, BVHTreeDeleter>> bvh_cache_loose_edges;
-  SharedCache<std::unique_ptr<BVHTree, BVHTreeDeleter>> bvh_cache_loose_edges_no_hidden;
+  SharedCache<MeshBVHCache> bvh_cache_verts;
+  SharedCache<MeshBVHCache> bvh_cache_edges;
+  SharedCache<MeshBVHCache> bvh_cache_faces;
+  SharedCache<MeshBVHCache> bvh_cache_corner_tris;
+  SharedCache<MeshBVHCache> bvh_cache_corner_tris_no_hidden;
+  SharedCache<MeshBVHCache> bvh_cache_loose_verts;
+  SharedCache<MeshBVHCache> bvh_cache_loose_verts_no_hidden;
+  SharedCache<MeshBVHCache> bvh_cache_loose_edges;
+  SharedCache<MeshBVHCache> bvh_cache_loose_edges_no_hidden;
 
   SharedCache<std::optional<int>> max_material_index;
   SharedCache<VectorSet<int>> used_material_indices;
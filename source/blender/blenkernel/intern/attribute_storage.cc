@@ -406,14 +406,19 @@ static void read_shared_array(BlendDataReader &reader,
                               const ImplicitSharingInfo **sharing_info)
 {
   const char *func = __func__;
-  *sharing_info = BLO_read_shared(&reader, data, [&]() -> const ImplicitSharingInfo * {
-    read_array_data(reader, dna_attr_type, size, data);
-    if (*data == nullptr) {
-      return nullptr;
-    }
-    const CPPType &cpp_type = attribute_type_to_cpp_type(AttrType(dna_attr_type));
-    return MEM_new<ArrayDataImplicitSharing>(func, *data, size, cpp_type);
-  });
+  /* Unknown types are not read, see #read_array_data. */
+  const bool is_known_type = dna_attr_type >= 0 && dna_attr_type <= int8_t(AttrType::String);
+  const size_t expected_size =
+      is_known_type ? attribute_type_to_cpp_type(AttrType(dna_attr_type)).size * size_t(size) : 0;
+  *sharing_info = BLO_read_shared(
+      &reader, data, expected_size, [&]() -> const ImplicitSharingInfo * {
+        read_array_data(reader, dna_attr_type, size, data);
+        if (*data == nullptr) {
+          return nullptr;
+        }
+        const CPPType &cpp_type = attribute_type_to_cpp_type(AttrType(dna_attr_type));
+        return MEM_new<ArrayDataImplicitSharing>(func, *data, size, cpp_type);
+      });
 }
 
 static std::optional<Attribute::DataVariant> read_attr_data(BlendDataReader &reader,
@@ -12,9 +12,13 @@
 #include "DNA_modifier_types.h"
 #include "DNA_node_types.h"
 
+#include "BLI_fileops.hh"
+#include "BLI_hash.hh"
 #include "BLI_listbase.h"
+#include "BLI_memory_cache.hh"
 #include "BLI_path_utils.hh"
 #include "BLI_string.h"
+#include "BLI_task.h"
 
 #include "MOD_nodes.hh"
 
@@ -32,6 +36,77 @@ void BakeNodeCache::reset()
   new (this) BakeNodeCache();
 }
 
+/**
+ * Identifies a lazily loaded frame in the global #memory_cache.
+ */
+class BakeFrameKey : public GenericKey {
+ public:
+  uint64_t bake_cache_id;
+  int frame_index;
+
+  BakeFrameKey(const uint64_t bake_cache_id, const int frame_index)
+      : bake_cache_id(bake_cache_id), frame_index(frame_index)
+  {
+  }
+
+  uint64_t hash() const override
+  {
+    return get_default_hash(this->bake_cache_id, this->frame_index);
+  }
+
+  bool equal_to(const GenericKey &other) const override
+  {
+    if (const auto *other_typed = dynamic_cast<const BakeFrameKey *>(&other)) {
+      return this->bake_cache_id == other_typed->bake_cache_id &&
+             this->frame_index == other_typed->frame_index;
+    }
+    return false;
+  }
+
+  std::unique_ptr<GenericKey> to_storable() const override
+  {
+    return std::make_unique<BakeFrameKey>(*this);
+  }
+};
+
+class LoadedBakeFrame : public memory_cache::CachedValue {
+ public:
+  /** Empty if loading the frame failed. */
+  std::optional<BakeState> state;
+
+  void count_memory(MemoryCounter &memory) const override
+  {
+    if (this->state) {
+      this->state->count_memory(memory);
+    }
+  }
+};
+
+/** Number of frames that are loaded ahead of the current frame during playback. */
+static constexpr int prefetch_frames_num = 4;
+
+NodeBakeCache::NodeBakeCache()
+{
+  static std::atomic<uint64_t> next_id = 0;
+  this->memory_cache_id = next_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+NodeBakeCache::~NodeBakeCache()
+{
+  if (this->prefetch_pool) {
+    BLI_task_pool_cancel(this->prefetch_pool);
+    BLI_task_pool_free(this->prefetch_pool);
+  }
+  if (this->last_loaded_frame_index) {
+    /* Free the loaded frames now instead of waiting until they are removed from the cache. */
+    const uint64_t id = this->memory_cache_id;
+    memory_cache::remove_if([&](const GenericKey &key) {
+      const auto *frame_key = dynamic_cast<const BakeFrameKey *>(&key);
+      return frame_key && frame_key->bake_cache_id == id;
+    });
+  }
+}
+
 void NodeBakeCache::reset()
 {
   std::destroy_at(this);
@@ -48,6 +123,141 @@ IndexRange NodeBakeCache::frame_range() const
   return IndexRange::from_begin_end_inclusive(start_frame, end_frame);
 }
 
+static std::unique_ptr<LoadedBakeFrame> load_frame_from_disk(const StringRefNull meta_path,
+                                                              const StringRefNull blobs_dir,
+                                                              const BlobReadSharing &blob_sharing)
+{
+  auto loaded_frame = std::make_unique<LoadedBakeFrame>();
+  DiskBlobReader blob_reader{blobs_dir};
+  fstream meta_file{meta_path.c_str()};
+  loaded_frame->state = deserialize_bake(meta_file, blob_reader, blob_sharing);
+  return loaded_frame;
+}
+
+static std::unique_ptr<LoadedBakeFrame> load_frame_from_memory(
+    const Span<std::byte> meta_buffer,
+    const BlobReader &blob_reader,
+    const BlobReadSharing &blob_sharing)
+{
+  auto loaded_frame = std::make_unique<LoadedBakeFrame>();
+  const std::string meta_str{reinterpret_cast<const char *>(meta_buffer.data()),
+                             size_t(meta_buffer.size())};
+  std::istringstream meta_stream{meta_str};
+  loaded_frame->state = deserialize_bake(meta_stream, blob_reader, blob_sharing);
+  return loaded_frame;
+}
+
+struct PrefetchFrameTask {
+  uint64_t bake_cache_id;
+  int frame_index;
+  std::string meta_path;
+  std::string blobs_dir;
+  /** Owned by the #NodeBakeCache, which waits for all tasks before freeing it. */
+  const BlobReadSharing *blob_sharing;
+};
+
+static void prefetch_frame_task_run(TaskPool *__restrict pool, void *taskdata)
+{
+  if (BLI_task_pool_current_canceled(pool)) {
+    return;
+  }
+  const PrefetchFrameTask &task = *static_cast<const PrefetchFrameTask *>(taskdata);
+  /* Only the side effect of adding the frame to the cache is needed. */
+  memory_cache::get<LoadedBakeFrame>(BakeFrameKey{task.bake_cache_id, task.frame_index}, [&]() {
+    return load_frame_from_disk(task.meta_path, task.blobs_dir, *task.blob_sharing);
+  });
+}
+
+static void prefetch_frame_task_free(TaskPool *__restrict /*pool*/, void *taskdata)
+{
+  MEM_delete(static_cast<PrefetchFrameTask *>(taskdata));
+}
+
+static void prefetch_frames_after(NodeBakeCache &bake_cache, const int frame_index)
+{
+  const bool is_playing_forward = bake_cache.last_loaded_frame_index == frame_index - 1;
+  bake_cache.last_loaded_frame_index = frame_index;
+  if (!is_playing_forward) {
+    /* After looping or scrubbing, previously prefetched frames may have been freed already. */
+    bake_cache.prefetch_end_index = frame_index + 1;
+    return;
+  }
+  if (!bake_cache.blobs_dir) {
+    return;
+  }
+  const int end_index = std::min<int>(frame_index + 1 + prefetch_frames_num,
+                                      bake_cache.frames.size());
+  const int start_index = std::max(frame_index + 1, bake_cache.prefetch_end_index);
+  if (start_index >= end_index) {
+    return;
+  }
+  if (!bake_cache.prefetch_pool) {
+    bake_cache.prefetch_pool = BLI_task_pool_create_background(nullptr, TASK_PRIORITY_LOW);
+  }
+  for (const int i : IndexRange::from_begin_end(start_index, end_index)) {
+    const FrameCache &frame_cache = *bake_cache.frames[i];
+    const auto *meta_path = frame_cache.meta_data_source ?
+                                std::get_if<std::string>(&*frame_cache.meta_data_source) :
+                                nullptr;
+    if (!meta_path) {
+      continue;
+    }
+    PrefetchFrameTask *task = MEM_new<PrefetchFrameTask>(__func__);
+    task->bake_cache_id = bake_cache.memory_cache_id;
+    task->frame_index = i;
+    task->meta_path = *meta_path;
+    task->blobs_dir = *bake_cache.blobs_dir;
+    task->blob_sharing = bake_cache.blob_sharing.get();
+    BLI_task_pool_push(bake_cache.prefetch_pool,
+                       prefetch_frame_task_run,
+                       task,
+                       true,
+                       prefetch_frame_task_free);
+  }
+  bake_cache.prefetch_end_index = end_index;
+}
+
+std::shared_ptr<const BakeState> load_frame_state(NodeBakeCache &bake_cache, const int frame_index)
+{
+  const FrameCache &frame_cache = *bake_cache.frames[frame_index];
+  if (!frame_cache.meta_data_source) {
+    /* The state is owned by the frame cache, so the returned pointer does not own it. */
+    return std::shared_ptr<const BakeState>(std::shared_ptr<const BakeState>(),
+                                            &frame_cache.state);
+  }
+  if (!bake_cache.blob_sharing) {
+    return nullptr;
+  }
+
+  std::shared_ptr<const LoadedBakeFrame> loaded_frame = memory_cache::get<LoadedBakeFrame>(
+      BakeFrameKey{bake_cache.memory_cache_id, frame_index},
+      [&]() -> std::unique_ptr<LoadedBakeFrame> {
+        if (const auto *meta_buffer = std::get_if<Span<std::byte>>(
+                &*frame_cache.meta_data_source))
+        {
+          if (!bake_cache.memory_blob_reader) {
+            return std::make_unique<LoadedBakeFrame>();
+          }
+          return load_frame_from_memory(
+              *meta_buffer, *bake_cache.memory_blob_reader, *bake_cache.blob_sharing);
+        }
+        const auto *meta_path = std::get_if<std::string>(&*frame_cache.meta_data_source);
+        if (!meta_path || !bake_cache.blobs_dir) {
+          return std::make_unique<LoadedBakeFrame>();
+        }
+        return load_frame_from_disk(*meta_path, *bake_cache.blobs_dir, *bake_cache.blob_sharing);
+      });
+  /* Loading a frame may have freed other frames in the cache. Also free the data that was only
+   * used by them. */
+  bake_cache.blob_sharing->remove_unused();
+  prefetch_frames_after(bake_cache, frame_index);
+
+  if (!loaded_frame->state) {
+    return nullptr;
+  }
+  return std::shared_ptr<const BakeState>(loaded_frame, &*loaded_frame->state);
+}
+
 SimulationNodeCache *ModifierCache::get_simulation_node_cache(const int id)
 {
   std::unique_ptr<SimulationNodeCache> *ptr = this->simulation_cache_by_id.lookup_ptr(id);
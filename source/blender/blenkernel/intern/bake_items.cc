@@ -203,6 +203,12 @@ BakeStateRef::BakeStateRef(const BakeState &bake_state)
   }
 }
 
+BakeStateRef::BakeStateRef(std::shared_ptr<const BakeState> bake_state)
+    : BakeStateRef(*bake_state)
+{
+  this->owner = std::move(bake_state);
+}
+
 void BakeState::count_memory(MemoryCounter &memory) const
 {
   for (const std::unique_ptr<BakeItem> &item : items_by_id.values()) {
@@ -15,11 +15,15 @@
 #include "BKE_pointcloud.hh"
 #include "BKE_volume.hh"
 
+#include "BLI_array.hh"
 #include "BLI_endian_defines.h"
 #include "BLI_listbase.h"
+#include "BLI_math_base.h"
 #include "BLI_math_matrix_types.hh"
+#include "BLI_mmap.h"
 #include "BLI_path_utils.hh"
 #include "BLI_string.h"
+#include "BLI_task.hh"
 
 #include "DNA_object_types.h"
 #include "DNA_volume_types.h"
@@ -27,9 +31,17 @@
 #include "RNA_access.hh"
 #include "RNA_enum_types.hh"
 
+#include <fcntl.h>
 #include <fmt/format.h>
 #include <sstream>
 #include <xxhash.h>
+#include <zstd.h>
+
+#ifndef WIN32
+#  include <unistd.h> /* For close. */
+#else
+#  include <io.h> /* For close. */
+#endif
 
 #ifdef WITH_OPENVDB
 #  include <openvdb/io/Stream.h>
@@ -88,8 +100,366 @@ bool BlobReader::read_as_stream(const BlobSlice &slice, FunctionRef<bool(std::is
   return true;
 }
 
+/**
+ * Data is compressed in chunks of this size, so that compression and decompression can run in
+ * parallel. The size is a multiple of every component size.
+ */
+static constexpr int64_t blob_compression_chunk_size = 1024 * 1024;
+/** Smaller data is not compressed, because the gain does not outweigh the overhead. */
+static constexpr int64_t blob_compression_min_size = 1024;
+static constexpr int blob_compression_level = 3;
+
+static StringRefNull get_blob_filter_io_name(const BlobFilter filter)
+{
+  switch (filter) {
+    case BlobFilter::None:
+      return "none";
+    case BlobFilter::Shuffle:
+      return "shuffle";
+    case BlobFilter::DeltaShuffle:
+      return "delta_shuffle";
+  }
+  BLI_assert_unreachable();
+  return "none";
+}
+
+static std::optional<BlobFilter> get_blob_filter_from_io_name(const StringRef io_name)
+{
+  if (io_name == "none") {
+    return BlobFilter::None;
+  }
+  if (io_name == "shuffle") {
+    return BlobFilter::Shuffle;
+  }
+  if (io_name == "delta_shuffle") {
+    return BlobFilter::DeltaShuffle;
+  }
+  return std::nullopt;
+}
+
+static void shuffle_bytes(const Span<std::byte> src,
+                          const int64_t component_size,
+                          MutableSpan<std::byte> dst)
+{
+  const int64_t components_num = src.size() / component_size;
+  for (const int64_t byte_i : IndexRange(component_size)) {
+    std::byte *dst_bytes = dst.data() + byte_i * components_num;
+    for (const int64_t i : IndexRange(components_num)) {
+      dst_bytes[i] = src[i * component_size + byte_i];
+    }
+  }
+}
+
+static void unshuffle_bytes(const Span<std::byte> src,
+                            const int64_t component_size,
+                            MutableSpan<std::byte> dst)
+{
+  const int64_t components_num = src.size() / component_size;
+  for (const int64_t byte_i : IndexRange(component_size)) {
+    const std::byte *src_bytes = src.data() + byte_i * components_num;
+    for (const int64_t i : IndexRange(components_num)) {
+      dst[i * component_size + byte_i] = src_bytes[i];
+    }
+  }
+}
+
+/**
+ * Apply the filter to a chunk of the data. Every chunk is filtered independently, so that it can
+ * be decoded without the others. Unsigned arithmetic is used so that overflow wraps around.
+ */
+static void blob_filter_apply(const BlobFilter filter,
+                              const int64_t component_size,
+                              const Span<std::byte> src,
+                              Vector<std::byte> &buffer,
+                              MutableSpan<std::byte> dst)
+{
+  switch (filter) {
+    case BlobFilter::None:
+      dst.copy_from(src);
+      break;
+    case BlobFilter::Shuffle:
+      shuffle_bytes(src, component_size, dst);
+      break;
+    case BlobFilter::DeltaShuffle: {
+      BLI_assert(component_size == sizeof(uint32_t));
+      buffer.resize(src.size());
+      const int64_t values_num = src.size() / int64_t(sizeof(uint32_t));
+      uint32_t prev_value = 0;
+      for (const int64_t i : IndexRange(values_num)) {
+        uint32_t value;
+        memcpy(&value, src.data() + i * sizeof(uint32_t), sizeof(uint32_t));
+        const uint32_t delta = value - prev_value;
+        memcpy(buffer.data() + i * sizeof(uint32_t), &delta, sizeof(uint32_t));
+        prev_value = value;
+      }
+      shuffle_bytes(buffer, component_size, dst);
+      break;
+    }
+  }
+}
+
+static void blob_filter_revert(const BlobFilter filter,
+                               const int64_t component_size,
+                               const Span<std::byte> src,
+                               MutableSpan<std::byte> dst)
+{
+  switch (filter) {
+    case BlobFilter::None:
+      dst.copy_from(src);
+      break;
+    case BlobFilter::Shuffle:
+      unshuffle_bytes(src, component_size, dst);
+      break;
+    case BlobFilter::DeltaShuffle: {
+      unshuffle_bytes(src, component_size, dst);
+      const int64_t values_num = dst.size() / int64_t(sizeof(uint32_t));
+      uint32_t prev_value = 0;
+      for (const int64_t i : IndexRange(values_num)) {
+        uint32_t delta;
+        memcpy(&delta, dst.data() + i * sizeof(uint32_t), sizeof(uint32_t));
+        prev_value += delta;
+        memcpy(dst.data() + i * sizeof(uint32_t), &prev_value, sizeof(uint32_t));
+      }
+      break;
+    }
+  }
+}
+
+std::shared_ptr<DictionaryValue> BlobWriter::write_encoded(const void *data,
+                                                           const int64_t size,
+                                                           const int64_t component_size,
+                                                           const BlobFilter filter)
+{
+  BLI_assert(blob_compression_chunk_size % component_size == 0);
+  BLI_assert(filter != BlobFilter::DeltaShuffle || component_size == sizeof(uint32_t));
+  if (!use_compression_ || size < blob_compression_min_size) {
+    return this->write(data, size).serialize();
+  }
+
+  const Span<std::byte> src{static_cast<const std::byte *>(data), size};
+  const int64_t chunks_num = int64_t(divide_ceil_ul(uint64_t(size), blob_compression_chunk_size));
+  Array<Vector<std::byte>> compressed_chunks(chunks_num);
+  std::atomic<bool> compression_failed = false;
+  threading::parallel_for(IndexRange(chunks_num), 1, [&](const IndexRange range) {
+    Vector<std::byte> filtered;
+    Vector<std::byte> buffer;
+    for (const int64_t chunk_i : range) {
+      const Span<std::byte> chunk = src.slice_safe(chunk_i * blob_compression_chunk_size,
+                                                   blob_compression_chunk_size);
+      filtered.resize(chunk.size());
+      blob_filter_apply(filter, component_size, chunk, buffer, filtered);
+
+      Vector<std::byte> &compressed = compressed_chunks[chunk_i];
+      compressed.resize(int64_t(ZSTD_compressBound(size_t(chunk.size()))));
+      const size_t compressed_size = ZSTD_compress(compressed.data(),
+                                                   size_t(compressed.size()),
+                                                   filtered.data(),
+                                                   size_t(filtered.size()),
+                                                   blob_compression_level);
+      if (ZSTD_isError(compressed_size)) {
+        compression_failed = true;
+        return;
+      }
+      compressed.resize(int64_t(compressed_size));
+    }
+  });
+
+  int64_t compressed_size = 0;
+  for (const Vector<std::byte> &compressed : compressed_chunks) {
+    compressed_size += compressed.size();
+  }
+  if (compression_failed || compressed_size >= size) {
+    return this->write(data, size).serialize();
+  }
+
+  /* Write all chunks at once, the zstd frames are found again when reading. */
+  Vector<std::byte> compressed_data;
+  compressed_data.reserve(compressed_size);
+  for (const Vector<std::byte> &compressed : compressed_chunks) {
+    compressed_data.extend(compressed);
+  }
+  const BlobSlice slice = this->write(compressed_data.data(), compressed_data.size());
+
+  std::shared_ptr<DictionaryValue> io_data = slice.serialize();
+  DictionaryValue &io_encoding = *io_data->append_dict("encoding");
+  io_encoding.append_str("compression", "zstd");
+  io_encoding.append_str("filter", get_blob_filter_io_name(filter));
+  io_encoding.append_int("component_size", component_size);
+  io_encoding.append_int("chunk_size", blob_compression_chunk_size);
+  io_encoding.append_int("size", size);
+  return io_data;
+}
+
+bool BlobReader::read_encoded(const DictionaryValue &io_data,
+                              const int64_t size,
+                              void *r_data) const
+{
+  const std::optional<BlobSlice> slice = BlobSlice::deserialize(io_data);
+  if (!slice) {
+    return false;
+  }
+  const DictionaryValue *io_encoding = io_data.lookup_dict("encoding");
+  if (!io_encoding) {
+    if (slice->range.size() != size) {
+      return false;
+    }
+    return this->read(*slice, r_data);
+  }
+
+  if (io_encoding->lookup_str("compression") != "zstd") {
+    return false;
+  }
+  const std::optional<BlobFilter> filter = get_blob_filter_from_io_name(
+      io_encoding->lookup_str("filter").value_or(""));
+  const std::optional<int64_t> component_size = io_encoding->lookup_int("component_size");
+  const std::optional<int64_t> chunk_size = io_encoding->lookup_int("chunk_size");
+  if (!filter || !component_size || !chunk_size) {
+    return false;
+  }
+  if (io_encoding->lookup_int("size") != size) {
+    return false;
+  }
+  if (!ELEM(*component_size, 1, 2, 4, 8) || *chunk_size <= 0 || *chunk_size % *component_size) {
+    return false;
+  }
+  if (*filter == BlobFilter::DeltaShuffle && *component_size != sizeof(uint32_t)) {
+    return false;
+  }
+
+  /* Avoid copying the compressed data if the reader supports it. */
+  Array<std::byte> compressed_buffer;
+  Span<std::byte> compressed;
+  const std::optional<ImplicitSharingInfoAndData> shared_data = this->read_shared_no_copy(*slice);
+  BLI_SCOPED_DEFER([&]() {
+    if (shared_data) {
+      shared_data->sharing_info->remove_user_and_delete_if_last();
+    }
+  });
+  if (shared_data) {
+    compressed = {static_cast<const std::byte *>(shared_data->data), slice->range.size()};
+  }
+  else {
+    compressed_buffer.reinitialize(slice->range.size());
+    if (!this->read(*slice, compressed_buffer.data())) {
+      return false;
+    }
+    compressed = compressed_buffer;
+  }
+
+  /* Find the zstd frame of every chunk. */
+  const int64_t chunks_num = int64_t(divide_ceil_ul(uint64_t(size), uint64_t(*chunk_size)));
+  Array<IndexRange> frames(chunks_num);
+  int64_t offset = 0;
+  for (const int64_t chunk_i : frames.index_range()) {
+    const size_t frame_size = ZSTD_findFrameCompressedSize(compressed.data() + offset,
+                                                           size_t(compressed.size() - offset));
+    if (ZSTD_isError(frame_size)) {
+      return false;
+    }
+    frames[chunk_i] = IndexRange(offset, int64_t(frame_size));
+    offset += int64_t(frame_size);
+  }
+  if (offset != compressed.size()) {
+    return false;
+  }
+
+  const MutableSpan<std::byte> dst{static_cast<std::byte *>(r_data), size};
+  std::atomic<bool> success = true;
+  threading::parallel_for(frames.index_range(), 1, [&](const IndexRange range) {
+    Vector<std::byte> buffer;
+    for (const int64_t chunk_i : range) {
+      const Span<std::byte> frame = compressed.slice(frames[chunk_i]);
+      const MutableSpan<std::byte> dst_chunk = dst.slice_safe(chunk_i * *chunk_size,
+                                                              *chunk_size);
+      /* Without a filter, decompress directly into the destination. */
+      MutableSpan<std::byte> decompressed = dst_chunk;
+      if (*filter != BlobFilter::None) {
+        buffer.resize(dst_chunk.size());
+        decompressed = buffer;
+      }
+      const size_t decompressed_size = ZSTD_decompress(
+          decompressed.data(), size_t(decompressed.size()), frame.data(), size_t(frame.size()));
+      if (ZSTD_isError(decompressed_size) || decompressed_size != size_t(decompressed.size())) {
+        success = false;
+        return;
+      }
+      if (*filter != BlobFilter::None) {
+        blob_filter_revert(*filter, *component_size, decompressed, dst_chunk);
+      }
+    }
+  });
+  return success;
+}
+
+std::optional<ImplicitSharingInfoAndData> BlobReader::read_shared_no_copy(
+    const BlobSlice & /*slice*/) const
+{
+  return std::nullopt;
+}
+
+/**
+ * Header at the start of blob files written by #DiskBlobWriter. Like the blob data, it is always
+ * stored in little endian.
+ */
+struct BlobFileHeader {
+  char magic[8];
+  uint32_t version;
+  /** Every blob starts at a multiple of this alignment. */
+  uint32_t alignment;
+  /** Location of the blob table, zero if writing the file was not finished. */
+  uint64_t table_offset;
+  /** Number of #BlobFileTableEntry in the table. */
+  uint64_t table_size;
+};
+
+/** Entries in the blob table are sorted by offset. Empty blobs are not stored. */
+struct BlobFileTableEntry {
+  uint64_t offset;
+  uint64_t size;
+};
+
+static constexpr char blob_file_magic[8] = {'B', 'L', 'E', 'N', 'B', 'L', 'O', 'B'};
+static constexpr uint32_t blob_file_version = 1;
+/** Large enough for every attribute type and for aligned SIMD loads of referenced data. */
+static constexpr int64_t blob_file_alignment = 64;
+
+static BlobFileHeader blob_file_header_init()
+{
+  BlobFileHeader header{};
+  memcpy(header.magic, blob_file_magic, sizeof(header.magic));
+  header.version = blob_file_version;
+  header.alignment = blob_file_alignment;
+  return header;
+}
+
+static bool blob_file_header_is_valid(const BlobFileHeader &header, const size_t file_size)
+{
+  if (memcmp(header.magic, blob_file_magic, sizeof(header.magic)) != 0) {
+    return false;
+  }
+  if (header.version != blob_file_version || header.alignment == 0) {
+    return false;
+  }
+  if (header.table_offset < sizeof(BlobFileHeader) || header.table_offset > file_size) {
+    return false;
+  }
+  if (header.table_offset % alignof(BlobFileTableEntry) != 0) {
+    return false;
+  }
+  return header.table_size <= (file_size - header.table_offset) / sizeof(BlobFileTableEntry);
+}
+
 DiskBlobReader::DiskBlobReader(std::string blobs_dir) : blobs_dir_(std::move(blobs_dir)) {}
 
+DiskBlobReader::~DiskBlobReader()
+{
+  for (BLI_mmap_file *mapped_file : mapped_files_.values()) {
+    if (mapped_file) {
+      BLI_mmap_free(mapped_file);
+    }
+  }
+}
+
 [[nodiscard]] bool DiskBlobReader::read(const BlobSlice &slice, void *r_data) const
 {
   if (slice.range.is_empty()) {
@@ -111,25 +481,146 @@ DiskBlobReader::DiskBlobReader(std::string blobs_dir) : blobs_dir_(std::move(blo
   return true;
 }
 
+BLI_mmap_file *DiskBlobReader::ensure_mapped_file(const StringRefNull blob_path) const
+{
+  return mapped_files_.lookup_or_add_cb_as(blob_path, [&]() -> BLI_mmap_file * {
+    const int file = BLI_open(blob_path.c_str(), O_BINARY | O_RDONLY, 0);
+    if (file == -1) {
+      return nullptr;
+    }
+    /* Referenced arrays become mutable once the cache is their only user. */
+    BLI_mmap_file *mapped_file = BLI_mmap_open_copy_on_write(file);
+    /* The mapping stays valid when the file is closed. */
+    close(file);
+    if (!mapped_file) {
+      return nullptr;
+    }
+    BlobFileHeader header;
+    if (!BLI_mmap_read(mapped_file, &header, 0, sizeof(header)) ||
+        !blob_file_header_is_valid(header, BLI_mmap_get_length(mapped_file)))
+    {
+      /* Not a blob container (or an unfinished one), the slices can only be copied. */
+      BLI_mmap_free(mapped_file);
+      return nullptr;
+    }
+    return mapped_file;
+  });
+}
+
+std::optional<ImplicitSharingInfoAndData> DiskBlobReader::read_shared_no_copy(
+    const BlobSlice &slice) const
+{
+#ifdef WIN32
+  /* Baked attributes become mutable once the cache is their only user. Without a copy-on-write
+   * mapping, writing to them would fail, so the data is copied with #read instead. */
+  UNUSED_VARS(slice);
+  return std::nullopt;
+#else
+  if (slice.range.is_empty()) {
+    return std::nullopt;
+  }
+
+  char blob_path[FILE_MAX];
+  BLI_path_join(blob_path, sizeof(blob_path), blobs_dir_.c_str(), slice.name.c_str());
+
+  std::lock_guard lock{mutex_};
+  BLI_mmap_file *mapped_file = this->ensure_mapped_file(blob_path);
+  if (!mapped_file || BLI_mmap_any_io_error(mapped_file)) {
+    return std::nullopt;
+  }
+  const std::byte *file_data = static_cast<const std::byte *>(BLI_mmap_get_pointer(mapped_file));
+  const BlobFileHeader &header = *reinterpret_cast<const BlobFileHeader *>(file_data);
+  const Span<BlobFileTableEntry> table{
+      reinterpret_cast<const BlobFileTableEntry *>(file_data + header.table_offset),
+      int64_t(header.table_size)};
+
+  /* Only reference blobs that are known to be in the file, this also validates the slice. */
+  const uint64_t offset = uint64_t(slice.range.start());
+  const BlobFileTableEntry *entry = std::lower_bound(
+      table.begin(), table.end(), offset, [](const BlobFileTableEntry &a, const uint64_t b) {
+        return a.offset < b;
+      });
+  if (entry == table.end() || entry->offset != offset ||
+      entry->size != uint64_t(slice.range.size()))
+  {
+    return std::nullopt;
+  }
+  /* The table isn't trusted, the blob has to be in the data section before the table. The header
+   * check made sure that the table itself is inside of the file. */
+  if (entry->size > header.table_offset || entry->offset > header.table_offset - entry->size ||
+      entry->offset < sizeof(BlobFileHeader))
+  {
+    return std::nullopt;
+  }
+  return ImplicitSharingInfoAndData{implicit_sharing::info_for_mmap(mapped_file),
+                                    file_data + entry->offset};
+#endif
+}
+
 DiskBlobWriter::DiskBlobWriter(std::string blob_dir, std::string base_name)
     : blob_dir_(std::move(blob_dir)), base_name_(std::move(base_name))
 {
   blob_name_ = base_name_ + ".blob";
 }
 
+DiskBlobWriter::~DiskBlobWriter()
+{
+  if (!blob_stream_.is_open()) {
+    return;
+  }
+  this->write_padding();
+  BlobFileHeader header = blob_file_header_init();
+  header.table_offset = uint64_t(current_offset_);
+  header.table_size = uint64_t(blob_ranges_.size());
+  for (const IndexRange range : blob_ranges_) {
+    const BlobFileTableEntry entry{uint64_t(range.start()), uint64_t(range.size())};
+    blob_stream_.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+  }
+  total_written_size_ += blob_ranges_.size() * int64_t(sizeof(BlobFileTableEntry));
+  /* The header is only complete once the table exists. */
+  blob_stream_.seekp(0);
+  blob_stream_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+}
+
+void DiskBlobWriter::write_padding()
+{
+  static constexpr char zeros[blob_file_alignment] = {};
+  const int64_t padding = int64_t(ceil_to_multiple_ul(uint64_t(current_offset_),
+                                                       uint64_t(blob_file_alignment))) -
+                          current_offset_;
+  blob_stream_.write(zeros, padding);
+  current_offset_ += padding;
+  total_written_size_ += padding;
+}
+
 BlobSlice DiskBlobWriter::write(const void *data, const int64_t size)
 {
   if (!blob_stream_.is_open()) {
     char blob_path[FILE_MAX];
     BLI_path_join(blob_path, sizeof(blob_path), blob_dir_.c_str(), blob_name_.c_str());
     BLI_file_ensure_parent_dir_exists(blob_path);
+    /* Create a new file instead of overwriting an existing one, which may still be mapped by a
+     * #DiskBlobReader. */
+    if (BLI_exists(blob_path)) {
+      BLI_delete(blob_path, false, false);
+    }
     blob_stream_.open(blob_path, std::ios::out | std::ios::binary);
+    const BlobFileHeader header = blob_file_header_init();
+    blob_stream_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    current_offset_ = sizeof(header);
+    total_written_size_ += sizeof(header);
   }
 
+  if (size > 0) {
+    this->write_padding();
+  }
   const int64_t old_offset = current_offset_;
   blob_stream_.write(static_cast<const char *>(data), size);
   current_offset_ += size;
   total_written_size_ += size;
+  if (size > 0) {
+    blob_ranges_.append(IndexRange(old_offset, size));
+  }
   return {blob_name_, {old_offset, size}};
 }
 
@@ -253,12 +744,16 @@ DictionaryValuePtr BlobWriteSharing::write_implicitly_shared(
 }
 
 std::shared_ptr<io::serialize::DictionaryValue> BlobWriteSharing::write_deduplicated(
-    BlobWriter &writer, const void *data, const int64_t size_in_bytes)
+    BlobWriter &writer,
+    const void *data,
+    const int64_t size_in_bytes,
+    const int64_t component_size,
+    const BlobFilter filter)
 {
   const uint64_t content_hash = XXH3_64bits(data, size_in_bytes);
-  const BlobSlice slice = slice_by_content_hash_.lookup_or_add_cb(
-      content_hash, [&]() { return writer.write(data, size_in_bytes); });
-  return slice.serialize();
+  return io_data_by_content_hash_.lookup_or_add_cb(content_hash, [&]() {
+    return writer.write_encoded(data, size_in_bytes, component_size, filter);
+  });
 }
 
 std::optional<ImplicitSharingInfoAndData> BlobReadSharing::read_shared(
@@ -287,6 +782,21 @@ std::optional<ImplicitSharingInfoAndData> BlobReadSharing::read_shared(
   return data;
 }
 
+void BlobReadSharing::remove_unused()
+{
+  std::lock_guard lock{mutex_};
+  runtime_by_stored_.remove_if([](const auto item) {
+    const ImplicitSharingInfo *sharing_info = item.value.sharing_info;
+    /* New users are only added while the mutex is locked, so if this is the only user, the data
+     * can't be referenced anymore. */
+    if (sharing_info->is_mutable()) {
+      sharing_info->remove_user_and_delete_if_last();
+      return true;
+    }
+    return false;
+  });
+}
+
 static StringRefNull get_endian_io_name(const int endian)
 {
   BLI_assert(endian == L_ENDIAN);
@@ -333,9 +843,12 @@ static std::shared_ptr<DictionaryValue> write_blob_raw_data_with_endian(
     BlobWriter &blob_writer,
     BlobWriteSharing &blob_sharing,
     const void *data,
-    const int64_t size_in_bytes)
+    const int64_t size_in_bytes,
+    const int64_t component_size,
+    const BlobFilter filter)
 {
-  auto io_data = blob_sharing.write_deduplicated(blob_writer, data, size_in_bytes);
+  auto io_data = blob_sharing.write_deduplicated(
+      blob_writer, data, size_in_bytes, component_size, filter);
   BLI_STATIC_ASSERT(ENDIAN_ORDER == L_ENDIAN, "Blender only builds on little endian systems")
   return io_data;
 }
@@ -351,14 +864,7 @@ static std::shared_ptr<DictionaryValue> write_blob_raw_data_with_endian(
                                                          const int64_t elements_num,
                                                          void *r_data)
 {
-  const std::optional<BlobSlice> slice = BlobSlice::deserialize(io_data);
-  if (!slice) {
-    return false;
-  }
-  if (slice->range.size() != element_size * elements_num) {
-    return false;
-  }
-  if (!blob_reader.read(*slice, r_data)) {
+  if (!blob_reader.read_encoded(io_data, element_size * elements_num, r_data)) {
     return false;
   }
   const StringRefNull stored_endian = io_data.lookup_str("endian").value_or("little");
@@ -387,14 +893,7 @@ static std::shared_ptr<DictionaryValue> write_blob_raw_bytes(BlobWriter &blob_wr
                                               const int64_t bytes_num,
                                               void *r_data)
 {
-  const std::optional<BlobSlice> slice = BlobSlice::deserialize(io_data);
-  if (!slice) {
-    return false;
-  }
-  if (slice->range.size() != bytes_num) {
-    return false;
-  }
-  return blob_reader.read(*slice, r_data);
+  return blob_reader.read_encoded(io_data, bytes_num, r_data);
 }
 
 static std::shared_ptr<DictionaryValue> write_blob_simple_gspan(BlobWriter &blob_writer,
@@ -406,8 +905,19 @@ static std::shared_ptr<DictionaryValue> write_blob_simple_gspan(BlobWriter &blob
   if (type.size == 1 || type.is<ColorGeometry4b>()) {
     return write_blob_raw_bytes(blob_writer, blob_sharing, data.data(), data.size_in_bytes());
   }
+  /* Component sizes match the element sizes used in #read_blob_simple_gspan. */
+  if (type.is_any<int16_t, uint16_t, short2>()) {
+    return write_blob_raw_data_with_endian(
+        blob_writer, blob_sharing, data.data(), data.size_in_bytes(), 2, BlobFilter::Shuffle);
+  }
+  if (type.is_any<int64_t, uint64_t>()) {
+    return write_blob_raw_data_with_endian(
+        blob_writer, blob_sharing, data.data(), data.size_in_bytes(), 8, BlobFilter::Shuffle);
+  }
+  /* Integer arrays are often offsets or indices, which are mostly increasing. */
+  const BlobFilter filter = type.is<int32_t>() ? BlobFilter::DeltaShuffle : BlobFilter::Shuffle;
   return write_blob_raw_data_with_endian(
-      blob_writer, blob_sharing, data.data(), data.size_in_bytes());
+      blob_writer, blob_sharing, data.data(), data.size_in_bytes(), 4, filter);
 }
 
 [[nodiscard]] static bool read_blob_simple_gspan(const BlobReader &blob_reader,
@@ -450,6 +960,42 @@ static std::shared_ptr<DictionaryValue> write_blob_simple_gspan(BlobWriter &blob
   return false;
 }
 
+/**
+ * Reference the stored data directly if the blob reader supports it and the data does not have to
+ * be converted when it is loaded.
+ */
+static std::optional<ImplicitSharingInfoAndData> read_blob_simple_gspan_no_copy(
+    const BlobReader &blob_reader,
+    const DictionaryValue &io_data,
+    const CPPType &cpp_type,
+    const int64_t size)
+{
+  BLI_assert(cpp_type.is_trivial);
+  if (io_data.lookup_dict("encoding")) {
+    return std::nullopt;
+  }
+  const std::optional<BlobSlice> slice = BlobSlice::deserialize(io_data);
+  if (!slice) {
+    return std::nullopt;
+  }
+  if (slice->range.size() != cpp_type.size * size) {
+    return std::nullopt;
+  }
+  const StringRefNull stored_endian = io_data.lookup_str("endian").value_or("little");
+  if (stored_endian != get_endian_io_name(ENDIAN_ORDER)) {
+    return std::nullopt;
+  }
+  std::optional<ImplicitSharingInfoAndData> data = blob_reader.read_shared_no_copy(*slice);
+  if (!data) {
+    return std::nullopt;
+  }
+  if (uintptr_t(data->data) % uintptr_t(cpp_type.alignment) != 0) {
+    data->sharing_info->remove_user_and_delete_if_last();
+    return std::nullopt;
+  }
+  return data;
+}
+
 static std::shared_ptr<DictionaryValue> write_blob_shared_simple_gspan(
     BlobWriter &blob_writer,
     BlobWriteSharing &blob_sharing,
@@ -471,6 +1017,11 @@ static std::shared_ptr<DictionaryValue> write_blob_shared_simple_gspan(
   const char *func = __func__;
   const std::optional<ImplicitSharingInfoAndData> sharing_info_and_data = blob_sharing.read_shared(
       io_data, [&]() -> std::optional<ImplicitSharingInfoAndData> {
+        if (std::optional<ImplicitSharingInfoAndData> data = read_blob_simple_gspan_no_copy(
+                blob_reader, io_data, cpp_type, size))
+        {
+          return data;
+        }
         void *data_mem = MEM_mallocN_aligned(size * cpp_type.size, cpp_type.alignment, func);
         if (!read_blob_simple_gspan(blob_reader, io_data, {cpp_type, data_mem, size})) {
           MEM_freeN(data_mem);
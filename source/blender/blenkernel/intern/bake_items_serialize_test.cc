@@ -0,0 +1,150 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+#include "testing/testing.h"
+#include "testing/testing_temp_dir.h"
+
+#include "BLI_array.hh"
+#include "BLI_fileops.hh"
+#include "BLI_path_utils.hh"
+
+#include "BKE_bake_items_serialize.hh"
+
+#include <sstream>
+
+namespace blender::bke::bake::tests {
+
+using DiskBlobTest = blender::tests::TempDirTest;
+
+TEST_F(DiskBlobTest, write_and_read)
+{
+  Array<float> data_a(1000);
+  Array<int> data_b(7);
+  for (const int i : data_a.index_range()) {
+    data_a[i] = float(i) * 0.5f;
+  }
+  for (const int i : data_b.index_range()) {
+    data_b[i] = i * 3;
+  }
+
+  BlobSlice slice_a;
+  BlobSlice slice_b;
+  {
+    DiskBlobWriter writer{temp_dir(), "0001"};
+    slice_a = writer.write(data_a.data(), data_a.as_span().size_in_bytes());
+    slice_b = writer.write(data_b.data(), data_b.as_span().size_in_bytes());
+  }
+
+  DiskBlobReader reader{temp_dir()};
+  Array<float> read_a(data_a.size());
+  Array<int> read_b(data_b.size());
+  EXPECT_TRUE(reader.read(slice_a, read_a.data()));
+  EXPECT_TRUE(reader.read(slice_b, read_b.data()));
+  EXPECT_EQ_SPAN(data_a.as_span(), read_a.as_span());
+  EXPECT_EQ_SPAN(data_b.as_span(), read_b.as_span());
+
+#ifndef WIN32
+  const std::optional<ImplicitSharingInfoAndData> shared_b = reader.read_shared_no_copy(slice_b);
+  ASSERT_TRUE(shared_b.has_value());
+  EXPECT_EQ(uintptr_t(shared_b->data) % 64, 0);
+  EXPECT_EQ_SPAN(data_b.as_span(),
+                 Span(static_cast<const int *>(shared_b->data), data_b.size()));
+  shared_b->sharing_info->remove_user_and_delete_if_last();
+
+  /* Slices that don't match a stored blob exactly are not referenced. */
+  BlobSlice partial_slice = slice_a;
+  partial_slice.range = partial_slice.range.drop_back(4);
+  EXPECT_FALSE(reader.read_shared_no_copy(partial_slice).has_value());
+#endif
+}
+
+TEST_F(DiskBlobTest, corrupt_blob_table)
+{
+#ifndef WIN32
+  const Array<int> data(1000, 7);
+  BlobSlice slice;
+  {
+    DiskBlobWriter writer{temp_dir(), "0001"};
+    slice = writer.write(data.data(), data.as_span().size_in_bytes());
+  }
+  char blob_path[FILE_MAX];
+  BLI_path_join(blob_path, sizeof(blob_path), temp_dir().c_str(), slice.name.c_str());
+
+  /* Make the only entry in the table extend past the end of the file, like the slice. */
+  const uint64_t corrupt_size = uint64_t(1) << 40;
+  {
+    fstream stream{blob_path, std::ios::in | std::ios::out | std::ios::binary};
+    uint64_t table_offset;
+    stream.seekg(16);
+    stream.read(reinterpret_cast<char *>(&table_offset), sizeof(table_offset));
+    stream.seekp(std::streamoff(table_offset + sizeof(uint64_t)));
+    stream.write(reinterpret_cast<const char *>(&corrupt_size), sizeof(corrupt_size));
+  }
+
+  BlobSlice corrupt_slice = slice;
+  corrupt_slice.range = IndexRange(slice.range.start(), int64_t(corrupt_size));
+  DiskBlobReader reader{temp_dir()};
+  EXPECT_FALSE(reader.read_shared_no_copy(corrupt_slice).has_value());
+#endif
+}
+
+TEST_F(DiskBlobTest, read_legacy_file)
+{
+  /* Blob files without the container header are still readable, but can't be referenced. */
+  const Array<int> data = {1, 2, 3, 4, 5};
+  char blob_path[FILE_MAX];
+  BLI_path_join(blob_path, sizeof(blob_path), temp_dir().c_str(), "legacy.blob");
+  {
+    fstream stream{blob_path, std::ios::out | std::ios::binary};
+    stream.write(reinterpret_cast<const char *>(data.data()), data.as_span().size_in_bytes());
+  }
+
+  const BlobSlice slice{"legacy.blob", IndexRange(data.as_span().size_in_bytes())};
+  DiskBlobReader reader{temp_dir()};
+  Array<int> read_data(data.size());
+  EXPECT_TRUE(reader.read(slice, read_data.data()));
+  EXPECT_EQ_SPAN(data.as_span(), read_data.as_span());
+  EXPECT_FALSE(reader.read_shared_no_copy(slice).has_value());
+}
+
+TEST(bake_blob, compressed_round_trip)
+{
+  Array<float> positions(300000);
+  Array<int> offsets(200001);
+  for (const int i : positions.index_range()) {
+    positions[i] = float(i % 1000) * 0.01f;
+  }
+  for (const int i : offsets.index_range()) {
+    offsets[i] = i * 4;
+  }
+
+  MemoryBlobWriter writer{"0001"};
+  writer.set_use_compression(true);
+  const auto io_positions = writer.write_encoded(
+      positions.data(), positions.as_span().size_in_bytes(), 4, BlobFilter::Shuffle);
+  const auto io_offsets = writer.write_encoded(
+      offsets.data(), offsets.as_span().size_in_bytes(), 4, BlobFilter::DeltaShuffle);
+  EXPECT_NE(io_positions->lookup_dict("encoding"), nullptr);
+  EXPECT_NE(io_offsets->lookup_dict("encoding"), nullptr);
+  EXPECT_LT(writer.written_size(),
+            (positions.as_span().size_in_bytes() + offsets.as_span().size_in_bytes()) / 3);
+
+  const std::string blob = writer.get_stream_by_name().lookup("0001.blob").stream->str();
+  MemoryBlobReader reader;
+  reader.add("0001.blob", Span(reinterpret_cast<const std::byte *>(blob.data()), blob.size()));
+
+  Array<float> read_positions(positions.size());
+  Array<int> read_offsets(offsets.size());
+  EXPECT_TRUE(reader.read_encoded(
+      *io_positions, read_positions.as_span().size_in_bytes(), read_positions.data()));
+  EXPECT_TRUE(reader.read_encoded(
+      *io_offsets, read_offsets.as_span().size_in_bytes(), read_offsets.data()));
+  EXPECT_EQ_SPAN(positions.as_span(), read_positions.as_span());
+  EXPECT_EQ_SPAN(offsets.as_span(), read_offsets.as_span());
+
+  /* The expected size is validated. */
+  EXPECT_FALSE(reader.read_encoded(*io_offsets, 16, read_offsets.data()));
+}
+
+}  // namespace blender::bke::bake::tests
@@ -637,6 +637,103 @@ static BitVector<> loose_edges_no_hidden_mask_get(const Mesh &mesh)
   return edge_mask;
 }
 
+/**
+ * Refitting a tree after a deformation is much faster than building a new one, but can make
+ * queries slower when elements move a lot relative to each other. Rebuild the tree when its
+ * expected query cost grew by more than this factor compared to the freshly built tree.
+ */
+static constexpr float bvh_refit_max_cost_factor = 1.5f;
+
+static std::array<int, 5> bvh_domain_sizes(const Mesh &mesh)
+{
+  return {mesh.verts_num, mesh.edges_num, mesh.faces_num, mesh.corners_num, mesh.totface_legacy};
+}
+
+/**
+ * Compute a cached tree, preferably by refitting the tree from before the last position change.
+ * The previous tree is copied first when it is still used by other meshes.
+ */
+static void ensure_bvh_cache(const Mesh &mesh,
+                             SharedCache<MeshBVHCache> &cache,
+                             const FunctionRef<std::unique_ptr<BVHTree, BVHTreeDeleter>()> build,
+                             const BVHTree_LeafPointsFn get_leaf_points)
+{
+  cache.ensure_with_previous([&](MeshBVHCache &data, const MeshBVHCache *previous) {
+    const std::array<int, 5> domain_sizes = bvh_domain_sizes(mesh);
+    /* Only positions are expected to change, but callers may tag a topology change as a position
+     * change by mistake. */
+    if (previous && previous->tree && previous->domain_sizes == domain_sizes) {
+      if (previous != &data) {
+        data.tree.reset(BLI_bvhtree_copy(*previous->tree));
+        data.built_surface_area_cost = previous->built_surface_area_cost;
+        data.domain_sizes = domain_sizes;
+      }
+      BLI_bvhtree_refit(*data.tree, get_leaf_points);
+      const float cost = BLI_bvhtree_surface_area_cost(*data.tree);
+      if (cost <= data.built_surface_area_cost * bvh_refit_max_cost_factor) {
+        return;
+      }
+    }
+    data.tree = build();
+    data.built_surface_area_cost = data.tree ? BLI_bvhtree_surface_area_cost(*data.tree) : 0.0f;
+    data.domain_sizes = domain_sizes;
+  });
+}
+
+static void ensure_verts_bvh_cache(const Mesh &mesh,
+                                   SharedCache<MeshBVHCache> &cache,
+                                   const Span<float3> positions,
+                                   const FunctionRef<IndexMask(IndexMaskMemory &memory)> get_mask)
+{
+  ensure_bvh_cache(
+      mesh,
+      cache,
+      [&]() {
+        IndexMaskMemory memory;
+        return create_tree_from_verts(positions, get_mask(memory));
+      },
+      [&](const int vert, float3 *r_points) {
+        r_points[0] = positions[vert];
+        return 1;
+      });
+}
+
+static void ensure_edges_bvh_cache(const Mesh &mesh,
+                                   SharedCache<MeshBVHCache> &cache,
+                                   const Span<float3> positions,
+                                   const Span<int2> edges,
+                                   const FunctionRef<IndexMask(IndexMaskMemory &memory)> get_mask)
+{
+  ensure_bvh_cache(
+      mesh,
+      cache,
+      [&]() {
+        IndexMaskMemory memory;
+        return create_tree_from_edges(positions, edges, get_mask(memory));
+      },
+      [&](const int edge, float3 *r_points) {
+        r_points[0] = positions[edges[edge][0]];
+        r_points[1] = positions[edges[edge][1]];
+        return 2;
+      });
+}
+
+static void ensure_tris_bvh_cache(
+    const Mesh &mesh,
+    SharedCache<MeshBVHCache> &cache,
+    const Span<float3> positions,
+    const Span<int> corner_verts,
+    const Span<int3> corner_tris,
+    const FunctionRef<std::unique_ptr<BVHTree, BVHTreeDeleter>()> build)
+{
+  ensure_bvh_cache(mesh, cache, build, [&](const int tri, float3 *r_points) {
+    r_points[0] = positions[corner_verts[corner_tris[tri][0]]];
+    r_points[1] = positions[corner_verts[corner_tris[tri][1]]];
+    r_points[2] = positions[corner_verts[corner_tris[tri][2]]];
+    return 3;
+  });
+}
+
 }  // namespace blender::bke
 
 blender::bke::BVHTreeFromMesh Mesh::bvh_loose_verts() const
@@ -644,13 +741,13 @@ blender::bke::BVHTreeFromMesh Mesh::bvh_loose_verts() const
   using namespace blender;
   using namespace blender::bke;
   const Span<float3> positions = this->vert_positions();
-  this->runtime->bvh_cache_loose_verts.ensure([&](std::unique_ptr<BVHTree, BVHTreeDeleter> &data) {
-    const LooseVertCache &loose_verts = this->loose_verts();
-    IndexMaskMemory memory;
-    const IndexMask mask = IndexMask::from_bits(loose_verts.is_loose_bits, memory);
-    data = create_tree_from_verts(positions, mask);
-  });
-  return create_verts_tree_data(this->runtime->bvh_cache_loose_verts.data().get(), positions);
+  ensure_verts_bvh_cache(
+      *this, this->runtime->bvh_cache_loose_verts, positions, [&](IndexMaskMemory &memory) {
+        const LooseVertCache &loose_verts = this->loose_verts();
+        return IndexMask::from_bits(loose_verts.is_loose_bits, memory);
+      });
+  return create_verts_tree_data(this->runtime->bvh_cache_loose_verts.data().tree.get(),
+                                positions);
 }
 
 blender::bke::BVHTreeFromMesh Mesh::bvh_loose_no_hidden_verts() const
@@ -658,14 +755,15 @@ blender::bke::BVHTreeFromMesh Mesh::bvh_loose_no_hidden_verts() const
   using namespace blender;
   using namespace blender::bke;
   const Span<float3> positions = this->vert_positions();
-  this->runtime->bvh_cache_loose_verts_no_hidden.ensure(
-      [&](std::unique_ptr<BVHTree, BVHTreeDeleter> &data) {
-        const BitVector<> mask = loose_verts_no_hidden_mask_get(*this);
-        IndexMaskMemory memory;
-        data = create_tree_from_verts(positions, IndexMask::from_bits(mask, memory));
-      });
-  return create_verts_tree_data(this->runtime->bvh_cache_loose_verts_no_hidden.data().get(),
-                                positions);
+  ensure_verts_bvh_cache(*this,
+                         this->runtime->bvh_cache_loose_verts_no_hidden,
+                         positions,
+                         [&](IndexMaskMemory &memory) {
+                           const BitVector<> mask = loose_verts_no_hidden_mask_get(*this);
+                           return IndexMask::from_bits(mask, memory);
+                         });
+  return create_verts_tree_data(
+      this->runtime->bvh_cache_loose_verts_no_hidden.data().tree.get(), positions);
 }
 
 blender::bke::BVHTreeFromMesh Mesh::bvh_verts() const
@@ -673,10 +771,11 @@ blender::bke::BVHTreeFromMesh Mesh::bvh_verts() const
   using namespace blender;
   using namespace blender::bke;
   const Span<float3> positions = this->vert_positions();
-  this->runtime->bvh_cache_verts.ensure([&](std::unique_ptr<BVHTree, BVHTreeDeleter> &data) {
-    data = create_tree_from_verts(positions, positions.index_range());
-  });
-  return create_verts_tree_data(this->runtime->bvh_cache_verts.data().get(), positions);
+  ensure_verts_bvh_cache(
+      *this, this->runtime->bvh_cache_verts, positions, [&](IndexMaskMemory &) {
+        return IndexMask(positions.index_range());
+      });
+  return create_verts_tree_data(this->runtime->bvh_cache_verts.data().tree.get(), positions);
 }
 
 blender::bke::BVHTreeFromMesh Mesh::bvh_loose_edges() const
@@ -685,14 +784,13 @@ blender::bke::BVHTreeFromMesh Mesh::bvh_loose_edges() const
   using namespace blender::bke;
   const Span<float3> positions = this->vert_positions();
   const Span<int2> edges = this->edges();
-  this->runtime->bvh_cache_loose_edges.ensure([&](std::unique_ptr<BVHTree, BVHTreeDeleter> &data) {
-    const LooseEdgeCache &loose_edges = this->loose_edges();
-    IndexMaskMemory memory;
-    const IndexMask mask = IndexMask::from_bits(loose_edges.is_loose_bits, memory);
-    data = create_tree_from_edges(positions, edges, mask);
-  });
+  ensure_edges_bvh_cache(
+      *this, this->runtime->bvh_cache_loose_edges, positions, edges, [&](IndexMaskMemory &memory) {
+        const LooseEdgeCache &loose_edges = this->loose_edges();
+        return IndexMask::from_bits(loose_edges.is_loose_bits, memory);
+      });
   return create_edges_tree_data(
-      this->runtime->bvh_cache_loose_edges.data().get(), positions, edges);
+      this->runtime->bvh_cache_loose_edges.data().tree.get(), positions, edges);
 }
 
 blender::bke::BVHTreeFromMesh Mesh::bvh_loose_no_hidden_edges() const
@@ -701,14 +799,16 @@ blender::bke::BVHTreeFromMesh Mesh::bvh_loose_no_hidden_edges() const
   using namespace blender::bke;
   const Span<float3> positions = this->vert_positions();
   const Span<int2> edges = this->edges();
-  this->runtime->bvh_cache_loose_edges_no_hidden.ensure(
-      [&](std::unique_ptr<BVHTree, BVHTreeDeleter> &data) {
-        const BitVector<> mask = loose_edges_no_hidden_mask_get(*this);
-        IndexMaskMemory memory;
-        data = create_tree_from_edges(positions, edges, IndexMask::from_bits(mask, memory));
-      });
+  ensure_edges_bvh_cache(*this,
+                         this->runtime->bvh_cache_loose_edges_no_hidden,
+                         positions,
+                         edges,
+                         [&](IndexMaskMemory &memory) {
+                           const BitVector<> mask = loose_edges_no_hidden_mask_get(*this);
+                           return IndexMask::from_bits(mask, memory);
+                         });
   return create_edges_tree_data(
-      this->runtime->bvh_cache_loose_edges_no_hidden.data().get(), positions, edges);
+      this->runtime->bvh_cache_loose_edges_no_hidden.data().tree.get(), positions, edges);
 }
 
 blender::bke::BVHTreeFromMesh Mesh::bvh_edges() const
@@ -717,10 +817,12 @@ blender::bke::BVHTreeFromMesh Mesh::bvh_edges() const
   using namespace blender::bke;
   const Span<float3> positions = this->vert_positions();
   const Span<int2> edges = this->edges();
-  this->runtime->bvh_cache_edges.ensure([&](std::unique_ptr<BVHTree, BVHTreeDeleter> &data) {
-    data = create_tree_from_edges(positions, edges, edges.index_range());
-  });
-  return create_edges_tree_data(this->runtime->bvh_cache_edges.data().get(), positions, edges);
+  ensure_edges_bvh_cache(
+      *this, this->runtime->bvh_cache_edges, positions, edges, [&](IndexMaskMemory &) {
+        return IndexMask(edges.index_range());
+      });
+  return create_edges_tree_data(
+      this->runtime->bvh_cache_edges.data().tree.get(), positions, edges);
 }
 
 blender::bke::BVHTreeFromMesh Mesh::bvh_legacy_faces() const
@@ -732,11 +834,23 @@ blender::bke::BVHTreeFromMesh Mesh::bvh_legacy_faces() const
       static_cast<const MFace *>(CustomData_get_layer(&this->fdata_legacy, CD_MFACE)),
       this->totface_legacy};
   const Span<float3> positions = this->vert_positions();
-  this->runtime->bvh_cache_faces.ensure([&](std::unique_ptr<BVHTree, BVHTreeDeleter> &data) {
-    data = create_tree_from_legacy_faces(positions, legacy_faces);
-  });
+  ensure_bvh_cache(
+      *this,
+      this->runtime->bvh_cache_faces,
+      [&]() { return create_tree_from_legacy_faces(positions, legacy_faces); },
+      [&](const int i, float3 *r_points) {
+        const MFace &face = legacy_faces[i];
+        r_points[0] = positions[face.v1];
+        r_points[1] = positions[face.v2];
+        r_points[2] = positions[face.v3];
+        if (face.v4) {
+          r_points[3] = positions[face.v4];
+          return 4;
+        }
+        return 3;
+      });
   return create_legacy_faces_tree_data(
-      this->runtime->bvh_cache_faces.data().get(), positions, legacy_faces.data());
+      this->runtime->bvh_cache_faces.data().tree.get(), positions, legacy_faces.data());
 }
 
 blender::bke::BVHTreeFromMesh Mesh::bvh_corner_tris_no_hidden() const
@@ -751,15 +865,20 @@ blender::bke::BVHTreeFromMesh Mesh::bvh_corner_tris_no_hidden() const
   if (!hide_poly) {
     return this->bvh_corner_tris();
   }
-  this->runtime->bvh_cache_corner_tris_no_hidden.ensure(
-      [&](std::unique_ptr<BVHTree, BVHTreeDeleter> &data) {
+  ensure_tris_bvh_cache(
+      *this,
+      this->runtime->bvh_cache_corner_tris_no_hidden,
+      positions,
+      corner_verts,
+      corner_tris,
+      [&]() {
         const OffsetIndices<int> faces = this->faces();
         IndexMaskMemory memory;
         const IndexMask visible_faces = IndexMask::from_bools_inverse(
             faces.index_range(), VArraySpan(hide_poly), memory);
-        data = create_tree_from_tris(positions, faces, corner_verts, corner_tris, visible_faces);
+        return create_tree_from_tris(positions, faces, corner_verts, corner_tris, visible_faces);
       });
-  return create_tris_tree_data(this->runtime->bvh_cache_corner_tris_no_hidden.data().get(),
+  return create_tris_tree_data(this->runtime->bvh_cache_corner_tris_no_hidden.data().tree.get(),
                                positions,
                                corner_verts,
                                corner_tris);
@@ -772,11 +891,14 @@ blender::bke::BVHTreeFromMesh Mesh::bvh_corner_tris() const
   const Span<float3> positions = this->vert_positions();
   const Span<int> corner_verts = this->corner_verts();
   const Span<int3> corner_tris = this->corner_tris();
-  this->runtime->bvh_cache_corner_tris.ensure([&](std::unique_ptr<BVHTree, BVHTreeDeleter> &data) {
-    data = create_tree_from_tris(positions, corner_verts, corner_tris);
-  });
-  return create_tris_tree_data(
-      this->runtime->bvh_cache_corner_tris.data().get(), positions, corner_verts, corner_tris);
+  ensure_tris_bvh_cache(
+      *this, this->runtime->bvh_cache_corner_tris, positions, corner_verts, corner_tris, [&]() {
+        return create_tree_from_tris(positions, corner_verts, corner_tris);
+      });
+  return create_tris_tree_data(this->runtime->bvh_cache_corner_tris.data().tree.get(),
+                               positions,
+                               corner_verts,
+                               corner_tris);
 }
 
 namespace blender::bke {
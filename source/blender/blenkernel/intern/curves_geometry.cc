@@ -1886,7 +1886,7 @@ void CurvesGeometry::blend_read(BlendDataReader &reader)
 
   if (this->curve_offsets) {
     this->runtime->curve_offsets_sharing_info = BLO_read_shared(
-        &reader, &this->curve_offsets, [&]() {
+        &reader, &this->curve_offsets, sizeof(int) * size_t(this->curve_num + 1), [&]() {
           BLO_read_int32_array(&reader, this->curve_num + 1, &this->curve_offsets);
           return implicit_sharing::info_for_mem_free(this->curve_offsets);
         });
@@ -1896,7 +1896,7 @@ void CurvesGeometry::blend_read(BlendDataReader &reader)
 
   if (this->custom_knot_num) {
     this->runtime->custom_knots_sharing_info = BLO_read_shared(
-        &reader, &this->custom_knots, [&]() {
+        &reader, &this->custom_knots, sizeof(float) * size_t(this->custom_knot_num), [&]() {
           BLO_read_float_array(&reader, this->custom_knot_num, &this->custom_knots);
           return implicit_sharing::info_for_mem_free(this->custom_knots);
         });
@@ -5376,8 +5376,10 @@ void CustomData_blend_read(BlendDataReader *reader, CustomData *data, const int
     layer->sharing_info = nullptr;
 
     if (CustomData_verify_versions(data, i)) {
+      const size_t expected_size = size_t(CustomData_sizeof(eCustomDataType(layer->type))) *
+                                   size_t(count);
       layer->sharing_info = BLO_read_shared(
-          reader, &layer->data, [&]() -> const ImplicitSharingInfo * {
+          reader, &layer->data, expected_size, [&]() -> const ImplicitSharingInfo * {
             blend_read_layer_data(reader, *layer, count);
             if (layer->data == nullptr) {
               return nullptr;
@@ -59,6 +59,20 @@ static void free_bvh_caches(MeshRuntime &mesh_runtime)
   mesh_runtime.bvh_cache_loose_edges_no_hidden.tag_dirty();
 }
 
+/** Keep the outdated trees so that they can be refit to the new positions. */
+static void tag_bvh_caches_positions_changed(MeshRuntime &mesh_runtime)
+{
+  mesh_runtime.bvh_cache_verts.tag_dirty_keep_previous();
+  mesh_runtime.bvh_cache_edges.tag_dirty_keep_previous();
+  mesh_runtime.bvh_cache_faces.tag_dirty_keep_previous();
+  mesh_runtime.bvh_cache_corner_tris.tag_dirty_keep_previous();
+  mesh_runtime.bvh_cache_corner_tris_no_hidden.tag_dirty_keep_previous();
+  mesh_runtime.bvh_cache_loose_verts.tag_dirty_keep_previous();
+  mesh_runtime.bvh_cache_loose_verts_no_hidden.tag_dirty_keep_previous();
+  mesh_runtime.bvh_cache_loose_edges.tag_dirty_keep_previous();
+  mesh_runtime.bvh_cache_loose_edges_no_hidden.tag_dirty_keep_previous();
+}
+
 MeshRuntime::MeshRuntime() = default;
 
 MeshRuntime::~MeshRuntime()
@@ -406,7 +420,7 @@ void Mesh::tag_positions_changed()
 
 void Mesh::tag_positions_changed_no_normals()
 {
-  free_bvh_caches(*this->runtime);
+  tag_bvh_caches_positions_changed(*this->runtime);
   this->runtime->corner_tris_cache.tag_dirty();
   this->runtime->bounds_cache.tag_dirty();
   this->runtime->shrinkwrap_boundary_cache.tag_dirty();
@@ -415,7 +429,7 @@ void Mesh::tag_positions_changed_no_normals()
 void Mesh::tag_positions_changed_uniformly()
 {
   /* The normals and triangulation didn't change, since all verts moved by the same amount. */
-  free_bvh_caches(*this->runtime);
+  tag_bvh_caches_positions_changed(*this->runtime);
   this->runtime->bounds_cache.tag_dirty();
 }
 
@@ -55,6 +55,11 @@ size_t BLI_array_store_calc_size_expanded_get(const BArrayStore *bs);
  * (duplicate chunks are only counted once).
  */
 size_t BLI_array_store_calc_size_compacted_get(const BArrayStore *bs);
+/**
+ * \return the amount of memory used for book keeping,
+ * the chunk lists, chunk references and chunk headers (not including #BChunk.data).
+ */
+size_t BLI_array_store_calc_size_overhead_get(const BArrayStore *bs);
 
 /**
  * \param data: Data used to create
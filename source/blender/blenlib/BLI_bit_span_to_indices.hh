@@ -0,0 +1,28 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup bli
+ */
+
+#pragma once
+
+#include "BLI_bit_span.hh"
+#include "BLI_span.hh"
+
+namespace blender::bits {
+
+/**
+ * Writes the indices of all set bits into \a r_indices and adds \a offset to each of them.
+ * For example 00110100 results in [2, 4, 5] when the offset is zero.
+ *
+ * Up to eight indices are generated at once using a lookup table, which is much faster than
+ * handling every set bit separately when there are many set bits.
+ *
+ * \param r_indices: Has to be large enough to hold an index for every set bit.
+ * \return The number of indices that have been written.
+ */
+int64_t bits_to_indices(BitSpan bits, MutableSpan<int16_t> r_indices, int16_t offset = 0);
+
+}  // namespace blender::bits
@@ -6,30 +6,17 @@
  * \ingroup bli
  */
 
-#ifdef WITH_TBB
-/* Quiet top level deprecation message, unrelated to API usage here. */
-#  if defined(WIN32) && !defined(NOMINMAX)
-/* TBB includes Windows.h which will define min/max macros causing issues
- * when we try to use std::min and std::max later on. */
-#    define NOMINMAX
-#    define TBB_MIN_MAX_CLEANUP
-#  endif
-#  include <tbb/concurrent_hash_map.h>
-#  ifdef WIN32
-/* We cannot keep this defined, since other parts of the code deal with this on their own, leading
- * to multiple define warnings unless we un-define this, however we can only undefine this if we
- * were the ones that made the definition earlier. */
-#    ifdef TBB_MIN_MAX_CLEANUP
-#      undef NOMINMAX
-#    endif
-#  endif
-#else
-#  include "BLI_mutex.hh"
-#  include "BLI_set.hh"
-#endif
+#include <atomic>
+#include <thread>
 
+#include "MEM_guardedalloc.h"
+
+#include "BLI_array.hh"
 #include "BLI_hash.hh"
 #include "BLI_hash_tables.hh"
+#include "BLI_mutex.hh"
+#include "BLI_span.hh"
+#include "BLI_task.hh"
 
 namespace blender {
 
@@ -44,9 +31,23 @@ namespace blender {
  *
  * \note #ConcurrentMap does not support iteration over all values.
  *
- * This is a thin wrapper around #tbb::concurrent_hash_map that also has a fallback implementation
- * if TBB is not available. The fallback implementation is not optimized for performance. It mainly
- * intends to be a simple implementation that can compile whenever the TBB variant can compile.
+ * Implementation:
+ *
+ * The map is split into a fixed number of shards, which are selected by the high bits of the
+ * hash. Every shard is an open addressing hash table with linear probing whose slots are atomic
+ * pointers to separately allocated key-value-pairs (nodes). Lookups don't lock the shard: they
+ * probe its table without synchronization and only lock the found node for the accessor.
+ * Adding and removing keys are serialized per shard with a mutex, so threads working on
+ * different shards don't interfere.
+ *
+ * Nodes and outgrown tables can't be freed while a lookup may still be reading them. Instead of
+ * locking, readers announce themselves in one of two per-shard counters. A writer that wants to
+ * free memory first unlinks it, then switches the counter that new readers use and waits until
+ * the readers of the old counter left (a grace period). Readers only stay in this state while
+ * probing, so the wait is short and readers are never blocked by it.
+ *
+ * The key-value-pair itself is protected by a small reader-writer spin lock that is held by the
+ * accessor. This gives the same semantics as #tbb::concurrent_hash_map, which was used before.
  */
 template<typename Key,
          typename Value,
@@ -56,29 +57,274 @@ class ConcurrentMap {
  public:
   using size_type = int64_t;
 
-  /* Sometimes TBB requires the value to be constructible. */
-  static_assert(std::is_copy_constructible_v<Value>);
+  /* Values are default constructed when a key is added. */
+  static_assert(std::is_default_constructible_v<Value>);
 
-#ifdef WITH_TBB
  private:
-  struct Hasher {
-    template<typename T> size_t hash(const T &value) const
+  /** Number of independent hash tables. Has to be a power of two. */
+  static constexpr int ShardsNum = 64;
+  static constexpr int ShardBits = 6;
+  static_assert((1 << ShardBits) == ShardsNum);
+
+  /** The capacity of the table that is allocated when the first key is added to a shard. */
+  static constexpr int64_t MinTableSize = 16;
+
+  /** The lowest bit marks the exclusive lock, all other bits count the shared locks. */
+  static constexpr uint32_t ExclusiveLockBit = 1;
+  static constexpr uint32_t SharedLockIncrement = 2;
+
+  struct Node {
+    std::pair<Key, Value> item;
+    uint64_t hash;
+    /**
+     * The table and lookups that wait for the lock own a reference. Accessors don't need one,
+     * because removing a node waits for its lock anyway.
+     */
+    std::atomic<int64_t> users;
+    std::atomic<uint32_t> lock_state = 0;
+    /** Set while the lock is held exclusively, once the node is not in the table anymore. */
+    bool removed = false;
+
+    Node(const Key &key, const uint64_t hash, const int64_t users)
+        : item(key, Value()), hash(hash), users(users)
     {
-      return Hash{}(value);
     }
 
-    template<typename T1, typename T2> bool equal(const T1 &a, const T2 &b) const
+    Node(const Key &key, const Value &value, const uint64_t hash, const int64_t users)
+        : item(key, value), hash(hash), users(users)
     {
-      return IsEqual{}(a, b);
     }
   };
 
-  using TBBMap = tbb::concurrent_hash_map<Key, Value, Hasher>;
-  TBBMap map_;
+  struct Table {
+    std::atomic<Node *> *slots;
+    uint64_t slot_mask;
+
+    explicit Table(const int64_t size) : slot_mask(uint64_t(size) - 1)
+    {
+      BLI_assert(is_power_of_2(size));
+      slots = static_cast<std::atomic<Node *> *>(
+          MEM_malloc_arrayN(size_t(size), sizeof(std::atomic<Node *>), __func__));
+      for (const int64_t i : IndexRange(size)) {
+        new (&slots[i]) std::atomic<Node *>(nullptr);
+      }
+    }
+
+    ~Table()
+    {
+      MEM_freeN(static_cast<void *>(slots));
+    }
+
+    int64_t size() const
+    {
+      return int64_t(slot_mask) + 1;
+    }
+  };
+
+  struct alignas(64) Shard {
+    std::atomic<Table *> table = nullptr;
+    /** Readers that are currently probing #table, see #enter_read_section. */
+    std::atomic<int64_t> readers[2] = {0, 0};
+    std::atomic<int> read_phase = 0;
+    /** Protects everything below and serializes all changes to the table. */
+    mutable Mutex mutex;
+    /** Number of nodes in the table. */
+    int64_t size = 0;
+    /** Number of slots that are not empty, including the removed ones. */
+    int64_t occupied = 0;
+  };
+
+  Shard shards_[ShardsNum];
+
+  /** The slot marker of a removed node. Lookups have to continue probing after it. */
+  static Node *removed_marker()
+  {
+    return reinterpret_cast<Node *>(uintptr_t(1));
+  }
+
+  static bool is_node(const Node *node)
+  {
+    return node != nullptr && node != removed_marker();
+  }
+
+  /**
+   * Weak hashes (e.g. the identity hash of integers) are mixed first, so that the high bits that
+   * select the shard and the low bits that select the slot are independent.
+   */
+  static uint64_t mix_hash(const uint64_t hash)
+  {
+    const uint64_t mixed = (hash ^ (hash >> 32)) * uint64_t(0x9E3779B97F4A7C15);
+    return mixed ^ (mixed >> 29);
+  }
+
+  Shard &shard_for_hash(const uint64_t hash)
+  {
+    return shards_[mix_hash(hash) >> (64 - ShardBits)];
+  }
+
+  static uint64_t first_slot(const uint64_t hash, const uint64_t slot_mask)
+  {
+    return mix_hash(hash) & slot_mask;
+  }
+
+  static void spin_wait(int &iteration)
+  {
+    if (iteration++ > 16) {
+      std::this_thread::yield();
+    }
+  }
+
+  /**
+   * Announce that the calling thread is about to read the table of the shard. Returns the phase
+   * that has to be passed to #exit_read_section.
+   */
+  static int enter_read_section(Shard &shard)
+  {
+    while (true) {
+      const int phase = shard.read_phase.load();
+      shard.readers[phase].fetch_add(1);
+      /* If the phase changed in the mean-time, the writer may not wait for this reader. */
+      if (shard.read_phase.load() == phase) {
+        return phase;
+      }
+      shard.readers[phase].fetch_sub(1, std::memory_order_release);
+    }
+  }
+
+  static void exit_read_section(Shard &shard, const int phase)
+  {
+    shard.readers[phase].fetch_sub(1, std::memory_order_release);
+  }
+
+  /**
+   * Wait until all readers that may still see nodes or tables that have been unlinked from the
+   * shard have finished. Has to be called with the shard mutex locked.
+   */
+  static void wait_for_readers(Shard &shard)
+  {
+    const int old_phase = shard.read_phase.load(std::memory_order_relaxed);
+    shard.read_phase.store(1 - old_phase);
+    int iteration = 0;
+    while (shard.readers[old_phase].load() != 0) {
+      spin_wait(iteration);
+    }
+  }
+
+  static void add_user(Node &node)
+  {
+    node.users.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  static void remove_user(Node &node)
+  {
+    if (node.users.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      MEM_delete(&node);
+    }
+  }
+
+  static bool try_lock(Node &node, const bool exclusive)
+  {
+    uint32_t state = node.lock_state.load(std::memory_order_relaxed);
+    if (exclusive) {
+      return state == 0 && node.lock_state.compare_exchange_strong(
+                               state, ExclusiveLockBit, std::memory_order_acquire);
+    }
+    return !(state & ExclusiveLockBit) &&
+           node.lock_state.compare_exchange_strong(
+               state, state + SharedLockIncrement, std::memory_order_acquire);
+  }
+
+  static void lock(Node &node, const bool exclusive)
+  {
+    int iteration = 0;
+    while (!try_lock(node, exclusive)) {
+      spin_wait(iteration);
+    }
+  }
+
+  static void unlock(Node &node, const bool exclusive)
+  {
+    if (exclusive) {
+      node.lock_state.store(0, std::memory_order_release);
+    }
+    else {
+      node.lock_state.fetch_sub(SharedLockIncrement, std::memory_order_release);
+    }
+  }
 
  public:
-  using MutableAccessor = typename TBBMap::accessor;
-  using ConstAccessor = typename TBBMap::const_accessor;
+  template<bool IsConst> class Accessor {
+   private:
+    Node *node_ = nullptr;
+
+    friend ConcurrentMap;
+
+   public:
+    using Item = std::conditional_t<IsConst, const std::pair<Key, Value>, std::pair<Key, Value>>;
+
+    Accessor() = default;
+    Accessor(const Accessor &other) = delete;
+    Accessor &operator=(const Accessor &other) = delete;
+
+    ~Accessor()
+    {
+      this->release();
+    }
+
+    bool is_empty() const
+    {
+      return node_ == nullptr;
+    }
+
+    /** Unlock the key-value-pair before the accessor is destructed. */
+    void release()
+    {
+      if (node_ == nullptr) {
+        return;
+      }
+      ConcurrentMap::unlock(*node_, !IsConst);
+      node_ = nullptr;
+    }
+
+    Item *operator->() const
+    {
+      BLI_assert(node_ != nullptr);
+      return &node_->item;
+    }
+
+    Item &operator*() const
+    {
+      BLI_assert(node_ != nullptr);
+      return node_->item;
+    }
+  };
+
+  using MutableAccessor = Accessor<false>;
+  using ConstAccessor = Accessor<true>;
+
+  ConcurrentMap() = default;
+  ConcurrentMap(const ConcurrentMap &other) = delete;
+  ConcurrentMap &operator=(const ConcurrentMap &other) = delete;
+
+  ~ConcurrentMap()
+  {
+    for (Shard &shard : shards_) {
+      Table *table = shard.table.load(std::memory_order_relaxed);
+      if (table == nullptr) {
+        continue;
+      }
+      for (const int64_t i : IndexRange(table->size())) {
+        Node *node = table->slots[i].load(std::memory_order_relaxed);
+        if (is_node(node)) {
+          /* Accessors must not outlive the map. */
+          BLI_assert(node->users.load(std::memory_order_relaxed) == 1);
+          BLI_assert(node->lock_state.load(std::memory_order_relaxed) == 0);
+          MEM_delete(node);
+        }
+      }
+      MEM_delete(table);
+    }
+  }
 
   /**
    * Try to find the key-value-pair for the given key and get write-access to it. Only one thread
@@ -89,7 +335,7 @@ class ConcurrentMap {
    */
   bool lookup(MutableAccessor &accessor, const Key &key)
   {
-    return map_.find(accessor, key);
+    return this->lookup_impl(accessor, key);
   }
 
   /**
@@ -98,7 +344,7 @@ class ConcurrentMap {
    */
   bool lookup(ConstAccessor &accessor, const Key &key)
   {
-    return map_.find(accessor, key);
+    return this->lookup_impl(accessor, key);
   }
 
   /**
@@ -107,106 +353,313 @@ class ConcurrentMap {
    */
   bool add(MutableAccessor &accessor, const Key &key)
   {
-    return map_.insert(accessor, key);
+    return this->add_impl(accessor, key);
   }
 
   bool add(ConstAccessor &accessor, const Key &key)
   {
-    return map_.insert(accessor, key);
+    return this->add_impl(accessor, key);
   }
 
   /**
-   * Remove the key-value-pair that corresponds to this key. This waits until no one else is using
-   * it anymore.
+   * Add many key-value-pairs at once, which is much faster than adding them one by one. Keys that
+   * exist already (or that come earlier in the span) keep their value. The hashing and the
+   * insertion into the different shards are done in parallel.
+   *
+   * This can be called while other threads use the map.
    */
-  bool remove(const Key &key)
+  void add_multiple(const Span<std::pair<Key, Value>> items)
   {
-    return map_.erase(key);
+    Array<uint64_t> hashes(items.size());
+    threading::parallel_for(items.index_range(), 2048, [&](const IndexRange range) {
+      for (const int64_t i : range) {
+        hashes[i] = Hash{}(items[i].first);
+      }
+    });
+
+    /* Group the items by shard, keeping their order within every shard. */
+    Array<int64_t> offsets(ShardsNum + 1, 0);
+    Array<uint8_t> shard_indices(items.size());
+    for (const int64_t i : items.index_range()) {
+      shard_indices[i] = uint8_t(mix_hash(hashes[i]) >> (64 - ShardBits));
+      offsets[shard_indices[i] + 1]++;
+    }
+    for (const int shard_i : IndexRange(ShardsNum)) {
+      offsets[shard_i + 1] += offsets[shard_i];
+    }
+    Array<int64_t> sorted_indices(items.size());
+    {
+      Array<int64_t> fill = offsets;
+      for (const int64_t i : items.index_range()) {
+        sorted_indices[fill[shard_indices[i]]++] = i;
+      }
+    }
+
+    threading::parallel_for(IndexRange(ShardsNum), 1, [&](const IndexRange range) {
+      for (const int shard_i : range) {
+        const IndexRange shard_range = IndexRange::from_begin_end(offsets[shard_i],
+                                                                  offsets[shard_i + 1]);
+        if (shard_range.is_empty()) {
+          continue;
+        }
+        Shard &shard = shards_[shard_i];
+        std::lock_guard lock{shard.mutex};
+        this->ensure_can_add(shard, shard_range.size());
+        for (const int64_t i : sorted_indices.as_span().slice(shard_range)) {
+          const std::pair<Key, Value> &item = items[i];
+          if (this->find_slot_locked(shard, item.first, hashes[i]) != nullptr) {
+            continue;
+          }
+          Node *node = MEM_new<Node>(__func__, item.first, item.second, hashes[i], 1);
+          this->insert_locked(shard, *node);
+        }
+      }
+    });
   }
 
-#else
- private:
   /**
-   * In the fallback implementation, we actually use a #Set, because the API expects the key and
-   * value to be stored in a `std::pair`. #Set can support this use case too.
+   * Allocate memory such that at least \a n keys can be added without growing the tables. Keys
+   * that are not evenly distributed among the shards may still require growing.
    */
-  struct SetKey {
-    std::pair<Key, Value> item;
-
-    SetKey(Key key) : item(std::move(key), Value()) {}
-
-    uint64_t hash() const
-    {
-      return Hash{}(this->item.first);
+  void reserve(const int64_t n)
+  {
+    /* Leave some room for the uneven distribution of keys among shards. */
+    const int64_t n_per_shard = n / ShardsNum + n / ShardsNum / 4 + 1;
+    for (Shard &shard : shards_) {
+      std::lock_guard lock{shard.mutex};
+      if (n_per_shard > shard.size) {
+        this->ensure_can_add(shard, n_per_shard - shard.size);
+      }
     }
+  }
 
-    static uint64_t hash_as(const Key &key)
+  /**
+   * Remove the key-value-pair that corresponds to this key. This waits until no one else is using
+   * it anymore.
+   */
+  bool remove(const Key &key)
+  {
+    const uint64_t hash = Hash{}(key);
+    Shard &shard = this->shard_for_hash(hash);
+    Node *node;
     {
-      return Hash{}(key);
+      std::lock_guard lock{shard.mutex};
+      std::atomic<Node *> *slot = this->find_slot_locked(shard, key, hash);
+      if (slot == nullptr) {
+        return false;
+      }
+      node = slot->load(std::memory_order_relaxed);
+      slot->store(removed_marker());
+      shard.size--;
+      /* After this, no lookup can find the node anymore. */
+      wait_for_readers(shard);
     }
+    /* Wait until the current accessors are done. Accessors that found the node before it was
+     * removed see the flag and behave as if the key was not found. */
+    lock(*node, true);
+    node->removed = true;
+    unlock(*node, true);
+    /* Remove the user of the table, lookups that still wait for the lock may free the node. */
+    remove_user(*node);
+    return true;
+  }
 
-    friend bool operator==(const SetKey &a, const SetKey &b)
-    {
-      return IsEqual{}(a.item.first, b.item.first);
+  /** The number of keys in the map. It's not exact while other threads add or remove keys. */
+  int64_t size() const
+  {
+    int64_t size = 0;
+    for (const Shard &shard : shards_) {
+      std::lock_guard lock{shard.mutex};
+      size += shard.size;
     }
+    return size;
+  }
 
-    friend bool operator==(const Key &a, const SetKey &b)
-    {
-      return IsEqual{}(a, b.item.first);
+ private:
+  /**
+   * Find the node for the given key without locking the shard and lock it for the accessor.
+   * Returns false if the key does not exist (anymore).
+   */
+  template<bool IsConst>
+  bool find_and_lock(Shard &shard,
+                     const Key &key,
+                     const uint64_t hash,
+                     Accessor<IsConst> &accessor)
+  {
+    const int phase = enter_read_section(shard);
+    Node *found_node = nullptr;
+    if (const Table *table = shard.table.load()) {
+      for (uint64_t slot_i = first_slot(hash, table->slot_mask);;
+           slot_i = (slot_i + 1) & table->slot_mask)
+      {
+        Node *node = table->slots[slot_i].load();
+        if (node == nullptr) {
+          break;
+        }
+        if (node != removed_marker() && node->hash == hash && IsEqual{}(node->item.first, key)) {
+          found_node = node;
+          break;
+        }
+      }
     }
-
-    friend bool operator==(const SetKey &a, const Key &b)
-    {
-      return IsEqual{}(a.item.first, b);
+    if (found_node == nullptr) {
+      exit_read_section(shard, phase);
+      return false;
     }
-  };
-
-  using UsedSet = Set<SetKey>;
-
-  struct Accessor {
-    std::unique_lock<Mutex> mutex;
-    std::pair<Key, Value> *data = nullptr;
+    /* Fast path when the node is not locked by a conflicting accessor. The node can't be freed
+     * once it is locked, so no user has to be added. */
+    if (try_lock(*found_node, !IsConst)) {
+      exit_read_section(shard, phase);
+      accessor.node_ = found_node;
+      return true;
+    }
+    /* Waiting for the lock in the read section could dead-lock with a thread that holds the lock
+     * and waits for the readers of this shard. */
+    add_user(*found_node);
+    exit_read_section(shard, phase);
+    return lock_user_node(accessor, *found_node);
+  }
 
-    std::pair<Key, Value> *operator->()
+  /** Find the slot that contains the key. Has to be called with the shard mutex locked. */
+  std::atomic<Node *> *find_slot_locked(Shard &shard, const Key &key, const uint64_t hash)
+  {
+    Table *table = shard.table.load(std::memory_order_relaxed);
+    if (table == nullptr) {
+      return nullptr;
+    }
+    for (uint64_t slot_i = first_slot(hash, table->slot_mask);;
+         slot_i = (slot_i + 1) & table->slot_mask)
     {
-      return this->data;
+      std::atomic<Node *> &slot = table->slots[slot_i];
+      Node *node = slot.load(std::memory_order_relaxed);
+      if (node == nullptr) {
+        return nullptr;
+      }
+      if (node != removed_marker() && node->hash == hash && IsEqual{}(node->item.first, key)) {
+        return &slot;
+      }
     }
-  };
+  }
 
-  Mutex mutex_;
-  UsedSet set_;
+  /**
+   * Make sure that \a n more nodes can be inserted into the table of the shard. Has to be called
+   * with the shard mutex locked.
+   */
+  void ensure_can_add(Shard &shard, const int64_t n)
+  {
+    Table *old_table = shard.table.load(std::memory_order_relaxed);
+    /* Keep the load factor (including removed slots) below one half, so that probing stays
+     * short. */
+    if (old_table != nullptr && (shard.occupied + n) * 2 <= old_table->size()) {
+      return;
+    }
+    int64_t new_size = MinTableSize;
+    while (new_size < (shard.size + n) * 2) {
+      new_size *= 2;
+    }
+    Table *new_table = MEM_new<Table>(__func__, new_size);
+    if (old_table != nullptr) {
+      for (const int64_t i : IndexRange(old_table->size())) {
+        Node *node = old_table->slots[i].load(std::memory_order_relaxed);
+        if (is_node(node)) {
+          uint64_t slot_i = first_slot(node->hash, new_table->slot_mask);
+          while (new_table->slots[slot_i].load(std::memory_order_relaxed) != nullptr) {
+            slot_i = (slot_i + 1) & new_table->slot_mask;
+          }
+          new_table->slots[slot_i].store(node, std::memory_order_relaxed);
+        }
+      }
+    }
+    shard.table.store(new_table);
+    shard.occupied = shard.size;
+    if (old_table != nullptr) {
+      /* Readers may still probe the old table. */
+      wait_for_readers(shard);
+      MEM_delete(old_table);
+    }
+  }
 
- public:
-  using MutableAccessor = Accessor;
-  using ConstAccessor = Accessor;
+  /**
+   * Publish a new node that does not exist in the table yet. Has to be called with the shard mutex
+   * locked and after #ensure_can_add.
+   */
+  void insert_locked(Shard &shard, Node &node)
+  {
+    Table &table = *shard.table.load(std::memory_order_relaxed);
+    uint64_t slot_i = first_slot(node.hash, table.slot_mask);
+    /* Removed slots are not reused, because a concurrent reader might still be probing past them
+     * in search of a key that comes later in the probing sequence. */
+    while (table.slots[slot_i].load(std::memory_order_relaxed) != nullptr) {
+      slot_i = (slot_i + 1) & table.slot_mask;
+    }
+    table.slots[slot_i].store(&node, std::memory_order_release);
+    shard.size++;
+    shard.occupied++;
+  }
 
-  bool lookup(Accessor &accessor, const Key &key)
+  /**
+   * Lock a node that the caller added a user to for the accessor and remove that user again.
+   * Returns false if the node has been removed from the map in the mean-time.
+   */
+  template<bool IsConst> static bool lock_user_node(Accessor<IsConst> &accessor, Node &node)
   {
-    accessor.mutex = std::unique_lock(mutex_);
-    SetKey *stored_key = const_cast<SetKey *>(set_.lookup_key_ptr_as(key));
-    if (!stored_key) {
+    lock(node, !IsConst);
+    if (node.removed) {
+      unlock(node, !IsConst);
+      remove_user(node);
       return false;
     }
-    accessor.data = &stored_key->item;
+    /* This is never the last user, because the table still owns the node. */
+    node.users.fetch_sub(1, std::memory_order_relaxed);
+    accessor.node_ = &node;
     return true;
   }
 
-  bool add(Accessor &accessor, const Key &key)
+  template<bool IsConst> bool lookup_impl(Accessor<IsConst> &accessor, const Key &key)
   {
-    accessor.mutex = std::unique_lock(mutex_);
-    const bool newly_added = !set_.contains_as(key);
-    SetKey &stored_key = const_cast<SetKey &>(set_.lookup_key_or_add_as(key));
-    accessor.data = &stored_key.item;
-    return newly_added;
+    accessor.release();
+    const uint64_t hash = Hash{}(key);
+    Shard &shard = this->shard_for_hash(hash);
+    return this->find_and_lock(shard, key, hash, accessor);
   }
 
-  bool remove(const Key &key)
+  template<bool IsConst> bool add_impl(Accessor<IsConst> &accessor, const Key &key)
   {
-    std::unique_lock lock(mutex_);
-    return set_.remove_as(key);
+    accessor.release();
+    const uint64_t hash = Hash{}(key);
+    Shard &shard = this->shard_for_hash(hash);
+    while (true) {
+      if (this->find_and_lock(shard, key, hash, accessor)) {
+        return false;
+      }
+      Node *node;
+      {
+        std::lock_guard lock{shard.mutex};
+        if (std::atomic<Node *> *slot = this->find_slot_locked(shard, key, hash)) {
+          /* Another thread added the key in the mean-time. */
+          node = slot->load(std::memory_order_relaxed);
+          add_user(*node);
+        }
+        else {
+          this->ensure_can_add(shard, 1);
+          /* The node is locked before it is published, so that no other thread can see the
+           * default constructed value. */
+          node = MEM_new<Node>(__func__, key, hash, 1);
+          node->lock_state.store(IsConst ? SharedLockIncrement : ExclusiveLockBit,
+                                 std::memory_order_relaxed);
+          this->insert_locked(shard, *node);
+          accessor.node_ = node;
+          return true;
+        }
+      }
+      /* The shard mutex must not be locked here, because the accessor that holds the node lock
+       * may want to add other keys to the same shard. */
+      if (lock_user_node(accessor, *node)) {
+        return false;
+      }
+      /* The key has just been removed, try again. */
+    }
   }
-
-#endif
 };
 
 }  // namespace blender
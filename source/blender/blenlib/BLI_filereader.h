@@ -48,12 +48,27 @@ typedef struct FileReader {
 
 /** Create #FileReader from raw file descriptor. */
 FileReader *BLI_filereader_new_file(int filedes) ATTR_WARN_UNUSED_RESULT;
-/** Create #FileReader from raw file descriptor using memory-mapped IO. */
-FileReader *BLI_filereader_new_mmap(int filedes) ATTR_WARN_UNUSED_RESULT;
+/**
+ * Create #FileReader from raw file descriptor using memory-mapped IO.
+ * \param copy_on_write: Make the mapped memory writable, see #BLI_mmap_open_copy_on_write.
+ */
+FileReader *BLI_filereader_new_mmap(int filedes, bool copy_on_write) ATTR_WARN_UNUSED_RESULT;
+/**
+ * Get the memory-mapped file used by a #FileReader created with #BLI_filereader_new_mmap,
+ * or null for any other kind of #FileReader.
+ */
+struct BLI_mmap_file *BLI_filereader_get_mmap(FileReader *reader) ATTR_NONNULL();
 /** Create #FileReader from a region of memory. */
 FileReader *BLI_filereader_new_memory(const void *data, size_t len) ATTR_WARN_UNUSED_RESULT
     ATTR_NONNULL();
 /** Create #FileReader from applying `Zstd` decompression on an underlying file. */
 FileReader *BLI_filereader_new_zstd(FileReader *base) ATTR_WARN_UNUSED_RESULT ATTR_NONNULL();
+/**
+ * Same as #BLI_filereader_new_zstd, but when the file uses the seekable format, the frames
+ * following the read position are decompressed in parallel. Intended for reading whole files
+ * sequentially, e.g. when loading a .blend file.
+ */
+FileReader *BLI_filereader_new_zstd_read_ahead(FileReader *base) ATTR_WARN_UNUSED_RESULT
+    ATTR_NONNULL();
 /** Create #FileReader from applying `Gzip` decompression on an underlying file. */
 FileReader *BLI_filereader_new_gzip(FileReader *base) ATTR_WARN_UNUSED_RESULT ATTR_NONNULL();
@@ -12,6 +12,8 @@
 
 #include <algorithm>
 
+#include "BLI_array.hh"
+#include "BLI_probing_strategies.hh"
 #include "BLI_utildefines.h"
 #include "BLI_vector.hh"
 
@@ -276,6 +278,87 @@ class HashTableStats {
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Control Bytes
+ *
+ * Some probing strategies (currently only #GroupProbingStrategy) need one control byte per slot
+ * that is stored separately from the slots. Hash tables keep those up to date by calling #occupy
+ * and #remove whenever the state of a slot changes. For all other probing strategies, this class
+ * is empty and all methods do nothing.
+ *
+ * \{ */
+
+template<typename ProbingStrategy, typename Allocator> class HashTableControlBytes {
+ public:
+  HashTableControlBytes(Allocator /*allocator*/ = {}) {}
+  HashTableControlBytes(const int64_t /*slots_num*/, Allocator /*allocator*/ = {}) {}
+
+  void reinitialize(const int64_t /*slots_num*/) {}
+
+  void occupy(const int64_t /*slot_index*/, const uint64_t /*hash*/) {}
+
+  void remove(const int64_t /*slot_index*/) {}
+
+  const uint8_t *data() const
+  {
+    return nullptr;
+  }
+
+  int64_t size_in_bytes() const
+  {
+    return 0;
+  }
+};
+
+template<typename Allocator> class HashTableControlBytes<GroupProbingStrategy, Allocator> {
+ private:
+  static constexpr int64_t group_size = GroupProbingStrategy::group_size;
+
+  /**
+   * One byte per slot. Tables with fewer slots than a group are padded, so that a full group can
+   * always be loaded.
+   */
+  Array<uint8_t, group_size, Allocator> bytes_;
+
+ public:
+  HashTableControlBytes(Allocator allocator = {}) : HashTableControlBytes(1, allocator) {}
+
+  HashTableControlBytes(const int64_t slots_num, Allocator allocator = {})
+      : bytes_(allocator)
+  {
+    this->reinitialize(slots_num);
+  }
+
+  void reinitialize(const int64_t slots_num)
+  {
+    bytes_.reinitialize(std::max(slots_num, group_size));
+    bytes_.as_mutable_span().take_front(slots_num).fill(GroupProbingStrategy::empty);
+    bytes_.as_mutable_span().drop_front(slots_num).fill(GroupProbingStrategy::padding);
+  }
+
+  void occupy(const int64_t slot_index, const uint64_t hash)
+  {
+    bytes_[slot_index] = GroupProbingStrategy::tag_for_hash(hash);
+  }
+
+  void remove(const int64_t slot_index)
+  {
+    bytes_[slot_index] = GroupProbingStrategy::removed;
+  }
+
+  const uint8_t *data() const
+  {
+    return bytes_.data();
+  }
+
+  int64_t size_in_bytes() const
+  {
+    return bytes_.size();
+  }
+};
+
+/** \} */
+
 /**
  * This struct provides an equality operator that returns true for all objects that compare equal
  * when one would use the `==` operator. This is different from std::equal_to<T>, because that
@@ -15,6 +15,8 @@
 
 #include "MEM_guardedalloc.h"
 
+struct BLI_mmap_file;
+
 namespace blender {
 
 /**
@@ -284,6 +286,12 @@ template<typename T> void free_shared_data(T **data, const ImplicitSharingInfo *
  */
 const ImplicitSharingInfo *info_for_mem_free(void *data);
 
+/**
+ * Create an implicit sharing object for data that points into a memory-mapped file. The file
+ * stays mapped until the sharing info is freed.
+ */
+const ImplicitSharingInfo *info_for_mmap(BLI_mmap_file *file);
+
 /**
  * Make data mutable (single-user) if it is shared. For trivially-copyable data only.
  */
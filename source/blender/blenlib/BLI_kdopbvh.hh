@@ -9,7 +9,9 @@
  */
 
 #include "BLI_function_ref.hh"
+#include "BLI_index_mask_fwd.hh"
 #include "BLI_math_vector_types.hh"
+#include "BLI_span.hh"
 #include "BLI_sys_types.h"
 
 struct BVHTree;
@@ -78,6 +80,11 @@ enum {
    * pair once, rather than twice in different order as usual. */
   BVH_OVERLAP_SELF = (1 << 2),
 };
+enum {
+  /* Split the leafs using a surface area heuristic instead of at the median. This takes longer to
+   * build, but speeds up queries, especially when the elements are distributed unevenly. */
+  BVH_BALANCE_SAH = (1 << 0),
+};
 enum {
   /* Use a priority queue to process nodes in the optimal order (for slow callbacks) */
   BVH_NEAREST_OPTIMAL_ORDER = (1 << 0),
@@ -145,6 +152,11 @@ BVHTree *BLI_bvhtree_new(int maxsize, float epsilon, char tree_type, char axis);
  */
 void BLI_bvhtree_insert(BVHTree *tree, int index, const float co[3], int numpoints);
 void BLI_bvhtree_balance(BVHTree *tree);
+/**
+ * \param flag: #BVH_BALANCE_SAH to build a tree that is faster to query, which is worth it for
+ * trees that are queried many times or are only refitted with #BLI_bvhtree_update_tree.
+ */
+void BLI_bvhtree_balance_ex(BVHTree *tree, int flag);
 
 /**
  * Update: first update points/nodes, then call update_tree to refit the bounding volumes.
@@ -310,6 +322,65 @@ extern const float bvhtree_kdop_axes[13][3];
 
 namespace blender {
 
+/**
+ * Same as #BLI_bvhtree_ray_cast_ex for every index in \a mask, which is used to index
+ * \a origins, \a directions and \a r_hits. Like with the single ray version, the hits have to
+ * be initialized by the caller, their distance limits the ray length.
+ *
+ * Neighboring rays in the mask are traversed together, so this is fastest when they are
+ * coherent, e.g. when they start on the same surface. The callback is called from multiple
+ * threads.
+ */
+void BLI_bvhtree_ray_cast_batch(const BVHTree &tree,
+                                const IndexMask &mask,
+                                Span<float3> origins,
+                                Span<float3> directions,
+                                float radius,
+                                MutableSpan<BVHTreeRayHit> r_hits,
+                                BVHTree_RayCastCallback callback,
+                                void *userdata,
+                                int flag = BVH_RAYCAST_DEFAULT);
+
+/**
+ * Same as #BLI_bvhtree_find_nearest for every index in \a mask, which is used to index
+ * \a positions and \a r_nearest. The nearest results have to be initialized by the caller, their
+ * distance limits the search radius. The callback is called from multiple threads.
+ */
+void BLI_bvhtree_find_nearest_batch(const BVHTree &tree,
+                                    const IndexMask &mask,
+                                    Span<float3> positions,
+                                    MutableSpan<BVHTreeNearest> r_nearest,
+                                    BVHTree_NearestPointCallback callback,
+                                    void *userdata);
+
+/**
+ * Create an independent copy of the tree with the same structure, e.g. to refit it without
+ * affecting other users of the original tree.
+ */
+BVHTree *BLI_bvhtree_copy(const BVHTree &tree);
+
+/**
+ * Writes the points of the element with the given index (as passed to #BLI_bvhtree_insert) to
+ * \a r_points and returns their number, which has to be at most four.
+ */
+using BVHTree_LeafPointsFn = FunctionRef<int(int index, float3 *r_points)>;
+
+/**
+ * Recompute the bounds of all leafs in parallel and refit the branches to them. The structure of
+ * the tree is kept, which is much cheaper than building a new tree, but the tree becomes less
+ * efficient to query when the elements move a lot relative to each other. See
+ * #BLI_bvhtree_surface_area_cost to detect that.
+ */
+void BLI_bvhtree_refit(BVHTree &tree, BVHTree_LeafPointsFn get_leaf_points);
+
+/**
+ * Sum of the surface areas of all branches relative to the surface area of the root. This is
+ * proportional to the expected cost of ray casts according to the surface area heuristic and does
+ * not change when the whole tree is moved or scaled uniformly. Only supported for trees that use
+ * the x, y and z axes.
+ */
+float BLI_bvhtree_surface_area_cost(const BVHTree &tree);
+
 using BVHTree_RayCastCallback_CPP =
     FunctionRef<void(int index, const BVHTreeRay &ray, BVHTreeRayHit &hit)>;
 
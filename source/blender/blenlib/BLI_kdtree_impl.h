@@ -63,6 +63,41 @@ void BLI_kdtree_nd_(range_search_cb)(
     bool (*search_cb)(void *user_data, int index, const float co[KD_DIMS], float dist_sq),
     void *user_data);
 
+/**
+ * Batched versions of the queries above, for all \a co_len points in \a co_array. The points are
+ * searched in parallel.
+ *
+ * \param r_nearest: The nearest point of every search point, the index is -1 when the tree is
+ * empty.
+ */
+void BLI_kdtree_nd_(find_nearest_batch)(const KDTree *tree,
+                                        const float (*co_array)[KD_DIMS],
+                                        int co_len,
+                                        KDTreeNearest *r_nearest) ATTR_NONNULL(1);
+/**
+ * \param r_nearest: An array sized `co_len * nearest_len_capacity`, the nearest points of search
+ * point `i` start at `r_nearest[i * nearest_len_capacity]`.
+ * \param r_nearest_len: The number of points found for every search point.
+ */
+void BLI_kdtree_nd_(find_nearest_n_batch)(const KDTree *tree,
+                                          const float (*co_array)[KD_DIMS],
+                                          int co_len,
+                                          KDTreeNearest *r_nearest,
+                                          uint nearest_len_capacity,
+                                          int *r_nearest_len) ATTR_NONNULL(1);
+/**
+ * \param r_offsets: An array sized `co_len + 1`, the points found for search point `i` are
+ * `(*r_nearest)[r_offsets[i]]` up to `(*r_nearest)[r_offsets[i + 1]]`, sorted by distance.
+ * \param r_nearest: Allocated array of all points found (caller is responsible for freeing).
+ * \return The total number of points found.
+ */
+int BLI_kdtree_nd_(range_search_batch)(const KDTree *tree,
+                                       const float (*co_array)[KD_DIMS],
+                                       int co_len,
+                                       float range,
+                                       int *r_offsets,
+                                       KDTreeNearest **r_nearest) ATTR_NONNULL(1, 5, 6);
+
 int BLI_kdtree_nd_(calc_duplicates_fast)(const KDTree *tree,
                                          float range,
                                          bool use_index_order,
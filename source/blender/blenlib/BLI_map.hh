@@ -164,6 +164,7 @@ class Map {
   using SlotArray =
       Array<Slot, LoadFactor::compute_total_slots(InlineBufferCapacity, LOAD_FACTOR), Allocator>;
 #undef LOAD_FACTOR
+  using ControlBytes = HashTableControlBytes<ProbingStrategy, Allocator>;
 
   /**
    * This is the array that contains the actual slots. There is always at least one empty slot and
@@ -171,9 +172,12 @@ class Map {
    */
   SlotArray slots_;
 
+  /** Additional state per slot that is only used by some probing strategies. */
+  BLI_NO_UNIQUE_ADDRESS ControlBytes control_bytes_;
+
   /** Iterate over a slot index sequence for a given hash. */
 #define MAP_SLOT_PROBING_BEGIN(HASH, R_SLOT) \
-  SLOT_PROBING_BEGIN (ProbingStrategy, HASH, slot_mask_, SLOT_INDEX) \
+  SLOT_PROBING_BEGIN (ProbingStrategy, HASH, slot_mask_, control_bytes_.data(), SLOT_INDEX) \
     auto &R_SLOT = slots_[SLOT_INDEX];
 #define MAP_SLOT_PROBING_END() SLOT_PROBING_END()
 
@@ -190,7 +194,8 @@ class Map {
         slot_mask_(0),
         hash_(),
         is_equal_(),
-        slots_(1, allocator)
+        slots_(1, allocator),
+        control_bytes_(allocator)
   {
   }
 
@@ -215,6 +220,7 @@ class Map {
         throw;
       }
     }
+    control_bytes_ = std::move(other.control_bytes_);
     removed_slots_ = other.removed_slots_;
     occupied_and_removed_slots_ = other.occupied_and_removed_slots_;
     usable_slots_ = other.usable_slots_;
@@ -376,6 +382,7 @@ class Map {
       return false;
     }
     slot->remove();
+    control_bytes_.remove(this->slot_index(*slot));
     removed_slots_++;
     return true;
   }
@@ -392,6 +399,7 @@ class Map {
   {
     Slot &slot = this->lookup_slot(key, hash_(key));
     slot.remove();
+    control_bytes_.remove(this->slot_index(slot));
     removed_slots_++;
   }
 
@@ -408,6 +416,7 @@ class Map {
     Slot &slot = this->lookup_slot(key, hash_(key));
     Value value = std::move(*slot.value());
     slot.remove();
+    control_bytes_.remove(this->slot_index(slot));
     removed_slots_++;
     return value;
   }
@@ -428,6 +437,7 @@ class Map {
     }
     std::optional<Value> value = std::move(*slot->value());
     slot->remove();
+    control_bytes_.remove(this->slot_index(*slot));
     removed_slots_++;
     return value;
   }
@@ -453,6 +463,7 @@ class Map {
     }
     Value value = std::move(*slot->value());
     slot->remove();
+    control_bytes_.remove(this->slot_index(*slot));
     removed_slots_++;
     return value;
   }
@@ -936,6 +947,7 @@ class Map {
     Slot &slot = iterator.current_slot();
     BLI_assert(slot.is_occupied());
     slot.remove();
+    control_bytes_.remove(this->slot_index(slot));
     removed_slots_++;
   }
 
@@ -954,6 +966,7 @@ class Map {
         Value &value = *slot.value();
         if (predicate(MutableItem{key, value})) {
           slot.remove();
+          control_bytes_.remove(this->slot_index(slot));
           removed_slots_++;
         }
       }
@@ -1018,7 +1031,7 @@ class Map {
    */
   int64_t size_in_bytes() const
   {
-    return int64_t(sizeof(Slot) * slots_.size());
+    return int64_t(sizeof(Slot) * slots_.size()) + control_bytes_.size_in_bytes();
   }
 
   /**
@@ -1054,6 +1067,7 @@ class Map {
       slot.~Slot();
       new (&slot) Slot();
     }
+    control_bytes_.reinitialize(slots_.size());
 
     removed_slots_ = 0;
     occupied_and_removed_slots_ = 0;
@@ -1110,6 +1124,7 @@ class Map {
     if (this->size() == 0) {
       try {
         slots_.reinitialize(total_slots);
+        control_bytes_.reinitialize(total_slots);
       }
       catch (...) {
         this->noexcept_reset();
@@ -1123,15 +1138,17 @@ class Map {
     }
 
     SlotArray new_slots(total_slots);
+    ControlBytes new_control_bytes(total_slots);
 
     try {
       for (Slot &slot : slots_) {
         if (slot.is_occupied()) {
-          this->add_after_grow(slot, new_slots, new_slot_mask);
+          this->add_after_grow(slot, new_slots, new_control_bytes, new_slot_mask);
           slot.remove();
         }
       }
       slots_ = std::move(new_slots);
+      control_bytes_ = std::move(new_control_bytes);
     }
     catch (...) {
       this->noexcept_reset();
@@ -1144,13 +1161,19 @@ class Map {
     slot_mask_ = new_slot_mask;
   }
 
-  void add_after_grow(Slot &old_slot, SlotArray &new_slots, uint64_t new_slot_mask)
+  void add_after_grow(Slot &old_slot,
+                      SlotArray &new_slots,
+                      ControlBytes &new_control_bytes,
+                      uint64_t new_slot_mask)
   {
     uint64_t hash = old_slot.get_hash(Hash());
-    SLOT_PROBING_BEGIN (ProbingStrategy, hash, new_slot_mask, slot_index) {
+    SLOT_PROBING_BEGIN (
+        ProbingStrategy, hash, new_slot_mask, new_control_bytes.data(), slot_index)
+    {
       Slot &slot = new_slots[slot_index];
       if (slot.is_empty()) {
         slot.occupy(std::move(*old_slot.key()), hash, std::move(*old_slot.value()));
+        new_control_bytes.occupy(slot_index, hash);
         return;
       }
     }
@@ -1174,6 +1197,7 @@ class Map {
     MAP_SLOT_PROBING_BEGIN (hash, slot) {
       if (slot.is_empty()) {
         slot.occupy(std::forward<ForwardKey>(key), hash, std::forward<ForwardValue>(value)...);
+        control_bytes_.occupy(this->slot_index(slot), hash);
         BLI_assert(hash_(*slot.key()) == hash);
         occupied_and_removed_slots_++;
         return;
@@ -1190,6 +1214,7 @@ class Map {
     MAP_SLOT_PROBING_BEGIN (hash, slot) {
       if (slot.is_empty()) {
         slot.occupy(std::forward<ForwardKey>(key), hash, std::forward<ForwardValue>(value)...);
+        control_bytes_.occupy(this->slot_index(slot), hash);
         BLI_assert(hash_(*slot.key()) == hash);
         occupied_and_removed_slots_++;
         return true;
@@ -1220,12 +1245,14 @@ class Map {
         if constexpr (std::is_void_v<CreateReturnT>) {
           create_value(value_ptr);
           slot.occupy_no_value(std::forward<ForwardKey>(key), hash);
+          control_bytes_.occupy(this->slot_index(slot), hash);
           occupied_and_removed_slots_++;
           return;
         }
         else {
           auto &&return_value = create_value(value_ptr);
           slot.occupy_no_value(std::forward<ForwardKey>(key), hash);
+          control_bytes_.occupy(this->slot_index(slot), hash);
           occupied_and_removed_slots_++;
           return return_value;
         }
@@ -1246,6 +1273,7 @@ class Map {
     MAP_SLOT_PROBING_BEGIN (hash, slot) {
       if (slot.is_empty()) {
         slot.occupy(std::forward<ForwardKey>(key), hash, create_value());
+        control_bytes_.occupy(this->slot_index(slot), hash);
         BLI_assert(hash_(*slot.key()) == hash);
         occupied_and_removed_slots_++;
         return *slot.value();
@@ -1265,6 +1293,7 @@ class Map {
     MAP_SLOT_PROBING_BEGIN (hash, slot) {
       if (slot.is_empty()) {
         slot.occupy(std::forward<ForwardKey>(key), hash, std::forward<ForwardValue>(value)...);
+        control_bytes_.occupy(this->slot_index(slot), hash);
         BLI_assert(hash_(*slot.key()) == hash);
         occupied_and_removed_slots_++;
         return *slot.value();
@@ -1344,6 +1373,11 @@ class Map {
     MAP_SLOT_PROBING_END();
   }
 
+  int64_t slot_index(const Slot &slot) const
+  {
+    return &slot - slots_.data();
+  }
+
   void ensure_can_add()
   {
     if (occupied_and_removed_slots_ >= usable_slots_) {
@@ -22,14 +22,26 @@ typedef struct BLI_mmap_file BLI_mmap_file;
  * Note that this seeks to the end of the file to determine its length. */
 BLI_mmap_file *BLI_mmap_open(int fd) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
 
+/* Same as #BLI_mmap_open, but the mapped memory is writable. Writes only affect the memory of the
+ * current process and never reach the file (copy-on-write). Use this when data referencing the
+ * mapped memory may be modified in place. */
+BLI_mmap_file *BLI_mmap_open_copy_on_write(int fd) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+
 /* Reads length bytes from file at the given offset into dest.
  * Returns whether the operation was successful (may fail when reading beyond the file
  * end or when IO errors occur). */
 bool BLI_mmap_read(BLI_mmap_file *file, void *dest, size_t offset, size_t length)
     ATTR_WARN_UNUSED_RESULT ATTR_NONNULL(1);
 
+/* Direct access to the mapped memory. It is read-only unless the file was opened with
+ * #BLI_mmap_open_copy_on_write. Unlike #BLI_mmap_read, IO errors are not reported. */
 void *BLI_mmap_get_pointer(BLI_mmap_file *file) ATTR_WARN_UNUSED_RESULT;
 size_t BLI_mmap_get_length(const BLI_mmap_file *file) ATTR_WARN_UNUSED_RESULT;
 bool BLI_mmap_any_io_error(const BLI_mmap_file *file) ATTR_WARN_UNUSED_RESULT;
 
+/* Keep the file mapped until a matching #BLI_mmap_free call, e.g. when other data references
+ * the mapped memory directly. Thread-safe. */
+void BLI_mmap_add_user(BLI_mmap_file *file) ATTR_NONNULL(1);
+
+/* Remove a user of the file, it is unmapped and freed when it was the last one. */
 void BLI_mmap_free(BLI_mmap_file *file) ATTR_NONNULL(1);
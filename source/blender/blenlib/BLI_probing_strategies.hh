@@ -39,10 +39,17 @@
  *   of the hash value contain the most information, different rehashing strategies work best.
  * - When the hash table is very small, having a trivial hash function and then doing linear
  *   probing might work best.
+ *
+ * #GroupProbingStrategy is different from the other strategies. Instead of producing a sequence of
+ * slot indices based on the hash alone, it uses additional control bytes that are stored by the
+ * hash table to skip slots that can't contain the key.
  */
 
 #include <limits>
 
+#include "BLI_assert.h"
+#include "BLI_math_bits.h"
+#include "BLI_simd.hh"
 #include "BLI_sys_types.h"
 
 namespace blender {
@@ -192,11 +199,194 @@ template<uint64_t LinearSteps = 2, bool PreShuffle = false> class ShuffleProbing
   }
 };
 
+/**
+ * Probes groups of 16 consecutive slots at once, similar to "Swiss tables". Next to the slots, the
+ * hash table stores one control byte per slot, which is either #empty, #removed or a 7 bit tag
+ * derived from the hash of the key in the slot. The control bytes of a group are compared to the
+ * tag of the searched key at once using SIMD instructions, so only slots that likely contain the
+ * key have to be accessed. The groups are visited in a triangular sequence, which hits every
+ * group.
+ *
+ * This works best when comparing keys is expensive or when the slots are large, because most
+ * slots that don't contain the key are never accessed. It also keeps long probing sequences cheap,
+ * so it can work well with bad hash functions. For small keys with a good hash function, the other
+ * strategies are often faster because they don't have to maintain the control bytes.
+ *
+ * The hash table has to maintain the control bytes with #HashTableControlBytes. This is done by
+ * #Set, #Map and #VectorSet.
+ */
+class GroupProbingStrategy {
+ public:
+  static constexpr int64_t group_size = 16;
+
+  /** Control byte of an empty slot. Tags never have the highest bit set. */
+  static constexpr uint8_t empty = 0x80;
+  /** Control byte of a slot that contained a key that has been removed. */
+  static constexpr uint8_t removed = 0xFE;
+  /** Control byte of the padding at the end of tables with less than #group_size slots. */
+  static constexpr uint8_t padding = 0xFF;
+
+  /**
+   * Many hash functions (e.g. for integers and pointers) put little information into some bits,
+   * so the hash is remixed before the group index and tag are extracted from it.
+   */
+  static uint64_t remix(const uint64_t hash)
+  {
+    return (hash ^ (hash >> 32)) * 0x9E3779B97F4A7C15;
+  }
+
+  static uint8_t tag(const uint64_t remixed_hash)
+  {
+    return uint8_t(remixed_hash >> 57);
+  }
+
+  static uint8_t tag_for_hash(const uint64_t hash)
+  {
+    return tag(remix(hash));
+  }
+
+  /**
+   * Get a bit mask of the slots in the group that have to be checked when searching for a key
+   * with the given tag. Those are all slots with that tag up to the first empty slot, and the
+   * empty slot itself. Slots after the empty slot don't have to be checked, because the key would
+   * have been inserted into the empty slot otherwise.
+   */
+  static uint32_t candidates(const uint8_t *group, const uint8_t tag)
+  {
+#if BLI_HAVE_SSE2
+    const __m128i control = _mm_loadu_si128(reinterpret_cast<const __m128i *>(group));
+    const uint32_t tag_mask = uint32_t(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(control, _mm_set1_epi8(char(tag)))));
+    const uint32_t empty_mask = uint32_t(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(control, _mm_set1_epi8(char(empty)))));
+#else
+    uint32_t tag_mask = 0;
+    uint32_t empty_mask = 0;
+    for (int i = 0; i < group_size; i++) {
+      tag_mask |= uint32_t(group[i] == tag) << i;
+      empty_mask |= uint32_t(group[i] == empty) << i;
+    }
+#endif
+    /* Is zero when there is no empty slot in the group. */
+    const uint32_t first_empty = empty_mask & (~empty_mask + 1);
+    return (tag_mask & (first_empty - 1)) | first_empty;
+  }
+};
+
 /**
  * Having a specified default is convenient.
  */
 using DefaultProbingStrategy = PythonProbingStrategy<>;
 
+/**
+ * Adapts a probing strategy to the interface used by #SLOT_PROBING_BEGIN. Every value in the
+ * sequence of the strategy is the start of a range of slots, of which the slots at the offsets
+ * `first_offset()`, `next_offset(first_offset())`, ... until `end_offset()` are visited.
+ *
+ * For most strategies, those are `linear_steps()` consecutive slots and the control bytes are
+ * ignored.
+ */
+template<typename ProbingStrategy> class SlotProbingSequence {
+ private:
+  ProbingStrategy strategy_;
+
+ public:
+  SlotProbingSequence(const uint64_t hash,
+                      const uint64_t /*slot_mask*/,
+                      const uint8_t * /*control_bytes*/)
+      : strategy_(hash)
+  {
+  }
+
+  void next()
+  {
+    strategy_.next();
+  }
+
+  uint64_t get() const
+  {
+    return strategy_.get();
+  }
+
+  int64_t first_offset() const
+  {
+    return 0;
+  }
+
+  int64_t next_offset(const int64_t offset) const
+  {
+    return offset + 1;
+  }
+
+  int64_t end_offset() const
+  {
+    return strategy_.linear_steps();
+  }
+};
+
+template<> class SlotProbingSequence<GroupProbingStrategy> {
+ private:
+  const uint8_t *control_bytes_;
+  uint64_t group_mask_;
+  uint64_t group_;
+  uint64_t step_ = 0;
+  uint32_t candidates_;
+  uint8_t tag_;
+
+  static constexpr int64_t group_size = GroupProbingStrategy::group_size;
+
+ public:
+  SlotProbingSequence(const uint64_t hash, const uint64_t slot_mask, const uint8_t *control_bytes)
+      : control_bytes_(control_bytes), group_mask_(slot_mask / group_size)
+  {
+    BLI_assert(control_bytes != nullptr);
+    const uint64_t remixed_hash = GroupProbingStrategy::remix(hash);
+    tag_ = GroupProbingStrategy::tag(remixed_hash);
+    group_ = (remixed_hash >> 7) & group_mask_;
+    this->load_candidates();
+  }
+
+  void next()
+  {
+    step_++;
+    group_ = (group_ + step_) & group_mask_;
+    this->load_candidates();
+  }
+
+  uint64_t get() const
+  {
+    return group_ * group_size;
+  }
+
+  int64_t first_offset() const
+  {
+    return this->candidate_from(0);
+  }
+
+  int64_t next_offset(const int64_t offset) const
+  {
+    return this->candidate_from(offset + 1);
+  }
+
+  int64_t end_offset() const
+  {
+    return group_size;
+  }
+
+ private:
+  void load_candidates()
+  {
+    candidates_ = GroupProbingStrategy::candidates(control_bytes_ + group_ * group_size, tag_);
+  }
+
+  /** Index of the first candidate slot at or after the given offset in the group. */
+  int64_t candidate_from(const int64_t offset) const
+  {
+    const uint32_t remaining = candidates_ & (~uint32_t(0) << offset);
+    return remaining == 0 ? group_size : int64_t(bitscan_forward_uint(remaining));
+  }
+};
+
 /* Turning off clang format here, because otherwise it will mess up the alignment between the
  * macros. */
 // clang-format off
@@ -212,19 +402,23 @@ using DefaultProbingStrategy = PythonProbingStrategy<>;
  * PROBING_STRATEGY: Class describing the probing strategy.
  * HASH: The initial hash as produced by a hash function.
  * MASK: A bit mask such that (hash & MASK) is a valid slot index.
+ * CONTROL_BYTES: Pointer to the control bytes of the hash table (see #HashTableControlBytes).
+ *   Only used by strategies that need them.
  * R_SLOT_INDEX: Name of the variable that will contain the slot index.
  */
-#define SLOT_PROBING_BEGIN(PROBING_STRATEGY, HASH, MASK, R_SLOT_INDEX) \
-  PROBING_STRATEGY probing_strategy(HASH); \
+#define SLOT_PROBING_BEGIN(PROBING_STRATEGY, HASH, MASK, CONTROL_BYTES, R_SLOT_INDEX) \
+  SlotProbingSequence<PROBING_STRATEGY> probing_sequence(HASH, MASK, CONTROL_BYTES); \
   do { \
-    int64_t linear_offset = 0; \
-    uint64_t current_hash = probing_strategy.get(); \
-    do { \
+    const uint64_t current_hash = probing_sequence.get(); \
+    for (int64_t linear_offset = probing_sequence.first_offset(); \
+         linear_offset < probing_sequence.end_offset(); \
+         linear_offset = probing_sequence.next_offset(linear_offset)) \
+    { \
       int64_t R_SLOT_INDEX = int64_t((current_hash + uint64_t(linear_offset)) & MASK);
 
 #define SLOT_PROBING_END() \
-    } while (++linear_offset < probing_strategy.linear_steps()); \
-    probing_strategy.next(); \
+    } \
+    probing_sequence.next(); \
   } while (true)
 
 // clang-format on
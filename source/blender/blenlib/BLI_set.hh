@@ -146,6 +146,7 @@ class Set {
   using SlotArray =
       Array<Slot, LoadFactor::compute_total_slots(InlineBufferCapacity, LOAD_FACTOR), Allocator>;
 #undef LOAD_FACTOR
+  using ControlBytes = HashTableControlBytes<ProbingStrategy, Allocator>;
 
   /**
    * This is the array that contains the actual slots. There is always at least one empty slot and
@@ -153,9 +154,12 @@ class Set {
    */
   SlotArray slots_;
 
+  /** Additional state per slot that is only used by some probing strategies. */
+  BLI_NO_UNIQUE_ADDRESS ControlBytes control_bytes_;
+
   /** Iterate over a slot index sequence for a given hash. */
 #define SET_SLOT_PROBING_BEGIN(HASH, R_SLOT) \
-  SLOT_PROBING_BEGIN (ProbingStrategy, HASH, slot_mask_, SLOT_INDEX) \
+  SLOT_PROBING_BEGIN (ProbingStrategy, HASH, slot_mask_, control_bytes_.data(), SLOT_INDEX) \
     auto &R_SLOT = slots_[SLOT_INDEX];
 #define SET_SLOT_PROBING_END() SLOT_PROBING_END()
 
@@ -170,7 +174,8 @@ class Set {
         occupied_and_removed_slots_(0),
         usable_slots_(0),
         slot_mask_(0),
-        slots_(1, allocator)
+        slots_(1, allocator),
+        control_bytes_(allocator)
   {
   }
 
@@ -206,6 +211,7 @@ class Set {
         throw;
       }
     }
+    control_bytes_ = std::move(other.control_bytes_);
     removed_slots_ = other.removed_slots_;
     occupied_and_removed_slots_ = other.occupied_and_removed_slots_;
     usable_slots_ = other.usable_slots_;
@@ -503,6 +509,7 @@ class Set {
     Slot &slot = const_cast<Slot &>(it.current_slot());
     BLI_assert(slot.is_occupied());
     slot.remove();
+    control_bytes_.remove(this->slot_index(slot));
     removed_slots_++;
   }
 
@@ -520,6 +527,7 @@ class Set {
         const Key &key = *slot.key();
         if (predicate(key)) {
           slot.remove();
+          control_bytes_.remove(this->slot_index(slot));
           removed_slots_++;
         }
       }
@@ -567,6 +575,7 @@ class Set {
       slot.~Slot();
       new (&slot) Slot();
     }
+    control_bytes_.reinitialize(slots_.size());
 
     removed_slots_ = 0;
     occupied_and_removed_slots_ = 0;
@@ -627,7 +636,7 @@ class Set {
    */
   int64_t size_in_bytes() const
   {
-    return sizeof(Slot) * slots_.size();
+    return sizeof(Slot) * slots_.size() + control_bytes_.size_in_bytes();
   }
 
   /**
@@ -700,6 +709,7 @@ class Set {
     if (this->size() == 0) {
       try {
         slots_.reinitialize(total_slots);
+        control_bytes_.reinitialize(total_slots);
       }
       catch (...) {
         this->noexcept_reset();
@@ -714,15 +724,17 @@ class Set {
 
     /* The grown array that we insert the keys into. */
     SlotArray new_slots(total_slots);
+    ControlBytes new_control_bytes(total_slots);
 
     try {
       for (Slot &slot : slots_) {
         if (slot.is_occupied()) {
-          this->add_after_grow(slot, new_slots, new_slot_mask);
+          this->add_after_grow(slot, new_slots, new_control_bytes, new_slot_mask);
           slot.remove();
         }
       }
       slots_ = std::move(new_slots);
+      control_bytes_ = std::move(new_control_bytes);
     }
     catch (...) {
       this->noexcept_reset();
@@ -735,14 +747,20 @@ class Set {
     slot_mask_ = new_slot_mask;
   }
 
-  void add_after_grow(Slot &old_slot, SlotArray &new_slots, const uint64_t new_slot_mask)
+  void add_after_grow(Slot &old_slot,
+                      SlotArray &new_slots,
+                      ControlBytes &new_control_bytes,
+                      const uint64_t new_slot_mask)
   {
     const uint64_t hash = old_slot.get_hash(Hash());
 
-    SLOT_PROBING_BEGIN (ProbingStrategy, hash, new_slot_mask, slot_index) {
+    SLOT_PROBING_BEGIN (
+        ProbingStrategy, hash, new_slot_mask, new_control_bytes.data(), slot_index)
+    {
       Slot &slot = new_slots[slot_index];
       if (slot.is_empty()) {
         slot.occupy(std::move(*old_slot.key()), hash);
+        new_control_bytes.occupy(slot_index, hash);
         return;
       }
     }
@@ -810,6 +828,7 @@ class Set {
     SET_SLOT_PROBING_BEGIN (hash, slot) {
       if (slot.is_empty()) {
         slot.occupy(std::forward<ForwardKey>(key), hash);
+        control_bytes_.occupy(this->slot_index(slot), hash);
         BLI_assert(hash_(*slot.key()) == hash);
         occupied_and_removed_slots_++;
         return;
@@ -825,6 +844,7 @@ class Set {
     SET_SLOT_PROBING_BEGIN (hash, slot) {
       if (slot.is_empty()) {
         slot.occupy(std::forward<ForwardKey>(key), hash);
+        control_bytes_.occupy(this->slot_index(slot), hash);
         BLI_assert(hash_(*slot.key()) == hash);
         occupied_and_removed_slots_++;
         return true;
@@ -843,6 +863,7 @@ class Set {
     SET_SLOT_PROBING_BEGIN (hash, slot) {
       if (slot.is_empty()) {
         slot.occupy(std::forward<ForwardKey>(key), hash);
+        control_bytes_.occupy(this->slot_index(slot), hash);
         BLI_assert(hash_(*slot.key()) == hash);
         occupied_and_removed_slots_++;
         return true;
@@ -862,6 +883,7 @@ class Set {
     SET_SLOT_PROBING_BEGIN (hash, slot) {
       if (slot.contains(key, is_equal_, hash)) {
         slot.remove();
+        control_bytes_.remove(this->slot_index(slot));
         removed_slots_++;
         return true;
       }
@@ -880,6 +902,7 @@ class Set {
     SET_SLOT_PROBING_BEGIN (hash, slot) {
       if (slot.contains(key, is_equal_, hash)) {
         slot.remove();
+        control_bytes_.remove(this->slot_index(slot));
         removed_slots_++;
         return;
       }
@@ -898,6 +921,7 @@ class Set {
       }
       if (slot.is_empty()) {
         slot.occupy(std::forward<ForwardKey>(key), hash);
+        control_bytes_.occupy(this->slot_index(slot), hash);
         BLI_assert(hash_(*slot.key()) == hash);
         occupied_and_removed_slots_++;
         return *slot.key();
@@ -923,6 +947,11 @@ class Set {
     SET_SLOT_PROBING_END();
   }
 
+  int64_t slot_index(const Slot &slot) const
+  {
+    return &slot - slots_.data();
+  }
+
   void ensure_can_add()
   {
     if (occupied_and_removed_slots_ >= usable_slots_) {
@@ -36,6 +36,13 @@ template<typename T> class SharedCache {
   struct CacheData {
     CacheMutex mutex;
     T data;
+    /**
+     * Cache of the data before it was tagged dirty with #tag_dirty_keep_previous, if it was
+     * shared with other objects at that point.
+     */
+    std::shared_ptr<const CacheData> previous;
+    /** True when #data still contains the outdated data from before it was tagged dirty. */
+    bool data_is_previous = false;
     CacheData() = default;
     CacheData(const T &data) : data(data) {}
   };
@@ -53,19 +60,69 @@ template<typename T> class SharedCache {
   {
     if (cache_.use_count() == 1) {
       cache_->mutex.tag_dirty();
+      this->reset_previous();
     }
     else {
       cache_ = std::make_shared<CacheData>();
     }
   }
 
+  /**
+   * Like #tag_dirty, but the outdated data stays available for the next computation with
+   * #ensure_with_previous. This is useful when the data can be updated much faster than it can be
+   * computed from scratch. If the cache is shared, the outdated data is kept alive by the new
+   * cache and not copied.
+   */
+  void tag_dirty_keep_previous()
+  {
+    if (cache_.use_count() == 1) {
+      if (cache_->mutex.is_cached()) {
+        cache_->previous.reset();
+        cache_->data_is_previous = true;
+        cache_->mutex.tag_dirty();
+      }
+    }
+    else {
+      std::shared_ptr<CacheData> new_cache = std::make_shared<CacheData>();
+      if (cache_->mutex.is_cached()) {
+        new_cache->previous = cache_;
+      }
+      cache_ = std::move(new_cache);
+    }
+  }
+
   /**
    * If the cache is dirty, trigger its computation with the provided function which should set
    * the proper data.
    */
   void ensure(FunctionRef<void(T &data)> compute_cache)
   {
-    cache_->mutex.ensure([&]() { compute_cache(this->cache_->data); });
+    cache_->mutex.ensure([&]() {
+      compute_cache(this->cache_->data);
+      this->reset_previous();
+    });
+  }
+
+  /**
+   * Same as #ensure, but the computation also gets the data from before the last call to
+   * #tag_dirty_keep_previous, if there is any. When it is the same as the data to compute, it can
+   * be updated in place. Otherwise the previous data may still be used by other objects and must
+   * not be modified.
+   */
+  void ensure_with_previous(FunctionRef<void(T &data, const T *previous)> compute_cache)
+  {
+    cache_->mutex.ensure([&]() {
+      CacheData &cache = *this->cache_;
+      const T *previous = nullptr;
+      if (cache.data_is_previous) {
+        previous = &cache.data;
+      }
+      else if (cache.previous) {
+        previous = &cache.previous->data;
+      }
+      compute_cache(cache.data, previous);
+      this->reset_previous();
+    });
   }
 
   /**
@@ -107,6 +164,13 @@ template<typename T> class SharedCache {
   {
     return cache_->mutex.is_cached();
   }
+
+ private:
+  void reset_previous()
+  {
+    cache_->previous.reset();
+    cache_->data_is_previous = false;
+  }
 };
 
 }  // namespace blender
@@ -0,0 +1,159 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+#pragma once
+
+/** \file
+ * \ingroup bli
+ *
+ * Opt-in tracing of the work done by the task scheduler. When enabled, every parallel region
+ * (#threading::parallel_for, #BLI_task_parallel_range), every executed sub-range, task pool task
+ * and task graph node, and every lazy threading hint is recorded together with the thread that
+ * ran it. The result can be exported in the Trace Event Format as used by `chrome://tracing` and
+ * https://ui.perfetto.dev.
+ *
+ * This helps answering questions like: are all threads busy, are the tasks too small to be worth
+ * the overhead, or did work end up on an unexpected thread?
+ *
+ * The recorded events are labeled with the innermost #ScopedLabel that was active on the thread
+ * that created the work. The label strings are not copied, so they have to stay valid until the
+ * trace is exported. Typically they are string literals.
+ *
+ * When tracing is disabled, the overhead is a single relaxed atomic load per parallel region or
+ * task.
+ */
+
+#include <atomic>
+#include <string>
+
+#include "BLI_string_ref.hh"
+
+namespace blender::threading::trace {
+
+enum class EventType : int8_t {
+  /** A call to #parallel_for or #BLI_task_parallel_range that uses multiple threads. */
+  ParallelRegion,
+  /** A sub-range of a parallel region that is processed by one thread. */
+  ParallelRange,
+  /** A task pushed to a #TaskPool. */
+  PoolTask,
+  /** A node of a #TaskGraph. */
+  GraphNode,
+  /** A lazy threading hint that was sent, see #lazy_threading::send_hint. */
+  LazyThreadingHint,
+};
+
+namespace detail {
+extern std::atomic<bool> is_enabled;
+void record(EventType type, const char *label, int64_t start_ns, int64_t end_ns, int64_t size);
+int64_t time_now_ns();
+/** Set the label of the current thread and return the previous one. */
+const char *exchange_label(const char *label);
+}  // namespace detail
+
+/** Whether events are recorded currently. This is cheap enough to be checked in hot code. */
+inline bool is_enabled()
+{
+  return detail::is_enabled.load(std::memory_order_relaxed);
+}
+
+/** Remove previously recorded events and start recording. */
+void start();
+/** Stop recording. The events are kept until they are exported or #start is called again. */
+void stop();
+
+/** Number of events that have been recorded since #start. */
+int64_t events_num();
+
+/** All recorded events in the (JSON based) Trace Event Format. */
+std::string to_trace_event_json();
+/** Write #to_trace_event_json to a file. Returns false if the file could not be written. */
+bool write_trace_event_json(StringRefNull filepath);
+
+/** The label of the innermost #ScopedLabel on the current thread, or null. */
+const char *current_label();
+
+/**
+ * Same as #current_label when tracing is enabled, otherwise null. Used when creating tasks, to
+ * avoid accessing thread local storage when tracing is disabled.
+ */
+inline const char *current_label_if_enabled()
+{
+  return is_enabled() ? current_label() : nullptr;
+}
+
+/**
+ * Labels all tasks that are created on the current thread while it exists. This is a no-op when
+ * tracing is disabled.
+ */
+class ScopedLabel {
+ private:
+  const char *previous_label_ = nullptr;
+  bool is_active_ = false;
+
+ public:
+  explicit ScopedLabel(const char *label)
+  {
+    if (is_enabled()) {
+      previous_label_ = detail::exchange_label(label);
+      is_active_ = true;
+    }
+  }
+
+  ~ScopedLabel()
+  {
+    if (is_active_) {
+      detail::exchange_label(previous_label_);
+    }
+  }
+
+  ScopedLabel(const ScopedLabel &other) = delete;
+  ScopedLabel &operator=(const ScopedLabel &other) = delete;
+};
+
+/**
+ * Records an event that spans the lifetime of this object. Nothing is recorded if tracing was
+ * disabled on construction.
+ */
+class ScopedEvent {
+ private:
+  int64_t start_ns_ = -1;
+  const char *label_;
+  int64_t size_;
+  EventType type_;
+
+ public:
+  /**
+   * \param label: Usually the result of #current_label on the thread that created the work.
+   * \param size: Number of elements that are processed, or -1 if that's not meaningful.
+   */
+  ScopedEvent(const EventType type, const char *label, const int64_t size = -1)
+      : label_(label), size_(size), type_(type)
+  {
+    if (is_enabled()) {
+      start_ns_ = detail::time_now_ns();
+    }
+  }
+
+  ~ScopedEvent()
+  {
+    if (start_ns_ >= 0) {
+      detail::record(type_, label_, start_ns_, detail::time_now_ns(), size_);
+    }
+  }
+
+  ScopedEvent(const ScopedEvent &other) = delete;
+  ScopedEvent &operator=(const ScopedEvent &other) = delete;
+};
+
+/** Record an event without a duration, e.g. a lazy threading hint. */
+inline void record_instant(const EventType type, const char *label)
+{
+  if (is_enabled()) {
+    const int64_t time = detail::time_now_ns();
+    detail::record(type, label, time, time, -1);
+  }
+}
+
+}  // namespace blender::threading::trace
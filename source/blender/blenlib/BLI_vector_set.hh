@@ -131,6 +131,7 @@ class VectorSet {
   static constexpr LoadFactor max_load_factor_ = LoadFactor(LOAD_FACTOR);
   using SlotArray = Array<Slot, LoadFactor::compute_total_slots(4, LOAD_FACTOR), Allocator>;
 #undef LOAD_FACTOR
+  using ControlBytes = HashTableControlBytes<ProbingStrategy, Allocator>;
 
   /**
    * This is the array that contains the actual slots. There is always at least one empty slot and
@@ -138,6 +139,9 @@ class VectorSet {
    */
   SlotArray slots_;
 
+  /** Additional state per slot that is only used by some probing strategies. */
+  BLI_NO_UNIQUE_ADDRESS ControlBytes control_bytes_;
+
   /** A buffer for #keys_ that will remain uninitialized until it is used. */
   BLI_NO_UNIQUE_ADDRESS TypedBuffer<Key, InlineBufferCapacity> inline_buffer_;
 
@@ -150,7 +154,7 @@ class VectorSet {
 
   /** Iterate over a slot index sequence for a given hash. */
 #define VECTOR_SET_SLOT_PROBING_BEGIN(HASH, R_SLOT) \
-  SLOT_PROBING_BEGIN (ProbingStrategy, HASH, slot_mask_, SLOT_INDEX) \
+  SLOT_PROBING_BEGIN (ProbingStrategy, HASH, slot_mask_, control_bytes_.data(), SLOT_INDEX) \
     auto &R_SLOT = slots_[SLOT_INDEX];
 #define VECTOR_SET_SLOT_PROBING_END() SLOT_PROBING_END()
 
@@ -178,7 +182,8 @@ class VectorSet {
         occupied_and_removed_slots_(0),
         usable_slots_(0),
         slot_mask_(0),
-        slots_(1, allocator)
+        slots_(1, allocator),
+        control_bytes_(allocator)
   {
     keys_ = inline_buffer_;
   }
@@ -206,7 +211,7 @@ class VectorSet {
     }
   }
 
-  VectorSet(const VectorSet &other) : slots_(other.slots_)
+  VectorSet(const VectorSet &other) : slots_(other.slots_), control_bytes_(other.control_bytes_)
   {
     if (other.size() <= InlineBufferCapacity) {
       usable_slots_ = other.size();
@@ -240,7 +245,8 @@ class VectorSet {
       : removed_slots_(other.removed_slots_),
         occupied_and_removed_slots_(other.occupied_and_removed_slots_),
         slot_mask_(other.slot_mask_),
-        slots_(std::move(other.slots_))
+        slots_(std::move(other.slots_)),
+        control_bytes_(std::move(other.control_bytes_))
   {
     if (other.is_inline()) {
       const int64_t size = other.size();
@@ -276,6 +282,7 @@ class VectorSet {
     other.usable_slots_ = 0;
     other.slot_mask_ = 0;
     other.slots_ = SlotArray(1);
+    other.control_bytes_.reinitialize(1);
     other.keys_ = other.inline_buffer_;
   }
 
@@ -636,7 +643,8 @@ class VectorSet {
    */
   int64_t size_in_bytes() const
   {
-    return int64_t(sizeof(Slot) * slots_.size() + sizeof(Key) * usable_slots_);
+    return int64_t(sizeof(Slot) * slots_.size() + sizeof(Key) * usable_slots_) +
+           control_bytes_.size_in_bytes();
   }
 
   /**
@@ -672,6 +680,7 @@ class VectorSet {
       slot.~Slot();
       new (&slot) Slot();
     }
+    control_bytes_.reinitialize(slots_.size());
 
     removed_slots_ = 0;
     occupied_and_removed_slots_ = 0;
@@ -743,6 +752,7 @@ class VectorSet {
     if (this->size() == 0) {
       try {
         slots_.reinitialize(total_slots);
+        control_bytes_.reinitialize(total_slots);
 
         Key *new_keys;
         if (usable_slots <= InlineBufferCapacity) {
@@ -770,15 +780,17 @@ class VectorSet {
     }
 
     SlotArray new_slots(total_slots);
+    ControlBytes new_control_bytes(total_slots);
 
     try {
       for (Slot &slot : slots_) {
         if (slot.is_occupied()) {
-          this->add_after_grow(slot, new_slots, new_slot_mask);
+          this->add_after_grow(slot, new_slots, new_control_bytes, new_slot_mask);
           slot.remove();
         }
       }
       slots_ = std::move(new_slots);
+      control_bytes_ = std::move(new_control_bytes);
     }
     catch (...) {
       this->noexcept_reset();
@@ -821,15 +833,21 @@ class VectorSet {
     slot_mask_ = new_slot_mask;
   }
 
-  void add_after_grow(Slot &old_slot, SlotArray &new_slots, const uint64_t new_slot_mask)
+  void add_after_grow(Slot &old_slot,
+                      SlotArray &new_slots,
+                      ControlBytes &new_control_bytes,
+                      const uint64_t new_slot_mask)
   {
     const Key &key = keys_[old_slot.index()];
     const uint64_t hash = old_slot.get_hash(key, Hash());
 
-    SLOT_PROBING_BEGIN (ProbingStrategy, hash, new_slot_mask, slot_index) {
+    SLOT_PROBING_BEGIN (
+        ProbingStrategy, hash, new_slot_mask, new_control_bytes.data(), slot_index)
+    {
       Slot &slot = new_slots[slot_index];
       if (slot.is_empty()) {
         slot.occupy(old_slot.index(), hash);
+        new_control_bytes.occupy(slot_index, hash);
         return;
       }
     }
@@ -870,6 +888,7 @@ class VectorSet {
         new (dst) Key(std::forward<ForwardKey>(key));
         BLI_assert(hash_(*dst) == hash);
         slot.occupy(index, hash);
+        control_bytes_.occupy(this->slot_index(slot), hash);
         occupied_and_removed_slots_++;
         return;
       }
@@ -888,6 +907,7 @@ class VectorSet {
         new (dst) Key(std::forward<ForwardKey>(key));
         BLI_assert(hash_(*dst) == hash);
         slot.occupy(index, hash);
+        control_bytes_.occupy(this->slot_index(slot), hash);
         occupied_and_removed_slots_++;
         return true;
       }
@@ -909,6 +929,7 @@ class VectorSet {
         new (dst) Key(std::forward<ForwardKey>(key));
         BLI_assert(hash_(*dst) == hash);
         slot.occupy(index, hash);
+        control_bytes_.occupy(this->slot_index(slot), hash);
         occupied_and_removed_slots_++;
         return true;
       }
@@ -965,6 +986,7 @@ class VectorSet {
         new (dst) Key(std::forward<ForwardKey>(key));
         BLI_assert(hash_(*dst) == hash);
         slot.occupy(index, hash);
+        control_bytes_.occupy(this->slot_index(slot), hash);
         occupied_and_removed_slots_++;
         return index;
       }
@@ -986,6 +1008,7 @@ class VectorSet {
     VECTOR_SET_SLOT_PROBING_BEGIN (hash, slot) {
       if (slot.has_index(index_to_pop)) {
         slot.remove();
+        control_bytes_.remove(this->slot_index(slot));
         return key;
       }
     }
@@ -1033,6 +1056,7 @@ class VectorSet {
 
     keys_[last_element_index].~Key();
     slot.remove();
+    control_bytes_.remove(this->slot_index(slot));
     removed_slots_++;
   }
 
@@ -1065,6 +1089,11 @@ class VectorSet {
     VECTOR_SET_SLOT_PROBING_END();
   }
 
+  int64_t slot_index(const Slot &slot) const
+  {
+    return &slot - slots_.data();
+  }
+
   void ensure_can_add()
   {
     if (occupied_and_removed_slots_ >= usable_slots_) {
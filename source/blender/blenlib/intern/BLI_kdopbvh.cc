@@ -24,16 +24,23 @@
  */
 
 #include <algorithm>
+#include <atomic>
+#include <functional>
 
 #include "MEM_guardedalloc.h"
 
 #include "BLI_alloca.h"
+#include "BLI_array.hh"
 #include "BLI_heap_simple.h"
+#include "BLI_index_mask.hh"
 #include "BLI_kdopbvh.hh"
+#include "BLI_math_bits.h"
 #include "BLI_math_geom.h"
 #include "BLI_math_vector_types.hh"
+#include "BLI_simd.hh"
 #include "BLI_stack.h"
 #include "BLI_task.h"
+#include "BLI_task.hh"
 #include "BLI_utildefines.h"
 
 #include "BLI_strict_flags.h" /* IWYU pragma: keep. Keep last. */
@@ -444,6 +451,46 @@ static void node_join(BVHTree *tree, BVHNode *node)
   }
 }
 
+/**
+ * #node_join for all branches of the subtree, bottom-up. The subtrees of branches up to
+ * \a parallel_depth are updated in parallel.
+ */
+static void bvhtree_refit_recursive(BVHTree *tree, BVHNode *node, const int parallel_depth)
+{
+  using namespace blender;
+  if (node->node_num == 0) {
+    return;
+  }
+  if (parallel_depth > 0) {
+    threading::parallel_for(IndexRange(node->node_num), 1, [&](const IndexRange range) {
+      for (const int64_t i : range) {
+        bvhtree_refit_recursive(tree, node->children[i], parallel_depth - 1);
+      }
+    });
+  }
+  else {
+    for (int i = 0; i < node->node_num; i++) {
+      bvhtree_refit_recursive(tree, node->children[i], 0);
+    }
+  }
+  node_join(tree, node);
+}
+
+static void bvhtree_refit_parallel(BVHTree *tree)
+{
+  if (tree->branch_num == 0) {
+    return;
+  }
+  /* Estimate how deep subtrees still contain enough leafs to be worth a separate task. */
+  int parallel_depth = 0;
+  for (int leafs_num = tree->leaf_num; leafs_num > KDOPBVH_THREAD_LEAF_THRESHOLD;
+       leafs_num /= tree->tree_type)
+  {
+    parallel_depth++;
+  }
+  bvhtree_refit_recursive(tree, tree->nodes[tree->leaf_num], parallel_depth);
+}
+
 #ifdef USE_PRINT_TREE
 
 /* -------------------------------------------------------------------- */
@@ -844,6 +891,384 @@ static void non_recursive_bvh_div_nodes(const BVHTree *tree,
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Surface Area Heuristic Build
+ *
+ * Alternative to the implicit tree of #non_recursive_bvh_div_nodes. Instead of splitting the leafs
+ * at the median of the largest axis, they are split where the estimated cost of the children is
+ * smallest: the surface area of their bounds times the number of leafs they contain. The best
+ * split is found by binning the leaf centers along the x, y and z axis.
+ *
+ * A branch is split until it has `tree_type` children (or only leafs), the largest child is split
+ * first. This results in more branches than the implicit tree, but in fewer nodes being visited by
+ * queries on unevenly distributed leafs. Like the implicit tree, all children are stored after
+ * their parent in the nodes array, which #BLI_bvhtree_update_tree relies on.
+ *
+ * Only the x, y and z axis of the bounding volumes are used, so this is only supported for trees
+ * whose k-DOP contains these axis.
+ * \{ */
+
+#define BVH_SAH_BINS_NUM 16
+/** Ranges with fewer leafs are binned and built on a single thread. */
+#define BVH_SAH_THREAD_LEAF_THRESHOLD 4096
+/** Branches deeper than this are split at the median, to bound the recursion depth of queries. */
+#define BVH_SAH_MAX_DEPTH 64
+
+struct BVHSAHBranch {
+  int children_num;
+  char main_axis;
+  /** Index of the child branch, or `-1 - i` for the leaf at position `i` of the leafs array. */
+  int children[MAX_TREETYPE];
+};
+
+struct BVHSAHBuildData {
+  const BVHTree *tree;
+  BVHNode **leafs_array;
+  blender::MutableSpan<BVHSAHBranch> branches;
+  std::atomic<int> branches_num;
+};
+
+struct BVHSAHBin {
+  /** Bounds of the leafs in the bin, in the same layout as #BVHNode.bv. */
+  float bv[6];
+  int leafs_num;
+};
+
+struct BVHSAHBins {
+  BVHSAHBin bins[3][BVH_SAH_BINS_NUM];
+};
+
+static void bvh_sah_bounds_init(float bv[6])
+{
+  for (int axis = 0; axis < 3; axis++) {
+    bv[axis * 2] = FLT_MAX;
+    bv[axis * 2 + 1] = -FLT_MAX;
+  }
+}
+
+static void bvh_sah_bounds_join(float bv[6], const float other[6])
+{
+  for (int axis = 0; axis < 3; axis++) {
+    bv[axis * 2] = std::min(bv[axis * 2], other[axis * 2]);
+    bv[axis * 2 + 1] = std::max(bv[axis * 2 + 1], other[axis * 2 + 1]);
+  }
+}
+
+/** Half the surface area of the bounds, the factor doesn't matter for comparing costs. */
+static float bvh_sah_bounds_area(const float bv[6])
+{
+  const float dx = bv[1] - bv[0];
+  const float dy = bv[3] - bv[2];
+  const float dz = bv[5] - bv[4];
+  if (dx < 0.0f || dy < 0.0f || dz < 0.0f) {
+    return 0.0f;
+  }
+  return dx * dy + dy * dz + dz * dx;
+}
+
+static float bvh_sah_leaf_center(const BVHNode *node, const int axis)
+{
+  return (node->bv[axis * 2] + node->bv[axis * 2 + 1]) * 0.5f;
+}
+
+static int bvh_sah_bin_index(const float center, const float min, const float scale)
+{
+  return std::clamp(int((center - min) * scale), 0, BVH_SAH_BINS_NUM - 1);
+}
+
+/**
+ * Reorder the leafs in the range so that it can be split in two at the returned position.
+ * \param r_axis: The axis (0, 1 or 2) along which the leafs were split.
+ */
+static int bvh_sah_split(const BVHSAHBuildData *data,
+                         const int begin,
+                         const int end,
+                         const bool use_median,
+                         int *r_axis)
+{
+  using namespace blender;
+  BVHNode **leafs = data->leafs_array;
+  const IndexRange range = IndexRange::from_begin_end(begin, end);
+
+  /* The bounds of the leaf centers, the leafs are binned within these. */
+  struct CenterBounds {
+    float bv[6];
+  };
+  CenterBounds identity;
+  bvh_sah_bounds_init(identity.bv);
+  const CenterBounds centers = threading::parallel_reduce(
+      range,
+      BVH_SAH_THREAD_LEAF_THRESHOLD,
+      identity,
+      [&](const IndexRange sub_range, const CenterBounds &init) {
+        CenterBounds result = init;
+        for (const int64_t i : sub_range) {
+          for (int axis = 0; axis < 3; axis++) {
+            const float center = bvh_sah_leaf_center(leafs[i], axis);
+            result.bv[axis * 2] = std::min(result.bv[axis * 2], center);
+            result.bv[axis * 2 + 1] = std::max(result.bv[axis * 2 + 1], center);
+          }
+        }
+        return result;
+      },
+      [](const CenterBounds &a, const CenterBounds &b) {
+        CenterBounds result = a;
+        bvh_sah_bounds_join(result.bv, b.bv);
+        return result;
+      });
+
+  int best_axis = -1;
+  int best_bin = 0;
+  if (!use_median) {
+    BVHSAHBins bins_identity;
+    for (int axis = 0; axis < 3; axis++) {
+      for (BVHSAHBin &bin : bins_identity.bins[axis]) {
+        bvh_sah_bounds_init(bin.bv);
+        bin.leafs_num = 0;
+      }
+    }
+    float scale[3];
+    for (int axis = 0; axis < 3; axis++) {
+      const float extent = centers.bv[axis * 2 + 1] - centers.bv[axis * 2];
+      scale[axis] = extent > 0.0f ? float(BVH_SAH_BINS_NUM) / extent : 0.0f;
+    }
+    const BVHSAHBins bins = threading::parallel_reduce(
+        range,
+        BVH_SAH_THREAD_LEAF_THRESHOLD,
+        bins_identity,
+        [&](const IndexRange sub_range, const BVHSAHBins &init) {
+          BVHSAHBins result = init;
+          for (const int64_t i : sub_range) {
+            for (int axis = 0; axis < 3; axis++) {
+              const int bin_index = bvh_sah_bin_index(
+                  bvh_sah_leaf_center(leafs[i], axis), centers.bv[axis * 2], scale[axis]);
+              BVHSAHBin &bin = result.bins[axis][bin_index];
+              bvh_sah_bounds_join(bin.bv, leafs[i]->bv);
+              bin.leafs_num++;
+            }
+          }
+          return result;
+        },
+        [](const BVHSAHBins &a, const BVHSAHBins &b) {
+          BVHSAHBins result = a;
+          for (int axis = 0; axis < 3; axis++) {
+            for (int bin_index = 0; bin_index < BVH_SAH_BINS_NUM; bin_index++) {
+              BVHSAHBin &bin = result.bins[axis][bin_index];
+              bvh_sah_bounds_join(bin.bv, b.bins[axis][bin_index].bv);
+              bin.leafs_num += b.bins[axis][bin_index].leafs_num;
+            }
+          }
+          return result;
+        });
+
+    float best_cost = FLT_MAX;
+    for (int axis = 0; axis < 3; axis++) {
+      if (scale[axis] == 0.0f) {
+        continue;
+      }
+      /* Cost of the leafs right of every split position, the split is after bin `i`. */
+      float right_cost[BVH_SAH_BINS_NUM];
+      float bv[6];
+      bvh_sah_bounds_init(bv);
+      int leafs_num = 0;
+      for (int i = BVH_SAH_BINS_NUM - 1; i > 0; i--) {
+        bvh_sah_bounds_join(bv, bins.bins[axis][i].bv);
+        leafs_num += bins.bins[axis][i].leafs_num;
+        right_cost[i - 1] = bvh_sah_bounds_area(bv) * float(leafs_num);
+      }
+      bvh_sah_bounds_init(bv);
+      leafs_num = 0;
+      for (int i = 0; i < BVH_SAH_BINS_NUM - 1; i++) {
+        bvh_sah_bounds_join(bv, bins.bins[axis][i].bv);
+        leafs_num += bins.bins[axis][i].leafs_num;
+        const float cost = bvh_sah_bounds_area(bv) * float(leafs_num) + right_cost[i];
+        if (leafs_num > 0 && leafs_num < end - begin && cost < best_cost) {
+          best_cost = cost;
+          best_axis = axis;
+          best_bin = i;
+        }
+      }
+    }
+  }
+
+  if (best_axis != -1) {
+    const float min = centers.bv[best_axis * 2];
+    const float scale = float(BVH_SAH_BINS_NUM) /
+                        (centers.bv[best_axis * 2 + 1] - centers.bv[best_axis * 2]);
+    BVHNode **mid = std::partition(leafs + begin, leafs + end, [&](const BVHNode *node) {
+      return bvh_sah_bin_index(bvh_sah_leaf_center(node, best_axis), min, scale) <= best_bin;
+    });
+    *r_axis = best_axis;
+    return int(mid - leafs);
+  }
+
+  /* All centers are in the same place or the branch is too deep, split at the median. */
+  int axis = 0;
+  for (int i = 1; i < 3; i++) {
+    const float extent = centers.bv[i * 2 + 1] - centers.bv[i * 2];
+    if (extent > centers.bv[axis * 2 + 1] - centers.bv[axis * 2]) {
+      axis = i;
+    }
+  }
+  const int mid = (begin + end) / 2;
+  std::nth_element(
+      leafs + begin, leafs + mid, leafs + end, [&](const BVHNode *a, const BVHNode *b) {
+        return bvh_sah_leaf_center(a, axis) < bvh_sah_leaf_center(b, axis);
+      });
+  *r_axis = axis;
+  return mid;
+}
+
+/** Build the branch containing the leafs in the range, returns its index. */
+static int bvh_sah_build_branch(BVHSAHBuildData *data,
+                                const int begin,
+                                const int end,
+                                const int depth)
+{
+  using namespace blender;
+  const int branch_index = data->branches_num.fetch_add(1);
+  BVHSAHBranch &branch = data->branches[branch_index];
+  branch.main_axis = 0;
+
+  int children_begin[MAX_TREETYPE + 1];
+  int children_num = 1;
+  children_begin[0] = begin;
+  children_begin[1] = end;
+  while (children_num < data->tree->tree_type) {
+    int largest = 0;
+    for (int i = 1; i < children_num; i++) {
+      if (children_begin[i + 1] - children_begin[i] >
+          children_begin[largest + 1] - children_begin[largest])
+      {
+        largest = i;
+      }
+    }
+    if (children_begin[largest + 1] - children_begin[largest] <= 1) {
+      break;
+    }
+    int axis;
+    const int mid = bvh_sah_split(data,
+                                  children_begin[largest],
+                                  children_begin[largest + 1],
+                                  depth >= BVH_SAH_MAX_DEPTH,
+                                  &axis);
+    if (children_num == 1) {
+      /* The first split divides all leafs, use it for the traversal order. */
+      branch.main_axis = char(axis);
+    }
+    for (int i = children_num; i > largest; i--) {
+      children_begin[i + 1] = children_begin[i];
+    }
+    children_begin[largest + 1] = mid;
+    children_num++;
+  }
+  branch.children_num = children_num;
+
+  auto build_child = [&](const int i) {
+    const int child_begin = children_begin[i];
+    const int child_end = children_begin[i + 1];
+    branch.children[i] = (child_end - child_begin == 1) ?
+                             -1 - child_begin :
+                             bvh_sah_build_branch(data, child_begin, child_end, depth + 1);
+  };
+  if (end - begin > BVH_SAH_THREAD_LEAF_THRESHOLD) {
+    threading::parallel_for(IndexRange(children_num), 1, [&](const IndexRange range) {
+      for (const int64_t i : range) {
+        build_child(int(i));
+      }
+    });
+  }
+  else {
+    for (int i = 0; i < children_num; i++) {
+      build_child(i);
+    }
+  }
+  return branch_index;
+}
+
+/**
+ * The SAH tree can have more branches than the implicit tree the arrays are allocated for in
+ * #BLI_bvhtree_new, grow them when necessary. Leafs keep their position in the node array.
+ */
+static void bvhtree_ensure_branches_capacity(BVHTree *tree, const int branch_num)
+{
+  const size_t nodes_num_old = MEM_allocN_len(tree->nodes) / sizeof(*tree->nodes);
+  const size_t nodes_num = size_t(tree->leaf_num) + size_t(branch_num);
+  if (nodes_num <= nodes_num_old) {
+    return;
+  }
+  const size_t axis = size_t(tree->axis);
+  const size_t tree_type = size_t(tree->tree_type);
+
+  BVHNode *nodearray_old = tree->nodearray;
+  float *nodebv = MEM_calloc_arrayN<float>(axis * nodes_num, "BVHNodeBV");
+  BVHNode **nodechild = MEM_calloc_arrayN<BVHNode *>(tree_type * nodes_num, "BVHNodeBV");
+  BVHNode *nodearray = MEM_calloc_arrayN<BVHNode>(nodes_num, "BVHNodeArray");
+  memcpy(nodebv, tree->nodebv, sizeof(float) * axis * size_t(tree->leaf_num));
+  for (size_t i = 0; i < nodes_num; i++) {
+    if (i < size_t(tree->leaf_num)) {
+      nodearray[i].index = nodearray_old[i].index;
+    }
+    nodearray[i].bv = &nodebv[i * axis];
+    nodearray[i].children = &nodechild[i * tree_type];
+  }
+
+  tree->nodes = static_cast<BVHNode **>(
+      MEM_recallocN(tree->nodes, sizeof(*tree->nodes) * nodes_num));
+  for (int i = 0; i < tree->leaf_num; i++) {
+    tree->nodes[i] = nodearray + (tree->nodes[i] - nodearray_old);
+  }
+
+  MEM_freeN(tree->nodearray);
+  MEM_freeN(tree->nodebv);
+  MEM_freeN(tree->nodechild);
+  tree->nodearray = nodearray;
+  tree->nodebv = nodebv;
+  tree->nodechild = nodechild;
+}
+
+static void bvh_sah_build(BVHTree *tree)
+{
+  using namespace blender;
+  const int leaf_num = tree->leaf_num;
+  BLI_assert(leaf_num > 1);
+
+  /* Every branch has at least two children, so there are fewer branches than leafs. */
+  Array<BVHSAHBranch> branches(leaf_num - 1, NoInitialization());
+  BVHSAHBuildData data{tree, tree->nodes, branches, 0};
+  bvh_sah_build_branch(&data, 0, leaf_num, 0);
+  const int branch_num = data.branches_num.load();
+
+  bvhtree_ensure_branches_capacity(tree, branch_num);
+
+  BVHNode *branches_array = tree->nodearray + leaf_num;
+  threading::parallel_for(IndexRange(branch_num), 1024, [&](const IndexRange range) {
+    for (const int64_t i : range) {
+      const BVHSAHBranch &branch = branches[i];
+      BVHNode *node = &branches_array[i];
+      node->main_axis = branch.main_axis;
+      node->node_num = char(branch.children_num);
+      for (int k = 0; k < tree->tree_type; k++) {
+        if (k < branch.children_num) {
+          const int child = branch.children[k];
+          node->children[k] = child < 0 ? tree->nodes[-1 - child] : &branches_array[child];
+          node->children[k]->parent = node;
+        }
+        else {
+          node->children[k] = nullptr;
+        }
+      }
+      tree->nodes[leaf_num + i] = node;
+    }
+  });
+  branches_array[0].parent = nullptr;
+  tree->branch_num = branch_num;
+
+  bvhtree_refit_parallel(tree);
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name BLI_bvhtree API
  * \{ */
@@ -930,7 +1355,7 @@ void BLI_bvhtree_free(BVHTree *tree)
   }
 }
 
-void BLI_bvhtree_balance(BVHTree *tree)
+void BLI_bvhtree_balance_ex(BVHTree *tree, const int flag)
 {
   BVHNode **leafs_array = tree->nodes;
 
@@ -938,15 +1363,20 @@ void BLI_bvhtree_balance(BVHTree *tree)
    * (some big bug goes here if its being called more than once per tree) */
   BLI_assert(tree->branch_num == 0);
 
-  /* Build the implicit tree */
-  non_recursive_bvh_div_nodes(
-      tree, tree->nodearray + (tree->leaf_num - 1), leafs_array, tree->leaf_num);
+  if ((flag & BVH_BALANCE_SAH) && tree->leaf_num > 1 && tree->start_axis == 0) {
+    bvh_sah_build(tree);
+  }
+  else {
+    /* Build the implicit tree */
+    non_recursive_bvh_div_nodes(
+        tree, tree->nodearray + (tree->leaf_num - 1), leafs_array, tree->leaf_num);
 
-  /* current code expects the branches to be linked to the nodes array
-   * we perform that linkage here */
-  tree->branch_num = implicit_needed_branches(tree->tree_type, tree->leaf_num);
-  for (int i = 0; i < tree->branch_num; i++) {
-    tree->nodes[tree->leaf_num + i] = &tree->nodearray[tree->leaf_num + i];
+    /* current code expects the branches to be linked to the nodes array
+     * we perform that linkage here */
+    tree->branch_num = implicit_needed_branches(tree->tree_type, tree->leaf_num);
+    for (int i = 0; i < tree->branch_num; i++) {
+      tree->nodes[tree->leaf_num + i] = &tree->nodearray[tree->leaf_num + i];
+    }
   }
 
 #ifdef USE_SKIP_LINKS
@@ -962,6 +1392,11 @@ void BLI_bvhtree_balance(BVHTree *tree)
 #endif
 }
 
+void BLI_bvhtree_balance(BVHTree *tree)
+{
+  BLI_bvhtree_balance_ex(tree, 0);
+}
+
 static void bvhtree_node_inflate(const BVHTree *tree, BVHNode *node, const float dist)
 {
   axis_t axis_iter;
@@ -1016,10 +1451,14 @@ bool BLI_bvhtree_update_node(
 
 void BLI_bvhtree_update_tree(BVHTree *tree)
 {
+  if (tree->leaf_num > KDOPBVH_THREAD_LEAF_THRESHOLD) {
+    bvhtree_refit_parallel(tree);
+    return;
+  }
+
   /* Update bottom=>top
    * TRICKY: the way we build the tree all the children have an index greater than the parent
    * This allows us todo a bottom up update by starting on the bigger numbered branch. */
-
   BVHNode **root = tree->nodes + tree->leaf_num;
   BVHNode **index = tree->nodes + tree->leaf_num + tree->branch_num - 1;
 
@@ -2094,6 +2533,418 @@ void BLI_bvhtree_ray_cast_all(const BVHTree *tree,
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Batched Queries
+ *
+ * Rays and points are traversed in packets of #BVH_PACKET_SIZE queries. The bounding volume of
+ * every visited node is tested against all queries of the packet at once, which pays off because
+ * neighboring queries (e.g. from adjacent elements of a geometry) tend to visit the same nodes.
+ * Packets are processed in parallel.
+ *
+ * \{ */
+
+/** Matches the width of SSE registers, on ARM the SSE code is emulated with NEON. */
+#define BVH_PACKET_SIZE 4
+
+/** Number of queries per task in the batched queries. */
+#define BVH_BATCH_GRAIN_SIZE 256
+
+struct BVHRayCastPacket {
+  BVHRayCastData lanes[BVH_PACKET_SIZE];
+  /* Ray origins and inverse directions per axis, for the node tests of all lanes at once. */
+  float origin[3][BVH_PACKET_SIZE];
+  float idot_axis[3][BVH_PACKET_SIZE];
+  bool use_radius;
+};
+
+/**
+ * Same test as #fast_ray_nearest_hit for all lanes in \a lane_mask, the returned bit mask contains
+ * the lanes whose ray hits \a bv closer than the current hit of that lane.
+ */
+static int ray_packet_nearest_hit(const BVHRayCastPacket *packet,
+                                  const int lane_mask,
+                                  const float bv[6],
+                                  float r_dist[BVH_PACKET_SIZE])
+{
+  if (packet->use_radius) {
+    int hit_mask = 0;
+    for (int lane = 0; lane < BVH_PACKET_SIZE; lane++) {
+      if (lane_mask & (1 << lane)) {
+        r_dist[lane] = ray_nearest_hit(&packet->lanes[lane], bv);
+        if (r_dist[lane] < packet->lanes[lane].hit.dist) {
+          hit_mask |= 1 << lane;
+        }
+      }
+    }
+    return hit_mask;
+  }
+
+#if BLI_HAVE_SSE2
+  __m128 t_near = _mm_setzero_ps();
+  __m128 t_far = _mm_setzero_ps();
+  for (int axis = 0; axis < 3; axis++) {
+    const __m128 origin = _mm_loadu_ps(packet->origin[axis]);
+    const __m128 idot = _mm_loadu_ps(packet->idot_axis[axis]);
+    const __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bv[axis * 2]), origin), idot);
+    const __m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bv[axis * 2 + 1]), origin), idot);
+    if (axis == 0) {
+      t_near = _mm_min_ps(t1, t2);
+      t_far = _mm_max_ps(t1, t2);
+    }
+    else {
+      t_near = _mm_max_ps(t_near, _mm_min_ps(t1, t2));
+      t_far = _mm_min_ps(t_far, _mm_max_ps(t1, t2));
+    }
+  }
+  const __m128 hit_dist = _mm_setr_ps(packet->lanes[0].hit.dist,
+                                      packet->lanes[1].hit.dist,
+                                      packet->lanes[2].hit.dist,
+                                      packet->lanes[3].hit.dist);
+  const __m128 is_hit = _mm_and_ps(
+      _mm_and_ps(_mm_cmple_ps(t_near, t_far), _mm_cmpge_ps(t_far, _mm_setzero_ps())),
+      _mm_cmplt_ps(t_near, hit_dist));
+  _mm_storeu_ps(r_dist, t_near);
+  return _mm_movemask_ps(is_hit) & lane_mask;
+#else
+  int hit_mask = 0;
+  for (int lane = 0; lane < BVH_PACKET_SIZE; lane++) {
+    float t_near = -FLT_MAX;
+    float t_far = FLT_MAX;
+    for (int axis = 0; axis < 3; axis++) {
+      const float t1 = (bv[axis * 2] - packet->origin[axis][lane]) *
+                       packet->idot_axis[axis][lane];
+      const float t2 = (bv[axis * 2 + 1] - packet->origin[axis][lane]) *
+                       packet->idot_axis[axis][lane];
+      t_near = std::max(t_near, std::min(t1, t2));
+      t_far = std::min(t_far, std::max(t1, t2));
+    }
+    r_dist[lane] = t_near;
+    if (t_near <= t_far && t_far >= 0.0f && t_near < packet->lanes[lane].hit.dist) {
+      hit_mask |= 1 << lane;
+    }
+  }
+  return hit_mask & lane_mask;
+#endif
+}
+
+static void dfs_raycast_packet(BVHRayCastPacket *packet, BVHNode *node, const int lane_mask)
+{
+  float dist[BVH_PACKET_SIZE];
+  const int hit_mask = ray_packet_nearest_hit(packet, lane_mask, node->bv, dist);
+  if (hit_mask == 0) {
+    return;
+  }
+
+  if (node->node_num == 0) {
+    for (int lane = 0; lane < BVH_PACKET_SIZE; lane++) {
+      if ((hit_mask & (1 << lane)) == 0) {
+        continue;
+      }
+      BVHRayCastData *data = &packet->lanes[lane];
+      if (data->callback) {
+        data->callback(data->userdata, node->index, &data->ray, &data->hit);
+      }
+      else {
+        data->hit.index = node->index;
+        data->hit.dist = dist[lane];
+        madd_v3_v3v3fl(data->hit.co, data->ray.origin, data->ray.direction, dist[lane]);
+      }
+    }
+  }
+  else {
+    /* All rays of a coherent packet prefer the same order, use the first ray that is still
+     * active to pick the loop direction. */
+    const BVHRayCastData *data = &packet->lanes[bitscan_forward_i(hit_mask)];
+    if (data->ray_dot_axis[node->main_axis] > 0.0f) {
+      for (int i = 0; i != node->node_num; i++) {
+        dfs_raycast_packet(packet, node->children[i], hit_mask);
+      }
+    }
+    else {
+      for (int i = node->node_num - 1; i >= 0; i--) {
+        dfs_raycast_packet(packet, node->children[i], hit_mask);
+      }
+    }
+  }
+}
+
+struct BVHNearestPacket {
+  BVHNearestData lanes[BVH_PACKET_SIZE];
+  /* Projected coordinates per axis, for the node tests of all lanes at once. */
+  float proj[3][BVH_PACKET_SIZE];
+};
+
+/**
+ * Same test as #calc_nearest_point_squared for all lanes in \a lane_mask, the returned bit mask
+ * contains the lanes that are closer to \a bv than to their current nearest element.
+ */
+static int nearest_packet_closer(const BVHNearestPacket *packet,
+                                 const int lane_mask,
+                                 const float bv[6])
+{
+#if BLI_HAVE_SSE2
+  __m128 dist_sq = _mm_setzero_ps();
+  for (int axis = 0; axis < 3; axis++) {
+    const __m128 proj = _mm_loadu_ps(packet->proj[axis]);
+    const __m128 nearest = _mm_min_ps(_mm_max_ps(proj, _mm_set1_ps(bv[axis * 2])),
+                                      _mm_set1_ps(bv[axis * 2 + 1]));
+    const __m128 delta = _mm_sub_ps(proj, nearest);
+    dist_sq = _mm_add_ps(dist_sq, _mm_mul_ps(delta, delta));
+  }
+  const __m128 nearest_dist_sq = _mm_setr_ps(packet->lanes[0].nearest.dist_sq,
+                                             packet->lanes[1].nearest.dist_sq,
+                                             packet->lanes[2].nearest.dist_sq,
+                                             packet->lanes[3].nearest.dist_sq);
+  return _mm_movemask_ps(_mm_cmplt_ps(dist_sq, nearest_dist_sq)) & lane_mask;
+#else
+  int closer_mask = 0;
+  for (int lane = 0; lane < BVH_PACKET_SIZE; lane++) {
+    float dist_sq = 0.0f;
+    for (int axis = 0; axis < 3; axis++) {
+      const float proj = packet->proj[axis][lane];
+      const float delta = proj - std::min(std::max(proj, bv[axis * 2]), bv[axis * 2 + 1]);
+      dist_sq += delta * delta;
+    }
+    if (dist_sq < packet->lanes[lane].nearest.dist_sq) {
+      closer_mask |= 1 << lane;
+    }
+  }
+  return closer_mask & lane_mask;
+#endif
+}
+
+static void dfs_find_nearest_packet(BVHNearestPacket *packet, BVHNode *node, const int lane_mask)
+{
+  const int closer_mask = nearest_packet_closer(packet, lane_mask, node->bv);
+  if (closer_mask == 0) {
+    return;
+  }
+
+  if (node->node_num == 0) {
+    for (int lane = 0; lane < BVH_PACKET_SIZE; lane++) {
+      if ((closer_mask & (1 << lane)) == 0) {
+        continue;
+      }
+      BVHNearestData *data = &packet->lanes[lane];
+      if (data->callback) {
+        data->callback(data->userdata, node->index, data->co, &data->nearest);
+      }
+      else {
+        data->nearest.index = node->index;
+        data->nearest.dist_sq = calc_nearest_point_squared(data->proj, node, data->nearest.co);
+      }
+    }
+  }
+  else {
+    /* Same heuristic as #dfs_find_nearest_dfs, based on the first point that is still active. */
+    const BVHNearestData *data = &packet->lanes[bitscan_forward_i(closer_mask)];
+    if (data->proj[node->main_axis] <= node->children[0]->bv[node->main_axis * 2 + 1]) {
+      for (int i = 0; i != node->node_num; i++) {
+        dfs_find_nearest_packet(packet, node->children[i], closer_mask);
+      }
+    }
+    else {
+      for (int i = node->node_num - 1; i >= 0; i--) {
+        dfs_find_nearest_packet(packet, node->children[i], closer_mask);
+      }
+    }
+  }
+}
+
+namespace blender {
+
+void BLI_bvhtree_ray_cast_batch(const BVHTree &tree,
+                                const IndexMask &mask,
+                                const Span<float3> origins,
+                                const Span<float3> directions,
+                                const float radius,
+                                MutableSpan<BVHTreeRayHit> r_hits,
+                                BVHTree_RayCastCallback callback,
+                                void *userdata,
+                                const int flag)
+{
+  BVHNode *root = tree.nodes[tree.leaf_num];
+  if (root == nullptr) {
+    return;
+  }
+
+  mask.foreach_segment(GrainSize(BVH_BATCH_GRAIN_SIZE), [&](const IndexMaskSegment segment) {
+    for (int64_t start = 0; start < segment.size(); start += BVH_PACKET_SIZE) {
+      const int lanes_num = int(std::min<int64_t>(BVH_PACKET_SIZE, segment.size() - start));
+      BVHRayCastPacket packet;
+      packet.use_radius = radius != 0.0f;
+      /* Unused lanes repeat the last ray, so that all lanes contain valid numbers. */
+      for (int lane = 0; lane < BVH_PACKET_SIZE; lane++) {
+        const int64_t i = segment[start + std::min(lane, lanes_num - 1)];
+        BVHRayCastData *data = &packet.lanes[lane];
+        BLI_ASSERT_UNIT_V3(directions[i]);
+        data->tree = &tree;
+        data->callback = callback;
+        data->userdata = userdata;
+        copy_v3_v3(data->ray.origin, origins[i]);
+        copy_v3_v3(data->ray.direction, directions[i]);
+        data->ray.radius = radius;
+        bvhtree_ray_cast_data_precalc(data, flag);
+        data->hit = r_hits[i];
+        for (int axis = 0; axis < 3; axis++) {
+          packet.origin[axis][lane] = data->ray.origin[axis];
+          packet.idot_axis[axis][lane] = data->idot_axis[axis];
+        }
+      }
+
+      dfs_raycast_packet(&packet, root, (1 << lanes_num) - 1);
+
+      for (int lane = 0; lane < lanes_num; lane++) {
+        r_hits[segment[start + lane]] = packet.lanes[lane].hit;
+      }
+    }
+  });
+}
+
+void BLI_bvhtree_find_nearest_batch(const BVHTree &tree,
+                                    const IndexMask &mask,
+                                    const Span<float3> positions,
+                                    MutableSpan<BVHTreeNearest> r_nearest,
+                                    BVHTree_NearestPointCallback callback,
+                                    void *userdata)
+{
+  BVHNode *root = tree.nodes[tree.leaf_num];
+  if (root == nullptr) {
+    return;
+  }
+  if (tree.start_axis != 0) {
+    /* The packet test only stores the projections on the first three axes. */
+    mask.foreach_index(GrainSize(BVH_BATCH_GRAIN_SIZE), [&](const int64_t i) {
+      BLI_bvhtree_find_nearest_ex(&tree, positions[i], &r_nearest[i], callback, userdata, 0);
+    });
+    return;
+  }
+
+  mask.foreach_segment(GrainSize(BVH_BATCH_GRAIN_SIZE), [&](const IndexMaskSegment segment) {
+    for (int64_t start = 0; start < segment.size(); start += BVH_PACKET_SIZE) {
+      const int lanes_num = int(std::min<int64_t>(BVH_PACKET_SIZE, segment.size() - start));
+      BVHNearestPacket packet;
+      /* Unused lanes repeat the last point, so that all lanes contain valid numbers. */
+      for (int lane = 0; lane < BVH_PACKET_SIZE; lane++) {
+        const int64_t i = segment[start + std::min(lane, lanes_num - 1)];
+        BVHNearestData *data = &packet.lanes[lane];
+        data->tree = &tree;
+        data->co = positions[i];
+        data->callback = callback;
+        data->userdata = userdata;
+        for (axis_t axis_iter = tree.start_axis; axis_iter != tree.stop_axis; axis_iter++) {
+          data->proj[axis_iter] = dot_v3v3(data->co, bvhtree_kdop_axes[axis_iter]);
+        }
+        data->nearest = r_nearest[i];
+        for (int axis = 0; axis < 3; axis++) {
+          packet.proj[axis][lane] = data->proj[axis];
+        }
+      }
+
+      dfs_find_nearest_packet(&packet, root, (1 << lanes_num) - 1);
+
+      for (int lane = 0; lane < lanes_num; lane++) {
+        r_nearest[segment[start + lane]] = packet.lanes[lane].nearest;
+      }
+    }
+  });
+}
+
+}  // namespace blender
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name BLI_bvhtree_copy / BLI_bvhtree_refit
+ * \{ */
+
+namespace blender {
+
+BVHTree *BLI_bvhtree_copy(const BVHTree &tree)
+{
+  BVHTree *new_tree = static_cast<BVHTree *>(MEM_dupallocN(&tree));
+  new_tree->nodes = static_cast<BVHNode **>(MEM_dupallocN(tree.nodes));
+  new_tree->nodearray = static_cast<BVHNode *>(MEM_dupallocN(tree.nodearray));
+  new_tree->nodebv = static_cast<float *>(MEM_dupallocN(tree.nodebv));
+  new_tree->nodechild = static_cast<BVHNode **>(MEM_dupallocN(tree.nodechild));
+
+  /* All pointers between nodes point into the arrays of the original tree. */
+  const auto remap_node = [&](BVHNode *node) {
+    return node ? new_tree->nodearray + (node - tree.nodearray) : nullptr;
+  };
+  const int64_t nodes_num = int64_t(MEM_allocN_len(tree.nodearray) / sizeof(BVHNode));
+  const int64_t children_num = int64_t(MEM_allocN_len(tree.nodechild) / sizeof(BVHNode *));
+  const int64_t node_pointers_num = int64_t(MEM_allocN_len(tree.nodes) / sizeof(BVHNode *));
+  threading::parallel_for(IndexRange(nodes_num), 4096, [&](const IndexRange range) {
+    for (const int64_t i : range) {
+      const BVHNode &old_node = tree.nodearray[i];
+      BVHNode &node = new_tree->nodearray[i];
+      node.bv = new_tree->nodebv + (old_node.bv - tree.nodebv);
+      node.children = new_tree->nodechild + (old_node.children - tree.nodechild);
+      node.parent = remap_node(old_node.parent);
+#ifdef USE_SKIP_LINKS
+      node.skip[0] = remap_node(old_node.skip[0]);
+      node.skip[1] = remap_node(old_node.skip[1]);
+#endif
+    }
+  });
+  threading::parallel_for(IndexRange(children_num), 4096, [&](const IndexRange range) {
+    for (const int64_t i : range) {
+      new_tree->nodechild[i] = remap_node(tree.nodechild[i]);
+    }
+  });
+  threading::parallel_for(IndexRange(node_pointers_num), 4096, [&](const IndexRange range) {
+    for (const int64_t i : range) {
+      new_tree->nodes[i] = remap_node(tree.nodes[i]);
+    }
+  });
+  return new_tree;
+}
+
+void BLI_bvhtree_refit(BVHTree &tree, const BVHTree_LeafPointsFn get_leaf_points)
+{
+  /* Leafs are stored at the start of the node array in the order in which they were inserted. */
+  threading::parallel_for(IndexRange(tree.leaf_num), 1024, [&](const IndexRange range) {
+    float3 points[4];
+    for (const int64_t i : range) {
+      BVHNode *node = &tree.nodearray[i];
+      const int points_num = get_leaf_points(node->index, points);
+      BLI_assert(points_num >= 1 && points_num <= 4);
+      create_kdop_hull(&tree, node, &points[0].x, points_num, 0);
+      bvhtree_node_inflate(&tree, node, tree.epsilon);
+    }
+  });
+  BLI_bvhtree_update_tree(&tree);
+}
+
+float BLI_bvhtree_surface_area_cost(const BVHTree &tree)
+{
+  BLI_assert(tree.start_axis == 0);
+  if (tree.branch_num == 0) {
+    return 0.0f;
+  }
+  const float root_area = bvh_sah_bounds_area(tree.nodes[tree.leaf_num]->bv);
+  if (root_area == 0.0f) {
+    return 0.0f;
+  }
+  const float branches_area = threading::parallel_reduce(
+      IndexRange(tree.leaf_num, tree.branch_num),
+      4096,
+      0.0f,
+      [&](const IndexRange range, float sum) {
+        for (const int64_t i : range) {
+          sum += bvh_sah_bounds_area(tree.nodes[i]->bv);
+        }
+        return sum;
+      },
+      std::plus<>());
+  return branches_area / root_area;
+}
+
+}  // namespace blender
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name BLI_bvhtree_range_query
  *
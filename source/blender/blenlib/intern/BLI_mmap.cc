@@ -8,10 +8,14 @@
 
 #include "BLI_mmap.h"
 #include "BLI_fileops.h"
-#include "BLI_listbase.h"
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
+#include <atomic>
 #include <cstring>
+#include <mutex>
+#include <thread>
 
 #ifndef WIN32
 #  include <csignal>
@@ -36,6 +40,9 @@ struct BLI_mmap_file {
   /* Flag to indicate IO errors. Needs to be volatile since it's being set from
    * within the signal handler, which is not part of the normal execution flow. */
   volatile bool io_error;
+
+  /* Number of users, the file is unmapped when the last one is removed. */
+  int32_t users;
 };
 
 #ifndef WIN32
@@ -52,37 +59,65 @@ struct BLI_mmap_file {
  * handler if one was configured and abort the process otherwise.
  */
 
+/**
+ * An entry in the list of mapped files checked by the error handler. Entries are never freed,
+ * so that the handler can traverse the list without locking while files are opened and freed on
+ * other threads. Unused entries are reused for new files.
+ */
+struct MappedFileEntry {
+  std::atomic<BLI_mmap_file *> file;
+  MappedFileEntry *next;
+};
+
 static struct error_handler_data {
-  ListBase open_mmaps;
+  std::atomic<MappedFileEntry *> open_mmaps;
   char configured;
   void (*next_handler)(int, siginfo_t *, void *);
-} error_handler = {{nullptr}};
+  /* Number of threads currently running the handler. A file is only unmapped when it has been
+   * removed from the list and no handler can still be accessing it. */
+  std::atomic<int> running_handlers;
+} error_handler = {};
+
+/* Serializes adding and removing files, the error handler itself does not lock. */
+static std::mutex error_handler_mutex;
 
 static void sigbus_handler(int sig, siginfo_t *siginfo, void *ptr)
 {
   /* We only handle SIGBUS here for now. */
   BLI_assert(sig == SIGBUS);
 
+  error_handler.running_handlers.fetch_add(1);
+
   const char *error_addr = (const char *)siginfo->si_addr;
   /* Find the file that this error belongs to. */
-  LISTBASE_FOREACH (LinkData *, link, &error_handler.open_mmaps) {
-    BLI_mmap_file *file = static_cast<BLI_mmap_file *>(link->data);
+  for (MappedFileEntry *entry = error_handler.open_mmaps.load(); entry; entry = entry->next) {
+    BLI_mmap_file *file = entry->file.load();
+    if (file == nullptr) {
+      continue;
+    }
 
     /* Is the address where the error occurred in this file's mapped range? */
     if (error_addr >= file->memory && error_addr < file->memory + file->length) {
       file->io_error = true;
 
       /* Replace the mapped memory with zeroes. */
-      const void *mapped_memory = mmap(
-          file->memory, file->length, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+      const void *mapped_memory = mmap(file->memory,
+                                       file->length,
+                                       PROT_READ | PROT_WRITE,
+                                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED,
+                                       -1,
+                                       0);
       if (mapped_memory == MAP_FAILED) {
         fprintf(stderr, "SIGBUS handler: Error replacing mapped file with zeros\n");
       }
 
+      error_handler.running_handlers.fetch_sub(1);
       return;
     }
   }
 
+  error_handler.running_handlers.fetch_sub(1);
+
   /* Fall back to other handler if there was one. */
   if (error_handler.next_handler) {
     error_handler.next_handler(sig, siginfo, ptr);
@@ -118,19 +153,44 @@ static bool sigbus_handler_setup()
 /* Adds a file to the list that the error handler checks. */
 static void sigbus_handler_add(BLI_mmap_file *file)
 {
-  BLI_addtail(&error_handler.open_mmaps, BLI_genericNodeN(file));
+  std::lock_guard lock{error_handler_mutex};
+  for (MappedFileEntry *entry = error_handler.open_mmaps.load(); entry; entry = entry->next) {
+    if (entry->file.load() == nullptr) {
+      entry->file.store(file);
+      return;
+    }
+  }
+  /* Not freed on purpose, see #MappedFileEntry. */
+  MappedFileEntry *entry = new MappedFileEntry();
+  entry->file.store(file);
+  entry->next = error_handler.open_mmaps.load();
+  error_handler.open_mmaps.store(entry);
 }
 
-/* Removes a file from the list that the error handler checks. */
+/**
+ * Removes a file from the list that the error handler checks. Afterwards, the file can be
+ * unmapped and freed safely.
+ */
 static void sigbus_handler_remove(BLI_mmap_file *file)
 {
-  LinkData *link = static_cast<LinkData *>(
-      BLI_findptr(&error_handler.open_mmaps, file, offsetof(LinkData, data)));
-  BLI_freelinkN(&error_handler.open_mmaps, link);
+  {
+    std::lock_guard lock{error_handler_mutex};
+    for (MappedFileEntry *entry = error_handler.open_mmaps.load(); entry; entry = entry->next) {
+      if (entry->file.load() == file) {
+        entry->file.store(nullptr);
+        break;
+      }
+    }
+  }
+  /* A handler that started before the file was removed may still access it. Handlers only run
+   * for a short time, so just wait for them to finish. */
+  while (error_handler.running_handlers.load() > 0) {
+    std::this_thread::yield();
+  }
 }
 #endif
 
-BLI_mmap_file *BLI_mmap_open(int fd)
+static BLI_mmap_file *mmap_open(const int fd, const bool copy_on_write)
 {
   void *memory, *handle = nullptr;
   const size_t length = BLI_lseek(fd, 0, SEEK_END);
@@ -144,8 +204,10 @@ BLI_mmap_file *BLI_mmap_open(int fd)
     return nullptr;
   }
 
-  /* Map the given file to memory. */
-  memory = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  /* Map the given file to memory. A writable mapping is private, so that writes only copy the
+   * touched pages and never change the file on disk. */
+  const int prot = copy_on_write ? PROT_READ | PROT_WRITE : PROT_READ;
+  memory = mmap(nullptr, length, prot, MAP_PRIVATE, fd, 0);
   if (memory == MAP_FAILED) {
     return nullptr;
   }
@@ -155,11 +217,12 @@ BLI_mmap_file *BLI_mmap_open(int fd)
   /* Memory mapping on Windows is a two-step process - first we create a mapping,
    * then we create a view into that mapping.
    * In our case, one view that spans the entire file is enough. */
-  handle = CreateFileMapping(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  handle = CreateFileMapping(
+      file_handle, nullptr, copy_on_write ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
   if (handle == nullptr) {
     return nullptr;
   }
-  memory = MapViewOfFile(handle, FILE_MAP_READ, 0, 0, 0);
+  memory = MapViewOfFile(handle, copy_on_write ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
   if (memory == nullptr) {
     CloseHandle(handle);
     return nullptr;
@@ -171,6 +234,7 @@ BLI_mmap_file *BLI_mmap_open(int fd)
   file->memory = static_cast<char *>(memory);
   file->handle = handle;
   file->length = length;
+  file->users = 1;
 
 #ifndef WIN32
   /* Register the file with the error handler. */
@@ -180,6 +244,16 @@ BLI_mmap_file *BLI_mmap_open(int fd)
   return file;
 }
 
+BLI_mmap_file *BLI_mmap_open(int fd)
+{
+  return mmap_open(fd, false);
+}
+
+BLI_mmap_file *BLI_mmap_open_copy_on_write(int fd)
+{
+  return mmap_open(fd, true);
+}
+
 bool BLI_mmap_read(BLI_mmap_file *file, void *dest, size_t offset, size_t length)
 {
   /* If a previous read has already failed or we try to read past the end,
@@ -224,11 +298,20 @@ bool BLI_mmap_any_io_error(const BLI_mmap_file *file)
   return file->io_error;
 }
 
+void BLI_mmap_add_user(BLI_mmap_file *file)
+{
+  atomic_add_and_fetch_int32(&file->users, 1);
+}
+
 void BLI_mmap_free(BLI_mmap_file *file)
 {
+  if (atomic_sub_and_fetch_int32(&file->users, 1) > 0) {
+    return;
+  }
+
 #ifndef WIN32
-  munmap((void *)file->memory, file->length);
   sigbus_handler_remove(file);
+  munmap((void *)file->memory, file->length);
 #else
   UnmapViewOfFile(file->memory);
   CloseHandle(file->handle);
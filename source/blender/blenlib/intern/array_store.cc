@@ -94,8 +94,13 @@
 #include "MEM_guardedalloc.h"
 
 #include "BLI_assert.h"
+#include "BLI_bit_vector.hh"
 #include "BLI_listbase.h"
+#include "BLI_math_base.h"
+#include "BLI_math_bits.h"
 #include "BLI_mempool.h"
+#include "BLI_task.hh"
+#include "BLI_threads.h"
 #include "BLI_utildefines.h"
 
 #include "BLI_array_store.h" /* Own include. */
@@ -175,6 +180,18 @@ struct BChunkList;
 #  define BCHUNK_HASH_LEN 16
 #endif
 
+#ifdef USE_HASH_TABLE_ACCUMULATE
+/**
+ * Hash the new data on multiple threads, and also find the offsets that may match a chunk of the
+ * reference in parallel. Looking up the matching chunks is still done sequentially (because a
+ * match means the following offsets are skipped), but offsets without any candidates in the table
+ * are skipped quickly.
+ */
+#  define USE_HASH_TABLE_PARALLEL
+/** Number of elements processed by a single task. */
+#  define HASH_TABLE_PARALLEL_GRAIN_SIZE (1 << 16)
+#endif
+
 /**
  * Calculate the key once and reuse it.
  */
@@ -815,22 +832,107 @@ static hash_key hash_data(const uchar *key, size_t n)
 #undef HASH_INIT
 
 #ifdef USE_HASH_TABLE_ACCUMULATE
-static void hash_array_from_data(const BArrayInfo *info,
-                                 const uchar *data_slice,
-                                 const size_t data_slice_len,
-                                 hash_key *hash_array)
+
+/**
+ * Similar to #hash_data, with a stride that is known at compile time so the loop is unrolled.
+ * When the stride is a multiple of four, whole 32 bit words are hashed instead of single bytes,
+ * which needs a quarter of the operations. The keys only have to match the keys of other elements
+ * hashed with the same stride, so this doesn't have to give the same result as #hash_data.
+ */
+template<size_t Stride> BLI_INLINE hash_key hash_data_stride(const uchar *key)
 {
-  if (info->chunk_stride != 1) {
-    for (size_t i = 0, i_step = 0; i_step < data_slice_len; i++, i_step += info->chunk_stride) {
-      hash_array[i] = hash_data(&data_slice[i_step], info->chunk_stride);
+  hash_key h = 5381;
+  if constexpr (Stride % sizeof(uint32_t) == 0) {
+    for (size_t i = 0; i < Stride; i += sizeof(uint32_t)) {
+      uint32_t word;
+      memcpy(&word, &key[i], sizeof(word));
+      h = (hash_key)((h << 5) + h) + (hash_key)word;
     }
   }
   else {
-    /* Fast-path for bytes. */
-    for (size_t i = 0; i < data_slice_len; i++) {
-      hash_array[i] = hash_data_single(data_slice[i]);
+    const signed char *p = (const signed char *)key;
+    for (size_t i = 0; i < Stride; i++) {
+      h = (hash_key)((h << 5) + h) + (hash_key)p[i];
     }
   }
+  return h;
+}
+
+template<size_t Stride>
+static void hash_array_from_data_stride(const uchar *data_slice,
+                                        const size_t hash_array_len,
+                                        hash_key *hash_array)
+{
+  for (size_t i = 0; i < hash_array_len; i++) {
+    hash_array[i] = hash_data_stride<Stride>(&data_slice[i * Stride]);
+  }
+}
+
+static void hash_array_from_data_single_thread(const BArrayInfo *info,
+                                               const uchar *data_slice,
+                                               const size_t data_slice_len,
+                                               hash_key *hash_array)
+{
+  const size_t hash_array_len = data_slice_len / info->chunk_stride;
+  /* Fast-paths for common strides. */
+  switch (info->chunk_stride) {
+    case 1: {
+      for (size_t i = 0; i < data_slice_len; i++) {
+        hash_array[i] = hash_data_single(data_slice[i]);
+      }
+      return;
+    }
+    case 2:
+      hash_array_from_data_stride<2>(data_slice, hash_array_len, hash_array);
+      break;
+    case 4:
+      hash_array_from_data_stride<4>(data_slice, hash_array_len, hash_array);
+      break;
+    case 8:
+      hash_array_from_data_stride<8>(data_slice, hash_array_len, hash_array);
+      break;
+    case 12:
+      hash_array_from_data_stride<12>(data_slice, hash_array_len, hash_array);
+      break;
+    case 16:
+      hash_array_from_data_stride<16>(data_slice, hash_array_len, hash_array);
+      break;
+    default: {
+      for (size_t i = 0; i < hash_array_len; i++) {
+        hash_array[i] = hash_data(&data_slice[i * info->chunk_stride], info->chunk_stride);
+      }
+      break;
+    }
+  }
+  /* A trailing partial element (only expected when the caller doesn't use the stride). */
+  if (hash_array_len * info->chunk_stride < data_slice_len) {
+    hash_array[hash_array_len] = hash_data(&data_slice[hash_array_len * info->chunk_stride],
+                                           info->chunk_stride);
+  }
+}
+
+static void hash_array_from_data(const BArrayInfo *info,
+                                 const uchar *data_slice,
+                                 const size_t data_slice_len,
+                                 hash_key *hash_array)
+{
+#  ifdef USE_HASH_TABLE_PARALLEL
+  const size_t hash_array_len = data_slice_len / info->chunk_stride;
+  if (hash_array_len * info->chunk_stride == data_slice_len) {
+    blender::threading::parallel_for(
+        blender::IndexRange(int64_t(hash_array_len)),
+        HASH_TABLE_PARALLEL_GRAIN_SIZE,
+        [&](const blender::IndexRange range) {
+          const size_t start = size_t(range.start());
+          hash_array_from_data_single_thread(info,
+                                             &data_slice[start * info->chunk_stride],
+                                             size_t(range.size()) * info->chunk_stride,
+                                             &hash_array[start]);
+        });
+    return;
+  }
+#  endif
+  hash_array_from_data_single_thread(info, data_slice, data_slice_len, hash_array);
 }
 
 /**
@@ -878,6 +980,47 @@ static void hash_accum(hash_key *hash_array, const size_t hash_array_len, size_t
   }
 
   const size_t hash_array_search_len = hash_array_len - iter_steps;
+
+#  ifdef USE_HASH_TABLE_PARALLEL
+  const size_t blocks_num = divide_ceil_ul(hash_array_search_len, HASH_TABLE_PARALLEL_GRAIN_SIZE);
+  if (blocks_num > 1) {
+    /* Every value is accumulated with a value ahead of it, which may be in the next block.
+     * Store these values before they are modified, so that blocks can be processed in parallel
+     * with the same result as the single threaded loop below. */
+    hash_key *block_ahead = MEM_malloc_arrayN<hash_key>(blocks_num * iter_steps, __func__);
+    while (iter_steps != 0) {
+      const size_t hash_offset = iter_steps;
+      for (size_t block = 0; block < blocks_num; block++) {
+        const size_t block_end = std::min((block + 1) * HASH_TABLE_PARALLEL_GRAIN_SIZE,
+                                          hash_array_search_len);
+        memcpy(&block_ahead[block * hash_offset],
+               &hash_array[block_end],
+               sizeof(hash_key) * hash_offset);
+      }
+      blender::threading::parallel_for(
+          blender::IndexRange(int64_t(blocks_num)), 1, [&](const blender::IndexRange range) {
+            for (const int64_t block : range) {
+              const size_t block_start = size_t(block) * HASH_TABLE_PARALLEL_GRAIN_SIZE;
+              const size_t block_end = std::min(block_start + HASH_TABLE_PARALLEL_GRAIN_SIZE,
+                                                hash_array_search_len);
+              const size_t block_inner_end = std::max(block_start, block_end - hash_offset);
+              for (size_t i = block_start; i < block_inner_end; i++) {
+                hash_accum_impl(hash_array, i, i + hash_offset);
+              }
+              const hash_key *ahead = &block_ahead[size_t(block) * hash_offset];
+              for (size_t i = block_inner_end; i < block_end; i++) {
+                hash_array[i] += ((ahead[i + hash_offset - block_end] << 3) ^
+                                  (hash_array[i] >> 1));
+              }
+            }
+          });
+      iter_steps -= 1;
+    }
+    MEM_freeN(block_ahead);
+    return;
+  }
+#  endif
+
   while (iter_steps != 0) {
     const size_t hash_offset = iter_steps;
     for (size_t i = 0; i < hash_array_search_len; i++) {
@@ -997,6 +1140,70 @@ static const BChunkRef *table_lookup(const BArrayInfo *info,
   return nullptr;
 }
 
+#  ifdef USE_HASH_TABLE_PARALLEL
+/**
+ * Find all offsets whose hash matches the key of a chunk in the table. Other offsets can be
+ * skipped without a lookup. The result has one bit for every value in \a table_hash_array.
+ */
+static void table_candidates_from_hash_array(BTableRef **table,
+                                             const size_t table_len,
+                                             const hash_key *table_hash_array,
+                                             const size_t table_hash_array_len,
+                                             blender::MutableBitSpan r_candidates)
+{
+  using namespace blender;
+  BLI_assert(r_candidates.size() == int64_t(table_hash_array_len));
+  bits::BitInt *candidates_data = r_candidates.data();
+  const int64_t ints_num = int64_t(divide_ceil_ul(table_hash_array_len, bits::BitsPerInt));
+  /* Each task writes whole integers, so that no bits are modified by different threads. */
+  threading::parallel_for(
+      IndexRange(ints_num),
+      HASH_TABLE_PARALLEL_GRAIN_SIZE / bits::BitsPerInt,
+      [&](const IndexRange range) {
+        for (const int64_t int_i : range) {
+          const size_t start = size_t(int_i) * bits::BitsPerInt;
+          const size_t end = std::min(start + bits::BitsPerInt, table_hash_array_len);
+          bits::BitInt value = 0;
+          for (size_t i = start; i < end; i++) {
+            const hash_key key = table_hash_array[i];
+            const BTableRef *tref = table[key % (hash_key)table_len];
+            for (; tref != nullptr; tref = tref->next) {
+#    ifdef USE_HASH_TABLE_KEY_CACHE
+              if (tref->cref->link->key != key) {
+                continue;
+              }
+#    endif
+              value |= bits::BitInt(1) << (i - start);
+              break;
+            }
+          }
+          candidates_data[int_i] = value;
+        }
+      });
+}
+
+/**
+ * \return The index of the next candidate starting at \a index,
+ * or the size of the candidates if there is none.
+ */
+static size_t table_candidates_next(const blender::BitSpan candidates, size_t index)
+{
+  using namespace blender;
+  const bits::BitInt *candidates_data = candidates.data();
+  const size_t candidates_len = size_t(candidates.size());
+  while (index < candidates_len) {
+    const bits::BitInt value = candidates_data[index / bits::BitsPerInt] >>
+                               (index % bits::BitsPerInt);
+    if (value != 0) {
+      return std::min(index + bitscan_forward_uint64(value), candidates_len);
+    }
+    /* Skip to the beginning of the next integer. */
+    index = (index / bits::BitsPerInt + 1) * bits::BitsPerInt;
+  }
+  return candidates_len;
+}
+#  endif
+
 #else /* USE_HASH_TABLE_ACCUMULATE */
 
 /* NON USE_HASH_TABLE_ACCUMULATE code (simply hash each chunk). */
@@ -1377,6 +1584,19 @@ static BChunkList *bchunk_list_from_data_merge(const BArrayInfo *info,
     }
     /* Done making the table. */
 
+#ifdef USE_HASH_TABLE_PARALLEL
+    /* Finding the candidates up-front looks up every offset, including the ones that are skipped
+     * by matches below, so it's only worth it when the work is spread over multiple threads. */
+    const bool use_table_candidates = (table_hash_array_len > HASH_TABLE_PARALLEL_GRAIN_SIZE) &&
+                                      (BLI_system_thread_count() > 1);
+    blender::BitVector<> table_candidates;
+    if (use_table_candidates) {
+      table_candidates.resize(int64_t(table_hash_array_len), false);
+      table_candidates_from_hash_array(
+          table, table_len, table_hash_array, table_hash_array_len, table_candidates);
+    }
+#endif
+
     BLI_assert(i_prev <= data_len);
     for (size_t i = i_prev; i < data_len;) {
       /* Assumes exiting chunk isn't a match! */
@@ -1423,6 +1643,17 @@ static BChunkList *bchunk_list_from_data_merge(const BArrayInfo *info,
         }
       }
       else {
+#ifdef USE_HASH_TABLE_PARALLEL
+        if (use_table_candidates) {
+          /* Skip all offsets that can't match any chunk. */
+          const size_t hash_index_next = table_candidates_next(
+              table_candidates, ((i - i_table_start) / info->chunk_stride) + 1);
+          i = (hash_index_next < table_hash_array_len) ?
+                  i_table_start + (hash_index_next * info->chunk_stride) :
+                  data_len;
+          continue;
+        }
+#endif
         i = i + info->chunk_stride;
       }
     }
@@ -1617,6 +1848,14 @@ size_t BLI_array_store_calc_size_compacted_get(const BArrayStore *bs)
   return size_total;
 }
 
+size_t BLI_array_store_calc_size_overhead_get(const BArrayStore *bs)
+{
+  return size_t(BLI_mempool_len(bs->memory.chunk_list)) * sizeof(BChunkList) +
+         size_t(BLI_mempool_len(bs->memory.chunk_ref)) * sizeof(BChunkRef) +
+         size_t(BLI_mempool_len(bs->memory.chunk)) * sizeof(BChunk) +
+         size_t(BLI_listbase_count(&bs->states)) * sizeof(BArrayState);
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -0,0 +1,134 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup bli
+ */
+
+#include <limits>
+
+#include "BLI_bit_span_to_indices.hh"
+#include "BLI_index_range.hh"
+#include "BLI_math_bits.h"
+#include "BLI_simd.hh"
+
+namespace blender::bits {
+
+namespace {
+
+/** Contains the positions of the set bits for every possible byte. Unused entries are zero. */
+struct ByteIndicesTable {
+  int16_t indices[256][8];
+  int8_t sizes[256];
+};
+
+}  // namespace
+
+static constexpr ByteIndicesTable build_byte_indices_table()
+{
+  ByteIndicesTable table{};
+  for (int byte = 0; byte < 256; byte++) {
+    int8_t size = 0;
+    for (int bit = 0; bit < 8; bit++) {
+      if (byte & (1 << bit)) {
+        table.indices[byte][size] = int16_t(bit);
+        size++;
+      }
+    }
+    table.sizes[byte] = size;
+  }
+  return table;
+}
+
+alignas(16) static constexpr ByteIndicesTable byte_indices_table = build_byte_indices_table();
+
+static int16_t *bit_int_to_indices_scalar(BitInt value, const int start, int16_t *dst)
+{
+  while (value != 0) {
+    *dst = int16_t(start + int(bitscan_forward_uint64(value)));
+    dst++;
+    /* Clear the lowest set bit. */
+    value &= value - 1;
+  }
+  return dst;
+}
+
+/**
+ * Writes the indices of the set bits in the given integer.
+ * \param dst_end: Used to determine whether there is enough space for the overshoot of the
+ * vectorized code path.
+ */
+static int16_t *bit_int_to_indices(const BitInt value,
+                                   const int start,
+                                   int16_t *dst,
+                                   const int16_t *dst_end)
+{
+  if (value == 0) {
+    return dst;
+  }
+#if BLI_HAVE_SSE2
+  /* Every byte writes eight indices, of which only the first few may be valid. So when there is
+   * enough space, the indices of each byte are written with a single store without any branches.
+   * Invalid indices are overwritten by the next byte. */
+  if (dst_end - dst >= BitsPerInt) {
+    for (int byte_i = 0; byte_i < 8; byte_i++) {
+      const int byte = int((value >> (byte_i * 8)) & 0xff);
+      const __m128i byte_indices = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(byte_indices_table.indices[byte]));
+      const __m128i indices = _mm_add_epi16(byte_indices,
+                                            _mm_set1_epi16(int16_t(start + byte_i * 8)));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), indices);
+      dst += byte_indices_table.sizes[byte];
+    }
+    return dst;
+  }
+#else
+  UNUSED_VARS(dst_end);
+#endif
+  return bit_int_to_indices_scalar(value, start, dst);
+}
+
+int64_t bits_to_indices(const BitSpan bits, MutableSpan<int16_t> r_indices, const int16_t offset)
+{
+  if (bits.is_empty()) {
+    return 0;
+  }
+  BLI_assert(offset + bits.size() <= std::numeric_limits<int16_t>::max() + 1);
+
+  const BitInt *data = bits.data();
+  const IndexRange bit_range = bits.bit_range();
+  int16_t *dst = r_indices.data();
+  const int16_t *dst_end = r_indices.data() + r_indices.size();
+
+  /* Full integers are processed at once, but the bit-span may not be aligned. */
+  const AlignedIndexRanges ranges = split_index_range_by_alignment(bit_range, BitsPerInt);
+
+  if (!ranges.prefix.is_empty()) {
+    const BitInt first_int = *int_containing_bit(data, bit_range.start()) >>
+                             (ranges.prefix.start() & BitIndexMask);
+    dst = bit_int_to_indices(
+        first_int & mask_first_n_bits(ranges.prefix.size()), offset, dst, dst_end);
+  }
+
+  if (!ranges.aligned.is_empty()) {
+    const BitInt *start = int_containing_bit(data, ranges.aligned.start());
+    const int64_t ints_num = ranges.aligned.size() / BitsPerInt;
+    for (int64_t int_i = 0; int_i < ints_num; int_i++) {
+      const int start_index = int(offset + ranges.prefix.size() + int_i * BitsPerInt);
+      dst = bit_int_to_indices(start[int_i], start_index, dst, dst_end);
+    }
+  }
+
+  if (!ranges.suffix.is_empty()) {
+    const BitInt last_int = *int_containing_bit(data, bit_range.last());
+    const int start_index = int(offset + ranges.prefix.size() + ranges.aligned.size());
+    dst = bit_int_to_indices(
+        last_int & mask_first_n_bits(ranges.suffix.size()), start_index, dst, dst_end);
+  }
+
+  BLI_assert(dst <= dst_end);
+  return dst - r_indices.data();
+}
+
+}  // namespace blender::bits
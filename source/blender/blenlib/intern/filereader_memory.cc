@@ -111,9 +111,10 @@ static void memory_close_mmap(FileReader *reader)
   MEM_freeN(mem);
 }
 
-FileReader *BLI_filereader_new_mmap(int filedes)
+FileReader *BLI_filereader_new_mmap(int filedes, const bool copy_on_write)
 {
-  BLI_mmap_file *mmap = BLI_mmap_open(filedes);
+  BLI_mmap_file *mmap = copy_on_write ? BLI_mmap_open_copy_on_write(filedes) :
+                                        BLI_mmap_open(filedes);
   if (mmap == nullptr) {
     return nullptr;
   }
@@ -129,3 +130,11 @@ FileReader *BLI_filereader_new_mmap(int filedes)
 
   return (FileReader *)mem;
 }
+
+BLI_mmap_file *BLI_filereader_get_mmap(FileReader *reader)
+{
+  if (reader->read != memory_read_mmap) {
+    return nullptr;
+  }
+  return ((MemoryReader *)reader)->mmap;
+}
@@ -7,14 +7,65 @@
  */
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <cstring>
+#include <mutex>
 #include <zstd.h>
 
 #include "BLI_fileops.hh"
 #include "BLI_filereader.h"
+#include "BLI_task.h"
 
 #include "MEM_guardedalloc.h"
 
+/** Upper bound for the number of frames that are decompressed ahead of the read position. */
+#define ZSTD_READ_AHEAD_MAX_FRAMES 32
+
+enum class ZstdFrameState {
+  /** The slot does not hold any frame. */
+  Empty,
+  /** The compressed data is loaded and a task has been pushed to decompress it. */
+  Pending,
+  /** A thread is currently decompressing the frame. */
+  Running,
+  /** The uncompressed data is available. */
+  Ready,
+  /** Decompression failed. */
+  Failed,
+};
+
+/**
+ * A frame in the read-ahead ring. The compressed data is always read on the thread that uses the
+ * #FileReader because the base reader is not thread-safe, only decompression happens in tasks.
+ */
+struct ZstdFrameSlot {
+  int frame = -1;
+  std::atomic<ZstdFrameState> state = ZstdFrameState::Empty;
+
+  ZSTD_DCtx *ctx = nullptr;
+  char *compressed_data = nullptr;
+  size_t compressed_size = 0;
+  size_t compressed_capacity = 0;
+  char *uncompressed_data = nullptr;
+  size_t uncompressed_size = 0;
+  size_t uncompressed_capacity = 0;
+};
+
+/**
+ * State for decompressing the frames that follow the current read position in parallel.
+ * Frame `i` is always stored in slot `i % slots_num`.
+ */
+struct ZstdReadAhead {
+  TaskPool *pool = nullptr;
+  int slots_num = 0;
+  ZstdFrameSlot slots[ZSTD_READ_AHEAD_MAX_FRAMES];
+
+  /** Used to wait for frames that are decompressed by another thread. */
+  std::mutex mutex;
+  std::condition_variable cv;
+};
+
 struct ZstdReader {
   FileReader reader;
 
@@ -32,6 +83,9 @@ struct ZstdReader {
     char *cached_content;
     int cached_frame;
   } seek;
+
+  /** Only set when the reader was created with read-ahead and the file is seekable. */
+  ZstdReadAhead *read_ahead;
 };
 
 static bool zstd_read_u32(FileReader *base, uint32_t *val)
@@ -191,6 +245,145 @@ static const char *zstd_ensure_cache(ZstdReader *zstd, int frame)
   return uncompressed_data;
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Read-Ahead
+ *
+ * Upcoming frames of the seekable format are decompressed in tasks, so that sequential reading
+ * mostly just copies already decompressed data.
+ * \{ */
+
+static void zstd_slot_decompress(ZstdFrameSlot &slot)
+{
+  if (slot.ctx == nullptr) {
+    slot.ctx = ZSTD_createDCtx();
+  }
+  size_t res = ZSTD_decompressDCtx(slot.ctx,
+                                   slot.uncompressed_data,
+                                   slot.uncompressed_size,
+                                   slot.compressed_data,
+                                   slot.compressed_size);
+  const bool success = !ZSTD_isError(res) && res >= slot.uncompressed_size;
+  slot.state.store(success ? ZstdFrameState::Ready : ZstdFrameState::Failed,
+                   std::memory_order_release);
+}
+
+/** Try to take ownership of a pending slot and decompress it on the current thread. */
+static bool zstd_slot_try_decompress(ZstdFrameSlot &slot)
+{
+  ZstdFrameState expected = ZstdFrameState::Pending;
+  if (!slot.state.compare_exchange_strong(expected, ZstdFrameState::Running)) {
+    return false;
+  }
+  zstd_slot_decompress(slot);
+  return true;
+}
+
+static void zstd_read_ahead_task(TaskPool *__restrict pool, void *taskdata)
+{
+  ZstdReadAhead *read_ahead = static_cast<ZstdReadAhead *>(BLI_task_pool_user_data(pool));
+  ZstdFrameSlot &slot = *static_cast<ZstdFrameSlot *>(taskdata);
+  if (!zstd_slot_try_decompress(slot)) {
+    /* The reading thread took over the work already. */
+    return;
+  }
+  /* Lock the mutex to avoid missing the notification between the state check and the wait. */
+  std::lock_guard lock{read_ahead->mutex};
+  read_ahead->cv.notify_all();
+}
+
+/** Wait until the slot is not being decompressed anymore, doing the work here if possible. */
+static void zstd_slot_wait(ZstdReadAhead *read_ahead, ZstdFrameSlot &slot)
+{
+  if (zstd_slot_try_decompress(slot)) {
+    return;
+  }
+  if (slot.state.load(std::memory_order_acquire) != ZstdFrameState::Running) {
+    return;
+  }
+  std::unique_lock lock{read_ahead->mutex};
+  read_ahead->cv.wait(lock, [&]() {
+    return slot.state.load(std::memory_order_acquire) != ZstdFrameState::Running;
+  });
+}
+
+static void zstd_ensure_capacity(char *&data, size_t &capacity, const size_t size)
+{
+  if (size <= capacity) {
+    return;
+  }
+  MEM_SAFE_FREE(data);
+  data = MEM_malloc_arrayN<char>(size, __func__);
+  capacity = size;
+}
+
+/** Read the compressed data of the frame and push a task that decompresses it. */
+static bool zstd_read_ahead_schedule(ZstdReader *zstd, int frame)
+{
+  ZstdReadAhead *read_ahead = zstd->read_ahead;
+  ZstdFrameSlot &slot = read_ahead->slots[frame % read_ahead->slots_num];
+  if (slot.frame == frame && slot.state.load(std::memory_order_acquire) != ZstdFrameState::Empty)
+  {
+    return true;
+  }
+  /* The slot may still be used by an older frame. */
+  zstd_slot_wait(read_ahead, slot);
+
+  slot.frame = frame;
+  slot.state.store(ZstdFrameState::Empty, std::memory_order_relaxed);
+  slot.compressed_size = zstd->seek.compressed_ofs[frame + 1] - zstd->seek.compressed_ofs[frame];
+  slot.uncompressed_size = zstd->seek.uncompressed_ofs[frame + 1] -
+                           zstd->seek.uncompressed_ofs[frame];
+  zstd_ensure_capacity(slot.compressed_data, slot.compressed_capacity, slot.compressed_size);
+  zstd_ensure_capacity(slot.uncompressed_data, slot.uncompressed_capacity, slot.uncompressed_size);
+
+  if (zstd->base->seek(zstd->base, zstd->seek.compressed_ofs[frame], SEEK_SET) < 0 ||
+      zstd->base->read(zstd->base, slot.compressed_data, slot.compressed_size) <
+          slot.compressed_size)
+  {
+    slot.state.store(ZstdFrameState::Failed, std::memory_order_release);
+    return false;
+  }
+
+  slot.state.store(ZstdFrameState::Pending, std::memory_order_release);
+  BLI_task_pool_push(read_ahead->pool, zstd_read_ahead_task, &slot, false, nullptr);
+  return true;
+}
+
+/** Same as #zstd_ensure_cache, but also starts decompressing the following frames. */
+static const char *zstd_ensure_cache_read_ahead(ZstdReader *zstd, int frame)
+{
+  ZstdReadAhead *read_ahead = zstd->read_ahead;
+  const int frames_end = std::min(frame + read_ahead->slots_num, zstd->seek.frames_num);
+  for (int i = frame; i < frames_end; i++) {
+    if (!zstd_read_ahead_schedule(zstd, i) && i == frame) {
+      return nullptr;
+    }
+  }
+
+  ZstdFrameSlot &slot = read_ahead->slots[frame % read_ahead->slots_num];
+  zstd_slot_wait(read_ahead, slot);
+  if (slot.state.load(std::memory_order_acquire) != ZstdFrameState::Ready) {
+    return nullptr;
+  }
+  return slot.uncompressed_data;
+}
+
+static void zstd_read_ahead_free(ZstdReadAhead *read_ahead)
+{
+  BLI_task_pool_work_and_wait(read_ahead->pool);
+  BLI_task_pool_free(read_ahead->pool);
+  for (ZstdFrameSlot &slot : read_ahead->slots) {
+    if (slot.ctx) {
+      ZSTD_freeDCtx(slot.ctx);
+    }
+    MEM_SAFE_FREE(slot.compressed_data);
+    MEM_SAFE_FREE(slot.uncompressed_data);
+  }
+  MEM_delete(read_ahead);
+}
+
+/** \} */
+
 static int64_t zstd_read_seekable(FileReader *reader, void *buffer, size_t size)
 {
   ZstdReader *zstd = (ZstdReader *)reader;
@@ -203,7 +396,8 @@ static int64_t zstd_read_seekable(FileReader *reader, void *buffer, size_t size)
       break;
     }
 
-    const char *framedata = zstd_ensure_cache(zstd, frame);
+    const char *framedata = zstd->read_ahead ? zstd_ensure_cache_read_ahead(zstd, frame) :
+                                               zstd_ensure_cache(zstd, frame);
     if (framedata == nullptr) {
       /* Error while reading the frame, so return as much as we can. */
       break;
@@ -278,6 +472,9 @@ static void zstd_close(FileReader *reader)
   ZstdReader *zstd = (ZstdReader *)reader;
 
   ZSTD_freeDCtx(zstd->ctx);
+  if (zstd->read_ahead) {
+    zstd_read_ahead_free(zstd->read_ahead);
+  }
   if (zstd->reader.seek) {
     MEM_freeN(zstd->seek.uncompressed_ofs);
     MEM_freeN(zstd->seek.compressed_ofs);
@@ -294,7 +491,7 @@ static void zstd_close(FileReader *reader)
   MEM_freeN(zstd);
 }
 
-FileReader *BLI_filereader_new_zstd(FileReader *base)
+static FileReader *zstd_filereader_new(FileReader *base, const bool use_read_ahead)
 {
   ZstdReader *zstd = MEM_callocN<ZstdReader>(__func__);
 
@@ -304,6 +501,18 @@ FileReader *BLI_filereader_new_zstd(FileReader *base)
   if (zstd_read_seek_table(zstd)) {
     zstd->reader.read = zstd_read_seekable;
     zstd->reader.seek = zstd_seek;
+
+    /* Read-ahead only pays off when there are other threads to decompress and more than one
+     * frame to decompress. */
+    const int threads_num = BLI_task_scheduler_num_threads();
+    if (use_read_ahead && threads_num > 1 && zstd->seek.frames_num > 1) {
+      zstd->read_ahead = MEM_new<ZstdReadAhead>(__func__);
+      zstd->read_ahead->slots_num = std::min({threads_num * 2,
+                                               zstd->seek.frames_num,
+                                               ZSTD_READ_AHEAD_MAX_FRAMES});
+      zstd->read_ahead->pool = BLI_task_pool_create_background(zstd->read_ahead,
+                                                               TASK_PRIORITY_HIGH);
+    }
   }
   else {
     zstd->reader.read = zstd_read;
@@ -323,3 +532,13 @@ FileReader *BLI_filereader_new_zstd(FileReader *base)
 
   return (FileReader *)zstd;
 }
+
+FileReader *BLI_filereader_new_zstd(FileReader *base)
+{
+  return zstd_filereader_new(base, false);
+}
+
+FileReader *BLI_filereader_new_zstd_read_ahead(FileReader *base)
+{
+  return zstd_filereader_new(base, true);
+}
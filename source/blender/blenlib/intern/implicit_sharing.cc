@@ -12,6 +12,7 @@
 #include "MEM_guardedalloc.h"
 
 #include "BLI_implicit_sharing.hh"
+#include "BLI_mmap.h"
 
 namespace blender::implicit_sharing {
 
@@ -37,6 +38,28 @@ const ImplicitSharingInfo *info_for_mem_free(void *data)
   return MEM_new<MEMFreeImplicitSharing>(__func__, data);
 }
 
+class MmapImplicitSharing : public ImplicitSharingInfo {
+ public:
+  BLI_mmap_file *file;
+
+  MmapImplicitSharing(BLI_mmap_file *file) : file(file)
+  {
+    BLI_mmap_add_user(file);
+  }
+
+ private:
+  void delete_self_with_data() override
+  {
+    BLI_mmap_free(file);
+    MEM_delete(this);
+  }
+};
+
+const ImplicitSharingInfo *info_for_mmap(BLI_mmap_file *file)
+{
+  return MEM_new<MmapImplicitSharing>(__func__, file);
+}
+
 namespace detail {
 
 void *make_trivial_data_mutable_impl(void *old_data,
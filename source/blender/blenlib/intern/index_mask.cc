@@ -14,12 +14,14 @@
 #include "BLI_bit_bool_conversion.hh"
 #include "BLI_bit_span_ops.hh"
 #include "BLI_bit_span_to_index_ranges.hh"
+#include "BLI_bit_span_to_indices.hh"
 #include "BLI_bit_vector.hh"
 #include "BLI_enumerable_thread_specific.hh"
 #include "BLI_index_mask.hh"
 #include "BLI_index_mask_expression.hh"
 #include "BLI_index_ranges_builder.hh"
 #include "BLI_math_base.hh"
+#include "BLI_math_bits.h"
 #include "BLI_rand.hh"
 #include "BLI_set.hh"
 #include "BLI_sort.hh"
@@ -451,61 +453,15 @@ IndexMask IndexMask::from_bits(const BitSpan bits, IndexMaskMemory &memory)
   return IndexMask::from_bits(bits.index_range(), bits, memory);
 }
 
-static int64_t from_bits_batch_predicate(const IndexMaskSegment universe_segment,
-                                         IndexRangesBuilder<int16_t> &builder,
-                                         const BitSpan bits_slice)
-{
-  const int64_t segment_start = universe_segment[0];
-  if (unique_sorted_indices::non_empty_is_range(universe_segment.base_span())) {
-    bits::bits_to_index_ranges<int16_t>(bits_slice, builder);
-  }
-  else {
-    /* If the universe is not a range, we need to create a new bit span first. In it, bits
-     * that are not part of the universe are set to 0. */
-    const int64_t segment_end = universe_segment.last() + 1;
-    BitVector<max_segment_size> local_bits(segment_end - segment_start, false);
-    for (const int64_t i : universe_segment.index_range()) {
-      const int64_t global_index = universe_segment[i];
-      const int64_t local_index = global_index - segment_start;
-      BLI_assert(local_index < max_segment_size);
-      /* It's not great to handle each index separately instead of working with bigger
-       * chunks, but that works well enough for now. */
-      if (bits_slice[local_index]) {
-        local_bits[local_index].set();
-      }
-    }
-    bits::bits_to_index_ranges<int16_t>(local_bits, builder);
-  }
-  return segment_start;
-}
-
-IndexMask IndexMask::from_bits(const IndexMask &universe,
-                               const BitSpan bits,
-                               IndexMaskMemory &memory)
-{
-  BLI_assert(bits.size() >= universe.min_array_size());
-  /* Use #from_batch_predicate because we can process many bits at once. */
-  return IndexMask::from_batch_predicate(
-      universe,
-      GrainSize(max_segment_size),
-      memory,
-      [&](const IndexMaskSegment universe_segment, IndexRangesBuilder<int16_t> &builder) {
-        const IndexRange slice = IndexRange::from_begin_end_inclusive(universe_segment[0],
-                                                                      universe_segment.last());
-        return from_bits_batch_predicate(universe_segment, builder, bits.slice(slice));
-      });
-}
-
-static void segments_from_batch_predicate(
-    const IndexMaskSegment universe_segment,
-    LinearAllocator<> &allocator,
-    const FunctionRef<int64_t(const IndexMaskSegment &universe_segment,
-                              IndexRangesBuilder<int16_t> &builder)> batch_predicate,
-    Vector<IndexMaskSegment, 16> &r_segments)
+/**
+ * Builds mask segments from the index ranges in the builder. Small ranges are merged into
+ * segments that contain the indices explicitly.
+ */
+static void segments_from_index_ranges(const IndexRangesBuilder<int16_t> &builder,
+                                       const int64_t segment_shift,
+                                       LinearAllocator<> &allocator,
+                                       Vector<IndexMaskSegment, 16> &r_segments)
 {
-  IndexRangesBuilderBuffer<int16_t, max_segment_size> builder_buffer;
-  IndexRangesBuilder<int16_t> builder{builder_buffer};
-  const int64_t segment_shift = batch_predicate(universe_segment, builder);
   if (builder.is_empty()) {
     return;
   }
@@ -550,12 +506,15 @@ static void segments_from_batch_predicate(
   consolidate_skipped_ranges(builder.size());
 }
 
-IndexMask IndexMask::from_batch_predicate(
-    const IndexMask &universe,
-    GrainSize grain_size,
-    IndexMaskMemory &memory,
-    const FunctionRef<int64_t(const IndexMaskSegment &universe_segment,
-                              IndexRangesBuilder<int16_t> &builder)> batch_predicate)
+using SegmentsFromUniverseSegmentFn = FunctionRef<void(const IndexMaskSegment &universe_segment,
+                                                       LinearAllocator<> &allocator,
+                                                       Vector<IndexMaskSegment, 16> &r_segments)>;
+
+/** Build the segments of a new mask separately for every segment of the universe. */
+static IndexMask from_universe_segments(const IndexMask &universe,
+                                        const GrainSize grain_size,
+                                        IndexMaskMemory &memory,
+                                        const SegmentsFromUniverseSegmentFn fn)
 {
   if (universe.is_empty()) {
     return {};
@@ -565,15 +524,14 @@ IndexMask IndexMask::from_batch_predicate(
   if (universe.size() <= grain_size.value) {
     for (const int64_t segment_i : IndexRange(universe.segments_num())) {
       const IndexMaskSegment universe_segment = universe.segment(segment_i);
-      segments_from_batch_predicate(universe_segment, memory, batch_predicate, segments);
+      fn(universe_segment, memory, segments);
     }
   }
   else {
     ParallelSegmentsCollector segments_collector;
     universe.foreach_segment(grain_size, [&](const IndexMaskSegment universe_segment) {
       ParallelSegmentsCollector::LocalData &data = segments_collector.data_by_thread.local();
-      segments_from_batch_predicate(
-          universe_segment, data.allocator, batch_predicate, data.segments);
+      fn(universe_segment, data.allocator, data.segments);
     });
     segments_collector.reduce(memory, segments);
   }
@@ -581,6 +539,154 @@ IndexMask IndexMask::from_batch_predicate(
   return IndexMask::from_segments(segments, memory);
 }
 
+/** Count the number of set bits and the number of ranges of consecutive set bits. */
+static void count_set_bits_and_ranges(const BitSpan bits,
+                                      int64_t &r_set_bits_num,
+                                      int64_t &r_ranges_num)
+{
+  r_set_bits_num = 0;
+  r_ranges_num = 0;
+  /* The last bit of the previously processed integer. */
+  bits::BitInt carry = 0;
+  auto process_bit_int = [&](const bits::BitInt value, const int64_t bits_num) {
+    r_set_bits_num += count_bits_uint64(value);
+    /* A range starts at every set bit whose previous bit is not set. */
+    r_ranges_num += count_bits_uint64(value & ~((value << 1) | carry));
+    carry = (value >> (bits_num - 1)) & 1;
+  };
+
+  const bits::BitInt *data = bits.data();
+  const IndexRange bit_range = bits.bit_range();
+  const AlignedIndexRanges ranges = split_index_range_by_alignment(bit_range, bits::BitsPerInt);
+  if (!ranges.prefix.is_empty()) {
+    const bits::BitInt first_int = *bits::int_containing_bit(data, bit_range.start()) >>
+                                   (bits::BitInt(ranges.prefix.start()) & bits::BitIndexMask);
+    process_bit_int(first_int & bits::mask_first_n_bits(ranges.prefix.size()),
+                    ranges.prefix.size());
+  }
+  if (!ranges.aligned.is_empty()) {
+    const bits::BitInt *start = bits::int_containing_bit(data, ranges.aligned.start());
+    for (const int64_t i : IndexRange(ranges.aligned.size() / bits::BitsPerInt)) {
+      process_bit_int(start[i], bits::BitsPerInt);
+    }
+  }
+  if (!ranges.suffix.is_empty()) {
+    const bits::BitInt last_int = *bits::int_containing_bit(data, bit_range.last());
+    process_bit_int(last_int & bits::mask_first_n_bits(ranges.suffix.size()),
+                    ranges.suffix.size());
+  }
+}
+
+/**
+ * Builds the segments for the set bits. The first bit corresponds to \a segment_start and there
+ * are at most #max_segment_size bits.
+ */
+static void segments_from_bits(const int64_t segment_start,
+                               const BitSpan bits,
+                               LinearAllocator<> &allocator,
+                               Vector<IndexMaskSegment, 16> &r_segments)
+{
+  BLI_assert(bits.size() <= max_segment_size);
+  int64_t set_bits_num;
+  int64_t ranges_num;
+  count_set_bits_and_ranges(bits, set_bits_num, ranges_num);
+  if (set_bits_num == 0) {
+    return;
+  }
+  if (set_bits_num >= ranges_num * 16) {
+    /* Most set bits are part of longer ranges, so it's more efficient to detect the ranges. */
+    IndexRangesBuilderBuffer<int16_t, max_segment_size> builder_buffer;
+    IndexRangesBuilder<int16_t> builder{builder_buffer};
+    bits::bits_to_index_ranges<int16_t>(bits, builder);
+    segments_from_index_ranges(builder, segment_start, allocator, r_segments);
+    return;
+  }
+
+  /* There are many small ranges, so it's faster to extract all indices at once and to only detect
+   * the longer ranges afterwards. */
+  MutableSpan<int16_t> indices = allocator.allocate_array<int16_t>(set_bits_num);
+  bits::bits_to_indices(bits, indices);
+  Vector<std::variant<IndexRange, Span<int16_t>>, 16> parts;
+  unique_sorted_indices::split_to_ranges_and_spans<int16_t>(indices, 64, parts);
+  const Span<int16_t> static_indices = get_static_indices_array();
+  for (const std::variant<IndexRange, Span<int16_t>> &part : parts) {
+    if (std::holds_alternative<IndexRange>(part)) {
+      const IndexRange range = std::get<IndexRange>(part);
+      r_segments.append_as(segment_start, static_indices.slice(range));
+    }
+    else {
+      r_segments.append_as(segment_start, std::get<Span<int16_t>>(part));
+    }
+  }
+}
+
+static void segments_from_bits(const IndexMaskSegment universe_segment,
+                               const BitSpan bits_slice,
+                               LinearAllocator<> &allocator,
+                               Vector<IndexMaskSegment, 16> &r_segments)
+{
+  const int64_t segment_start = universe_segment[0];
+  if (unique_sorted_indices::non_empty_is_range(universe_segment.base_span())) {
+    segments_from_bits(segment_start, bits_slice, allocator, r_segments);
+    return;
+  }
+  /* If the universe is not a range, we need to create a new bit span first. In it, bits that are
+   * not part of the universe are set to 0. */
+  const int64_t segment_end = universe_segment.last() + 1;
+  BitVector<max_segment_size> local_bits(segment_end - segment_start, false);
+  for (const int64_t i : universe_segment.index_range()) {
+    const int64_t global_index = universe_segment[i];
+    const int64_t local_index = global_index - segment_start;
+    BLI_assert(local_index < max_segment_size);
+    /* It's not great to handle each index separately instead of working with bigger
+     * chunks, but that works well enough for now. */
+    if (bits_slice[local_index]) {
+      local_bits[local_index].set();
+    }
+  }
+  segments_from_bits(segment_start, local_bits, allocator, r_segments);
+}
+
+IndexMask IndexMask::from_bits(const IndexMask &universe,
+                               const BitSpan bits,
+                               IndexMaskMemory &memory)
+{
+  BLI_assert(bits.size() >= universe.min_array_size());
+  /* Process a full segment at once, because many bits can be processed at once. */
+  return from_universe_segments(
+      universe,
+      GrainSize(max_segment_size),
+      memory,
+      [&](const IndexMaskSegment &universe_segment,
+          LinearAllocator<> &allocator,
+          Vector<IndexMaskSegment, 16> &r_segments) {
+        const IndexRange slice = IndexRange::from_begin_end_inclusive(universe_segment[0],
+                                                                      universe_segment.last());
+        segments_from_bits(universe_segment, bits.slice(slice), allocator, r_segments);
+      });
+}
+
+IndexMask IndexMask::from_batch_predicate(
+    const IndexMask &universe,
+    GrainSize grain_size,
+    IndexMaskMemory &memory,
+    const FunctionRef<int64_t(const IndexMaskSegment &universe_segment,
+                              IndexRangesBuilder<int16_t> &builder)> batch_predicate)
+{
+  return from_universe_segments(
+      universe,
+      grain_size,
+      memory,
+      [&](const IndexMaskSegment &universe_segment,
+          LinearAllocator<> &allocator,
+          Vector<IndexMaskSegment, 16> &r_segments) {
+        IndexRangesBuilderBuffer<int16_t, max_segment_size> builder_buffer;
+        IndexRangesBuilder<int16_t> builder{builder_buffer};
+        const int64_t segment_shift = batch_predicate(universe_segment, builder);
+        segments_from_index_ranges(builder, segment_shift, allocator, r_segments);
+      });
+}
+
 IndexMask IndexMask::from_bools(Span<bool> bools, IndexMaskMemory &memory)
 {
   return IndexMask::from_bools(bools.index_range(), bools, memory);
@@ -601,12 +707,13 @@ IndexMask IndexMask::from_bools(const IndexMask &universe,
                                 IndexMaskMemory &memory)
 {
   BLI_assert(bools.size() >= universe.min_array_size());
-  return IndexMask::from_batch_predicate(
+  return from_universe_segments(
       universe,
       GrainSize(max_segment_size),
       memory,
-      [&](const IndexMaskSegment universe_segment,
-          IndexRangesBuilder<int16_t> &builder) -> int64_t {
+      [&](const IndexMaskSegment &universe_segment,
+          LinearAllocator<> &allocator,
+          Vector<IndexMaskSegment, 16> &r_segments) {
         const IndexRange slice = IndexRange::from_begin_end_inclusive(universe_segment[0],
                                                                       universe_segment.last());
         /* +16 to allow for some overshoot when converting bools to bits. */
@@ -617,9 +724,9 @@ IndexMask IndexMask::from_bools(const IndexMask &universe,
         const bool any_true = bits::or_bools_into_bits(
             bools.slice(slice), bits, allowed_overshoot);
         if (!any_true) {
-          return 0;
+          return;
         }
-        return from_bits_batch_predicate(universe_segment, builder, bits);
+        segments_from_bits(universe_segment, bits, allocator, r_segments);
       });
   BitVector bits(bools);
   return IndexMask::from_bits(universe, bits, memory);
@@ -16,8 +16,11 @@
  */
 
 #include "BLI_array.hh"
+#include "BLI_array_utils.hh"
+#include "BLI_binary_search.hh"
 #include "BLI_bit_group_vector.hh"
 #include "BLI_bit_span_ops.hh"
+#include "BLI_bit_span_to_indices.hh"
 #include "BLI_enumerable_thread_specific.hh"
 #include "BLI_index_mask_expression.hh"
 #include "BLI_stack.hh"
@@ -567,13 +570,10 @@ static CoarseResult evaluate_coarse(const Expr &root_expression,
 
 static Span<int16_t> bits_to_indices(const BoundedBitSpan bits, LinearAllocator<> &allocator)
 {
-  /* TODO: Could first count the number of set bits. */
-  Vector<int16_t, max_segment_size> indices_vec;
-  bits::foreach_1_index(bits, [&](const int64_t i) {
-    BLI_assert(i < max_segment_size);
-    indices_vec.append_unchecked(int16_t(i));
-  });
-  return allocator.construct_array_copy<int16_t>(indices_vec);
+  BLI_assert(bits.size() <= max_segment_size);
+  std::array<int16_t, max_segment_size> indices_buffer;
+  const int64_t indices_num = bits::bits_to_indices(bits, indices_buffer);
+  return allocator.construct_array_copy<int16_t>(Span(indices_buffer.data(), indices_num));
 }
 
 /**
@@ -641,6 +641,107 @@ static IndexMaskSegment evaluate_exact_with_bits(const Expr &root_expression,
   return IndexMaskSegment(bounds_min, indices);
 }
 
+/**
+ * Get the range of values that is covered by the segment if it does not have any gaps. Segments
+ * are often ranges, which allows computing set operations with them without a full merge of the
+ * sorted indices. Instead, only the relevant parts of the other segment have to be copied.
+ */
+static std::optional<IndexRange> segment_as_range(const IndexMaskSegment &segment)
+{
+  if (segment.is_empty()) {
+    return std::nullopt;
+  }
+  if (const std::optional<IndexRange> range = unique_sorted_indices::non_empty_as_range_try(
+          segment.base_span()))
+  {
+    return range->shift(segment.offset());
+  }
+  return std::nullopt;
+}
+
+/** Find the positions in the segment of the indices that are in the given range of values. */
+static IndexRange find_indices_in_range(const IndexMaskSegment &segment, const IndexRange range)
+{
+  const Span<int16_t> base_span = segment.base_span();
+  const int64_t offset = segment.offset();
+  const int64_t begin = binary_search::first_if(
+      base_span, [&](const int16_t i) { return i + offset >= range.start(); });
+  const int64_t size = binary_search::first_if(
+      base_span.drop_front(begin),
+      [&](const int16_t i) { return i + offset >= range.one_after_last(); });
+  return IndexRange(begin, size);
+}
+
+static int16_t *copy_segment_indices(const IndexMaskSegment &segment, int16_t *dst)
+{
+  const Span<int16_t> base_span = segment.base_span();
+  const int64_t offset = segment.offset();
+  for (const int64_t i : base_span.index_range()) {
+    dst[i] = int16_t(base_span[i] + offset);
+  }
+  return dst + base_span.size();
+}
+
+static int16_t *fill_range_indices(const IndexRange range, int16_t *dst)
+{
+  array_utils::fill_index_range(MutableSpan<int16_t>(dst, range.size()), int16_t(range.start()));
+  return dst + range.size();
+}
+
+/**
+ * Computes the union of a range and another segment. The segments are expected to be shifted so
+ * that all indices fit into #int16_t already.
+ */
+static int64_t union_range_and_segment(const IndexRange range,
+                                       const IndexMaskSegment &segment,
+                                       int16_t *r_values)
+{
+  const IndexRange indices_in_range = find_indices_in_range(segment, range);
+  const IndexRange indices_after_range = IndexRange::from_begin_end(
+      indices_in_range.one_after_last(), segment.size());
+  int16_t *dst = r_values;
+  dst = copy_segment_indices(segment.slice(0, indices_in_range.start()), dst);
+  dst = fill_range_indices(range, dst);
+  dst = copy_segment_indices(segment.slice(indices_after_range), dst);
+  return dst - r_values;
+}
+
+static int64_t intersect_range_and_segment(const IndexRange range,
+                                           const IndexMaskSegment &segment,
+                                           int16_t *r_values)
+{
+  const IndexRange indices_in_range = find_indices_in_range(segment, range);
+  return copy_segment_indices(segment.slice(indices_in_range), r_values) - r_values;
+}
+
+static int64_t subtract_range_from_segment(const IndexMaskSegment &segment,
+                                           const IndexRange range,
+                                           int16_t *r_values)
+{
+  const IndexRange indices_in_range = find_indices_in_range(segment, range);
+  const IndexRange indices_after_range = IndexRange::from_begin_end(
+      indices_in_range.one_after_last(), segment.size());
+  int16_t *dst = r_values;
+  dst = copy_segment_indices(segment.slice(0, indices_in_range.start()), dst);
+  dst = copy_segment_indices(segment.slice(indices_after_range), dst);
+  return dst - r_values;
+}
+
+static int64_t subtract_segment_from_range(const IndexRange range,
+                                           const IndexMaskSegment &segment,
+                                           int16_t *r_values)
+{
+  const IndexMaskSegment indices_in_range = segment.slice(find_indices_in_range(segment, range));
+  int16_t *dst = r_values;
+  int64_t next_index = range.start();
+  for (const int64_t index : indices_in_range) {
+    dst = fill_range_indices(IndexRange::from_begin_end(next_index, index), dst);
+    next_index = index + 1;
+  }
+  dst = fill_range_indices(IndexRange::from_begin_end(next_index, range.one_after_last()), dst);
+  return dst - r_values;
+}
+
 /** Compute a new set of indices that is the union of the given segments. */
 static IndexMaskSegment union_index_mask_segments(const Span<IndexMaskSegment> segments,
                                                   const int64_t bounds_min,
@@ -655,8 +756,16 @@ static IndexMaskSegment union_index_mask_segments(const Span<IndexMaskSegment> s
   if (segments.size() == 2) {
     const IndexMaskSegment a = segments[0].shift(-bounds_min);
     const IndexMaskSegment b = segments[1].shift(-bounds_min);
-    const int64_t size = std::set_union(a.begin(), a.end(), b.begin(), b.end(), r_values) -
-                         r_values;
+    int64_t size;
+    if (const std::optional<IndexRange> a_range = segment_as_range(a)) {
+      size = union_range_and_segment(*a_range, b, r_values);
+    }
+    else if (const std::optional<IndexRange> b_range = segment_as_range(b)) {
+      size = union_range_and_segment(*b_range, a, r_values);
+    }
+    else {
+      size = std::set_union(a.begin(), a.end(), b.begin(), b.end(), r_values) - r_values;
+    }
     return {bounds_min, {r_values, size}};
   }
 
@@ -715,8 +824,16 @@ static IndexMaskSegment intersect_index_mask_segments(const Span<IndexMaskSegmen
   if (segments.size() == 2) {
     const IndexMaskSegment a = segments[0].shift(-bounds_min);
     const IndexMaskSegment b = segments[1].shift(-bounds_min);
-    const int64_t size = std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), r_values) -
-                         r_values;
+    int64_t size;
+    if (const std::optional<IndexRange> a_range = segment_as_range(a)) {
+      size = intersect_range_and_segment(*a_range, b, r_values);
+    }
+    else if (const std::optional<IndexRange> b_range = segment_as_range(b)) {
+      size = intersect_range_and_segment(*b_range, a, r_values);
+    }
+    else {
+      size = std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), r_values) - r_values;
+    }
     return {bounds_min, {r_values, size}};
   }
 
@@ -773,12 +890,22 @@ static IndexMaskSegment difference_index_mask_segments(
   if (subtract_segments.size() == 1) {
     const IndexMaskSegment shifted_main_segment = main_segment.shift(-bounds_min);
     const IndexMaskSegment subtract_segment = subtract_segments[0].shift(-bounds_min);
-    const int64_t size = std::set_difference(shifted_main_segment.begin(),
-                                             shifted_main_segment.end(),
-                                             subtract_segment.begin(),
-                                             subtract_segment.end(),
-                                             r_values) -
-                         r_values;
+    int64_t size;
+    if (const std::optional<IndexRange> subtract_range = segment_as_range(subtract_segment)) {
+      size = subtract_range_from_segment(shifted_main_segment, *subtract_range, r_values);
+    }
+    else if (const std::optional<IndexRange> main_range = segment_as_range(shifted_main_segment))
+    {
+      size = subtract_segment_from_range(*main_range, subtract_segment, r_values);
+    }
+    else {
+      size = std::set_difference(shifted_main_segment.begin(),
+                                 shifted_main_segment.end(),
+                                 subtract_segment.begin(),
+                                 subtract_segment.end(),
+                                 r_values) -
+             r_values;
+    }
     return {bounds_min, {r_values, size}};
   }
 
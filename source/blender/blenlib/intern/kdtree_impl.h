@@ -8,8 +8,11 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "BLI_array.hh"
 #include "BLI_kdtree_impl.h"
 #include "BLI_math_base.h"
+#include "BLI_offset_indices.hh"
+#include "BLI_task.hh"
 #include "BLI_utildefines.h"
 #include "BLI_vector.hh"
 
@@ -54,6 +57,9 @@ struct KDTree {
 #define KD_NEAR_ALLOC_INC 100 /* alloc increment for collecting nearest */
 #define KD_FOUND_ALLOC_INC 50 /* alloc increment for collecting nearest */
 
+#define KD_BALANCE_THREAD_NODES_THRESHOLD 10000 /* smaller sub-trees are balanced on one thread */
+#define KD_BATCH_GRAIN_SIZE 256                /* number of points per task in batched queries */
+
 #define KD_NODE_UNSET ((uint)-1)
 
 /**
@@ -194,9 +200,14 @@ static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const u
   node = &nodes[median];
   node->d = axis;
   axis = (axis + 1) % KD_DIMS;
-  node->left = kdtree_balance(nodes, median, axis, ofs);
-  node->right = kdtree_balance(
-      nodes + median + 1, (nodes_len - (median + 1)), axis, (median + 1) + ofs);
+  /* The sub-nodes on either side of the median are independent. */
+  blender::threading::parallel_invoke(
+      nodes_len > KD_BALANCE_THREAD_NODES_THRESHOLD,
+      [&]() { node->left = kdtree_balance(nodes, median, axis, ofs); },
+      [&]() {
+        node->right = kdtree_balance(
+            nodes + median + 1, (nodes_len - (median + 1)), axis, (median + 1) + ofs);
+      });
 
   return median + ofs;
 }
@@ -801,6 +812,105 @@ finally:
   }
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Batched Queries
+ *
+ * Search for many points at once, in parallel. Results are written to arrays provided by the
+ * caller or gathered per task, so there are no allocations per point.
+ * \{ */
+
+void BLI_kdtree_nd_(find_nearest_batch)(const KDTree *tree,
+                                        const float (*co_array)[KD_DIMS],
+                                        const int co_len,
+                                        KDTreeNearest *r_nearest)
+{
+  using namespace blender;
+  threading::parallel_for(IndexRange(co_len), KD_BATCH_GRAIN_SIZE, [&](const IndexRange range) {
+    for (const int64_t i : range) {
+      if (BLI_kdtree_nd_(find_nearest)(tree, co_array[i], &r_nearest[i]) == -1) {
+        r_nearest[i].index = -1;
+      }
+    }
+  });
+}
+
+void BLI_kdtree_nd_(find_nearest_n_batch)(const KDTree *tree,
+                                          const float (*co_array)[KD_DIMS],
+                                          const int co_len,
+                                          KDTreeNearest *r_nearest,
+                                          const uint nearest_len_capacity,
+                                          int *r_nearest_len)
+{
+  using namespace blender;
+  threading::parallel_for(IndexRange(co_len), KD_BATCH_GRAIN_SIZE, [&](const IndexRange range) {
+    for (const int64_t i : range) {
+      r_nearest_len[i] = BLI_kdtree_nd_(find_nearest_n)(
+          tree, co_array[i], &r_nearest[size_t(i) * nearest_len_capacity], nearest_len_capacity);
+    }
+  });
+}
+
+int BLI_kdtree_nd_(range_search_batch)(const KDTree *tree,
+                                       const float (*co_array)[KD_DIMS],
+                                       const int co_len,
+                                       const float range,
+                                       int *r_offsets,
+                                       KDTreeNearest **r_nearest)
+{
+  using namespace blender;
+  /* Gather the results of every chunk of points separately, the chunks are concatenated once the
+   * number of points found for every search point is known. */
+  const int chunks_num = (co_len + KD_BATCH_GRAIN_SIZE - 1) / KD_BATCH_GRAIN_SIZE;
+  const auto chunk_range = [&](const int64_t chunk) {
+    return IndexRange(co_len).slice(chunk * KD_BATCH_GRAIN_SIZE,
+                                    std::min<int64_t>(KD_BATCH_GRAIN_SIZE,
+                                                      co_len - chunk * KD_BATCH_GRAIN_SIZE));
+  };
+  Array<Vector<KDTreeNearest>> chunk_nearest(chunks_num);
+  threading::parallel_for(IndexRange(chunks_num), 1, [&](const IndexRange chunks) {
+    for (const int64_t chunk : chunks) {
+      Vector<KDTreeNearest> &nearest = chunk_nearest[chunk];
+      for (const int64_t i : chunk_range(chunk)) {
+        const int64_t nearest_start = nearest.size();
+        BLI_kdtree_nd_(range_search_cb_cpp)(
+            tree,
+            co_array[i],
+            range,
+            [&](const int index, const float co[KD_DIMS], const float dist_sq) {
+              KDTreeNearest found;
+              found.index = index;
+              found.dist = sqrtf(dist_sq);
+              copy_vn_vn(found.co, co);
+              nearest.append(found);
+              return true;
+            });
+        std::sort(nearest.begin() + nearest_start,
+                  nearest.end(),
+                  [](const KDTreeNearest &a, const KDTreeNearest &b) { return a.dist < b.dist; });
+        r_offsets[i] = int(nearest.size() - nearest_start);
+      }
+    }
+  });
+
+  const OffsetIndices<int> offsets = offset_indices::accumulate_counts_to_offsets(
+      MutableSpan<int>(r_offsets, co_len + 1));
+  const int nearest_len = offsets.total_size();
+  *r_nearest = nearest_len ? MEM_malloc_arrayN<KDTreeNearest>(size_t(nearest_len), __func__) :
+                             nullptr;
+  threading::parallel_for(IndexRange(chunks_num), 1, [&](const IndexRange chunks) {
+    for (const int64_t chunk : chunks) {
+      const Span<KDTreeNearest> nearest = chunk_nearest[chunk];
+      if (!nearest.is_empty()) {
+        const int64_t start = offsets[chunk_range(chunk)].start();
+        std::copy(nearest.begin(), nearest.end(), *r_nearest + start);
+      }
+    }
+  });
+  return nearest_len;
+}
+
+/** \} */
+
 /**
  * Use when we want to loop over nodes ordered by index.
  * Requires indices to be aligned with nodes.
@@ -8,6 +8,7 @@
 
 #include "BLI_lazy_threading.hh"
 #include "BLI_stack.hh"
+#include "BLI_task_trace.hh"
 #include "BLI_vector.hh"
 
 namespace blender::lazy_threading {
@@ -27,7 +28,13 @@ static thread_local HintReceivers hint_receivers = []() {
 
 void send_hint()
 {
-  for (const FunctionRef<void()> &fn : hint_receivers.peek()) {
+  const RawVector<FunctionRef<void()>, 0> &receivers = hint_receivers.peek();
+  if (!receivers.is_empty()) {
+    /* Only record hints that can actually move work to other threads. */
+    threading::trace::record_instant(threading::trace::EventType::LazyThreadingHint,
+                                     threading::trace::current_label_if_enabled());
+  }
+  for (const FunctionRef<void()> &fn : receivers) {
     fn();
   }
 }
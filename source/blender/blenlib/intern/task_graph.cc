@@ -11,6 +11,7 @@
 #include "MEM_guardedalloc.h"
 
 #include "BLI_task.h"
+#include "BLI_task_trace.hh"
 
 #include <memory>
 #include <vector>
@@ -44,6 +45,8 @@ struct TaskNode {
   /* Optional callback to free task data along with the graph. If task data
    * is shared between nodes, only a single task node should free the data. */
   TaskGraphNodeFreeFunction free_func;
+  /* Label of the thread that created the node, for tracing. */
+  const char *trace_label;
 
   TaskNode(TaskGraph *task_graph,
            TaskGraphNodeRunFunction run_func,
@@ -57,7 +60,8 @@ struct TaskNode {
 #endif
         run_func(run_func),
         task_data(task_data),
-        free_func(free_func)
+        free_func(free_func),
+        trace_label(blender::threading::trace::current_label_if_enabled())
   {
 #ifndef WITH_TBB
     UNUSED_VARS(task_graph);
@@ -77,14 +81,22 @@ struct TaskNode {
 #ifdef WITH_TBB
   tbb::flow::continue_msg run(const tbb::flow::continue_msg /*input*/)
   {
-    run_func(task_data);
+    this->run_traced();
     return tbb::flow::continue_msg();
   }
 #endif
 
-  void run_serial()
+  void run_traced()
   {
+    using namespace blender::threading;
+    const trace::ScopedEvent trace_event{trace::EventType::GraphNode, trace_label};
+    const trace::ScopedLabel scoped_label{trace_label};
     run_func(task_data);
+  }
+
+  void run_serial()
+  {
+    this->run_traced();
     for (TaskNode *successor : successors) {
       successor->run_serial();
     }
@@ -20,6 +20,7 @@
 #include "BLI_assert.h"
 #include "BLI_mempool.h"
 #include "BLI_task.h"
+#include "BLI_task_trace.hh"
 #include "BLI_threads.h"
 #include "BLI_vector.hh"
 
@@ -41,13 +42,20 @@ class Task {
   void *taskdata;
   bool free_taskdata;
   TaskFreeFunction freedata;
+  /* Label of the thread that pushed the task, for tracing. */
+  const char *trace_label;
 
   Task(TaskPool *pool,
        TaskRunFunction run,
        void *taskdata,
        bool free_taskdata,
        TaskFreeFunction freedata)
-      : pool(pool), run(run), taskdata(taskdata), free_taskdata(free_taskdata), freedata(freedata)
+      : pool(pool),
+        run(run),
+        taskdata(taskdata),
+        free_taskdata(free_taskdata),
+        freedata(freedata),
+        trace_label(blender::threading::trace::current_label_if_enabled())
   {
   }
 
@@ -72,7 +80,8 @@ class Task {
         run(other.run),
         taskdata(other.taskdata),
         free_taskdata(other.free_taskdata),
-        freedata(other.freedata)
+        freedata(other.freedata),
+        trace_label(other.trace_label)
   {
     other.pool = nullptr;
     other.run = nullptr;
@@ -92,7 +101,8 @@ class Task {
         run(other.run),
         taskdata(other.taskdata),
         free_taskdata(other.free_taskdata),
-        freedata(other.freedata)
+        freedata(other.freedata),
+        trace_label(other.trace_label)
   {
     ((Task &)other).pool = nullptr;
     ((Task &)other).run = nullptr;
@@ -113,6 +123,9 @@ class Task {
 /* Execute task. */
 void Task::operator()() const
 {
+  using namespace blender::threading;
+  const trace::ScopedEvent trace_event{trace::EventType::PoolTask, trace_label};
+  const trace::ScopedLabel scoped_label{trace_label};
   run(pool, taskdata);
 }
 
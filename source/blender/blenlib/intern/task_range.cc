@@ -17,6 +17,7 @@
 #include "BLI_offset_indices.hh"
 #include "BLI_task.h"
 #include "BLI_task.hh"
+#include "BLI_task_trace.hh"
 #include "BLI_threads.h"
 #include "BLI_vector.hh"
 
@@ -39,23 +40,35 @@ struct RangeTask {
 
   void *userdata_chunk;
 
+  /* Label of the thread that started the parallel range, for tracing. */
+  const char *trace_label;
+
   /* Root constructor. */
   RangeTask(TaskParallelRangeFunc func, void *userdata, const TaskParallelSettings *settings)
-      : func(func), userdata(userdata), settings(settings)
+      : func(func),
+        userdata(userdata),
+        settings(settings),
+        trace_label(blender::threading::trace::current_label_if_enabled())
   {
     init_chunk(settings->userdata_chunk);
   }
 
   /* Copy constructor. */
   RangeTask(const RangeTask &other)
-      : func(other.func), userdata(other.userdata), settings(other.settings)
+      : func(other.func),
+        userdata(other.userdata),
+        settings(other.settings),
+        trace_label(other.trace_label)
   {
     init_chunk(settings->userdata_chunk);
   }
 
   /* Splitting constructor for parallel reduce. */
   RangeTask(RangeTask &other, tbb::split /*unused*/)
-      : func(other.func), userdata(other.userdata), settings(other.settings)
+      : func(other.func),
+        userdata(other.userdata),
+        settings(other.settings),
+        trace_label(other.trace_label)
   {
     init_chunk(settings->userdata_chunk);
   }
@@ -81,6 +94,10 @@ struct RangeTask {
 
   void operator()(const tbb::blocked_range<int> &r) const
   {
+    using namespace blender::threading;
+    const trace::ScopedEvent trace_event{
+        trace::EventType::ParallelRange, trace_label, int64_t(r.size())};
+    const trace::ScopedLabel scoped_label{trace_label};
     TaskParallelTLS tls;
     tls.userdata_chunk = userdata_chunk;
     for (int i = r.begin(); i != r.end(); ++i) {
@@ -108,6 +125,8 @@ void BLI_task_parallel_range(const int start,
     RangeTask task(func, userdata, settings);
     const size_t grainsize = std::max(settings->min_iter_per_thread, 1);
     const tbb::blocked_range<int> range(start, stop, grainsize);
+    const blender::threading::trace::ScopedEvent trace_event{
+        blender::threading::trace::EventType::ParallelRegion, task.trace_label, stop - start};
 
     blender::lazy_threading::send_hint();
 
@@ -246,12 +265,12 @@ static void parallel_for_impl_accumulated_size_lookup(
       });
 }
 
-void parallel_for_impl(const IndexRange range,
-                       const int64_t grain_size,
-                       const FunctionRef<void(IndexRange)> function,
-                       const TaskSizeHints &size_hints)
-{
 #ifdef WITH_TBB
+static void parallel_for_impl_untraced(const IndexRange range,
+                                       const int64_t grain_size,
+                                       const FunctionRef<void(IndexRange)> function,
+                                       const TaskSizeHints &size_hints)
+{
   lazy_threading::send_hint();
   switch (size_hints.type) {
     case TaskSizeHints::Type::Static: {
@@ -279,7 +298,43 @@ void parallel_for_impl(const IndexRange range,
       break;
     }
   }
+}
+
+/**
+ * Records the region and every sub-range. The label is passed on to the threads that process the
+ * sub-ranges, so that nested parallel work is attributed to the same label.
+ */
+static void parallel_for_impl_traced(const IndexRange range,
+                                     const int64_t grain_size,
+                                     const FunctionRef<void(IndexRange)> function,
+                                     const TaskSizeHints &size_hints)
+{
+  const char *label = trace::current_label();
+  const trace::ScopedEvent region_event{trace::EventType::ParallelRegion, label, range.size()};
+  parallel_for_impl_untraced(
+      range,
+      grain_size,
+      [&](const IndexRange sub_range) {
+        const trace::ScopedEvent range_event{
+            trace::EventType::ParallelRange, label, sub_range.size()};
+        const trace::ScopedLabel scoped_label{label};
+        function(sub_range);
+      },
+      size_hints);
+}
+#endif /* WITH_TBB */
 
+void parallel_for_impl(const IndexRange range,
+                       const int64_t grain_size,
+                       const FunctionRef<void(IndexRange)> function,
+                       const TaskSizeHints &size_hints)
+{
+#ifdef WITH_TBB
+  if (UNLIKELY(trace::is_enabled())) {
+    parallel_for_impl_traced(range, grain_size, function, size_hints);
+    return;
+  }
+  parallel_for_impl_untraced(range, grain_size, function, size_hints);
 #else
   UNUSED_VARS(grain_size, size_hints);
   function(range);
@@ -0,0 +1,251 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup bli
+ */
+
+#include <chrono>
+#include <fmt/format.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "BLI_fileops.hh"
+#include "BLI_mutex.hh"
+#include "BLI_task_trace.hh"
+#include "BLI_threads.h"
+
+namespace blender::threading::trace {
+
+namespace detail {
+std::atomic<bool> is_enabled = false;
+}
+
+namespace {
+
+struct Event {
+  const char *label;
+  int64_t start_ns;
+  int64_t end_ns;
+  int64_t size;
+  EventType type;
+};
+
+/**
+ * Events of a single thread. The buffers are owned by #TraceData and outlive their threads, so
+ * that the events can be exported later.
+ *
+ * This uses standard containers instead of the guarded allocator, because threads may still
+ * record events while Blender checks for memory leaks on exit.
+ */
+struct ThreadEvents {
+  /** Only locked by the owning thread while recording, so it's uncontended almost always. */
+  Mutex mutex;
+  std::vector<Event> events;
+  int thread_index;
+  bool is_main_thread;
+};
+
+struct TraceData {
+  Mutex mutex;
+  std::vector<std::unique_ptr<ThreadEvents>> threads;
+  /** Timestamps are relative to the start of the trace. */
+  std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+};
+
+}  // namespace
+
+static TraceData &get_trace_data()
+{
+  static TraceData data;
+  return data;
+}
+
+static thread_local ThreadEvents *current_thread_events = nullptr;
+static thread_local const char *current_thread_label = nullptr;
+
+static ThreadEvents &ensure_thread_events()
+{
+  if (current_thread_events == nullptr) {
+    TraceData &data = get_trace_data();
+    std::lock_guard lock{data.mutex};
+    auto thread_events = std::make_unique<ThreadEvents>();
+    thread_events->thread_index = int(data.threads.size());
+    thread_events->is_main_thread = BLI_thread_is_main();
+    current_thread_events = thread_events.get();
+    data.threads.push_back(std::move(thread_events));
+  }
+  return *current_thread_events;
+}
+
+namespace detail {
+
+int64_t time_now_ns()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() -
+                                                              get_trace_data().start_time)
+      .count();
+}
+
+void record(const EventType type,
+            const char *label,
+            const int64_t start_ns,
+            const int64_t end_ns,
+            const int64_t size)
+{
+  ThreadEvents &thread_events = ensure_thread_events();
+  std::lock_guard lock{thread_events.mutex};
+  thread_events.events.push_back({label, start_ns, end_ns, size, type});
+}
+
+}  // namespace detail
+
+void start()
+{
+  TraceData &data = get_trace_data();
+  {
+    std::lock_guard lock{data.mutex};
+    for (std::unique_ptr<ThreadEvents> &thread_events : data.threads) {
+      std::lock_guard thread_lock{thread_events->mutex};
+      thread_events->events.clear();
+    }
+  }
+  detail::is_enabled.store(true, std::memory_order_relaxed);
+}
+
+void stop()
+{
+  detail::is_enabled.store(false, std::memory_order_relaxed);
+}
+
+int64_t events_num()
+{
+  TraceData &data = get_trace_data();
+  std::lock_guard lock{data.mutex};
+  int64_t num = 0;
+  for (std::unique_ptr<ThreadEvents> &thread_events : data.threads) {
+    std::lock_guard thread_lock{thread_events->mutex};
+    num += int64_t(thread_events->events.size());
+  }
+  return num;
+}
+
+static const char *event_type_name(const EventType type)
+{
+  switch (type) {
+    case EventType::ParallelRegion:
+      return "parallel_region";
+    case EventType::ParallelRange:
+      return "parallel_range";
+    case EventType::PoolTask:
+      return "pool_task";
+    case EventType::GraphNode:
+      return "graph_node";
+    case EventType::LazyThreadingHint:
+      return "lazy_threading_hint";
+  }
+  return "";
+}
+
+static void append_json_string(std::string &r_json, const char *str)
+{
+  r_json += '"';
+  for (const char *c = str; *c; c++) {
+    switch (*c) {
+      case '"':
+        r_json += "\\\"";
+        break;
+      case '\\':
+        r_json += "\\\\";
+        break;
+      case '\n':
+        r_json += "\\n";
+        break;
+      default:
+        if (uint8_t(*c) < 0x20) {
+          r_json += fmt::format("\\u{:04x}", int(*c));
+        }
+        else {
+          r_json += *c;
+        }
+        break;
+    }
+  }
+  r_json += '"';
+}
+
+std::string to_trace_event_json()
+{
+  TraceData &data = get_trace_data();
+  std::lock_guard lock{data.mutex};
+
+  std::string json = R"({"displayTimeUnit":"ms","traceEvents":[)";
+  json += R"({"name":"process_name","ph":"M","pid":1,"args":{"name":"Blender"}})";
+  for (const std::unique_ptr<ThreadEvents> &thread_events : data.threads) {
+    const std::string thread_name = thread_events->is_main_thread ?
+                                        std::string("Main") :
+                                        fmt::format("Worker {}", thread_events->thread_index);
+    json += fmt::format(
+        ",\n"
+        R"({{"name":"thread_name","ph":"M","pid":1,"tid":{},"args":{{"name":"{}"}}}})",
+        thread_events->thread_index,
+        thread_name);
+    /* Keep the main thread on top. */
+    json += fmt::format(
+        ",\n"
+        R"({{"name":"thread_sort_index","ph":"M","pid":1,"tid":{},"args":{{"sort_index":{}}}}})",
+        thread_events->thread_index,
+        thread_events->is_main_thread ? -1 : thread_events->thread_index);
+
+    std::lock_guard thread_lock{thread_events->mutex};
+    for (const Event &event : thread_events->events) {
+      const char *type_name = event_type_name(event.type);
+      json += ",\n{\"name\":";
+      append_json_string(json, event.label ? event.label : type_name);
+      /* Timestamps are in microseconds. */
+      json += fmt::format(R"(,"cat":"{}","pid":1,"tid":{},"ts":{:.3f})",
+                          type_name,
+                          thread_events->thread_index,
+                          double(event.start_ns) / 1000.0);
+      if (event.type == EventType::LazyThreadingHint) {
+        json += R"(,"ph":"i","s":"t")";
+      }
+      else {
+        json += fmt::format(R"(,"ph":"X","dur":{:.3f})",
+                            double(event.end_ns - event.start_ns) / 1000.0);
+      }
+      if (event.size >= 0) {
+        json += fmt::format(R"(,"args":{{"size":{}}})", event.size);
+      }
+      json += '}';
+    }
+  }
+  json += "\n]}\n";
+  return json;
+}
+
+bool write_trace_event_json(const StringRefNull filepath)
+{
+  fstream file(filepath.c_str(), std::ios::out | std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  file << to_trace_event_json();
+  return bool(file);
+}
+
+const char *current_label()
+{
+  return current_thread_label;
+}
+
+const char *detail::exchange_label(const char *label)
+{
+  const char *previous_label = current_thread_label;
+  current_thread_label = label;
+  return previous_label;
+}
+
+}  // namespace blender::threading::trace
@@ -708,6 +708,16 @@ TEST(array_store, TestData_Stride32_Chunk64_Mutate8)
   random_data_mutate_helper(0, 256, 200, 32, 64, 7117, 8);
 }
 
+/* Large enough to process the hashes with multiple tasks. */
+TEST(array_store, TestData_Stride12_Chunk256_Mutate8_Large)
+{
+  random_data_mutate_helper(100000, 100256, 6, 12, 256, 1221, 8);
+}
+TEST(array_store, TestData_Stride1_Chunk64_Mutate8_Large)
+{
+  random_data_mutate_helper(300000, 300256, 6, 1, 64, 2112, 8);
+}
+
 /* -------------------------------------------------------------------- */
 /* Randomized Chunks Test */
 
@@ -773,6 +783,7 @@ static void random_chunk_mutate_helper(const int chunks_per_buffer,
 
   size_t expected_size = chunks_per_buffer * chunk_count * stride;
   EXPECT_EQ(BLI_array_store_calc_size_compacted_get(bs), expected_size);
+  EXPECT_GT(BLI_array_store_calc_size_overhead_get(bs), 0);
 
   BLI_array_store_destroy(bs);
 
@@ -795,6 +806,10 @@ TEST(array_store, TestChunk_Rand31_Stride11_Chunk21)
 {
   random_chunk_mutate_helper(31, 100, 11, 21, 7117);
 }
+TEST(array_store, TestChunk_Rand2048_Stride4_Chunk64)
+{
+  random_chunk_mutate_helper(2048, 4, 4, 64, 4114);
+}
 
 /* -------------------------------------------------------------------- */
 /** \name RLE Encode/Decode Utilities
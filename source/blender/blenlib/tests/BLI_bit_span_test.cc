@@ -7,6 +7,7 @@
 #include "BLI_bit_span.hh"
 #include "BLI_bit_span_ops.hh"
 #include "BLI_bit_span_to_index_ranges.hh"
+#include "BLI_bit_span_to_indices.hh"
 #include "BLI_bit_vector.hh"
 #include "BLI_timeit.hh"
 #include "BLI_vector.hh"
@@ -410,4 +411,45 @@ TEST(bit_span, to_index_ranges_all_ones)
   EXPECT_EQ(builder[0], IndexRange(8765));
 }
 
+TEST(bit_span, to_indices)
+{
+  BitVector<> bits(10, false);
+  bits[2].set();
+  bits[4].set();
+  bits[5].set();
+  bits[9].set();
+
+  std::array<int16_t, 4> indices;
+  EXPECT_EQ(bits_to_indices(bits, indices), 4);
+  EXPECT_EQ(indices[0], 2);
+  EXPECT_EQ(indices[1], 4);
+  EXPECT_EQ(indices[2], 5);
+  EXPECT_EQ(indices[3], 9);
+
+  EXPECT_EQ(bits_to_indices(BitSpan(bits).slice(IndexRange(3, 5)), indices, 100), 2);
+  EXPECT_EQ(indices[0], 101);
+  EXPECT_EQ(indices[1], 102);
+}
+
+TEST(bit_span, to_indices_unaligned)
+{
+  BitVector<> bits(1000, false);
+  for (const int64_t i : bits.index_range()) {
+    bits[i].set(i % 3 == 0 || i % 7 == 0 || (i > 500 && i < 700));
+  }
+  for (const IndexRange slice : {IndexRange(0, 1000), IndexRange(5, 990), IndexRange(70, 3)}) {
+    const BitSpan span = BitSpan(bits).slice(slice);
+    Vector<int16_t> expected;
+    for (const int64_t i : span.index_range()) {
+      if (span[i]) {
+        expected.append(int16_t(i));
+      }
+    }
+    /* The exact size makes sure that nothing is written after the end. */
+    Vector<int16_t> indices(expected.size());
+    EXPECT_EQ(bits_to_indices(span, indices), expected.size());
+    EXPECT_EQ(indices.as_span(), expected.as_span());
+  }
+}
+
 }  // namespace blender::bits::tests
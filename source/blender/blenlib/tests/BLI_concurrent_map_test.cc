@@ -0,0 +1,169 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0 */
+
+#include <atomic>
+#include <string>
+
+#include "BLI_concurrent_map.hh"
+#include "BLI_task.hh"
+#include "BLI_vector.hh"
+
+#include "testing/testing.h"
+
+#include "BLI_strict_flags.h" /* IWYU pragma: keep. Keep last. */
+
+namespace blender::tests {
+
+TEST(concurrent_map, DefaultConstructor)
+{
+  ConcurrentMap<int, int> map;
+  EXPECT_EQ(map.size(), 0);
+  ConcurrentMap<int, int>::ConstAccessor accessor;
+  EXPECT_FALSE(map.lookup(accessor, 5));
+  EXPECT_TRUE(accessor.is_empty());
+}
+
+TEST(concurrent_map, AddLookup)
+{
+  ConcurrentMap<int, std::string> map;
+  {
+    ConcurrentMap<int, std::string>::MutableAccessor accessor;
+    EXPECT_TRUE(map.add(accessor, 3));
+    EXPECT_EQ(accessor->first, 3);
+    EXPECT_EQ(accessor->second, "");
+    accessor->second = "three";
+  }
+  {
+    ConcurrentMap<int, std::string>::MutableAccessor accessor;
+    EXPECT_FALSE(map.add(accessor, 3));
+    EXPECT_EQ(accessor->second, "three");
+  }
+  {
+    ConcurrentMap<int, std::string>::ConstAccessor accessor;
+    EXPECT_TRUE(map.lookup(accessor, 3));
+    EXPECT_EQ((*accessor).second, "three");
+    EXPECT_FALSE(map.lookup(accessor, 4));
+  }
+  EXPECT_EQ(map.size(), 1);
+}
+
+TEST(concurrent_map, Remove)
+{
+  ConcurrentMap<int, int> map;
+  for (int i = 0; i < 1000; i++) {
+    ConcurrentMap<int, int>::MutableAccessor accessor;
+    map.add(accessor, i);
+    accessor->second = i * 2;
+  }
+  EXPECT_EQ(map.size(), 1000);
+  for (int i = 0; i < 1000; i++) {
+    if (i % 3 == 0) {
+      EXPECT_TRUE(map.remove(i));
+    }
+  }
+  EXPECT_FALSE(map.remove(0));
+  EXPECT_FALSE(map.remove(2000));
+  EXPECT_EQ(map.size(), 666);
+  for (int i = 0; i < 1000; i++) {
+    ConcurrentMap<int, int>::ConstAccessor accessor;
+    if (i % 3 == 0) {
+      EXPECT_FALSE(map.lookup(accessor, i));
+    }
+    else {
+      EXPECT_TRUE(map.lookup(accessor, i));
+      EXPECT_EQ(accessor->second, i * 2);
+    }
+  }
+  /* Removed keys can be added again. */
+  ConcurrentMap<int, int>::MutableAccessor accessor;
+  EXPECT_TRUE(map.add(accessor, 3));
+  EXPECT_EQ(accessor->second, 0);
+}
+
+TEST(concurrent_map, AccessorOutlivesRemove)
+{
+  ConcurrentMap<int, std::string> map;
+  {
+    ConcurrentMap<int, std::string>::MutableAccessor accessor;
+    map.add(accessor, 1);
+    accessor->second = "value";
+  }
+  ConcurrentMap<int, std::string>::ConstAccessor accessor;
+  EXPECT_TRUE(map.lookup(accessor, 1));
+  std::atomic<bool> removed = false;
+  threading::parallel_invoke(
+      [&]() {
+        EXPECT_TRUE(map.remove(1));
+        removed = true;
+      },
+      [&]() {
+        /* The value stays valid until the accessor is released. */
+        EXPECT_EQ(accessor->second, "value");
+        accessor.release();
+      });
+  EXPECT_TRUE(removed);
+  EXPECT_FALSE(map.lookup(accessor, 1));
+}
+
+TEST(concurrent_map, AddMultiple)
+{
+  ConcurrentMap<int, int> map;
+  {
+    ConcurrentMap<int, int>::MutableAccessor accessor;
+    map.add(accessor, 5);
+    accessor->second = -1;
+  }
+  Vector<std::pair<int, int>> items;
+  for (int i = 0; i < 10000; i++) {
+    items.append({i, i + 1});
+  }
+  items.append({10, 0});
+  map.reserve(10000);
+  map.add_multiple(items);
+  EXPECT_EQ(map.size(), 10000);
+  for (int i = 0; i < 10000; i++) {
+    ConcurrentMap<int, int>::ConstAccessor accessor;
+    EXPECT_TRUE(map.lookup(accessor, i));
+    /* Existing keys and keys that come first keep their values. */
+    EXPECT_EQ(accessor->second, i == 5 ? -1 : i + 1);
+  }
+}
+
+TEST(concurrent_map, ParallelAddRemove)
+{
+  ConcurrentMap<int, int> map;
+  std::atomic<int> newly_added_num = 0;
+  threading::parallel_for(IndexRange(100000), 64, [&](const IndexRange range) {
+    for (const int64_t i : range) {
+      const int key = int(i % 5000);
+      ConcurrentMap<int, int>::MutableAccessor accessor;
+      if (map.add(accessor, key)) {
+        newly_added_num++;
+      }
+      accessor->second++;
+    }
+  });
+  EXPECT_EQ(newly_added_num, 5000);
+  EXPECT_EQ(map.size(), 5000);
+  for (int i = 0; i < 5000; i++) {
+    ConcurrentMap<int, int>::ConstAccessor accessor;
+    EXPECT_TRUE(map.lookup(accessor, i));
+    EXPECT_EQ(accessor->second, 20);
+  }
+
+  threading::parallel_for(IndexRange(5000), 64, [&](const IndexRange range) {
+    for (const int64_t i : range) {
+      if (i % 2 == 0) {
+        EXPECT_TRUE(map.remove(int(i)));
+      }
+      else {
+        ConcurrentMap<int, int>::ConstAccessor accessor;
+        EXPECT_TRUE(map.lookup(accessor, int(i)));
+      }
+    }
+  });
+  EXPECT_EQ(map.size(), 2500);
+}
+
+}  // namespace blender::tests
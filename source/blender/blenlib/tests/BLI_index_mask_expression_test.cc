@@ -240,6 +240,30 @@ TEST(index_mask_expression, SubtractSelf)
   EXPECT_TRUE(result.is_empty());
 }
 
+TEST(index_mask_expression, RangeAndIndices)
+{
+  IndexMaskMemory memory;
+  const IndexMask range = IndexRange(10, 20);
+  const IndexMask indices = IndexMask::from_initializers({1, 5, 12, 13, 20, 29, 30, 40}, memory);
+
+  ExprBuilder builder;
+  const IndexMask union_result = evaluate_expression(builder.merge({&range, &indices}), memory);
+  EXPECT_EQ(union_result, IndexMask::from_initializers({1, 5, IndexRange(10, 21), 40}, memory));
+  EXPECT_EQ(evaluate_expression(builder.merge({&indices, &range}), memory), union_result);
+
+  const IndexMask intersection_result = evaluate_expression(builder.intersect({&range, &indices}),
+                                                            memory);
+  EXPECT_EQ(intersection_result, IndexMask::from_initializers({12, 13, 20, 29}, memory));
+  EXPECT_EQ(evaluate_expression(builder.intersect({&indices, &range}), memory),
+            intersection_result);
+
+  EXPECT_EQ(evaluate_expression(builder.subtract(&range, {&indices}), memory),
+            IndexMask::from_initializers(
+                {IndexRange(10, 2), IndexRange(14, 6), IndexRange(21, 8)}, memory));
+  EXPECT_EQ(evaluate_expression(builder.subtract(&indices, {&range}), memory),
+            IndexMask::from_initializers({1, 5, 30, 40}, memory));
+}
+
 /* Disable benchmark by default. */
 #if 0
 TEST(index_mask_expression, Benchmark)
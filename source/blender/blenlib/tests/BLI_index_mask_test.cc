@@ -235,6 +235,34 @@ TEST(index_mask, FromBitsBenchmark)
   }
 }
 
+TEST(index_mask, SetOperationsBenchmark)
+{
+  IndexMaskMemory memory;
+  /* Masks that consist of many short ranges and a few scattered indices. */
+  const IndexMask ranges = IndexMask::from_predicate(
+      IndexRange(10'000'000), GrainSize(4096), memory, [](const int64_t i) {
+        return (i / 20) % 3 != 0;
+      });
+  const IndexMask indices = IndexMask::from_every_nth(7, 1'000'000, 0, memory);
+  for ([[maybe_unused]] const int64_t i : IndexRange(5)) {
+    {
+      SCOPED_TIMER("union");
+      IndexMaskMemory result_memory;
+      IndexMask::from_union(ranges, indices, result_memory);
+    }
+    {
+      SCOPED_TIMER("intersection");
+      IndexMaskMemory result_memory;
+      IndexMask::from_intersection(ranges, indices, result_memory);
+    }
+    {
+      SCOPED_TIMER("difference");
+      IndexMaskMemory result_memory;
+      IndexMask::from_difference(ranges, indices, result_memory);
+    }
+  }
+}
+
 /* Benchmark. */
 #endif
 
@@ -287,6 +315,42 @@ TEST(index_mask, FromBitsFuzzy)
   }
 }
 
+TEST(index_mask, FromBitsMixedDensity)
+{
+  const int size = 100'000;
+  RandomNumberGenerator rng(0);
+  BitVector<> bits(size, false);
+  Array<bool> bools(size);
+  for (int i = 0; i < size; i++) {
+    if (i < 20'000) {
+      /* Many short ranges. */
+      bools[i] = i % 3 != 0;
+    }
+    else if (i < 40'000) {
+      bools[i] = rng.get_float() < 0.05f;
+    }
+    else if (i < 60'000) {
+      /* Long ranges. */
+      bools[i] = (i / 100) % 2 == 0;
+    }
+    else {
+      bools[i] = rng.get_float() < 0.7f;
+    }
+    bits[i].set(bools[i]);
+  }
+
+  IndexMaskMemory memory;
+  for (const IndexRange slice : {IndexRange(size), IndexRange::from_begin_end(3, size - 10)}) {
+    const BitSpan bits_slice = BitSpan(bits).slice(slice);
+    const IndexMask expected = IndexMask::from_predicate(
+        IndexRange(slice.size()), GrainSize(1024), memory, [&](const int64_t i) {
+          return bits_slice[i].test();
+        });
+    EXPECT_EQ(IndexMask::from_bits(bits_slice, memory), expected);
+    EXPECT_EQ(IndexMask::from_bools(bools.as_span().slice(slice), memory), expected);
+  }
+}
+
 TEST(index_mask, FromBitsDense)
 {
   BitVector bit_vec(1'000, true);
@@ -8,9 +8,12 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "BLI_array.hh"
 #include "BLI_compiler_attrs.h"
+#include "BLI_index_mask.hh"
 #include "BLI_kdopbvh.hh"
 #include "BLI_math_vector.h"
+#include "BLI_math_vector.hh"
 #include "BLI_rand.h"
 
 /* -------------------------------------------------------------------- */
@@ -134,3 +137,254 @@ TEST(kdopbvh, OptimalFindNearest_500)
 {
   find_nearest_points_test(500, 1.0, 1000, 12, true);
 }
+
+static void random_box(RNG *rng, float r_co[2][3])
+{
+  rng_v3_round(r_co[0], 3, rng, 1000, 10.0f);
+  madd_v3_v3v3fl(r_co[1], r_co[0], blender::float3(1.0f, 0.5f, 0.25f), BLI_rng_get_float(rng));
+}
+
+/** A tree of \a boxes_len small random boxes, each leaf is the bounding box of two points. */
+static BVHTree *random_boxes_tree_new(int boxes_len,
+                                      int random_seed,
+                                      char tree_type = 8,
+                                      int balance_flag = 0)
+{
+  RNG *rng = BLI_rng_new(random_seed);
+  BVHTree *tree = BLI_bvhtree_new(boxes_len, 0.0, tree_type, 8);
+  for (int i = 0; i < boxes_len; i++) {
+    float co[2][3];
+    random_box(rng, co);
+    BLI_bvhtree_insert(tree, i, co[0], 2);
+  }
+  BLI_bvhtree_balance_ex(tree, balance_flag);
+  BLI_rng_free(rng);
+  return tree;
+}
+
+static void ray_cast_batch_test(float radius)
+{
+  using namespace blender;
+  BVHTree *tree = random_boxes_tree_new(2000, 42);
+  RNG *rng = BLI_rng_new(7);
+
+  const int rays_num = 1001;
+  Array<float3> origins(rays_num);
+  Array<float3> directions(rays_num);
+  Array<BVHTreeRayHit> hits(rays_num);
+  for (const int i : IndexRange(rays_num)) {
+    /* Rays on a grid pointing in roughly the same direction, like rays cast from a surface. */
+    origins[i] = float3(float(i % 32) - 16.0f, float(i / 32) - 16.0f, -20.0f);
+    rng_v3_round(directions[i], 3, rng, 1000, 0.3f);
+    directions[i] = math::normalize(float3(0.0f, 0.0f, 1.0f) + directions[i]);
+    hits[i].index = -1;
+    hits[i].dist = BVH_RAYCAST_DIST_MAX;
+  }
+
+  IndexMaskMemory memory;
+  const IndexMask mask = IndexMask::from_predicate(
+      IndexRange(rays_num), GrainSize(512), memory, [](const int i) { return i % 7 != 3; });
+  BLI_bvhtree_ray_cast_batch(*tree, mask, origins, directions, radius, hits, nullptr, nullptr);
+
+  for (const int i : IndexRange(rays_num)) {
+    BVHTreeRayHit hit;
+    hit.index = -1;
+    hit.dist = BVH_RAYCAST_DIST_MAX;
+    if (mask.contains(i)) {
+      BLI_bvhtree_ray_cast(tree, origins[i], directions[i], radius, &hit, nullptr, nullptr);
+      EXPECT_NEAR(hits[i].dist, hit.dist, 1e-4f);
+    }
+    else {
+      EXPECT_EQ(hits[i].dist, BVH_RAYCAST_DIST_MAX);
+    }
+    EXPECT_EQ(hits[i].index, hit.index);
+  }
+
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+}
+
+TEST(kdopbvh, RayCastBatch)
+{
+  ray_cast_batch_test(0.0f);
+}
+TEST(kdopbvh, RayCastBatchRadius)
+{
+  ray_cast_batch_test(0.2f);
+}
+
+TEST(kdopbvh, FindNearestBatch)
+{
+  using namespace blender;
+  BVHTree *tree = random_boxes_tree_new(2000, 12);
+  RNG *rng = BLI_rng_new(3);
+
+  const int points_num = 999;
+  Array<float3> positions(points_num);
+  Array<BVHTreeNearest> nearest(points_num);
+  for (const int i : IndexRange(points_num)) {
+    rng_v3_round(positions[i], 3, rng, 1000, 12.0f);
+    nearest[i].index = -1;
+    nearest[i].dist_sq = FLT_MAX;
+  }
+
+  BLI_bvhtree_find_nearest_batch(
+      *tree, IndexRange(points_num), positions, nearest, nullptr, nullptr);
+
+  for (const int i : IndexRange(points_num)) {
+    BVHTreeNearest expected;
+    expected.index = -1;
+    expected.dist_sq = FLT_MAX;
+    BLI_bvhtree_find_nearest(tree, positions[i], &expected, nullptr, nullptr);
+    EXPECT_NEAR(nearest[i].dist_sq, expected.dist_sq, 1e-5f);
+    EXPECT_V3_NEAR(nearest[i].co, expected.co, 1e-5f);
+  }
+
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+}
+
+/** Compare ray casts and nearest queries on two trees that contain the same leafs. */
+static void expect_trees_query_equal(const BVHTree *tree_a, const BVHTree *tree_b)
+{
+  RNG *rng = BLI_rng_new(5);
+  for (int i = 0; i < 500; i++) {
+    float co[3], dir[3];
+    rng_v3_round(co, 3, rng, 1000, 15.0f);
+    rng_v3_round(dir, 3, rng, 1000, 1.0f);
+    if (normalize_v3(dir) == 0.0f) {
+      continue;
+    }
+
+    BVHTreeRayHit hit_a, hit_b;
+    hit_a.index = hit_b.index = -1;
+    hit_a.dist = hit_b.dist = BVH_RAYCAST_DIST_MAX;
+    BLI_bvhtree_ray_cast(tree_a, co, dir, 0.0f, &hit_a, nullptr, nullptr);
+    BLI_bvhtree_ray_cast(tree_b, co, dir, 0.0f, &hit_b, nullptr, nullptr);
+    EXPECT_EQ(hit_a.index == -1, hit_b.index == -1);
+    if (hit_a.index != -1 && hit_b.index != -1) {
+      EXPECT_NEAR(hit_a.dist, hit_b.dist, 1e-4f);
+    }
+
+    BVHTreeNearest nearest_a, nearest_b;
+    nearest_a.index = nearest_b.index = -1;
+    nearest_a.dist_sq = nearest_b.dist_sq = FLT_MAX;
+    BLI_bvhtree_find_nearest(tree_a, co, &nearest_a, nullptr, nullptr);
+    BLI_bvhtree_find_nearest(tree_b, co, &nearest_b, nullptr, nullptr);
+    EXPECT_NEAR(nearest_a.dist_sq, nearest_b.dist_sq, 1e-4f);
+  }
+  BLI_rng_free(rng);
+}
+
+static void balance_sah_test(int boxes_len, char tree_type)
+{
+  BVHTree *tree_median = random_boxes_tree_new(boxes_len, 21, tree_type);
+  BVHTree *tree_sah = random_boxes_tree_new(boxes_len, 21, tree_type, BVH_BALANCE_SAH);
+  EXPECT_EQ(BLI_bvhtree_get_len(tree_sah), boxes_len);
+  expect_trees_query_equal(tree_median, tree_sah);
+
+  /* Move all leafs and refit, the result should match a tree that is built from scratch. */
+  RNG *rng = BLI_rng_new(22);
+  BVHTree *tree_moved = BLI_bvhtree_new(boxes_len, 0.0, tree_type, 8);
+  for (int i = 0; i < boxes_len; i++) {
+    float co[2][3];
+    random_box(rng, co);
+    BLI_bvhtree_insert(tree_moved, i, co[0], 2);
+    BLI_bvhtree_update_node(tree_median, i, co[0], nullptr, 2);
+    BLI_bvhtree_update_node(tree_sah, i, co[0], nullptr, 2);
+  }
+  BLI_bvhtree_balance(tree_moved);
+  BLI_bvhtree_update_tree(tree_median);
+  BLI_bvhtree_update_tree(tree_sah);
+  expect_trees_query_equal(tree_moved, tree_median);
+  expect_trees_query_equal(tree_moved, tree_sah);
+
+  BLI_bvhtree_free(tree_median);
+  BLI_bvhtree_free(tree_sah);
+  BLI_bvhtree_free(tree_moved);
+  BLI_rng_free(rng);
+}
+
+TEST(kdopbvh, BalanceSAH_2)
+{
+  balance_sah_test(2, 2);
+}
+TEST(kdopbvh, BalanceSAH_Binary)
+{
+  balance_sah_test(20000, 2);
+}
+TEST(kdopbvh, BalanceSAH_Octree)
+{
+  balance_sah_test(20000, 8);
+}
+
+static BVHTree *boxes_tree_new(const blender::Span<blender::float3> points, char tree_type)
+{
+  const int boxes_len = int(points.size() / 2);
+  BVHTree *tree = BLI_bvhtree_new(boxes_len, 0.0, tree_type, 6);
+  for (int i = 0; i < boxes_len; i++) {
+    BLI_bvhtree_insert(tree, i, points[i * 2], 2);
+  }
+  BLI_bvhtree_balance(tree);
+  return tree;
+}
+
+TEST(kdopbvh, CopyRefit)
+{
+  using namespace blender;
+  const int boxes_len = 5000;
+  RNG *rng = BLI_rng_new(31);
+  Array<float3> points(boxes_len * 2);
+  for (int i = 0; i < boxes_len; i++) {
+    random_box(rng, reinterpret_cast<float(*)[3]>(&points[i * 2]));
+  }
+  BVHTree *tree = boxes_tree_new(points, 2);
+  const float built_cost = BLI_bvhtree_surface_area_cost(*tree);
+  EXPECT_GT(built_cost, 0.0f);
+
+  /* Scaling and moving everything uniformly doesn't change the relative cost of the tree. */
+  Array<float3> scaled_points(points.size());
+  for (const int i : points.index_range()) {
+    scaled_points[i] = points[i] * 3.0f + float3(5.0f, -2.0f, 1.0f);
+  }
+  const auto get_scaled_points = [&](const int index, float3 *r_points) {
+    r_points[0] = scaled_points[index * 2];
+    r_points[1] = scaled_points[index * 2 + 1];
+    return 2;
+  };
+  BVHTree *tree_scaled = BLI_bvhtree_copy(*tree);
+  BLI_bvhtree_refit(*tree_scaled, get_scaled_points);
+  EXPECT_NEAR(BLI_bvhtree_surface_area_cost(*tree_scaled), built_cost, built_cost * 1e-3f);
+  BVHTree *tree_scaled_expected = boxes_tree_new(scaled_points, 2);
+  expect_trees_query_equal(tree_scaled_expected, tree_scaled);
+
+  /* Moving the boxes randomly makes the refit tree much worse than a new tree. */
+  Array<float3> moved_points(points.size());
+  for (int i = 0; i < boxes_len; i++) {
+    random_box(rng, reinterpret_cast<float(*)[3]>(&moved_points[i * 2]));
+  }
+  const auto get_moved_points = [&](const int index, float3 *r_points) {
+    r_points[0] = moved_points[index * 2];
+    r_points[1] = moved_points[index * 2 + 1];
+    return 2;
+  };
+  BVHTree *tree_moved = BLI_bvhtree_copy(*tree);
+  BLI_bvhtree_refit(*tree_moved, get_moved_points);
+  BVHTree *tree_moved_expected = boxes_tree_new(moved_points, 2);
+  expect_trees_query_equal(tree_moved_expected, tree_moved);
+  EXPECT_GT(BLI_bvhtree_surface_area_cost(*tree_moved),
+            BLI_bvhtree_surface_area_cost(*tree_moved_expected) * 2.0f);
+
+  /* The original tree is not affected by refitting its copies. */
+  BVHTree *tree_expected = boxes_tree_new(points, 2);
+  expect_trees_query_equal(tree_expected, tree);
+  EXPECT_EQ(BLI_bvhtree_surface_area_cost(*tree), built_cost);
+
+  BLI_bvhtree_free(tree);
+  BLI_bvhtree_free(tree_scaled);
+  BLI_bvhtree_free(tree_scaled_expected);
+  BLI_bvhtree_free(tree_moved);
+  BLI_bvhtree_free(tree_moved_expected);
+  BLI_bvhtree_free(tree_expected);
+  BLI_rng_free(rng);
+}
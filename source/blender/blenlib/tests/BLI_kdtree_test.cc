@@ -4,7 +4,12 @@
 
 #include "testing/testing.h"
 
+#include "MEM_guardedalloc.h"
+
+#include "BLI_array.hh"
 #include "BLI_kdtree.h"
+#include "BLI_math_vector_types.hh"
+#include "BLI_rand.hh"
 
 #include <cmath>
 
@@ -63,3 +68,93 @@ TEST(kdtree, Deduplicate)
 {
   deduplicate_test();
 }
+
+/** A balanced tree with enough points to be balanced on multiple threads. */
+static KDTree_3d *random_points_tree_new(const blender::Span<blender::float3> points)
+{
+  KDTree_3d *tree = BLI_kdtree_3d_new(uint(points.size()));
+  for (const int i : points.index_range()) {
+    BLI_kdtree_3d_insert(tree, i, points[i]);
+  }
+  BLI_kdtree_3d_balance(tree);
+  return tree;
+}
+
+static blender::Array<blender::float3> random_points(const int points_num, const int seed)
+{
+  blender::RandomNumberGenerator rng(seed);
+  blender::Array<blender::float3> points(points_num);
+  for (blender::float3 &point : points) {
+    point = rng.get_unit_float3() * rng.get_float();
+  }
+  return points;
+}
+
+TEST(kdtree, FindNearestBatch)
+{
+  using namespace blender;
+  const Array<float3> points = random_points(50000, 1);
+  const Array<float3> search = random_points(1000, 2);
+  KDTree_3d *tree = random_points_tree_new(points);
+
+  Array<KDTreeNearest_3d> nearest(search.size());
+  BLI_kdtree_3d_find_nearest_batch(
+      tree, reinterpret_cast<const float(*)[3]>(search.data()), search.size(), nearest.data());
+  for (const int i : search.index_range()) {
+    KDTreeNearest_3d expected;
+    EXPECT_EQ(BLI_kdtree_3d_find_nearest(tree, search[i], &expected), nearest[i].index);
+    EXPECT_EQ(expected.dist, nearest[i].dist);
+  }
+
+  const int n = 5;
+  Array<KDTreeNearest_3d> nearest_n(search.size() * n);
+  Array<int> nearest_n_len(search.size());
+  BLI_kdtree_3d_find_nearest_n_batch(tree,
+                                     reinterpret_cast<const float(*)[3]>(search.data()),
+                                     search.size(),
+                                     nearest_n.data(),
+                                     n,
+                                     nearest_n_len.data());
+  for (const int i : search.index_range()) {
+    KDTreeNearest_3d expected[n];
+    ASSERT_EQ(BLI_kdtree_3d_find_nearest_n(tree, search[i], expected, n), nearest_n_len[i]);
+    for (const int j : IndexRange(nearest_n_len[i])) {
+      EXPECT_EQ(expected[j].index, nearest_n[i * n + j].index);
+    }
+  }
+
+  BLI_kdtree_3d_free(tree);
+}
+
+TEST(kdtree, RangeSearchBatch)
+{
+  using namespace blender;
+  const Array<float3> points = random_points(50000, 3);
+  const Array<float3> search = random_points(1000, 4);
+  KDTree_3d *tree = random_points_tree_new(points);
+
+  Array<int> offsets(search.size() + 1);
+  KDTreeNearest_3d *nearest;
+  const int nearest_len = BLI_kdtree_3d_range_search_batch(tree,
+                                                           reinterpret_cast<const float(*)[3]>(
+                                                               search.data()),
+                                                           search.size(),
+                                                           0.05f,
+                                                           offsets.data(),
+                                                           &nearest);
+  EXPECT_EQ(offsets.last(), nearest_len);
+  for (const int i : search.index_range()) {
+    KDTreeNearest_3d *expected;
+    const int expected_len = BLI_kdtree_3d_range_search(tree, search[i], &expected, 0.05f);
+    ASSERT_EQ(offsets[i + 1] - offsets[i], expected_len);
+    for (const int j : IndexRange(expected_len)) {
+      EXPECT_EQ(expected[j].dist, nearest[offsets[i] + j].dist);
+    }
+    if (expected) {
+      MEM_freeN(expected);
+    }
+  }
+
+  MEM_SAFE_FREE(nearest);
+  BLI_kdtree_3d_free(tree);
+}
@@ -777,6 +777,71 @@ TEST(map, AddCbMove)
   EXPECT_EQ(value, "");
 }
 
+TEST(map, GroupProbing)
+{
+  /* Mix additions and removals, so that the groups also contain removed slots. */
+  Map<int, int, 4, GroupProbingStrategy> map;
+  std::unordered_map<int, int> reference;
+  for (int i = 0; i < 20000; i++) {
+    const int key = (i * 7919) % 3000;
+    if (i % 3 == 0) {
+      const std::optional<int> value = map.pop_try(key);
+      EXPECT_EQ(value.has_value(), reference.erase(key) == 1);
+    }
+    else if (i % 3 == 1) {
+      EXPECT_EQ(map.add(key, i), reference.insert({key, i}).second);
+    }
+    else {
+      map.add_overwrite(key, i);
+      reference[key] = i;
+    }
+  }
+  EXPECT_EQ(map.size(), int64_t(reference.size()));
+  for (int key = 0; key < 3000; key++) {
+    const auto it = reference.find(key);
+    EXPECT_EQ(map.lookup_ptr(key) == nullptr, it == reference.end());
+    if (it != reference.end()) {
+      EXPECT_EQ(map.lookup(key), it->second);
+    }
+  }
+
+  map.remove_if([](const auto item) { return item.key % 2 == 0; });
+  for (int key = 0; key < 3000; key++) {
+    EXPECT_EQ(map.contains(key), key % 2 == 1 && reference.count(key) == 1);
+  }
+  const Map<int, int, 4, GroupProbingStrategy> copied_map = map;
+  EXPECT_EQ(copied_map, map);
+  Map<int, int, 4, GroupProbingStrategy> moved_map = std::move(map);
+  EXPECT_EQ(copied_map, moved_map);
+  EXPECT_TRUE(map.is_empty()); /* NOLINT: bugprone-use-after-move */
+  EXPECT_EQ(map.lookup_or_add(1, 5), 5);
+}
+
+TEST(map, GroupProbingCollisions)
+{
+  /* All keys have the same hash, so all groups are filled up. */
+  struct ConstantHash {
+    uint64_t operator()(const int /*value*/) const
+    {
+      return 42;
+    }
+  };
+  Map<int, std::string, 0, GroupProbingStrategy, ConstantHash> map;
+  for (int i = 0; i < 100; i++) {
+    map.add_new(i, std::to_string(i));
+  }
+  for (int i = 0; i < 100; i += 3) {
+    map.remove_contained(i);
+  }
+  for (int i = 0; i < 110; i++) {
+    EXPECT_EQ(map.contains(i), i < 100 && i % 3 != 0);
+  }
+  EXPECT_EQ(map.lookup_or_add_cb(1, []() { return "x"; }), "1");
+  EXPECT_EQ(map.lookup_or_add_cb(3, []() { return "x"; }), "x");
+  EXPECT_EQ(map.pop(3), "x");
+  EXPECT_FALSE(map.contains(3));
+}
+
 /**
  * Set this to 1 to activate the benchmark. It is disabled by default, because it prints a lot.
  */
@@ -412,6 +412,76 @@ TEST(set, IntrusiveIntKey)
   EXPECT_TRUE(set.remove(4));
 }
 
+TEST(set, GroupProbing)
+{
+  /* Mix additions and removals, so that the groups also contain removed slots. */
+  Set<int, 4, GroupProbingStrategy> set;
+  std::unordered_set<int> reference;
+  for (int i = 0; i < 20000; i++) {
+    const int key = (i * 7919) % 3000;
+    if (i % 3 == 0) {
+      EXPECT_EQ(set.remove(key), reference.erase(key) == 1);
+    }
+    else {
+      EXPECT_EQ(set.add(key), reference.insert(key).second);
+    }
+  }
+  EXPECT_EQ(set.size(), int64_t(reference.size()));
+  for (int key = 0; key < 3000; key++) {
+    EXPECT_EQ(set.contains(key), reference.count(key) == 1);
+  }
+  set.rehash();
+  for (const int key : reference) {
+    EXPECT_TRUE(set.contains(key));
+  }
+  set.clear_and_keep_capacity();
+  EXPECT_TRUE(set.is_empty());
+  for (const int key : reference) {
+    EXPECT_FALSE(set.contains(key));
+  }
+}
+
+TEST(set, GroupProbingCollisions)
+{
+  /* Only ten different hashes, so many keys have the same tag and have to be placed in other
+   * groups once a group is full. */
+  Set<uint, 2, GroupProbingStrategy, HashIntModN<10>> set;
+  for (uint i = 0; i < 200; i++) {
+    EXPECT_TRUE(set.add(i));
+    EXPECT_FALSE(set.add(i));
+  }
+  EXPECT_EQ(set.size(), 200);
+  for (uint i = 0; i < 200; i += 2) {
+    set.remove_contained(i);
+  }
+  for (uint i = 0; i < 250; i++) {
+    EXPECT_EQ(set.contains(i), i < 200 && i % 2 == 1);
+  }
+
+  Set<uint, 2, GroupProbingStrategy, HashIntModN<10>> moved_set = std::move(set);
+  EXPECT_EQ(moved_set.size(), 100);
+  EXPECT_TRUE(moved_set.contains(199));
+  EXPECT_FALSE(set.contains(199)); /* NOLINT: bugprone-use-after-move */
+  EXPECT_TRUE(set.add(199));
+  Set<uint, 2, GroupProbingStrategy, HashIntModN<10>> copied_set = moved_set;
+  EXPECT_EQ(copied_set, moved_set);
+}
+
+TEST(set, GroupProbingSmall)
+{
+  /* Tables that have fewer slots than a group. */
+  Set<std::string, 2, GroupProbingStrategy> set;
+  EXPECT_FALSE(set.contains("a"));
+  set.add("a");
+  set.add("b");
+  EXPECT_TRUE(set.contains("a"));
+  EXPECT_TRUE(set.contains("b"));
+  EXPECT_FALSE(set.contains("c"));
+  EXPECT_TRUE(set.remove("a"));
+  EXPECT_FALSE(set.contains("a"));
+  EXPECT_EQ(set.size(), 1);
+}
+
 struct MyKeyType {
   uint32_t key;
   int32_t attached_data;
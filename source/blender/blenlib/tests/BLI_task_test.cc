@@ -14,6 +14,7 @@
 #include "BLI_mempool.h"
 #include "BLI_task.h"
 #include "BLI_task.hh"
+#include "BLI_task_trace.hh"
 
 #define ITEMS_NUM 10000
 
@@ -243,3 +244,57 @@ TEST(task, ParallelInvoke)
                                       [&]() { counter++; });
   EXPECT_EQ(counter, 6);
 }
+
+TEST(task, Trace)
+{
+  using namespace blender;
+  using namespace blender::threading;
+
+  EXPECT_FALSE(trace::is_enabled());
+  trace::start();
+  {
+    const trace::ScopedLabel label{"Outer \"label\""};
+    EXPECT_STREQ(trace::current_label(), "Outer \"label\"");
+    std::atomic<int> counter = 0;
+    parallel_for(IndexRange(1000), 10, [&](const IndexRange range) {
+      /* The label is passed on to the threads that process the range. */
+      EXPECT_STREQ(trace::current_label(), "Outer \"label\"");
+      counter += int(range.size());
+    });
+    EXPECT_EQ(counter, 1000);
+
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.min_iter_per_thread = 10;
+    BLI_task_parallel_range(
+        0,
+        1000,
+        nullptr,
+        [](void *__restrict /*userdata*/, const int /*i*/, const TaskParallelTLS *__restrict) {
+          EXPECT_STREQ(trace::current_label(), "Outer \"label\"");
+        },
+        &settings);
+
+    TaskPool *pool = BLI_task_pool_create_no_threads(nullptr);
+    BLI_task_pool_push(
+        pool, [](TaskPool * /*pool*/, void * /*taskdata*/) {}, nullptr, false, nullptr);
+    BLI_task_pool_work_and_wait(pool);
+    BLI_task_pool_free(pool);
+  }
+  EXPECT_EQ(trace::current_label(), nullptr);
+  trace::stop();
+
+  const int64_t events_num = trace::events_num();
+  /* At least the region, one sub-range and the pool task. */
+  EXPECT_GE(events_num, 3);
+
+  /* Nothing is recorded while tracing is disabled. */
+  parallel_for(IndexRange(1000), 10, [&](const IndexRange /*range*/) {});
+  EXPECT_EQ(trace::events_num(), events_num);
+
+  const std::string json = trace::to_trace_event_json();
+  EXPECT_NE(json.find(R"("name":"Outer \"label\"","cat":"parallel_region")"), std::string::npos);
+  EXPECT_NE(json.find(R"("cat":"parallel_range")"), std::string::npos);
+  EXPECT_NE(json.find(R"("cat":"pool_task")"), std::string::npos);
+  EXPECT_NE(json.find(R"("args":{"size":1000})"), std::string::npos);
+}
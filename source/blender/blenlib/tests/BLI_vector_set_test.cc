@@ -481,4 +481,36 @@ TEST(vector_set, LookupDefault)
   EXPECT_EQ(set.lookup_key_default(KeyWithData{2, "t"}, {1, "default"}), set[2]);
 }
 
+TEST(vector_set, GroupProbing)
+{
+  VectorSet<int, 4, GroupProbingStrategy> set;
+  for (int i = 0; i < 1000; i++) {
+    EXPECT_EQ(set.index_of_or_add(i * 3), i);
+  }
+  /* Removing keys moves the last key to the removed index. */
+  for (int i = 0; i < 1000; i += 2) {
+    set.remove_contained(i * 3);
+  }
+  EXPECT_EQ(set.size(), 500);
+  for (int i = 0; i < 3000; i++) {
+    EXPECT_EQ(set.contains(i), i % 6 == 3);
+  }
+  for (const int64_t index : set.index_range()) {
+    EXPECT_EQ(set.index_of(set[index]), index);
+  }
+  while (set.size() > 250) {
+    const int key = set.pop();
+    EXPECT_FALSE(set.contains(key));
+    EXPECT_EQ(set.index_of_try(key), -1);
+  }
+
+  VectorSet<int, 16, GroupProbingStrategy> moved_set = std::move(set);
+  EXPECT_EQ(moved_set.size(), 250);
+  for (const int64_t index : moved_set.index_range()) {
+    EXPECT_EQ(moved_set.index_of(moved_set[index]), index);
+  }
+  EXPECT_TRUE(set.add(3)); /* NOLINT: bugprone-use-after-move */
+  EXPECT_TRUE(set.contains(3));
+}
+
 }  // namespace blender::tests
@@ -0,0 +1,149 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0 */
+
+#include "testing/testing.h"
+
+#include <iostream>
+
+#include "BLI_concurrent_map.hh"
+#include "BLI_map.hh"
+#include "BLI_mutex.hh"
+#include "BLI_task.hh"
+#include "BLI_timeit.hh"
+
+namespace blender::tests {
+
+/**
+ * Compares #ConcurrentMap with a #Map that is protected by a single mutex under different amounts
+ * of contention. All threads work on the same keys, so fewer keys means more contention.
+ */
+
+static constexpr int64_t OPERATIONS_NUM = 4000000;
+
+/** A simple baseline, the same approach as the old fallback of #ConcurrentMap. */
+class MutexMap {
+ private:
+  Mutex mutex_;
+  Map<int, int> map_;
+
+ public:
+  bool lookup(const int key, int &r_value)
+  {
+    std::lock_guard lock{mutex_};
+    if (const int *value = map_.lookup_ptr(key)) {
+      r_value = *value;
+      return true;
+    }
+    return false;
+  }
+
+  void add_or_modify(const int key)
+  {
+    std::lock_guard lock{mutex_};
+    map_.lookup_or_add(key, 0)++;
+  }
+};
+
+/**
+ * Every key is accessed once per \a keys_num operations. In 1 of \a write_ratio of these rounds
+ * all keys are added or modified, otherwise they are looked up.
+ */
+static void benchmark_concurrent_map(const int keys_num, const int write_ratio)
+{
+  ConcurrentMap<int, int> map;
+  std::atomic<int64_t> found_num = 0;
+  SCOPED_TIMER("ConcurrentMap, " + std::to_string(keys_num) + " keys, write 1/" +
+               std::to_string(write_ratio));
+  threading::parallel_for(IndexRange(OPERATIONS_NUM), 4096, [&](const IndexRange range) {
+    int64_t local_found_num = 0;
+    for (const int64_t i : range) {
+      const int key = int((i * 7919) % keys_num);
+      if ((i / keys_num) % write_ratio == 0) {
+        ConcurrentMap<int, int>::MutableAccessor accessor;
+        map.add(accessor, key);
+        accessor->second++;
+      }
+      else {
+        ConcurrentMap<int, int>::ConstAccessor accessor;
+        local_found_num += map.lookup(accessor, key);
+      }
+    }
+    found_num += local_found_num;
+  });
+  EXPECT_GT(found_num, 0);
+}
+
+static void benchmark_mutex_map(const int keys_num, const int write_ratio)
+{
+  MutexMap map;
+  std::atomic<int64_t> found_num = 0;
+  SCOPED_TIMER("Map with mutex, " + std::to_string(keys_num) + " keys, write 1/" +
+               std::to_string(write_ratio));
+  threading::parallel_for(IndexRange(OPERATIONS_NUM), 4096, [&](const IndexRange range) {
+    int64_t local_found_num = 0;
+    for (const int64_t i : range) {
+      const int key = int((i * 7919) % keys_num);
+      if ((i / keys_num) % write_ratio == 0) {
+        map.add_or_modify(key);
+      }
+      else {
+        int value;
+        local_found_num += map.lookup(key, value);
+      }
+    }
+    found_num += local_found_num;
+  });
+  EXPECT_GT(found_num, 0);
+}
+
+static void benchmark_all(const int write_ratio)
+{
+  for (const int keys_num : {16, 1024, 1000000}) {
+    benchmark_concurrent_map(keys_num, write_ratio);
+    benchmark_mutex_map(keys_num, write_ratio);
+  }
+}
+
+TEST(concurrent_map_performance, ReadMostly)
+{
+  benchmark_all(100);
+}
+
+TEST(concurrent_map_performance, ReadWrite)
+{
+  benchmark_all(2);
+}
+
+TEST(concurrent_map_performance, BulkConstruction)
+{
+  Vector<std::pair<int, int>> items;
+  for (const int i : IndexRange(4000000)) {
+    items.append({i * 31, i});
+  }
+  {
+    ConcurrentMap<int, int> map;
+    SCOPED_TIMER("ConcurrentMap add one by one");
+    threading::parallel_for(items.index_range(), 4096, [&](const IndexRange range) {
+      for (const int64_t i : range) {
+        ConcurrentMap<int, int>::MutableAccessor accessor;
+        map.add(accessor, items[i].first);
+        accessor->second = items[i].second;
+      }
+    });
+  }
+  {
+    ConcurrentMap<int, int> map;
+    SCOPED_TIMER("ConcurrentMap add_multiple");
+    map.add_multiple(items);
+  }
+  {
+    Map<int, int> map;
+    SCOPED_TIMER("Map add_new");
+    for (const std::pair<int, int> &item : items) {
+      map.add_new(item.first, item.second);
+    }
+  }
+}
+
+}  // namespace blender::tests
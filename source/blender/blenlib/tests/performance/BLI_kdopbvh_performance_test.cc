@@ -0,0 +1,143 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_array.hh"
+#include "BLI_kdopbvh.hh"
+#include "BLI_math_geom.h"
+#include "BLI_math_vector.hh"
+#include "BLI_rand.hh"
+#include "BLI_timeit.hh"
+
+using namespace blender;
+
+/**
+ * Triangles of two unevenly sized spheres: a large sparse one and a small dense one, like a
+ * detailed model placed in a simple environment. The surface area heuristic is meant for this
+ * kind of distribution, with evenly distributed elements it behaves like the median split.
+ */
+static Array<float3> random_triangles(const int tris_num)
+{
+  RandomNumberGenerator rng(42);
+  Array<float3> positions(tris_num * 3);
+  for (const int tri : IndexRange(tris_num)) {
+    const bool is_dense = tri % 2 == 0;
+    const float3 center = is_dense ? float3(30.0f, 0.0f, 0.0f) : float3(0.0f);
+    const float radius = is_dense ? 0.5f : 100.0f;
+    const float size = is_dense ? 0.002f : 0.5f;
+    const float3 point = center + rng.get_unit_float3() * radius;
+    for (const int i : IndexRange(3)) {
+      positions[tri * 3 + i] = point + rng.get_unit_float3() * size;
+    }
+  }
+  return positions;
+}
+
+static BVHTree *triangles_tree_new(const Span<float3> positions, const int tree_type)
+{
+  BVHTree *tree = BLI_bvhtree_new(int(positions.size() / 3), 0.0f, char(tree_type), 6);
+  for (const int tri : IndexRange(positions.size() / 3)) {
+    BLI_bvhtree_insert(tree, tri, positions[tri * 3], 3);
+  }
+  return tree;
+}
+
+struct RayCastStats {
+  Span<float3> positions;
+  int64_t tris_tested = 0;
+};
+
+static void ray_cast_triangle_cb(void *userdata,
+                                 const int index,
+                                 const BVHTreeRay *ray,
+                                 BVHTreeRayHit *hit)
+{
+  RayCastStats &stats = *static_cast<RayCastStats *>(userdata);
+  stats.tris_tested++;
+  const float3 *tri = &stats.positions[index * 3];
+  float dist;
+  if (isect_ray_tri_v3(ray->origin, ray->direction, tri[0], tri[1], tri[2], &dist, nullptr) &&
+      dist < hit->dist)
+  {
+    hit->index = index;
+    hit->dist = dist;
+  }
+}
+
+static void bvhtree_build_and_query(const int tris_num, const int tree_type, const int flag)
+{
+  const Array<float3> positions = random_triangles(tris_num);
+  const char *mode = (flag & BVH_BALANCE_SAH) ? "SAH" : "median";
+  printf("\n========== %d triangles, tree type %d, %s split ==========\n",
+         tris_num,
+         tree_type,
+         mode);
+
+  BVHTree *tree = triangles_tree_new(positions, tree_type);
+  {
+    SCOPED_TIMER("balance");
+    BLI_bvhtree_balance_ex(tree, flag);
+  }
+
+  for (const int tri : IndexRange(tris_num)) {
+    const float3 offset(0.0f, 0.0f, 0.01f);
+    float3 co[3] = {positions[tri * 3] + offset,
+                    positions[tri * 3 + 1] + offset,
+                    positions[tri * 3 + 2] + offset};
+    BLI_bvhtree_update_node(tree, tri, co[0], nullptr, 3);
+  }
+  {
+    SCOPED_TIMER("update_tree");
+    BLI_bvhtree_update_tree(tree);
+  }
+
+  /* Rays from random points in the large sphere towards the dense sphere. */
+  RandomNumberGenerator rng(7);
+  const int rays_num = 200000;
+  RayCastStats stats{positions};
+  int hits_num = 0;
+  {
+    SCOPED_TIMER("ray_cast");
+    for ([[maybe_unused]] const int i : IndexRange(rays_num)) {
+      const float3 origin = rng.get_unit_float3() * 80.0f;
+      const float3 target = float3(30.0f, 0.0f, 0.0f) + rng.get_unit_float3() * 0.5f;
+      const float3 direction = math::normalize(target - origin);
+      BVHTreeRayHit hit;
+      hit.index = -1;
+      hit.dist = BVH_RAYCAST_DIST_MAX;
+      BLI_bvhtree_ray_cast(
+          tree, origin, direction, 0.0f, &hit, ray_cast_triangle_cb, &stats);
+      hits_num += hit.index != -1;
+    }
+  }
+  printf("%d of %d rays hit, %.1f triangles tested per ray\n",
+         hits_num,
+         rays_num,
+         double(stats.tris_tested) / double(rays_num));
+
+  BLI_bvhtree_free(tree);
+}
+
+TEST(kdopbvh_performance, balance_median_binary)
+{
+  bvhtree_build_and_query(1000000, 2, 0);
+}
+
+TEST(kdopbvh_performance, balance_sah_binary)
+{
+  bvhtree_build_and_query(1000000, 2, BVH_BALANCE_SAH);
+}
+
+TEST(kdopbvh_performance, balance_median_quad)
+{
+  bvhtree_build_and_query(1000000, 4, 0);
+}
+
+TEST(kdopbvh_performance, balance_sah_quad)
+{
+  bvhtree_build_and_query(1000000, 4, BVH_BALANCE_SAH);
+}
@@ -37,6 +37,13 @@ static constexpr bool USE_RESERVE_COUNT = false;
 /* Size of 'small case' ghash (number of entries). */
 static constexpr size_t TESTCASE_SIZE_SMALL = 17;
 
+/* Compare the default probing strategy of #Map with #GroupProbingStrategy. */
+template<typename Key, typename Value>
+using GroupProbingMap = Map<Key,
+                            Value,
+                            default_inline_buffer_capacity(sizeof(Key) + sizeof(Value)),
+                            GroupProbingStrategy>;
+
 static void print_ghash_stats(GHash *gh)
 {
   double lf, var, pempty, poverloaded;
@@ -243,6 +250,12 @@ TEST(ghash, TextMap)
   str_map_tests(map, "StrMap - DefaultHash");
 }
 
+TEST(ghash, TextMapGroupProbing)
+{
+  GroupProbingMap<StringRef, int64_t> map;
+  str_map_tests(map, "StrMap - GroupProbing");
+}
+
 /* Int: uniform 100M first integers. */
 
 static void int_ghash_tests(GHash *ghash, const char *id, const uint count)
@@ -370,12 +383,24 @@ TEST(ghash, IntMap12000)
   int_map_tests(map, "IntMap - DefaultHash - 12000", 12000);
 }
 
+TEST(ghash, IntMapGroupProbing12000)
+{
+  GroupProbingMap<int, int> map;
+  int_map_tests(map, "IntMap - GroupProbing - 12000", 12000);
+}
+
 #ifdef USE_BIG_TESTS
 TEST(ghash, IntMap100000000)
 {
   Map<int, int> map;
   int_map_tests(map, "IntMap - DefaultHash - 100000000", 100000000);
 }
+
+TEST(ghash, IntMapGroupProbing100000000)
+{
+  GroupProbingMap<int, int> map;
+  int_map_tests(map, "IntMap - GroupProbing - 100000000", 100000000);
+}
 #endif
 
 /* Int: random 50M integers. */
@@ -497,12 +522,24 @@ TEST(ghash, IntRandMap12000)
   randint_map_tests(map, "RandIntMap - DefaultHash - 12000", 12000);
 }
 
+TEST(ghash, IntRandMapGroupProbing12000)
+{
+  GroupProbingMap<int, int> map;
+  randint_map_tests(map, "RandIntMap - GroupProbing - 12000", 12000);
+}
+
 #ifdef USE_BIG_TESTS
 TEST(ghash, IntRandMap50000000)
 {
   Map<int, int> map;
   randint_map_tests(map, "RandIntMap - DefaultHash - 50000000", 50000000);
 }
+
+TEST(ghash, IntRandMapGroupProbing50000000)
+{
+  GroupProbingMap<int, int> map;
+  randint_map_tests(map, "RandIntMap - GroupProbing - 50000000", 50000000);
+}
 #endif
 
 static uint ghashutil_tests_nohash_p(const void *p)
@@ -660,12 +697,24 @@ TEST(ghash, Int4Map2000)
   int4_map_tests(map, "Int4Map - DefaultHash - 2000", 2000);
 }
 
+TEST(ghash, Int4MapGroupProbing2000)
+{
+  GroupProbingMap<uint4, int> map;
+  int4_map_tests(map, "Int4Map - GroupProbing - 2000", 2000);
+}
+
 #ifdef USE_BIG_TESTS
 TEST(ghash, Int4Map20000000)
 {
   Map<uint4, int> map;
   int4_map_tests(map, "Int4Map - DefaultHash - 20000000", 20000000);
 }
+
+TEST(ghash, Int4MapGroupProbing20000000)
+{
+  GroupProbingMap<uint4, int> map;
+  int4_map_tests(map, "Int4Map - GroupProbing - 20000000", 20000000);
+}
 #endif
 
 /* MultiSmall: create and manipulate a lot of very small ghash's
@@ -0,0 +1,79 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+#pragma once
+
+/** \file
+ * \ingroup blenloader
+ * \brief Time and memory statistics of the phases of reading and writing blend-files.
+ *
+ * Gathering is opt-in: the statistics are only recorded when an #IOStats is passed in
+ * #BlendFileReadReport.io_stats or #BlendFileWriteParams.io_stats. This is done for `--debug-io`
+ * and by the `BLO_read_write` performance tests.
+ */
+
+#include <string>
+
+#include "BLI_mutex.hh"
+#include "BLI_vector.hh"
+
+namespace blender::blo {
+
+struct IOPhaseStats {
+  /** Static string, e.g. "Versioning 280". */
+  const char *name = nullptr;
+  /** Number of times the phase ran, e.g. once for every library. */
+  int64_t calls = 0;
+  /** Wall time in seconds, summed over all calls. */
+  double duration = 0.0;
+  /**
+   * Change of the memory allocated with `guardedalloc` while the phase ran, summed over all calls.
+   * Allocations done concurrently by other threads are included as well.
+   */
+  int64_t memory_delta = 0;
+};
+
+/**
+ * Statistics for all phases of one or more read or write operations.
+ *
+ * Phases can be nested (e.g. reading blocks from the file is part of building the block index),
+ * so the durations of all phases don't add up to the total time. Phases can be added from
+ * multiple threads.
+ */
+class IOStats {
+ private:
+  mutable Mutex mutex_;
+  /** In the order the phases ran first. */
+  Vector<IOPhaseStats> phases_;
+
+ public:
+  void add(const char *name, double duration, int64_t memory_delta, int64_t calls = 1);
+
+  Vector<IOPhaseStats> phases() const;
+  void clear();
+
+  /** A table of all phases, one per line. */
+  std::string report() const;
+};
+
+/**
+ * Records the time and memory change between its construction and destruction as a phase of
+ * \a stats. Does nothing when \a stats is null.
+ */
+class IOPhaseTimer {
+ private:
+  IOStats *stats_;
+  const char *name_;
+  double start_time_ = 0.0;
+  int64_t start_memory_ = 0;
+
+ public:
+  IOPhaseTimer(IOStats *stats, const char *name);
+  ~IOPhaseTimer();
+
+  IOPhaseTimer(const IOPhaseTimer &other) = delete;
+  IOPhaseTimer &operator=(const IOPhaseTimer &other) = delete;
+};
+
+}  // namespace blender::blo
@@ -348,20 +348,26 @@ void BLO_read_string(BlendDataReader *reader, const char **ptr_p);
 blender::ImplicitSharingInfoAndData blo_read_shared_impl(
     BlendDataReader *reader,
     const void **ptr_p,
+    size_t expected_size,
     blender::FunctionRef<const blender::ImplicitSharingInfo *()> read_fn);
 
 /**
  * Check if there is any shared data for the given data pointer. If yes, return the existing
  * sharing-info. If not, call the provided function to actually read the data now.
+ *
+ * \param expected_size: The size of the data in bytes, as validated by the read function. Data
+ * that is referenced in a memory-mapped file directly is only used if it is large enough. Zero if
+ * the size is unknown, then the data is always read with the read function.
  */
 template<typename T>
 const blender::ImplicitSharingInfo *BLO_read_shared(
     BlendDataReader *reader,
     T **data_ptr,
+    const size_t expected_size,
     blender::FunctionRef<const blender::ImplicitSharingInfo *()> read_fn)
 {
   blender::ImplicitSharingInfoAndData shared_data = blo_read_shared_impl(
-      reader, (const void **)data_ptr, read_fn);
+      reader, (const void **)data_ptr, expected_size, read_fn);
   /* Need const-cast here, because not all DNA members that reference potentially shared data are
    * const yet. */
   *data_ptr = const_cast<T *>(static_cast<const T *>(shared_data.data));
@@ -38,6 +38,9 @@ struct ViewLayer;
 struct WorkSpace;
 struct bScreen;
 struct wmWindowManager;
+namespace blender::blo {
+class IOStats;
+}
 
 struct WorkspaceConfigFileData {
   Main *main; /* has to be freed when done reading file data */
@@ -109,12 +112,26 @@ struct BlendFileReadReport {
   /** Timing information. */
   struct {
     double whole;
+    /** Reading all blocks of the main file (excluding the reconstruction below). */
+    double bhead_index;
+    /** Converting structs from the file DNA to the current DNA, done in parallel. */
+    double struct_reconstruct;
+    /** Reading the IDs of the main file (#read_libblock). */
+    double read_ids;
+    /** Versioning of the main file, before linking. */
+    double versioning;
     double libraries;
     double lib_overrides;
     double lib_overrides_resync;
     double lib_overrides_recursive_resync;
   } duration;
 
+  /**
+   * Optional, detailed time and memory statistics of the reading phases, including the reading
+   * of libraries. Only gathered when set (e.g. with `--debug-io`).
+   */
+  blender::blo::IOStats *io_stats;
+
   /** Count information. */
   struct {
     /**
@@ -340,6 +357,11 @@ void BLO_blendhandle_close(BlendHandle *bh) ATTR_NONNULL(1);
  */
 void BLO_read_invalidate_message(BlendHandle *bh, Main *bmain, const char *message);
 
+/**
+ * Wait for library block indices that are written in the background, to be called on exit.
+ */
+void BLO_library_index_exit();
+
 /**
  * BLI_assert-like macro to check a condition, and if `false`, fail the whole .blend reading
  * process by marking the Main data-base as invalid, and returning provided `_ret_value`.
@@ -17,6 +17,7 @@ namespace blender {
 class ImplicitSharingInfo;
 }
 struct Main;
+struct MemFileChunkData;
 struct Scene;
 
 struct MemFileSharedStorage {
@@ -30,10 +31,14 @@ struct MemFileSharedStorage {
 
 struct MemFileChunk {
   void *next, *prev;
-  const char *buf;
+  /**
+   * The content of the chunk, shared with all other chunks with the same content (from any undo
+   * step). May be compressed when the chunk is not part of the most recent undo step.
+   */
+  MemFileChunkData *data;
   /** Size in bytes. */
   size_t size;
-  /** When true, this chunk doesn't own the memory, it's shared with a previous #MemFileChunk */
+  /** When true, this chunk is identical to the matching one in the previous step. */
   bool is_identical;
   /** When true, this chunk is also identical to the one in the next step (used by undo code to
    * detect unchanged IDs).
@@ -46,6 +51,10 @@ struct MemFileChunk {
 
 struct MemFile {
   ListBase chunks;
+  /**
+   * Memory used by the chunk data added to the store by this memfile (not shared with older
+   * ones). Decreases when the data is compressed in the background, see #BLO_memfile_size.
+   */
   size_t size;
   /**
    * Some data is not serialized into a new buffer because the undo-step can take ownership of it
@@ -98,6 +107,10 @@ void BLO_memfile_chunk_add(MemFileWriteData *mem_data, const char *buf, size_t s
 /* **************** support for memory-write, for undo buffers *************** */
 
 void BLO_memfile_free(MemFile *memfile);
+/**
+ * Get #MemFile.size, which may be changed by background compression.
+ */
+size_t BLO_memfile_size(const MemFile *memfile);
 /**
  * Result is that 'first' is being freed.
  * To keep the #MemFile linked list of consistent, `first` is always first in list.
@@ -108,6 +121,22 @@ void BLO_memfile_merge(MemFile *first, MemFile *second);
  */
 void BLO_memfile_clear_future(MemFile *memfile);
 
+/** Memory usage of the chunk data shared by all #MemFile. */
+struct MemFileChunkStoreStats {
+  /** Number of unique chunk contents. */
+  int64_t chunks_num;
+  /** Number of chunk contents that are currently compressed. */
+  int64_t compressed_chunks_num;
+  /** Size of the chunk contents when uncompressed. */
+  size_t data_size;
+  /** Memory actually used by the chunk contents. */
+  size_t stored_size;
+};
+
+MemFileChunkStoreStats BLO_memfile_chunk_store_stats();
+/** Wait for background compression of the chunk store, to be called on exit. */
+void BLO_memfile_chunk_store_exit();
+
 /* Utilities. */
 
 Main *BLO_memfile_main_get(MemFile *memfile, Main *bmain, Scene **r_scene);
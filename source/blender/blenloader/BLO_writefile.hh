@@ -11,10 +11,14 @@
 
 #include "BLI_sys_types.h"
 
+struct BlendFileSnapshot;
 struct BlendThumbnail;
 struct Main;
 struct MemFile;
 struct ReportList;
+namespace blender::blo {
+class IOStats;
+}
 
 /* -------------------------------------------------------------------- */
 /** \name BLO Write File API
@@ -45,6 +49,8 @@ struct BlendFileWriteParams {
   uint use_save_as_copy : 1;
   uint use_userdef : 1;
   const BlendThumbnail *thumb;
+  /** Optional, detailed time and memory statistics of the writing phases, see #IOStats. */
+  blender::blo::IOStats *io_stats;
 };
 
 /**
@@ -61,4 +67,30 @@ extern bool BLO_write_file(Main *mainvar,
  */
 extern bool BLO_write_file_mem(Main *mainvar, MemFile *compare, MemFile *current, int write_flags);
 
+/**
+ * Serialize `mainvar` into memory, to be written to `filepath` later with
+ * #BLO_write_snapshot_to_file. This is the part of #BLO_write_file that accesses #Main data, the
+ * (slow) compression and disk IO are left out. Implicitly shared data is referenced, not copied.
+ *
+ * \return The snapshot, or null on failure.
+ */
+BlendFileSnapshot *BLO_write_snapshot(Main *mainvar,
+                                      const char *filepath,
+                                      int write_flags,
+                                      const BlendFileWriteParams *params,
+                                      ReportList *reports);
+/**
+ * Write a snapshot to its file, replacing the existing file only when successful.
+ * Doesn't access #Main data, so it can run on a background thread.
+ *
+ * \param stop: Optional, cancels writing when it becomes true.
+ * \param progress: Optional, set to the written fraction of the file.
+ * \return Success.
+ */
+bool BLO_write_snapshot_to_file(const BlendFileSnapshot *snapshot,
+                                ReportList *reports,
+                                const bool *stop,
+                                float *progress);
+void BLO_write_snapshot_free(BlendFileSnapshot *snapshot);
+
 /** \} */
@@ -0,0 +1,88 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup blenloader
+ */
+
+#include <fmt/format.h>
+#include <mutex>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_time.h"
+#include "BLI_utildefines.h"
+
+#include "BLO_io_stats.hh"
+
+namespace blender::blo {
+
+void IOStats::add(const char *name,
+                  const double duration,
+                  const int64_t memory_delta,
+                  const int64_t calls)
+{
+  std::lock_guard lock{mutex_};
+  IOPhaseStats *phase = nullptr;
+  for (IOPhaseStats &existing : phases_) {
+    if (STREQ(existing.name, name)) {
+      phase = &existing;
+      break;
+    }
+  }
+  if (phase == nullptr) {
+    phases_.append({name});
+    phase = &phases_.last();
+  }
+  phase->calls += calls;
+  phase->duration += duration;
+  phase->memory_delta += memory_delta;
+}
+
+Vector<IOPhaseStats> IOStats::phases() const
+{
+  std::lock_guard lock{mutex_};
+  return phases_;
+}
+
+void IOStats::clear()
+{
+  std::lock_guard lock{mutex_};
+  phases_.clear();
+}
+
+std::string IOStats::report() const
+{
+  std::string result = fmt::format(
+      "{:<40} {:>8} {:>12} {:>14}\n", "Phase", "Calls", "Time (ms)", "Memory (KiB)");
+  for (const IOPhaseStats &phase : this->phases()) {
+    result += fmt::format("{:<40} {:>8} {:>12.3f} {:>14}\n",
+                          phase.name,
+                          phase.calls,
+                          phase.duration * 1000.0,
+                          phase.memory_delta / 1024);
+  }
+  return result;
+}
+
+IOPhaseTimer::IOPhaseTimer(IOStats *stats, const char *name) : stats_(stats), name_(name)
+{
+  if (stats_ == nullptr) {
+    return;
+  }
+  start_time_ = BLI_time_now_seconds();
+  start_memory_ = int64_t(MEM_get_memory_in_use());
+}
+
+IOPhaseTimer::~IOPhaseTimer()
+{
+  if (stats_ == nullptr) {
+    return;
+  }
+  stats_->add(name_,
+              BLI_time_now_seconds() - start_time_,
+              int64_t(MEM_get_memory_in_use()) - start_memory_);
+}
+
+}  // namespace blender::blo
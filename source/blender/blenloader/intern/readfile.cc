@@ -8,6 +8,7 @@
 
 #include "fmt/core.h"
 
+#include <algorithm>
 #include <cerrno>
 #include <cstdarg> /* for va_start/end. */
 #include <cstddef> /* for offsetof. */
@@ -15,6 +16,7 @@
 #include <cstring>
 #include <ctime>   /* for gmtime. */
 #include <fcntl.h> /* for open flags (O_BINARY, O_RDONLY). */
+#include <mutex>
 #include <queue>
 
 #ifndef WIN32
@@ -26,6 +28,7 @@
 #endif
 
 #include <fmt/format.h>
+#include <xxhash.h>
 
 #include "CLG_log.h"
 
@@ -47,16 +50,24 @@
 #include "MEM_alloc_string_storage.hh"
 #include "MEM_guardedalloc.h"
 
+#include "BLI_array.hh"
 #include "BLI_endian_defines.h"
 #include "BLI_fileops.h"
 #include "BLI_ghash.h"
+#include "BLI_hash.hh"
 #include "BLI_map.hh"
 #include "BLI_memarena.h"
+#include "BLI_mmap.h"
+#include "BLI_path_utils.hh"
 #include "BLI_set.hh"
 #include "BLI_string.h"
 #include "BLI_string_ref.hh"
 #include "BLI_string_utf8.h"
 #include "BLI_string_utils.hh"
+#include "BLI_struct_equality_utils.hh"
+#include "BLI_system.h"
+#include "BLI_task.h"
+#include "BLI_task.hh"
 #include "BLI_threads.h"
 #include "BLI_time.h"
 #include "BLI_utildefines.h"
@@ -65,6 +76,7 @@
 
 #include "BKE_anim_data.hh"
 #include "BKE_animsys.h"
+#include "BKE_appdir.hh"
 #include "BKE_asset.hh"
 #include "BKE_blender_version.h"
 #include "BKE_collection.hh"
@@ -101,6 +113,7 @@
 #include "DEG_depsgraph.hh"
 
 #include "BLO_blend_validate.hh"
+#include "BLO_io_stats.hh"
 #include "BLO_read_write.hh"
 #include "BLO_readfile.hh"
 #include "BLO_undofile.hh"
@@ -110,6 +123,8 @@
 #include "SEQ_sequencer.hh"
 #include "SEQ_utils.hh"
 
+#include BLI_SYSTEM_PID_H
+
 #include "readfile.hh"
 #include "versioning_common.hh"
 
@@ -196,6 +211,11 @@ struct BHeadN {
   bool has_data;
 #endif
   bool is_memchunk_identical;
+  /**
+   * Result of #DNA_struct_reconstruct computed ahead of time, see
+   * #read_file_structs_reconstruct_parallel. Ownership is taken by the first #read_struct call.
+   */
+  void *reconstructed_data;
   BHead bhead;
 };
 
@@ -665,6 +685,7 @@ static BHeadN *get_bhead(FileData *fd)
           new_bhead->file_offset = fd->file->offset;
           new_bhead->has_data = false;
           new_bhead->is_memchunk_identical = false;
+          new_bhead->reconstructed_data = nullptr;
           new_bhead->bhead = *bhead;
           const off64_t seek_new = fd->file->seek(fd->file, bhead->len, SEEK_CUR);
           if (UNLIKELY(seek_new == -1)) {
@@ -691,6 +712,7 @@ static BHeadN *get_bhead(FileData *fd)
           new_bhead->has_data = true;
 #endif
           new_bhead->is_memchunk_identical = false;
+          new_bhead->reconstructed_data = nullptr;
           new_bhead->bhead = *bhead;
 
           const int64_t readsize = fd->file->read(fd->file, new_bhead + 1, size_t(bhead->len));
@@ -814,6 +836,7 @@ static BHead *blo_bhead_read_full(FileData *fd, BHead *thisblock)
   new_bhead_data->file_offset = new_bhead->file_offset;
   new_bhead_data->has_data = true;
   new_bhead_data->is_memchunk_identical = false;
+  new_bhead_data->reconstructed_data = nullptr;
   if (!blo_bhead_read_data(fd, thisblock, new_bhead_data + 1)) {
     MEM_freeN(new_bhead_data);
     return nullptr;
@@ -845,6 +868,7 @@ AssetMetaData *blo_bhead_id_asset_data_address(const FileData *fd, const BHead *
 
 static void read_blender_header(FileData *fd)
 {
+  blender::blo::IOPhaseTimer timer(fd->reports->io_stats, "Header");
   const BlenderHeaderVariant header_variant = BLO_readfile_blender_header_decode(fd->file);
   if (std::holds_alternative<BlenderHeaderInvalid>(header_variant)) {
     return;
@@ -1196,10 +1220,12 @@ static bool is_minversion_older_than_blender(FileData *fd, ReportList *reports)
   return false;
 }
 
-static FileData *blo_decode_and_check(FileData *fd, ReportList *reports)
+/**
+ * Check the header read by #read_blender_header and read the DNA.
+ * \return null (after freeing \a fd) when the file can't be read.
+ */
+static FileData *blo_check_and_read_dna(FileData *fd, ReportList *reports)
 {
-  read_blender_header(fd);
-
   if (fd->flags & FD_FLAGS_SWITCH_ENDIAN) {
     BLI_STATIC_ASSERT(ENDIAN_ORDER == L_ENDIAN, "Blender only builds on little endian systems")
     BKE_reportf(reports,
@@ -1213,7 +1239,13 @@ static FileData *blo_decode_and_check(FileData *fd, ReportList *reports)
   }
   else if (fd->flags & FD_FLAGS_FILE_OK) {
     const char *error_message = nullptr;
-    if (read_file_dna(fd, &error_message) == false) {
+    bool dna_read;
+    {
+      /* Reading the DNA walks over all blocks (it is stored at the end of the file). */
+      blender::blo::IOPhaseTimer timer(fd->reports->io_stats, "Block index and DNA");
+      dna_read = read_file_dna(fd, &error_message);
+    }
+    if (dna_read == false) {
       BKE_reportf(
           reports, RPT_ERROR, "Failed to read blend file '%s': %s", fd->relabase, error_message);
       blo_filedata_free(fd);
@@ -1242,9 +1274,74 @@ static FileData *blo_decode_and_check(FileData *fd, ReportList *reports)
   return fd;
 }
 
+static FileData *blo_decode_and_check(FileData *fd, ReportList *reports)
+{
+  read_blender_header(fd);
+  return blo_check_and_read_dna(fd, reports);
+}
+
+/**
+ * Wraps another #FileReader to measure the time spent waiting for data from the file. This
+ * includes decompression, unless it was already done ahead by other threads.
+ */
+struct TimedFileReader {
+  FileReader reader;
+
+  FileReader *base;
+  blender::blo::IOStats *io_stats;
+  double duration;
+  int64_t calls;
+};
+
+static int64_t timed_file_read(FileReader *reader, void *buffer, size_t size)
+{
+  TimedFileReader *timed = reinterpret_cast<TimedFileReader *>(reader);
+  const double time_start = BLI_time_now_seconds();
+  const int64_t readsize = timed->base->read(timed->base, buffer, size);
+  timed->duration += BLI_time_now_seconds() - time_start;
+  timed->calls++;
+  timed->reader.offset = timed->base->offset;
+  return readsize;
+}
+
+static off64_t timed_file_seek(FileReader *reader, off64_t offset, int whence)
+{
+  TimedFileReader *timed = reinterpret_cast<TimedFileReader *>(reader);
+  const double time_start = BLI_time_now_seconds();
+  const off64_t new_pos = timed->base->seek(timed->base, offset, whence);
+  timed->duration += BLI_time_now_seconds() - time_start;
+  timed->reader.offset = timed->base->offset;
+  return new_pos;
+}
+
+static void timed_file_close(FileReader *reader)
+{
+  TimedFileReader *timed = reinterpret_cast<TimedFileReader *>(reader);
+  timed->io_stats->add("File reading (I/O, decompression)", timed->duration, 0, timed->calls);
+  timed->base->close(timed->base);
+  MEM_freeN(timed);
+}
+
+static FileReader *timed_file_reader_new(FileReader *base, blender::blo::IOStats *io_stats)
+{
+  TimedFileReader *timed = MEM_callocN<TimedFileReader>(__func__);
+  timed->base = base;
+  timed->io_stats = io_stats;
+  timed->reader.read = timed_file_read;
+  timed->reader.seek = (base->seek != nullptr) ? timed_file_seek : nullptr;
+  timed->reader.close = timed_file_close;
+  timed->reader.offset = base->offset;
+  return &timed->reader;
+}
+
+/**
+ * \param use_read_ahead: Decompress upcoming parts of compressed files in parallel, useful when
+ * the whole file is going to be read.
+ */
 static FileData *blo_filedata_from_file_descriptor(const char *filepath,
                                                    BlendFileReadReport *reports,
-                                                   const int filedes)
+                                                   const int filedes,
+                                                   const bool use_read_ahead)
 {
   char header[7];
   FileReader *rawfile = BLI_filereader_new_file(filedes);
@@ -1270,10 +1367,19 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
   /* Rewind the file after reading the header. */
   rawfile->seek(rawfile, 0, SEEK_SET);
 
+#ifndef WIN32
+  /* Not supported on WIN32, where a file can't be replaced while it is mapped,
+   * which would prevent saving over it. */
+  const bool use_mapped_data = USER_EXPERIMENTAL_TEST(&U, use_mapped_file_data);
+#else
+  const bool use_mapped_data = false;
+#endif
+
   /* Check if we have a regular file. */
   if (memcmp(header, "BLENDER", sizeof(header)) == 0) {
-    /* Try opening the file with memory-mapped IO. */
-    file = BLI_filereader_new_mmap(filedes);
+    /* Try opening the file with memory-mapped IO. Arrays that reference the mapped data can
+     * become mutable and be modified in place, which requires a writable mapping. */
+    file = BLI_filereader_new_mmap(filedes, use_mapped_data);
     if (file == nullptr) {
       /* `mmap` failed, so just keep using `rawfile`. */
       file = rawfile;
@@ -1287,7 +1393,8 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
     }
   }
   else if (BLI_file_magic_is_zstd(header)) {
-    file = BLI_filereader_new_zstd(rawfile);
+    file = use_read_ahead ? BLI_filereader_new_zstd_read_ahead(rawfile) :
+                            BLI_filereader_new_zstd(rawfile);
     if (file != nullptr) {
       rawfile = nullptr; /* The `Zstd` #FileReader takes ownership of `rawfile`. */
     }
@@ -1305,10 +1412,20 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
   FileData *fd = filedata_new(reports);
   fd->file = file;
 
+  if (use_mapped_data) {
+    fd->mapped_file = BLI_filereader_get_mmap(file);
+  }
+
+  if (reports->io_stats) {
+    fd->file = timed_file_reader_new(file, reports->io_stats);
+  }
+
   return fd;
 }
 
-static FileData *blo_filedata_from_file_open(const char *filepath, BlendFileReadReport *reports)
+static FileData *blo_filedata_from_file_open(const char *filepath,
+                                             BlendFileReadReport *reports,
+                                             const bool use_read_ahead)
 {
   errno = 0;
   const int file = BLI_open(filepath, O_BINARY | O_RDONLY, 0);
@@ -1320,12 +1437,12 @@ static FileData *blo_filedata_from_file_open(const char *filepath, BlendFileRead
                 errno ? strerror(errno) : RPT_("unknown error reading file"));
     return nullptr;
   }
-  return blo_filedata_from_file_descriptor(filepath, reports, file);
+  return blo_filedata_from_file_descriptor(filepath, reports, file, use_read_ahead);
 }
 
 FileData *blo_filedata_from_file(const char *filepath, BlendFileReadReport *reports)
 {
-  FileData *fd = blo_filedata_from_file_open(filepath, reports);
+  FileData *fd = blo_filedata_from_file_open(filepath, reports, true);
   if (fd != nullptr) {
     /* needed for library_append and read_libraries */
     STRNCPY(fd->relabase, filepath);
@@ -1342,7 +1459,7 @@ FileData *blo_filedata_from_file(const char *filepath, BlendFileReadReport *repo
 static FileData *blo_filedata_from_file_minimal(const char *filepath)
 {
   BlendFileReadReport read_report{};
-  FileData *fd = blo_filedata_from_file_open(filepath, &read_report);
+  FileData *fd = blo_filedata_from_file_open(filepath, &read_report, false);
   if (fd != nullptr) {
     read_blender_header(fd);
     if (fd->flags & FD_FLAGS_FILE_OK) {
@@ -1370,7 +1487,7 @@ FileData *blo_filedata_from_memory(const void *mem,
     file = BLI_filereader_new_gzip(mem_file);
   }
   else if (BLI_file_magic_is_zstd(static_cast<const char *>(mem))) {
-    file = BLI_filereader_new_zstd(mem_file);
+    file = BLI_filereader_new_zstd_read_ahead(mem_file);
   }
 
   if (file == nullptr) {
@@ -1405,19 +1522,19 @@ FileData *blo_filedata_from_memfile(MemFile *memfile,
 void blo_filedata_free(FileData *fd)
 {
   /* Free all BHeadN data blocks */
-#ifdef NDEBUG
-  BLI_freelistN(&fd->bhead_list);
-#else
-  /* Sanity check we're not keeping memory we don't need. */
   LISTBASE_FOREACH_MUTABLE (BHeadN *, new_bhead, &fd->bhead_list) {
-#  ifdef USE_BHEAD_READ_ON_DEMAND
+#if !defined(NDEBUG) && defined(USE_BHEAD_READ_ON_DEMAND)
+    /* Sanity check we're not keeping memory we don't need. */
     if (fd->file->seek != nullptr && BHEAD_USE_READ_ON_DEMAND(&new_bhead->bhead)) {
       BLI_assert(new_bhead->has_data == 0);
     }
-#  endif
+#endif
+    /* Reconstructed data of blocks that ended up not being read. */
+    if (new_bhead->reconstructed_data) {
+      MEM_freeN(new_bhead->reconstructed_data);
+    }
     MEM_freeN(new_bhead);
   }
-#endif
   fd->file->close(fd->file);
 
   if (fd->filesdna) {
@@ -1455,6 +1572,482 @@ void blo_filedata_free(FileData *fd)
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Library Block Index
+ *
+ * Linking from a library typically only reads a few of its data-blocks, but finding them requires
+ * walking over all block headers of the file first. For large or compressed files this is most of
+ * the cost of opening them, so the resulting block list is stored in the user cache directory and
+ * reused as long as the library file is unchanged.
+ *
+ * The index stores every #BHead with the offset of its data in the library file. The data of the
+ * blocks that are not read on demand (IDs, DNA, file global, thumbnail...) is stored as well, so
+ * listing and finding IDs doesn't need to read the library file at all.
+ *
+ * Indices are written by a background task after a library was opened without one. The least
+ * recently used ones are deleted when the directory grows larger than #BHEAD_INDEX_DIR_MAX_SIZE.
+ * \{ */
+
+#define BHEAD_INDEX_EXTENSION ".bhead_index"
+
+/** Modification time in nanoseconds, only whole seconds are available on WIN32. */
+static int64_t bhead_index_file_mtime(const BLI_stat_t &status)
+{
+#if defined(WIN32)
+  return int64_t(status.st_mtime) * 1000000000;
+#elif defined(__APPLE__)
+  return int64_t(status.st_mtimespec.tv_sec) * 1000000000 + status.st_mtimespec.tv_nsec;
+#else
+  return int64_t(status.st_mtim.tv_sec) * 1000000000 + status.st_mtim.tv_nsec;
+#endif
+}
+
+#ifdef USE_BHEAD_READ_ON_DEMAND
+
+/** Bump when the layout of the index files changes. */
+#  define BHEAD_INDEX_VERSION 2
+/** Scanning smaller files is cheap enough that the index isn't worth storing. */
+#  define BHEAD_INDEX_MIN_FILE_SIZE (1 << 20)
+/** Size of the parts of the library file that are hashed, see #bhead_index_content_hash. */
+#  define BHEAD_INDEX_HASH_SAMPLE_SIZE 4096
+#  define BHEAD_INDEX_HASH_SAMPLES_NUM 16
+/** Total size of all index files in the cache directory. */
+#  define BHEAD_INDEX_DIR_MAX_SIZE (int64_t(256) << 20)
+
+static const char bhead_index_magic[8] = {'B', 'L', 'E', 'N', 'B', 'H', 'I', 'X'};
+
+/** Identifies the state of the library file an index was created for. */
+struct BHeadIndexKey {
+  int64_t file_size;
+  /** See #bhead_index_file_mtime. */
+  int64_t file_mtime;
+  /** Detects changes that don't affect the file size and modification time. */
+  uint64_t content_hash;
+
+  BLI_STRUCT_EQUALITY_OPERATORS_3(BHeadIndexKey, file_size, file_mtime, content_hash)
+};
+
+struct BHeadIndexHeader {
+  char magic[8];
+  int32_t version;
+  int32_t bhead_size;
+  BlenderHeader blender_header;
+  BHeadIndexKey key;
+  /** Offset of the first block in the (decompressed) library file. */
+  int64_t bhead_start_offset;
+  int64_t bhead_num;
+};
+
+struct BHeadIndexEntry {
+  BHead bhead;
+  /** Offset of the block data in the library file, zero when the data follows the entry. */
+  int64_t file_offset;
+};
+
+/**
+ * Hash evenly spaced parts of the file, including its start and end. Saving a blend-file changes
+ * its header blocks and the DNA at the end, so this catches files that are rewritten within the
+ * precision of the modification time, without reading all of it.
+ */
+static std::optional<uint64_t> bhead_index_content_hash(const char *filepath,
+                                                        const int64_t file_size)
+{
+  const int file = BLI_open(filepath, O_BINARY | O_RDONLY, 0);
+  if (file == -1) {
+    return std::nullopt;
+  }
+  BLI_assert(file_size >= BHEAD_INDEX_HASH_SAMPLE_SIZE);
+  const int64_t last_sample_offset = file_size - BHEAD_INDEX_HASH_SAMPLE_SIZE;
+  blender::Array<char> samples(BHEAD_INDEX_HASH_SAMPLE_SIZE * BHEAD_INDEX_HASH_SAMPLES_NUM);
+  bool success = true;
+  for (const int i : blender::IndexRange(BHEAD_INDEX_HASH_SAMPLES_NUM)) {
+    const int64_t offset = last_sample_offset * i / (BHEAD_INDEX_HASH_SAMPLES_NUM - 1);
+    if (BLI_lseek(file, offset, SEEK_SET) != offset ||
+        BLI_read(file,
+                 samples.data() + i * BHEAD_INDEX_HASH_SAMPLE_SIZE,
+                 BHEAD_INDEX_HASH_SAMPLE_SIZE) != BHEAD_INDEX_HASH_SAMPLE_SIZE)
+    {
+      success = false;
+      break;
+    }
+  }
+  close(file);
+  if (!success) {
+    return std::nullopt;
+  }
+  return XXH3_64bits(samples.data(), size_t(samples.size()));
+}
+
+/**
+ * \return The key of the library file, or nothing when no index should be used for it.
+ */
+static std::optional<BHeadIndexKey> bhead_index_key_get(const char *filepath)
+{
+  BLI_stat_t status;
+  if (BLI_stat(filepath, &status) == -1 || !S_ISREG(status.st_mode) ||
+      status.st_size < BHEAD_INDEX_MIN_FILE_SIZE)
+  {
+    return std::nullopt;
+  }
+  const std::optional<uint64_t> content_hash = bhead_index_content_hash(filepath,
+                                                                        status.st_size);
+  if (!content_hash) {
+    return std::nullopt;
+  }
+  return BHeadIndexKey{int64_t(status.st_size), bhead_index_file_mtime(status), *content_hash};
+}
+
+static bool bhead_index_dir_get(char *r_index_dir)
+{
+  char caches_dir[FILE_MAX];
+  if (!BKE_appdir_folder_caches(caches_dir, sizeof(caches_dir))) {
+    return false;
+  }
+  BLI_path_join(r_index_dir, FILE_MAX, caches_dir, "blend-library-indices");
+  return true;
+}
+
+/**
+ * `BKE_appdir_folder_caches/blend-library-indices/<filepath-hash>_<filename>.bhead_index`.
+ */
+static bool bhead_index_filepath_get(const char *filepath, char *r_index_filepath)
+{
+  char index_dir[FILE_MAX];
+  if (!bhead_index_dir_get(index_dir)) {
+    return false;
+  }
+  const std::string filename = fmt::format("{:016x}_{}" BHEAD_INDEX_EXTENSION,
+                                           blender::get_default_hash(blender::StringRef(filepath)),
+                                           BLI_path_basename(filepath));
+  BLI_path_join(r_index_filepath, FILE_MAX, index_dir, filename.c_str());
+  return true;
+}
+
+/**
+ * Fill the block list of \a fd from an index, instead of reading it from the file.
+ * Must be called right after #read_blender_header.
+ *
+ * \return False when the index doesn't match the file, the block list is left untouched then.
+ */
+static bool bhead_index_read(FileData *fd,
+                             const BHeadIndexKey &key,
+                             const blender::Span<std::byte> index)
+{
+  BLI_assert(BLI_listbase_is_empty(&fd->bhead_list));
+  if (index.size() < sizeof(BHeadIndexHeader)) {
+    return false;
+  }
+  BHeadIndexHeader header;
+  memcpy(&header, index.data(), sizeof(header));
+  if (memcmp(header.magic, bhead_index_magic, sizeof(header.magic)) != 0 ||
+      header.version != BHEAD_INDEX_VERSION || header.bhead_size != sizeof(BHead) ||
+      memcmp(&header.blender_header, &fd->blender_header, sizeof(BlenderHeader)) != 0 ||
+      header.key != key || header.bhead_start_offset != fd->file->offset)
+  {
+    return false;
+  }
+
+  ListBase bhead_list = {};
+  int64_t pos = sizeof(header);
+  bool is_valid = true;
+  for (int64_t i = 0; i < header.bhead_num; i++) {
+    BHeadIndexEntry entry;
+    if (pos + int64_t(sizeof(entry)) > index.size()) {
+      is_valid = false;
+      break;
+    }
+    memcpy(&entry, index.data() + pos, sizeof(entry));
+    pos += sizeof(entry);
+
+    const bool has_data = entry.file_offset == 0;
+    if (entry.bhead.len < 0 || entry.file_offset < 0 ||
+        (has_data && pos + entry.bhead.len > index.size()))
+    {
+      is_valid = false;
+      break;
+    }
+    BHeadN *new_bhead = static_cast<BHeadN *>(
+        MEM_mallocN(sizeof(BHeadN) + (has_data ? size_t(entry.bhead.len) : 0), "new_bhead"));
+    new_bhead->next = new_bhead->prev = nullptr;
+    new_bhead->file_offset = entry.file_offset;
+    new_bhead->has_data = has_data;
+    new_bhead->is_memchunk_identical = false;
+    new_bhead->reconstructed_data = nullptr;
+    new_bhead->bhead = entry.bhead;
+    if (has_data) {
+      memcpy(new_bhead + 1, index.data() + pos, size_t(entry.bhead.len));
+      pos += entry.bhead.len;
+    }
+    BLI_addtail(&bhead_list, new_bhead);
+  }
+
+  if (!is_valid || pos != index.size()) {
+    BLI_freelistN(&bhead_list);
+    return false;
+  }
+  fd->bhead_list = bhead_list;
+  /* All blocks are known, the file is only accessed to read the data of blocks on demand. */
+  fd->is_eof = true;
+  return true;
+}
+
+static bool bhead_index_write(FileData *fd,
+                              const char *index_filepath,
+                              const BHeadIndexKey &key,
+                              const off64_t bhead_start_offset)
+{
+  /* Reading the DNA usually stops right before the last block. */
+  while (get_bhead(fd)) {
+  }
+
+  BHeadIndexHeader header{};
+  memcpy(header.magic, bhead_index_magic, sizeof(header.magic));
+  header.version = BHEAD_INDEX_VERSION;
+  header.bhead_size = sizeof(BHead);
+  header.blender_header = fd->blender_header;
+  header.key = key;
+  header.bhead_start_offset = bhead_start_offset;
+  header.bhead_num = BLI_listbase_count(&fd->bhead_list);
+
+  if (!BLI_file_ensure_parent_dir_exists(index_filepath)) {
+    return false;
+  }
+  /* Write to a temporary file first, so that other instances never read a partial index. */
+  char temp_filepath[FILE_MAX + 16];
+  SNPRINTF(temp_filepath, "%s@%d", index_filepath, abs(getpid()));
+  FILE *file = BLI_fopen(temp_filepath, "wb");
+  if (file == nullptr) {
+    return false;
+  }
+
+  bool success = fwrite(&header, sizeof(header), 1, file) == 1;
+  LISTBASE_FOREACH (const BHeadN *, bheadn, &fd->bhead_list) {
+    if (!success) {
+      break;
+    }
+    BHeadIndexEntry entry{};
+    entry.bhead = bheadn->bhead;
+    entry.file_offset = bheadn->has_data ? 0 : bheadn->file_offset;
+    success = fwrite(&entry, sizeof(entry), 1, file) == 1;
+    if (success && bheadn->has_data && bheadn->bhead.len > 0) {
+      success = fwrite(bheadn + 1, size_t(bheadn->bhead.len), 1, file) == 1;
+    }
+  }
+  success &= fclose(file) == 0;
+
+  if (!success || BLI_rename_overwrite(temp_filepath, index_filepath) != 0) {
+    BLI_delete(temp_filepath, false, false);
+    return false;
+  }
+  return true;
+}
+
+/** Background writing of indices, see #bhead_index_write_schedule. */
+struct BHeadIndexWriter {
+  std::mutex mutex;
+  TaskPool *pool = nullptr;
+  /** Library files that have a write task scheduled. */
+  blender::Set<std::string> scheduled_filepaths;
+};
+
+static BHeadIndexWriter &bhead_index_writer()
+{
+  static BHeadIndexWriter writer;
+  return writer;
+}
+
+struct BHeadIndexWriteTask {
+  std::string filepath;
+  std::string index_filepath;
+};
+
+static void bhead_index_write_task(TaskPool *__restrict /*pool*/, void *taskdata)
+{
+  const BHeadIndexWriteTask &task = *static_cast<const BHeadIndexWriteTask *>(taskdata);
+  if (blo_library_index_write(task.filepath.c_str(), task.index_filepath.c_str())) {
+    char index_dir[FILE_MAX];
+    BLI_path_split_dir_part(task.index_filepath.c_str(), index_dir, sizeof(index_dir));
+    blo_library_index_dir_trim(index_dir, BHEAD_INDEX_DIR_MAX_SIZE);
+  }
+  BHeadIndexWriter &writer = bhead_index_writer();
+  std::lock_guard lock{writer.mutex};
+  writer.scheduled_filepaths.remove(task.filepath);
+}
+
+static void bhead_index_write_task_free(TaskPool *__restrict /*pool*/, void *taskdata)
+{
+  MEM_delete(static_cast<BHeadIndexWriteTask *>(taskdata));
+}
+
+/**
+ * Write the index for \a filepath in a background task. The library file is opened again by the
+ * task, so this doesn't hold up reading it.
+ */
+static void bhead_index_write_schedule(const char *filepath, const char *index_filepath)
+{
+  BHeadIndexWriter &writer = bhead_index_writer();
+  std::lock_guard lock{writer.mutex};
+  if (!writer.scheduled_filepaths.add(filepath)) {
+    return;
+  }
+  if (writer.pool == nullptr) {
+    writer.pool = BLI_task_pool_create_background(nullptr, TASK_PRIORITY_LOW);
+  }
+  BLI_task_pool_push(writer.pool,
+                     bhead_index_write_task,
+                     MEM_new<BHeadIndexWriteTask>(__func__, filepath, index_filepath),
+                     true,
+                     bhead_index_write_task_free);
+}
+
+#endif /* USE_BHEAD_READ_ON_DEMAND */
+
+bool blo_library_index_write(const char *filepath, const char *index_filepath)
+{
+#ifdef USE_BHEAD_READ_ON_DEMAND
+  const std::optional<BHeadIndexKey> key = bhead_index_key_get(filepath);
+  if (!key) {
+    return false;
+  }
+  BlendFileReadReport reports{};
+  FileData *fd = blo_filedata_from_file_open(filepath, &reports, false);
+  if (fd == nullptr) {
+    return false;
+  }
+  STRNCPY(fd->relabase, filepath);
+  read_blender_header(fd);
+  const off64_t bhead_start_offset = fd->file->offset;
+  if (fd->file->seek == nullptr) {
+    blo_filedata_free(fd);
+    return false;
+  }
+  fd = blo_check_and_read_dna(fd, nullptr);
+  if (fd == nullptr) {
+    return false;
+  }
+  bool success = false;
+  /* The file may have been saved again while it was read. */
+  if (bhead_index_key_get(filepath) == key) {
+    success = bhead_index_write(fd, index_filepath, *key, bhead_start_offset);
+  }
+  blo_filedata_free(fd);
+  return success;
+#else
+  UNUSED_VARS(filepath, index_filepath);
+  return false;
+#endif
+}
+
+void blo_library_index_dir_trim(const char *dirpath, const int64_t max_size)
+{
+  direntry *files;
+  const uint files_num = BLI_filelist_dir_contents(dirpath, &files);
+  blender::Vector<const direntry *> index_files;
+  int64_t total_size = 0;
+  for (const direntry &file : blender::Span(files, files_num)) {
+    if (S_ISREG(file.s.st_mode) && BLI_str_endswith(file.relname, BHEAD_INDEX_EXTENSION)) {
+      index_files.append(&file);
+      total_size += int64_t(file.s.st_size);
+    }
+  }
+  if (total_size > max_size) {
+    /* Indices are touched when they are used, so the oldest ones are the least recently used. */
+    std::sort(index_files.begin(), index_files.end(), [](const direntry *a, const direntry *b) {
+      return bhead_index_file_mtime(a->s) < bhead_index_file_mtime(b->s);
+    });
+    for (const direntry *file : index_files) {
+      if (total_size <= max_size) {
+        break;
+      }
+      if (BLI_delete(file->path, false, false) == 0) {
+        total_size -= int64_t(file->s.st_size);
+      }
+    }
+  }
+  BLI_filelist_free(files, files_num);
+}
+
+FileData *blo_filedata_from_library_file_with_index(const char *filepath,
+                                                    const char *index_filepath,
+                                                    BlendFileReadReport *reports,
+                                                    bool *r_index_outdated)
+{
+  *r_index_outdated = false;
+#ifdef USE_BHEAD_READ_ON_DEMAND
+  std::optional<BHeadIndexKey> index_key = bhead_index_key_get(filepath);
+  size_t index_size = 0;
+  void *index_data = index_key ? BLI_file_read_binary_as_mem(index_filepath, 0, &index_size) :
+                                 nullptr;
+
+  /* With an index only the needed blocks are read, decompressing ahead would be wasted. */
+  FileData *fd = blo_filedata_from_file_open(filepath, reports, index_data == nullptr);
+  if (fd == nullptr) {
+    MEM_SAFE_FREE(index_data);
+    return nullptr;
+  }
+  STRNCPY(fd->relabase, filepath);
+
+  read_blender_header(fd);
+  /* Blocks can only be read on demand from seekable files. */
+  if (fd->file->seek == nullptr || (fd->flags & FD_FLAGS_FILE_OK) == 0) {
+    index_key.reset();
+  }
+  bool index_used = false;
+  if (index_key && index_data) {
+    index_used = bhead_index_read(
+        fd,
+        *index_key,
+        blender::Span(static_cast<const std::byte *>(index_data), int64_t(index_size)));
+  }
+  MEM_SAFE_FREE(index_data);
+  if (index_used) {
+    /* Mark the index as recently used, see #blo_library_index_dir_trim. */
+    BLI_file_touch(index_filepath);
+  }
+  *r_index_outdated = index_key && !index_used;
+
+  return blo_check_and_read_dna(fd, reports->reports);
+#else
+  UNUSED_VARS(index_filepath);
+  return blo_filedata_from_file(filepath, reports);
+#endif
+}
+
+FileData *blo_filedata_from_library_file(const char *filepath, BlendFileReadReport *reports)
+{
+#ifdef USE_BHEAD_READ_ON_DEMAND
+  char index_filepath[FILE_MAX];
+  if (!bhead_index_filepath_get(filepath, index_filepath)) {
+    return blo_filedata_from_file(filepath, reports);
+  }
+  bool index_outdated;
+  FileData *fd = blo_filedata_from_library_file_with_index(
+      filepath, index_filepath, reports, &index_outdated);
+  if (fd && index_outdated) {
+    bhead_index_write_schedule(filepath, index_filepath);
+  }
+  return fd;
+#else
+  return blo_filedata_from_file(filepath, reports);
+#endif
+}
+
+void BLO_library_index_exit()
+{
+#ifdef USE_BHEAD_READ_ON_DEMAND
+  BHeadIndexWriter &writer = bhead_index_writer();
+  if (writer.pool == nullptr) {
+    return;
+  }
+  /* Writing an index is cheap compared to the reading it avoids, don't cancel it. */
+  BLI_task_pool_work_and_wait(writer.pool);
+  BLI_task_pool_free(writer.pool);
+  writer.pool = nullptr;
+#endif
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Read Thumbnail from Blend File
  * \{ */
@@ -1503,15 +2096,36 @@ short BLO_version_from_file(const char *filepath)
 /** \name Old/New Pointer Map
  * \{ */
 
+/**
+ * Copy a block that was not read into the datamap because it is mapped (see
+ * #read_data_into_datamap), for the cases where it is not accessed through #BLO_read_shared.
+ */
+static void mapped_data_block_read(FileData *fd, const void *adr)
+{
+  if (fd->mapped_data_blocks.is_empty()) {
+    return;
+  }
+  const std::optional<MappedDataBlock> block = fd->mapped_data_blocks.pop_try(adr);
+  if (!block) {
+    return;
+  }
+  void *data = read_struct(fd, block->bhead, block->allocname, block->id_type_index);
+  if (data) {
+    oldnewmap_insert(fd->datamap, adr, data, 0);
+  }
+}
+
 /* Only direct data-blocks. */
 static void *newdataadr(FileData *fd, const void *adr)
 {
+  mapped_data_block_read(fd, adr);
   return oldnewmap_lookup_and_inc(fd->datamap, adr, true);
 }
 
 /* Only direct data-blocks. */
 static void *newdataadr_no_us(FileData *fd, const void *adr)
 {
+  mapped_data_block_read(fd, adr);
   return oldnewmap_lookup_and_inc(fd->datamap, adr, false);
 }
 
@@ -1861,6 +2475,13 @@ static void *read_struct(FileData *fd, BHead *bh, const char *blockname, const i
   void *temp = nullptr;
 
   if (bh->len) {
+    BHeadN *bheadn = BHEADN_FROM_BHEAD(bh);
+    if (bheadn->reconstructed_data) {
+      temp = bheadn->reconstructed_data;
+      bheadn->reconstructed_data = nullptr;
+      return temp;
+    }
+
 #ifdef USE_BHEAD_READ_ON_DEMAND
     BHead *bh_orig = bh;
 #endif
@@ -2645,6 +3266,38 @@ static bool direct_link_id(FileData *fd,
   return success;
 }
 
+/* Smaller blocks are always copied, mapping them isn't worth the overhead. */
+#define MAPPED_DATA_BLOCK_MIN_SIZE (64 * 1024)
+
+/**
+ * Whether the block can be referenced directly in the mapped file instead of being copied:
+ * large raw data arrays which need no conversion and are sufficiently aligned in the file.
+ */
+static bool read_data_is_mappable(FileData *fd, const BHead *bhead)
+{
+#ifdef USE_BHEAD_READ_ON_DEMAND
+  if (fd->mapped_file == nullptr) {
+    return false;
+  }
+  if (bhead->SDNAnr != SDNA_RAW_DATA_STRUCT_INDEX || bhead->len < MAPPED_DATA_BLOCK_MIN_SIZE) {
+    return false;
+  }
+  const BHeadN *bheadn = BHEADN_FROM_BHEAD(bhead);
+  if (bheadn->has_data || bheadn->reconstructed_data) {
+    return false;
+  }
+  if (size_t(bheadn->file_offset) + size_t(bhead->len) > BLI_mmap_get_length(fd->mapped_file)) {
+    return false;
+  }
+  const void *data = POINTER_OFFSET(BLI_mmap_get_pointer(fd->mapped_file), bheadn->file_offset);
+  const int alignment = DNA_struct_alignment(fd->filesdna, SDNA_RAW_DATA_STRUCT_INDEX);
+  return (uintptr_t(data) % uintptr_t(alignment)) == 0;
+#else
+  UNUSED_VARS(fd, bhead);
+  return false;
+#endif
+}
+
 /* Read all data associated with a datablock into datamap. */
 static BHead *read_data_into_datamap(FileData *fd,
                                      BHead *bhead,
@@ -2654,6 +3307,18 @@ static BHead *read_data_into_datamap(FileData *fd,
   bhead = blo_bhead_next(fd, bhead);
 
   while (bhead && bhead->code == BLO_CODE_DATA) {
+    if (read_data_is_mappable(fd, bhead)) {
+      /* Delay reading, the block might be referenced in the mapped file by shared data. */
+      if (!fd->mapped_data_blocks.add(bhead->old, {bhead, allocname, id_type_index})) {
+        CLOG_ERROR(&LOG,
+                   "Blendfile corruption: Invalid, or multiple `bhead` with same old address "
+                   "value (%p) for a given ID.",
+                   bhead->old);
+      }
+      bhead = blo_bhead_next(fd, bhead);
+      continue;
+    }
+
     void *data = read_struct(fd, bhead, allocname, id_type_index);
     if (data) {
       const bool is_new = oldnewmap_insert(fd->datamap, bhead->old, data, 0);
@@ -3151,6 +3816,7 @@ static BHead *read_libblock(FileData *fd,
   bhead = read_data_into_datamap(fd, bhead, blockname, id_type_index);
   const bool success = direct_link_id(fd, main, id_tag, id_read_tags, id, id_old);
   oldnewmap_clear(fd->datamap);
+  fd->mapped_data_blocks.clear();
 
   if (!success) {
     /* XXX This is probably working OK currently given the very limited scope of that flag.
@@ -3195,6 +3861,7 @@ BHead *blo_read_asset_data_block(FileData *fd, BHead *bhead, AssetMetaData **r_a
   BKE_asset_metadata_read(&reader, *r_asset_data);
 
   oldnewmap_clear(fd->datamap);
+  fd->mapped_data_blocks.clear();
 
   return bhead;
 }
@@ -3298,6 +3965,8 @@ static void do_versions(FileData *fd, Library *lib, Main *main)
   /* Don't allow versioning to create new data-blocks. */
   main->is_locked_for_linking = true;
 
+  blender::blo::IOStats *io_stats = fd->reports->io_stats;
+
   /* Code ensuring conversion to/from new 'system IDProperties'. This needs to run before any other
    * data versioning. Otherwise, things like Cycles versioning code cannot work as expected. */
   if (!MAIN_VERSION_FILE_ATLEAST(main, 500, 27)) {
@@ -3328,45 +3997,59 @@ static void do_versions(FileData *fd, Library *lib, Main *main)
   }
 
   if (!main->is_read_invalid) {
+    blender::blo::IOPhaseTimer timer(io_stats, "Versioning pre 2.50");
     blo_do_versions_pre250(fd, lib, main);
   }
   if (!main->is_read_invalid) {
+    blender::blo::IOPhaseTimer timer(io_stats, "Versioning 250");
     blo_do_versions_250(fd, lib, main);
   }
   if (!main->is_read_invalid) {
+    blender::blo::IOPhaseTimer timer(io_stats, "Versioning 260");
     blo_do_versions_260(fd, lib, main);
   }
   if (!main->is_read_invalid) {
+    blender::blo::IOPhaseTimer timer(io_stats, "Versioning 270");
     blo_do_versions_270(fd, lib, main);
   }
   if (!main->is_read_invalid) {
+    blender::blo::IOPhaseTimer timer(io_stats, "Versioning 280");
     blo_do_versions_280(fd, lib, main);
   }
   if (!main->is_read_invalid) {
+    blender::blo::IOPhaseTimer timer(io_stats, "Versioning 290");
     blo_do_versions_290(fd, lib, main);
   }
   if (!main->is_read_invalid) {
+    blender::blo::IOPhaseTimer timer(io_stats, "Versioning 300");
     blo_do_versions_300(fd, lib, main);
   }
   if (!main->is_read_invalid) {
+    blender::blo::IOPhaseTimer timer(io_stats, "Versioning 400");
     blo_do_versions_400(fd, lib, main);
   }
   if (!main->is_read_invalid) {
+    blender::blo::IOPhaseTimer timer(io_stats, "Versioning 410");
     blo_do_versions_410(fd, lib, main);
   }
   if (!main->is_read_invalid) {
+    blender::blo::IOPhaseTimer timer(io_stats, "Versioning 420");
     blo_do_versions_420(fd, lib, main);
   }
   if (!main->is_read_invalid) {
+    blender::blo::IOPhaseTimer timer(io_stats, "Versioning 430");
     blo_do_versions_430(fd, lib, main);
   }
   if (!main->is_read_invalid) {
+    blender::blo::IOPhaseTimer timer(io_stats, "Versioning 440");
     blo_do_versions_440(fd, lib, main);
   }
   if (!main->is_read_invalid) {
+    blender::blo::IOPhaseTimer timer(io_stats, "Versioning 450");
     blo_do_versions_450(fd, lib, main);
   }
   if (!main->is_read_invalid) {
+    blender::blo::IOPhaseTimer timer(io_stats, "Versioning 500");
     blo_do_versions_500(fd, lib, main);
   }
 
@@ -3392,43 +4075,58 @@ static void do_versions_after_linking(FileData *fd, Main *main)
   /* Don't allow versioning to create new data-blocks. */
   main->is_locked_for_linking = true;
 
+  blender::blo::IOStats *io_stats = fd->reports->io_stats;
+
   if (!main->is_read_invalid) {
+    blender::blo::IOPhaseTimer timer(io_stats, "Versioning after linking 250");
     do_versions_after_linking_250(main);
   }
   if (!main->is_read_invalid) {
+    blender::blo::IOPhaseTimer timer(io_stats, "Versioning after linking 260");
     do_versions_after_linking_260(main);
   }
   if (!main->is_read_invalid) {
+    blender::blo::IOPhaseTimer timer(io_stats, "Versioning after linking 270");
     do_versions_after_linking_270(main);
   }
   if (!main->is_read_invalid) {
+    blender::blo::IOPhaseTimer timer(io_stats, "Versioning after linking 280");
     do_versions_after_linking_280(fd, main);
   }
   if (!main->is_read_invalid) {
+    blender::blo::IOPhaseTimer timer(io_stats, "Versioning after linking 290");
     do_versions_after_linking_290(fd, main);
   }
   if (!main->is_read_invalid) {
+    blender::blo::IOPhaseTimer timer(io_stats, "Versioning after linking 300");
     do_versions_after_linking_300(fd, main);
   }
   if (!main->is_read_invalid) {
+    blender::blo::IOPhaseTimer timer(io_stats, "Versioning after linking 400");
     do_versions_after_linking_400(fd, main);
   }
   if (!main->is_read_invalid) {
+    blender::blo::IOPhaseTimer timer(io_stats, "Versioning after linking 410");
     do_versions_after_linking_410(fd, main);
   }
   if (!main->is_read_invalid) {
+    blender::blo::IOPhaseTimer timer(io_stats, "Versioning after linking 420");
     do_versions_after_linking_420(fd, main);
   }
   if (!main->is_read_invalid) {
+    blender::blo::IOPhaseTimer timer(io_stats, "Versioning after linking 430");
     do_versions_after_linking_430(fd, main);
   }
   if (!main->is_read_invalid) {
+    blender::blo::IOPhaseTimer timer(io_stats, "Versioning after linking 440");
     do_versions_after_linking_440(fd, main);
   }
   if (!main->is_read_invalid) {
+    blender::blo::IOPhaseTimer timer(io_stats, "Versioning after linking 450");
     do_versions_after_linking_450(fd, main);
   }
   if (!main->is_read_invalid) {
+    blender::blo::IOPhaseTimer timer(io_stats, "Versioning after linking 500");
     do_versions_after_linking_500(fd, main);
   }
 
@@ -3471,6 +4169,7 @@ static int lib_link_cb(LibraryIDLinkCallbackData *cb_data)
 
 static void lib_link_all(FileData *fd, Main *bmain)
 {
+  blender::blo::IOPhaseTimer timer(fd->reports->io_stats, "Lib linking");
   BlendLibReader reader = {fd, bmain};
 
   ID *id;
@@ -3543,6 +4242,7 @@ static void lib_link_all(FileData *fd, Main *bmain)
  */
 static void after_liblink_merged_bmain_process(Main *bmain, BlendFileReadReport *reports)
 {
+  blender::blo::IOPhaseTimer timer(reports->io_stats, "After lib-link processing");
   /* We only expect a merged Main here, not a split one. */
   BLI_assert(!bmain->split_mains);
 
@@ -3678,6 +4378,7 @@ static BHead *read_userdef(BlendFileData *bfd, FileData *fd, BHead *bhead)
 
   /* free fd->datamap again */
   oldnewmap_clear(fd->datamap);
+  fd->mapped_data_blocks.clear();
 
   return bhead;
 }
@@ -3748,6 +4449,120 @@ static void blo_read_file_checks(Main *bmain)
   UNUSED_VARS_NDEBUG(bmain);
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Parallel Struct Reconstruction
+ *
+ * Converting structs from the file DNA to the current DNA (#DNA_struct_reconstruct) is
+ * independent for each block, so it is done ahead of time and in parallel for all the blocks of
+ * the local IDs. #read_struct then only has to take ownership of the result, leaving the serial
+ * part of reading (pointer remapping, lib-linking, versioning) with less work.
+ * \{ */
+
+/**
+ * Limit the amount of block data that is read into memory before being reconstructed, since
+ * blocks read on demand are only kept in memory until their reconstruction is done.
+ */
+static constexpr int64_t RECONSTRUCT_BATCH_SIZE = 64 * 1024 * 1024;
+
+struct BHeadReconstructTask {
+  BHeadN *bheadn;
+  /** Either the block itself or a temporary copy with its data read from the file. */
+  BHead *bhead_data;
+  const char *alloc_name;
+};
+
+static void read_file_structs_reconstruct_batch(FileData *fd,
+                                                blender::MutableSpan<BHeadReconstructTask> tasks)
+{
+  const double time_start = BLI_time_now_seconds();
+  blender::threading::parallel_for(tasks.index_range(), 16, [&](const blender::IndexRange range) {
+    for (BHeadReconstructTask &task : tasks.slice(range)) {
+      const BHead *bh = task.bhead_data;
+      task.bheadn->reconstructed_data = DNA_struct_reconstruct(
+          fd->reconstruct_info, bh->SDNAnr, bh->nr, bh + 1, task.alloc_name);
+    }
+  });
+  for (BHeadReconstructTask &task : tasks) {
+    if (task.bhead_data != &task.bheadn->bhead) {
+      MEM_freeN(BHEADN_FROM_BHEAD(task.bhead_data));
+    }
+  }
+  fd->reports->duration.struct_reconstruct += BLI_time_now_seconds() - time_start;
+}
+
+/**
+ * Read all remaining #BHead of the file, and reconstruct the ID structs and their data blocks
+ * which DNA does not match the current one.
+ */
+static void read_file_structs_reconstruct_parallel(FileData *fd)
+{
+  BLI_assert((fd->flags & FD_FLAGS_IS_MEMFILE) == 0);
+
+  const blender::Span<char> compflags(fd->compflags, fd->filesdna->structs_num);
+  if (!compflags.contains(SDNA_CMP_NOT_EQUAL)) {
+    /* Still index all the blocks in one go. */
+    BHead *bhead = blo_bhead_first(fd);
+    while (bhead) {
+      bhead = blo_bhead_next(fd, bhead);
+    }
+    return;
+  }
+
+  blender::Vector<BHeadReconstructTask> tasks;
+  int64_t batch_size = 0;
+  int id_type_index = INDEX_ID_NULL;
+  bool is_id_data = false;
+
+  for (BHead *bhead = blo_bhead_first(fd); bhead; bhead = blo_bhead_next(fd, bhead)) {
+    if (bhead->code == BLO_CODE_ENDB) {
+      break;
+    }
+    if (bhead->code == BLO_CODE_DATA) {
+      if (!is_id_data) {
+        continue;
+      }
+    }
+    else if (blo_bhead_is_id_valid_type(bhead) || bhead->code == ID_SCRN) {
+      /* Only data of IDs is handled, other blocks are read with specific allocation names. */
+      is_id_data = bhead->code != ID_LINK_PLACEHOLDER;
+      id_type_index = BKE_idtype_idcode_to_index(bhead->code == ID_SCRN ? ID_SCR : bhead->code);
+    }
+    else {
+      is_id_data = false;
+      continue;
+    }
+
+    if (bhead->len == 0 || fd->compflags[bhead->SDNAnr] != SDNA_CMP_NOT_EQUAL) {
+      continue;
+    }
+
+    BHead *bhead_data = bhead;
+#ifdef USE_BHEAD_READ_ON_DEMAND
+    if (!BHEADN_FROM_BHEAD(bhead)->has_data) {
+      bhead_data = blo_bhead_read_full(fd, bhead);
+      if (UNLIKELY(bhead_data == nullptr)) {
+        /* Let the regular reading code handle the error. */
+        continue;
+      }
+    }
+#endif
+    /* Must match the allocation name used by #read_libblock and #read_data_into_datamap. */
+    const char *alloc_name = get_alloc_name(fd, bhead, nullptr, id_type_index);
+    tasks.append({BHEADN_FROM_BHEAD(bhead), bhead_data, alloc_name});
+
+    batch_size += bhead->len;
+    if (batch_size >= RECONSTRUCT_BATCH_SIZE) {
+      read_file_structs_reconstruct_batch(fd, tasks);
+      tasks.clear();
+      batch_size = 0;
+    }
+  }
+
+  read_file_structs_reconstruct_batch(fd, tasks);
+}
+
+/** \} */
+
 BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
 {
   BHead *bhead = blo_bhead_first(fd);
@@ -3812,6 +4627,20 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
     read_undo_reuse_noundo_local_ids(fd);
   }
 
+  if (!is_undo && (fd->skip_flags & BLO_READ_SKIP_DATA) == 0) {
+    const double time_start = BLI_time_now_seconds();
+    fd->reports->duration.struct_reconstruct = 0.0;
+    {
+      blender::blo::IOPhaseTimer timer(fd->reports->io_stats, "Struct reconstruction");
+      read_file_structs_reconstruct_parallel(fd);
+    }
+    fd->reports->duration.bhead_index = BLI_time_now_seconds() - time_start -
+                                        fd->reports->duration.struct_reconstruct;
+  }
+
+  fd->reports->duration.read_ids = BLI_time_now_seconds();
+  blender::blo::IOStats *io_stats = fd->reports->io_stats;
+  const int64_t read_ids_memory = io_stats ? int64_t(MEM_get_memory_in_use()) : 0;
   while (bhead) {
     switch (bhead->code) {
       case BLO_CODE_DATA:
@@ -3874,9 +4703,16 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
     }
 
     if (bfd->main->is_read_invalid) {
+      fd->reports->duration.read_ids = BLI_time_now_seconds() - fd->reports->duration.read_ids;
       return bfd;
     }
   }
+  fd->reports->duration.read_ids = BLI_time_now_seconds() - fd->reports->duration.read_ids;
+  if (io_stats) {
+    io_stats->add("Reading data-blocks",
+                  fd->reports->duration.read_ids,
+                  int64_t(MEM_get_memory_in_use()) - read_ids_memory);
+  }
 
   if (is_undo) {
     /* Move the remaining Library IDs and their linked data to the new main.
@@ -3940,7 +4776,10 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
   /* Do versioning before read_libraries, but skip in undo case. */
   if (!is_undo) {
     if ((fd->skip_flags & BLO_READ_SKIP_DATA) == 0) {
+      fd->reports->duration.versioning = BLI_time_now_seconds();
       do_versions(fd, nullptr, bfd->main);
+      fd->reports->duration.versioning = BLI_time_now_seconds() -
+                                         fd->reports->duration.versioning;
     }
 
     if ((fd->skip_flags & BLO_READ_SKIP_USERDEF) == 0) {
@@ -5006,7 +5845,8 @@ static FileData *read_library_file_data(FileData *basefd, Main *bmain, Main *lib
                      lib_bmain->curlib->runtime->filepath_abs,
                      lib_bmain->curlib->filepath,
                      library_parent_filepath(lib_bmain->curlib));
-    fd = blo_filedata_from_file(lib_bmain->curlib->runtime->filepath_abs, basefd->reports);
+    fd = blo_filedata_from_library_file(lib_bmain->curlib->runtime->filepath_abs,
+                                        basefd->reports);
   }
 
   if (fd) {
@@ -5054,6 +5894,7 @@ static FileData *read_library_file_data(FileData *basefd, Main *bmain, Main *lib
 
 static void read_libraries(FileData *basefd)
 {
+  blender::blo::IOPhaseTimer timer(basefd->reports->io_stats, "Reading libraries");
   Main *bmain = basefd->bmain;
   BLI_assert(bmain->split_mains);
   bool do_it = true;
@@ -5393,9 +6234,43 @@ void BLO_read_pointer_array(BlendDataReader *reader, const int64_t array_size, v
   *ptr_p = final_array;
 }
 
+/**
+ * Get the address of a block in the mapped file, if it was skipped by #read_data_into_datamap.
+ * The block is removed from the delayed blocks, it is either referenced or read now. Blocks that
+ * are smaller than expected are left to the regular reading code, which reports the corruption.
+ */
+static const void *mapped_data_block_pop(FileData *fd,
+                                         const void *adr,
+                                         const size_t expected_size)
+{
+#ifdef USE_BHEAD_READ_ON_DEMAND
+  if (fd->mapped_data_blocks.is_empty()) {
+    return nullptr;
+  }
+  if (BLI_mmap_any_io_error(fd->mapped_file)) {
+    /* Let the regular reading code handle the error. */
+    return nullptr;
+  }
+  const MappedDataBlock *block = fd->mapped_data_blocks.lookup_ptr(adr);
+  if (!block) {
+    return nullptr;
+  }
+  if (expected_size == 0 || size_t(block->bhead->len) < expected_size) {
+    return nullptr;
+  }
+  const BHeadN *bheadn = BHEADN_FROM_BHEAD(block->bhead);
+  fd->mapped_data_blocks.remove_contained(adr);
+  return POINTER_OFFSET(BLI_mmap_get_pointer(fd->mapped_file), bheadn->file_offset);
+#else
+  UNUSED_VARS(fd, adr, expected_size);
+  return nullptr;
+#endif
+}
+
 blender::ImplicitSharingInfoAndData blo_read_shared_impl(
     BlendDataReader *reader,
     const void **ptr_p,
+    const size_t expected_size,
     const blender::FunctionRef<const blender::ImplicitSharingInfo *()> read_fn)
 {
   const void *old_address = *ptr_p;
@@ -5427,6 +6302,17 @@ blender::ImplicitSharingInfoAndData blo_read_shared_impl(
     return *shared_data;
   }
 
+  if (const void *mapped_data = mapped_data_block_pop(reader->fd, old_address, expected_size)) {
+    /* Reference the array in the mapped file instead of copying it. When the array is modified
+     * after it became mutable, only the touched pages are copied, see
+     * #BLI_mmap_open_copy_on_write. */
+    const blender::ImplicitSharingInfo *sharing_info = blender::implicit_sharing::info_for_mmap(
+        reader->fd->mapped_file);
+    const blender::ImplicitSharingInfoAndData shared_data{sharing_info, mapped_data};
+    reader->shared_data_by_stored_address.add(old_address, shared_data);
+    return shared_data;
+  }
+
   /* This is the first time this data is loaded. The callback also creates the corresponding
    * sharing info which may be reused later. */
   const blender::ImplicitSharingInfo *sharing_info = read_fn();
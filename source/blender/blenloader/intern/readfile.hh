@@ -32,6 +32,7 @@ struct BlendFileReadParams;
 struct BlendFileReadReport;
 struct BLOCacheStorage;
 struct BHeadSort;
+struct BLI_mmap_file;
 struct DNA_ReconstructInfo;
 struct IDNameLib_Map;
 struct Key;
@@ -63,6 +64,17 @@ enum eFileDataFlag {
 };
 ENUM_OPERATORS(eFileDataFlag, FD_FLAGS_IS_MEMFILE)
 
+/**
+ * A raw data block that is referenced directly in the memory-mapped file instead of being read
+ * into #FileData.datamap, see #FileData.mapped_data_blocks.
+ */
+struct MappedDataBlock {
+  BHead *bhead;
+  /** Used when the block has to be copied after all, see #read_struct. */
+  const char *allocname;
+  int id_type_index;
+};
+
 /* Disallow since it's 32bit on ms-windows. */
 #ifdef __GNUC__
 #  pragma GCC poison off_t
@@ -136,6 +148,18 @@ struct FileData {
   OldNewMap *datamap = nullptr;
   OldNewMap *globmap = nullptr;
 
+  /**
+   * The memory-mapped file, when large arrays may be referenced directly from it instead of being
+   * copied (see the `use_mapped_file_data` experimental option). Owned by #file.
+   */
+  BLI_mmap_file *mapped_file = nullptr;
+  /**
+   * Raw data blocks of the data-block currently being read that were not copied into #datamap.
+   * Shared arrays reference the mapped memory directly, other accesses copy the block on demand.
+   * Cleared together with #datamap.
+   */
+  blender::Map<const void *, MappedDataBlock> mapped_data_blocks;
+
   /**
    * Store mapping from old ID pointers (the values they have in the .blend file) to new ones,
    * typically from value in `bhead->old` to address in memory where the ID was read.
@@ -201,6 +225,30 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath) ATTR_N
  * cannot be called with relative paths anymore!
  */
 FileData *blo_filedata_from_file(const char *filepath, BlendFileReadReport *reports);
+/**
+ * Same as #blo_filedata_from_file, for files that are only partially read (e.g. libraries). The
+ * block list is reused from an index in the user cache directory when possible, see
+ * `Library Block Index` in `readfile.cc`.
+ */
+FileData *blo_filedata_from_library_file(const char *filepath, BlendFileReadReport *reports);
+/**
+ * Same as #blo_filedata_from_library_file with an explicit index file, which is never written.
+ * \param r_index_outdated: Set when the index is missing or doesn't match the library file.
+ */
+FileData *blo_filedata_from_library_file_with_index(const char *filepath,
+                                                    const char *index_filepath,
+                                                    BlendFileReadReport *reports,
+                                                    bool *r_index_outdated);
+/**
+ * Write the block index of the library file at \a filepath.
+ * \return False when the file can't be indexed, e.g. because it is too small or not seekable.
+ */
+bool blo_library_index_write(const char *filepath, const char *index_filepath);
+/**
+ * Delete the least recently used index files in \a dirpath, until all of them take up at most
+ * \a max_size bytes.
+ */
+void blo_library_index_dir_trim(const char *dirpath, int64_t max_size);
 FileData *blo_filedata_from_memory(const void *mem, int memsize, BlendFileReadReport *reports);
 FileData *blo_filedata_from_memfile(MemFile *memfile,
                                     const BlendFileReadParams *params,
@@ -6,10 +6,15 @@
  * \ingroup blenloader
  */
 
+#include <atomic>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <fcntl.h>
+#include <mutex>
+
+#include <xxhash.h>
+#include <zstd.h>
 
 /* open/close */
 #ifndef _WIN32
@@ -18,11 +23,15 @@
 #  include <io.h>
 #endif
 
+#include "CLG_log.h"
+
 #include "MEM_guardedalloc.h"
 
 #include "DNA_listBase.h"
 
 #include "BLI_implicit_sharing.hh"
+#include "BLI_task.h"
+#include "BLI_vector.hh"
 
 #include "BLO_readfile.hh"
 #include "BLO_undofile.hh"
@@ -33,15 +42,349 @@
 
 #include "BLI_strict_flags.h" /* IWYU pragma: keep. Keep last. */
 
+static CLG_LogRef LOG = {"undo.memfile"};
+
+/* -------------------------------------------------------------------- */
+/** \name Chunk Store
+ *
+ * The content of the chunks of all undo steps is stored only once, in a global store where it is
+ * looked up by a hash of the content. This way identical chunks are shared even when they are
+ * written in a different order or at a different address than in the previous step.
+ *
+ * Chunks that are not used by the most recent undo step anymore are compressed in the
+ * background, and decompressed again when they are accessed. The memory actually used by the data
+ * is accounted to the #MemFile that added it to the store (see #MemFile.size).
+ * \{ */
+
+/** Compressing smaller chunks is not worth the overhead. */
+#define MEMFILE_CHUNK_COMPRESS_MIN_SIZE 4096
+/** Favor speed, compression runs after each undo push. */
+#define MEMFILE_CHUNK_COMPRESS_LEVEL 1
+
+struct MemFileChunkData {
+  /** Number of chunks (and pending compression tasks) using the data. Protected by the store. */
+  int users;
+  uint64_t hash;
+  /** Size of the uncompressed data. */
+  size_t size;
+  /** The last write (see #MemFileChunkStore.generation) that used the data, main thread only. */
+  uint64_t last_used_generation;
+  /**
+   * The memfile whose size includes the stored size of this data, null when it was freed.
+   * Protected by the store.
+   */
+  MemFile *owner;
+
+  /** Protects the members below. */
+  std::mutex mutex;
+  /** Uncompressed data, null while the data is compressed. */
+  char *buf;
+  char *compressed_buf;
+  size_t compressed_size;
+  bool compress_scheduled;
+};
+
+struct MemFileChunkStore {
+  std::mutex mutex;
+  /** All data in use, hash collisions between different contents are possible. */
+  blender::Map<uint64_t, blender::Vector<MemFileChunkData *, 1>> data_by_hash;
+  /** Incremented for every written #MemFile. */
+  uint64_t generation = 0;
+  /** Background compression of data that isn't used by the most recent undo step. */
+  TaskPool *compress_pool = nullptr;
+
+  std::atomic<int64_t> chunks_num = 0;
+  std::atomic<int64_t> compressed_chunks_num = 0;
+  std::atomic<size_t> data_size = 0;
+  std::atomic<size_t> stored_size = 0;
+};
+
+static MemFileChunkStore &chunk_store()
+{
+  static MemFileChunkStore store;
+  return store;
+}
+
+/** Size of the data as it is currently stored. Caller must hold the lock of `data`. */
+static size_t chunk_data_stored_size(const MemFileChunkData *data)
+{
+  return data->buf ? data->size : data->compressed_size;
+}
+
+/** Caller must hold the lock of the store and of `data`. */
+static void chunk_data_decompress(MemFileChunkData *data)
+{
+  BLI_assert(data->buf == nullptr);
+  char *buf = MEM_malloc_arrayN<char>(data->size, "Chunk buffer");
+  const size_t result = ZSTD_decompress(
+      buf, data->size, data->compressed_buf, data->compressed_size);
+  /* Only possible with memory corruption, the data was compressed by us. */
+  BLI_assert(result == data->size);
+  UNUSED_VARS_NDEBUG(result);
+
+  MemFileChunkStore &store = chunk_store();
+  store.stored_size += data->size;
+  store.stored_size -= data->compressed_size;
+  store.compressed_chunks_num--;
+  if (data->owner) {
+    data->owner->size += data->size - data->compressed_size;
+  }
+
+  MEM_freeN(data->compressed_buf);
+  data->compressed_buf = nullptr;
+  data->compressed_size = 0;
+  data->buf = buf;
+}
+
+/**
+ * Lock the data for reading, decompressing it if necessary.
+ * \param store_is_locked: Whether the caller holds the store lock, which is needed to decompress.
+ * \return The uncompressed data, valid until the lock is released.
+ */
+static const char *chunk_data_lock(MemFileChunkData *data,
+                                   std::unique_lock<std::mutex> &lock,
+                                   const bool store_is_locked)
+{
+  lock = std::unique_lock{data->mutex};
+  if (data->buf == nullptr) {
+    if (store_is_locked) {
+      chunk_data_decompress(data);
+    }
+    else {
+      /* The store is always locked first. */
+      lock.unlock();
+      std::lock_guard store_lock{chunk_store().mutex};
+      lock.lock();
+      if (data->buf == nullptr) {
+        chunk_data_decompress(data);
+      }
+    }
+  }
+  return data->buf;
+}
+
+/** Caller must hold the store lock. */
+static void chunk_data_remove_user_locked(MemFileChunkStore &store, MemFileChunkData *data)
+{
+  BLI_assert(data->users > 0);
+  data->users--;
+  if (data->users > 0) {
+    return;
+  }
+
+  blender::Vector<MemFileChunkData *, 1> &candidates = store.data_by_hash.lookup(data->hash);
+  candidates.remove_first_occurrence_and_reorder(data);
+  if (candidates.is_empty()) {
+    store.data_by_hash.remove(data->hash);
+  }
+
+  store.chunks_num--;
+  store.data_size -= data->size;
+  if (data->buf) {
+    store.stored_size -= data->size;
+    MEM_freeN(data->buf);
+  }
+  else {
+    store.stored_size -= data->compressed_size;
+    store.compressed_chunks_num--;
+    MEM_freeN(data->compressed_buf);
+  }
+  MEM_delete(data);
+
+  if (store.data_by_hash.is_empty()) {
+    /* Don't keep memory around when there are no undo steps left (e.g. on exit). */
+    store.data_by_hash.clear();
+  }
+}
+
+static void chunk_data_add_user(MemFileChunkData *data)
+{
+  MemFileChunkStore &store = chunk_store();
+  std::lock_guard lock{store.mutex};
+  data->users++;
+}
+
+static void chunk_data_remove_user(MemFileChunkData *data)
+{
+  MemFileChunkStore &store = chunk_store();
+  std::lock_guard lock{store.mutex};
+  chunk_data_remove_user_locked(store, data);
+}
+
+/**
+ * Get the stored data with the given content, adding a user to it. New data is accounted to the
+ * given memfile.
+ */
+static MemFileChunkData *chunk_store_add(MemFile *memfile, const char *buf, const size_t size)
+{
+  MemFileChunkStore &store = chunk_store();
+  const uint64_t hash = XXH3_64bits(buf, size);
+
+  std::lock_guard lock{store.mutex};
+  blender::Vector<MemFileChunkData *, 1> &candidates = store.data_by_hash.lookup_or_add_default(
+      hash);
+  for (MemFileChunkData *data : candidates) {
+    if (data->size != size) {
+      continue;
+    }
+    std::unique_lock<std::mutex> data_lock;
+    if (memcmp(chunk_data_lock(data, data_lock, true), buf, size) == 0) {
+      data->users++;
+      return data;
+    }
+  }
+
+  MemFileChunkData *data = MEM_new<MemFileChunkData>("MemFileChunkData");
+  data->users = 1;
+  data->hash = hash;
+  data->size = size;
+  data->last_used_generation = store.generation;
+  data->owner = memfile;
+  data->buf = MEM_malloc_arrayN<char>(size, "Chunk buffer");
+  memcpy(data->buf, buf, size);
+  data->compressed_buf = nullptr;
+  data->compressed_size = 0;
+  data->compress_scheduled = false;
+  candidates.append(data);
+
+  store.chunks_num++;
+  store.data_size += size;
+  store.stored_size += size;
+  memfile->size += size;
+
+  return data;
+}
+
+static void chunk_data_compress_task(TaskPool *__restrict /*pool*/, void *taskdata)
+{
+  MemFileChunkData *data = static_cast<MemFileChunkData *>(taskdata);
+  MemFileChunkStore &store = chunk_store();
+
+  /* The uncompressed buffer can only be freed by this task while it is scheduled, so it can be
+   * compressed without holding the lock, other threads only read it in the meantime. */
+  const char *buf;
+  {
+    std::lock_guard store_lock{store.mutex};
+    std::lock_guard lock{data->mutex};
+    /* Don't bother when all undo steps using the data have been freed in the meantime. */
+    buf = data->users > 1 ? data->buf : nullptr;
+  }
+
+  if (buf != nullptr) {
+    const size_t bound = ZSTD_compressBound(data->size);
+    char *compressed_buf = MEM_malloc_arrayN<char>(bound, "Chunk compressed buffer");
+    const size_t compressed_size = ZSTD_compress(
+        compressed_buf, bound, buf, data->size, MEMFILE_CHUNK_COMPRESS_LEVEL);
+
+    if (ZSTD_isError(compressed_size) || compressed_size >= data->size) {
+      MEM_freeN(compressed_buf);
+    }
+    else {
+      compressed_buf = static_cast<char *>(MEM_reallocN(compressed_buf, compressed_size));
+
+      std::lock_guard store_lock{store.mutex};
+      std::lock_guard lock{data->mutex};
+      BLI_assert(data->buf == buf);
+      MEM_freeN(data->buf);
+      data->buf = nullptr;
+      data->compressed_buf = compressed_buf;
+      data->compressed_size = compressed_size;
+
+      store.stored_size -= data->size;
+      store.stored_size += compressed_size;
+      store.compressed_chunks_num++;
+      if (data->owner) {
+        data->owner->size -= data->size - compressed_size;
+      }
+    }
+  }
+
+  {
+    std::lock_guard lock{data->mutex};
+    data->compress_scheduled = false;
+  }
+  chunk_data_remove_user(data);
+}
+
+/**
+ * Compress the data of chunks in `memfile` which were not used by the last write in the
+ * background.
+ */
+static void chunk_store_compress_unused(MemFile *memfile)
+{
+  MemFileChunkStore &store = chunk_store();
+
+  LISTBASE_FOREACH (MemFileChunk *, chunk, &memfile->chunks) {
+    MemFileChunkData *data = chunk->data;
+    if (data->last_used_generation == store.generation ||
+        data->size < MEMFILE_CHUNK_COMPRESS_MIN_SIZE)
+    {
+      continue;
+    }
+    {
+      std::lock_guard lock{data->mutex};
+      if (data->buf == nullptr || data->compress_scheduled) {
+        continue;
+      }
+      data->compress_scheduled = true;
+    }
+
+    if (store.compress_pool == nullptr) {
+      store.compress_pool = BLI_task_pool_create_background(nullptr, TASK_PRIORITY_LOW);
+    }
+    /* The task keeps the data alive, even if the undo step is freed in the meantime. */
+    chunk_data_add_user(data);
+    BLI_task_pool_push(store.compress_pool, chunk_data_compress_task, data, false, nullptr);
+  }
+}
+
+void BLO_memfile_chunk_store_exit()
+{
+  MemFileChunkStore &store = chunk_store();
+  if (store.compress_pool == nullptr) {
+    return;
+  }
+  /* Tasks for data that isn't used anymore finish immediately. */
+  BLI_task_pool_work_and_wait(store.compress_pool);
+  BLI_task_pool_free(store.compress_pool);
+  store.compress_pool = nullptr;
+}
+
+MemFileChunkStoreStats BLO_memfile_chunk_store_stats()
+{
+  const MemFileChunkStore &store = chunk_store();
+  MemFileChunkStoreStats stats;
+  stats.chunks_num = store.chunks_num;
+  stats.compressed_chunks_num = store.compressed_chunks_num;
+  stats.data_size = store.data_size;
+  stats.stored_size = store.stored_size;
+  return stats;
+}
+
+/** \} */
+
 /* **************** support for memory-write, for undo buffers *************** */
 
+size_t BLO_memfile_size(const MemFile *memfile)
+{
+  /* The size changes when data is compressed in the background. */
+  std::lock_guard lock{chunk_store().mutex};
+  return memfile->size;
+}
+
 void BLO_memfile_free(MemFile *memfile)
 {
-  while (MemFileChunk *chunk = static_cast<MemFileChunk *>(BLI_pophead(&memfile->chunks))) {
-    if (chunk->is_identical == false) {
-      MEM_freeN(chunk->buf);
+  /* Pending compression tasks keep their data alive, so there is no need to wait for them. */
+  {
+    MemFileChunkStore &store = chunk_store();
+    std::lock_guard lock{store.mutex};
+    while (MemFileChunk *chunk = static_cast<MemFileChunk *>(BLI_pophead(&memfile->chunks))) {
+      if (chunk->data->owner == memfile) {
+        chunk->data->owner = nullptr;
+      }
+      chunk_data_remove_user_locked(store, chunk->data);
+      MEM_freeN(chunk);
     }
-    MEM_freeN(chunk);
   }
   MEM_delete(memfile->shared_storage);
   memfile->shared_storage = nullptr;
@@ -58,29 +401,42 @@ MemFileSharedStorage::~MemFileSharedStorage()
 
 void BLO_memfile_merge(MemFile *first, MemFile *second)
 {
-  /* We use this mapping to store the memory buffers from second memfile chunks which are not owned
-   * by it (i.e. shared with some previous memory steps). */
-  blender::Map<const char *, MemFileChunk *> buffer_to_second_memchunk;
+  /* We use this mapping to store the data from second memfile chunks which are identical to the
+   * ones in the first memfile. */
+  blender::Map<const MemFileChunkData *, MemFileChunk *> data_to_second_memchunk;
 
-  /* First, detect all memchunks in second memfile that are not owned by it. */
+  /* First, detect all memchunks in second memfile that are identical to the previous step. */
   LISTBASE_FOREACH (MemFileChunk *, sc, &second->chunks) {
     if (sc->is_identical) {
-      buffer_to_second_memchunk.add(sc->buf, sc);
+      data_to_second_memchunk.add(sc->data, sc);
     }
   }
 
-  /* Now, check all chunks from first memfile (the one we are removing), and if a memchunk owned by
-   * it is also used by the second memfile, transfer the ownership. */
+  /* Now, check all chunks from first memfile (the one we are removing), and if a memchunk that
+   * changed in it is also used by the second memfile, the second memfile is now the one where it
+   * changed. The data itself is kept alive by its users in the store. */
   LISTBASE_FOREACH (MemFileChunk *, fc, &first->chunks) {
     if (!fc->is_identical) {
-      if (MemFileChunk *sc = buffer_to_second_memchunk.lookup_default(fc->buf, nullptr)) {
+      if (MemFileChunk *sc = data_to_second_memchunk.lookup_default(fc->data, nullptr)) {
         BLI_assert(sc->is_identical);
         sc->is_identical = false;
         fc->is_identical = true;
       }
-      /* Note that if the second memfile does not use that chunk, we assume that the first one
-       * fully owns it without sharing it with any other memfile, and hence it should be freed with
-       * it. */
+    }
+  }
+
+  /* Data added by the first memfile that is still used is accounted to the second one now. */
+  {
+    std::lock_guard lock{chunk_store().mutex};
+    LISTBASE_FOREACH (MemFileChunk *, sc, &second->chunks) {
+      MemFileChunkData *data = sc->data;
+      if (data->owner == first) {
+        std::lock_guard data_lock{data->mutex};
+        const size_t stored_size = chunk_data_stored_size(data);
+        data->owner = second;
+        first->size -= stored_size;
+        second->size += stored_size;
+      }
     }
   }
 
@@ -100,6 +456,7 @@ void BLO_memfile_write_init(MemFileWriteData *mem_data,
 {
   mem_data->written_memfile = written_memfile;
   mem_data->reference_memfile = reference_memfile;
+  chunk_store().generation++;
   mem_data->reference_current_chunk = reference_memfile ? static_cast<MemFileChunk *>(
                                                               reference_memfile->chunks.first) :
                                                           nullptr;
@@ -123,6 +480,19 @@ void BLO_memfile_write_init(MemFileWriteData *mem_data,
 void BLO_memfile_write_finalize(MemFileWriteData *mem_data)
 {
   mem_data->id_session_uid_mapping.clear();
+
+  /* Data that only older undo steps use is unlikely to be accessed again soon. */
+  if (mem_data->reference_memfile != nullptr) {
+    chunk_store_compress_unused(mem_data->reference_memfile);
+  }
+
+  const MemFileChunkStoreStats stats = BLO_memfile_chunk_store_stats();
+  CLOG_DEBUG(&LOG,
+             "Chunk store: %lld chunks (%lld compressed), %zu bytes stored for %zu bytes of data",
+             (long long int)stats.chunks_num,
+             (long long int)stats.compressed_chunks_num,
+             stats.stored_size,
+             stats.data_size);
 }
 
 void BLO_memfile_chunk_add(MemFileWriteData *mem_data, const char *buf, size_t size)
@@ -132,7 +502,7 @@ void BLO_memfile_chunk_add(MemFileWriteData *mem_data, const char *buf, size_t s
 
   MemFileChunk *curchunk = MEM_mallocN<MemFileChunk>("MemFileChunk");
   curchunk->size = size;
-  curchunk->buf = nullptr;
+  curchunk->data = nullptr;
   curchunk->is_identical = false;
   /* This is unsafe in the sense that an app handler or other code that does not
    * perform an undo push may make changes after the last undo push that
@@ -145,8 +515,16 @@ void BLO_memfile_chunk_add(MemFileWriteData *mem_data, const char *buf, size_t s
   if (*compchunk_step != nullptr) {
     MemFileChunk *compchunk = *compchunk_step;
     if (compchunk->size == curchunk->size) {
-      if (memcmp(compchunk->buf, buf, size) == 0) {
-        curchunk->buf = compchunk->buf;
+      /* Fast path for the common case of unchanged data, without hashing. */
+      bool is_identical;
+      {
+        std::unique_lock<std::mutex> data_lock;
+        const char *compchunk_buf = chunk_data_lock(compchunk->data, data_lock, false);
+        is_identical = memcmp(compchunk_buf, buf, size) == 0;
+      }
+      if (is_identical) {
+        chunk_data_add_user(compchunk->data);
+        curchunk->data = compchunk->data;
         curchunk->is_identical = true;
         compchunk->is_identical_future = true;
       }
@@ -155,12 +533,12 @@ void BLO_memfile_chunk_add(MemFileWriteData *mem_data, const char *buf, size_t s
   }
 
   /* not equal... */
-  if (curchunk->buf == nullptr) {
-    char *buf_new = MEM_malloc_arrayN<char>(size, "Chunk buffer");
-    memcpy(buf_new, buf, size);
-    curchunk->buf = buf_new;
-    memfile->size += size;
+  if (curchunk->data == nullptr) {
+    /* The same data may still be stored already, e.g. for re-ordered or re-allocated data, or
+     * from an older undo step. */
+    curchunk->data = chunk_store_add(memfile, buf, size);
   }
+  curchunk->data->last_used_generation = chunk_store().generation;
 }
 
 Main *BLO_memfile_main_get(MemFile *memfile, Main *bmain, Scene **r_scene)
@@ -238,7 +616,11 @@ static int64_t undo_read(FileReader *reader, void *buffer, size_t size)
         readsize = chunk->size - chunkoffset;
       }
 
-      memcpy(POINTER_OFFSET(buffer, totread), chunk->buf + chunkoffset, readsize);
+      {
+        std::unique_lock<std::mutex> data_lock;
+        const char *chunk_buf = chunk_data_lock(chunk->data, data_lock, false);
+        memcpy(POINTER_OFFSET(buffer, totread), chunk_buf + chunkoffset, readsize);
+      }
       totread += readsize;
       undo->reader.offset += (off64_t)readsize;
       seek += readsize;
@@ -101,6 +101,8 @@
 #include "BLI_set.hh"
 #include "BLI_string.h"
 #include "BLI_threads.h"
+#include "BLI_time.h"
+#include "BLI_vector.hh"
 
 #include "MEM_guardedalloc.h" /* MEM_freeN */
 
@@ -126,6 +128,7 @@
 #include "DRW_engine.hh"
 
 #include "BLO_blend_validate.hh"
+#include "BLO_io_stats.hh"
 #include "BLO_read_write.hh"
 #include "BLO_readfile.hh"
 #include "BLO_undofile.hh"
@@ -174,9 +177,21 @@ struct ZstdFrame {
 
 class WriteWrap {
  public:
+  virtual ~WriteWrap() = default;
+
   virtual bool open(const char *filepath) = 0;
   virtual bool close() = 0;
   virtual bool write(const void *buf, size_t buf_len) = 0;
+  /**
+   * Keep a reference to implicitly shared data instead of writing it immediately.
+   * \return False when not supported, the data has to be written with #write then.
+   */
+  virtual bool write_shared(const void * /*buf*/,
+                            size_t /*buf_len*/,
+                            const blender::ImplicitSharingInfo * /*sharing_info*/)
+  {
+    return false;
+  }
 
   /** Buffer output (we only want when output isn't already buffered). */
   bool use_buf = true;
@@ -228,8 +243,15 @@ class ZstdWriteWrap : public WriteWrap {
 
   bool write_error = false;
 
+  /** Optional, the time spent compressing frames is summed up in #compress_duration. */
+  blender::blo::IOStats *io_stats = nullptr;
+  double compress_duration = 0.0;
+
  public:
-  ZstdWriteWrap(WriteWrap &base_wrap) : base_wrap(base_wrap) {}
+  ZstdWriteWrap(WriteWrap &base_wrap, blender::blo::IOStats *io_stats = nullptr)
+      : base_wrap(base_wrap), io_stats(io_stats)
+  {
+  }
 
   bool open(const char *filepath) override;
   bool close() override;
@@ -259,15 +281,19 @@ struct ZstdWriteWrap::ZstdWriteBlockTask {
 
 void ZstdWriteWrap::write_task(ZstdWriteBlockTask *task)
 {
+  const double time_start = io_stats ? BLI_time_now_seconds() : 0.0;
   size_t out_buf_len = ZSTD_compressBound(task->size);
   void *out_buf = MEM_mallocN(out_buf_len, "Zstd out buffer");
   size_t out_size = ZSTD_compress(
       out_buf, out_buf_len, task->data, task->size, ZSTD_COMPRESSION_LEVEL);
+  const double duration = io_stats ? BLI_time_now_seconds() - time_start : 0.0;
 
   MEM_freeN(task->data);
 
   BLI_mutex_lock(&mutex);
 
+  compress_duration += duration;
+
   while (next_frame != task->frame_number) {
     BLI_condition_wait(&condition, &mutex);
   }
@@ -362,6 +388,11 @@ bool ZstdWriteWrap::close()
   write_seekable_frames();
   BLI_freelistN(&frames);
 
+  if (io_stats) {
+    /* Summed over all threads, so this can be larger than the time of the whole write. */
+    io_stats->add("Compression (all threads)", compress_duration, 0, num_frames);
+  }
+
   return base_wrap.close() && !write_error;
 }
 
@@ -401,6 +432,70 @@ bool ZstdWriteWrap::write(const void *buf, const size_t buf_len)
   return true;
 }
 
+/**
+ * Keeps everything that is written in memory, to be written to an actual file later, see
+ * #BLO_write_snapshot. Implicitly shared data is referenced instead of being copied.
+ */
+class SnapshotWriteWrap : public WriteWrap {
+ public:
+  struct Segment {
+    const void *data;
+    size_t size;
+    /** When null, the data is owned by the segment. */
+    const blender::ImplicitSharingInfo *sharing_info;
+  };
+  blender::Vector<Segment> segments;
+  /** Size of all segments in bytes. */
+  size_t size = 0;
+
+  ~SnapshotWriteWrap() override;
+
+  bool open(const char * /*filepath*/) override
+  {
+    return true;
+  }
+  bool close() override
+  {
+    return true;
+  }
+  bool write(const void *buf, size_t buf_len) override;
+  bool write_shared(const void *buf,
+                    size_t buf_len,
+                    const blender::ImplicitSharingInfo *sharing_info) override;
+};
+
+SnapshotWriteWrap::~SnapshotWriteWrap()
+{
+  for (const Segment &segment : segments) {
+    if (segment.sharing_info) {
+      segment.sharing_info->remove_user_and_delete_if_last();
+    }
+    else {
+      MEM_freeN(const_cast<void *>(segment.data));
+    }
+  }
+}
+
+bool SnapshotWriteWrap::write(const void *buf, const size_t buf_len)
+{
+  void *data = MEM_mallocN(buf_len, __func__);
+  memcpy(data, buf, buf_len);
+  segments.append({data, buf_len, nullptr});
+  size += buf_len;
+  return true;
+}
+
+bool SnapshotWriteWrap::write_shared(const void *buf,
+                                     const size_t buf_len,
+                                     const blender::ImplicitSharingInfo *sharing_info)
+{
+  /* The snapshot takes (shared) ownership of the data, which also makes it immutable. */
+  sharing_info->add_user();
+  segments.append({buf, buf_len, sharing_info});
+  size += buf_len;
+  return true;
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -451,6 +546,15 @@ struct WriteData {
    */
   blender::Set<const void *> per_id_written_shared_addresses;
 
+  /**
+   * The implicitly shared data currently written by #BLO_write_shared, which may be passed to
+   * #WriteWrap::write_shared as a whole.
+   */
+  struct {
+    const void *data = nullptr;
+    const blender::ImplicitSharingInfo *sharing_info = nullptr;
+  } shared_write;
+
   /** #MemFile writing (used for undo). */
   MemFileWriteData mem;
   /** When true, write to #WriteData.current, could also call 'is_undo'. */
@@ -575,6 +679,12 @@ static void mywrite(WriteData *wd, const void *adr, size_t len)
         wd->buffer.used_len = 0;
       }
 
+      if (adr == wd->shared_write.data && wd->shared_write.sharing_info != nullptr &&
+          wd->ww != nullptr && wd->ww->write_shared(adr, len, wd->shared_write.sharing_info))
+      {
+        return;
+      }
+
       do {
         const size_t writelen = std::min(len, wd->buffer.chunk_size);
         writedata_do_write(wd, adr, writelen);
@@ -1674,20 +1784,22 @@ static void write_file_main_validate_post(Main *bmain, ReportList *reports)
   }
 }
 
-static bool BLO_write_file_impl(Main *mainvar,
-                                const char *filepath,
-                                const int write_flags,
-                                const BlendFileWriteParams *params,
-                                ReportList *reports,
-                                WriteWrap &ww)
+/**
+ * Write `mainvar` into `ww`, opened at `tempname`.
+ * \return Success, the temporary file is removed otherwise.
+ */
+static bool write_file_to_temp(Main *mainvar,
+                               const char *filepath,
+                               const char *tempname,
+                               const int write_flags,
+                               const BlendFileWriteParams *params,
+                               ReportList *reports,
+                               WriteWrap &ww)
 {
   BLI_assert(!BLI_path_is_rel(filepath));
   BLI_assert(BLI_path_is_abs_from_cwd(filepath));
 
-  char tempname[FILE_MAX + 1];
-
   eBLO_WritePathRemap remap_mode = params->remap_mode;
-  const bool use_save_versions = params->use_save_versions;
   const bool use_save_as_copy = params->use_save_as_copy;
   const bool use_userdef = params->use_userdef;
   const BlendThumbnail *thumb = params->thumb;
@@ -1708,9 +1820,6 @@ static bool BLO_write_file_impl(Main *mainvar,
 
   write_file_main_validate_pre(mainvar, reports);
 
-  /* Open temporary file, so we preserve the original in case we crash. */
-  SNPRINTF(tempname, "%s@", filepath);
-
   if (ww.open(tempname) == false) {
     BKE_reportf(
         reports, RPT_ERROR, "Cannot open file %s for writing: %s", tempname, strerror(errno));
@@ -1809,10 +1918,18 @@ static bool BLO_write_file_impl(Main *mainvar,
 #endif
 
   /* Actual file writing. */
-  const bool err = write_file_handle(
-      mainvar, &ww, nullptr, nullptr, write_flags, use_userdef, thumb, debug_dst);
+  bool err;
+  {
+    blender::blo::IOPhaseTimer timer(params->io_stats, "Writing data-blocks");
+    err = write_file_handle(
+        mainvar, &ww, nullptr, nullptr, write_flags, use_userdef, thumb, debug_dst);
+  }
 
-  ww.close();
+  {
+    /* Includes waiting for the remaining compression tasks. */
+    blender::blo::IOPhaseTimer timer(params->io_stats, "Closing file");
+    ww.close();
+  }
 
   if (UNLIKELY(path_list_backup)) {
     BKE_bpath_list_restore(mainvar, path_list_flag, path_list_backup);
@@ -1826,6 +1943,18 @@ static bool BLO_write_file_impl(Main *mainvar,
     return false;
   }
 
+  return true;
+}
+
+/**
+ * Replace the file at `filepath` by the successfully written temporary file.
+ * Doesn't access any #Main data.
+ */
+static bool write_file_replace_from_temp(const char *filepath,
+                                         const char *tempname,
+                                         const bool use_save_versions,
+                                         ReportList *reports)
+{
   /* File save to temporary file was successful, now do reverse file history
    * (move `.blend1` -> `.blend2`, `.blend` -> `.blend1` .. etc). */
   if (use_save_versions) {
@@ -1840,6 +1969,30 @@ static bool BLO_write_file_impl(Main *mainvar,
     return false;
   }
 
+  return true;
+}
+
+static bool BLO_write_file_impl(Main *mainvar,
+                                const char *filepath,
+                                const int write_flags,
+                                const BlendFileWriteParams *params,
+                                ReportList *reports,
+                                WriteWrap &ww)
+{
+  /* Open temporary file, so we preserve the original in case we crash. */
+  char tempname[FILE_MAX + 1];
+  SNPRINTF(tempname, "%s@", filepath);
+
+  if (!write_file_to_temp(mainvar, filepath, tempname, write_flags, params, reports, ww)) {
+    return false;
+  }
+  {
+    blender::blo::IOPhaseTimer timer(params->io_stats, "Replacing file");
+    if (!write_file_replace_from_temp(filepath, tempname, params->use_save_versions, reports)) {
+      return false;
+    }
+  }
+
   write_file_main_validate_post(mainvar, reports);
   if (mainvar->is_global_main && !params->use_save_as_copy) {
     /* It is used to reload Blender after a crash on Windows OS. */
@@ -1863,7 +2016,7 @@ bool BLO_write_file(Main *mainvar,
   RawWriteWrap raw_wrap;
 
   if (write_flags & G_FILE_COMPRESS) {
-    ZstdWriteWrap zstd_wrap(raw_wrap);
+    ZstdWriteWrap zstd_wrap(raw_wrap, params->io_stats);
     return BLO_write_file_impl(mainvar, filepath, write_flags, params, reports, zstd_wrap);
   }
 
@@ -1880,6 +2033,102 @@ bool BLO_write_file_mem(Main *mainvar, MemFile *compare, MemFile *current, const
   return (err == 0);
 }
 
+struct BlendFileSnapshot {
+  SnapshotWriteWrap ww;
+  char filepath[FILE_MAX];
+  int write_flags;
+  bool use_save_versions;
+};
+
+BlendFileSnapshot *BLO_write_snapshot(Main *mainvar,
+                                      const char *filepath,
+                                      const int write_flags,
+                                      const BlendFileWriteParams *params,
+                                      ReportList *reports)
+{
+  BlendFileSnapshot *snapshot = MEM_new<BlendFileSnapshot>(__func__);
+  STRNCPY(snapshot->filepath, filepath);
+  snapshot->write_flags = write_flags;
+  snapshot->use_save_versions = params->use_save_versions;
+
+  char tempname[FILE_MAX + 1];
+  SNPRINTF(tempname, "%s@", filepath);
+
+  if (!write_file_to_temp(mainvar, filepath, tempname, write_flags, params, reports, snapshot->ww))
+  {
+    MEM_delete(snapshot);
+    return nullptr;
+  }
+  return snapshot;
+}
+
+bool BLO_write_snapshot_to_file(const BlendFileSnapshot *snapshot,
+                                ReportList *reports,
+                                const bool *stop,
+                                float *progress)
+{
+  char tempname[FILE_MAX + 1];
+  SNPRINTF(tempname, "%s@", snapshot->filepath);
+
+  RawWriteWrap raw_wrap;
+  ZstdWriteWrap zstd_wrap(raw_wrap);
+  WriteWrap &ww = (snapshot->write_flags & G_FILE_COMPRESS) ? static_cast<WriteWrap &>(zstd_wrap) :
+                                                               raw_wrap;
+
+  if (ww.open(tempname) == false) {
+    BKE_reportf(
+        reports, RPT_ERROR, "Cannot open file %s for writing: %s", tempname, strerror(errno));
+    return false;
+  }
+
+  bool is_canceled = false;
+  bool write_error = false;
+  size_t written_size = 0;
+  for (const SnapshotWriteWrap::Segment &segment : snapshot->ww.segments) {
+    if (stop != nullptr && *stop) {
+      is_canceled = true;
+      break;
+    }
+    if (segment.sharing_info) {
+      /* Split shared data in the same pieces as #mywrite, so compressed frames keep their size. */
+      for (size_t offset = 0; offset < segment.size && !write_error; offset += ZSTD_CHUNK_SIZE) {
+        const size_t write_len = std::min(segment.size - offset, size_t(ZSTD_CHUNK_SIZE));
+        write_error = !ww.write(POINTER_OFFSET(segment.data, offset), write_len);
+      }
+    }
+    else {
+      write_error = !ww.write(segment.data, segment.size);
+    }
+    if (write_error) {
+      break;
+    }
+    written_size += segment.size;
+    if (progress != nullptr) {
+      *progress = float(written_size) / float(std::max<size_t>(snapshot->ww.size, 1));
+    }
+  }
+
+  if (!ww.close()) {
+    write_error = true;
+  }
+
+  if (is_canceled || write_error) {
+    if (!is_canceled) {
+      BKE_reportf(reports, RPT_ERROR, "Cannot write file %s: %s", tempname, strerror(errno));
+    }
+    remove(tempname);
+    return false;
+  }
+
+  return write_file_replace_from_temp(
+      snapshot->filepath, tempname, snapshot->use_save_versions, reports);
+}
+
+void BLO_write_snapshot_free(BlendFileSnapshot *snapshot)
+{
+  MEM_delete(snapshot);
+}
+
 /*
  * API to write chunks of data.
  */
@@ -2063,7 +2312,12 @@ void BLO_write_shared(BlendWriter *writer,
       return;
     }
   }
+  WriteData *wd = writer->wd;
+  const auto shared_write_prev = wd->shared_write;
+  wd->shared_write.data = data;
+  wd->shared_write.sharing_info = sharing_info;
   write_fn();
+  wd->shared_write = shared_write_prev;
 }
 
 bool BLO_write_is_undo(BlendWriter *writer)
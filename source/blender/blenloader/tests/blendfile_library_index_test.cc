@@ -0,0 +1,244 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+#include "blendfile_loading_base_test.h"
+
+#include "testing/testing_temp_dir.h"
+
+#include <string>
+
+#ifndef WIN32
+#  include <fcntl.h>
+#  include <sys/stat.h>
+#endif
+
+#include "BLI_fileops.hh"
+#include "BLI_linklist.h"
+#include "BLI_math_vector_types.hh"
+#include "BLI_struct_equality_utils.hh"
+#include "BLI_vector.hh"
+
+#include "BKE_customdata.hh"
+#include "BKE_lib_id.hh"
+#include "BKE_main.hh"
+#include "BKE_mesh.hh"
+
+#include "BLO_readfile.hh"
+#include "BLO_writefile.hh"
+
+#include "DNA_mesh_types.h"
+
+#include "intern/readfile.hh"
+
+namespace blender::blo::tests {
+
+class LibraryIndexTest : public BlendfileLoadingBaseTest {
+ protected:
+  std::unique_ptr<blender::tests::TempDirectory> temp_dir;
+  std::string library_filepath;
+  std::string index_filepath;
+
+  void SetUp() override
+  {
+    BlendfileLoadingBaseTest::SetUp();
+    temp_dir = std::make_unique<blender::tests::TempDirectory>("blo_library_index");
+    library_filepath = temp_dir->file_path("library.blend");
+    index_filepath = temp_dir->file_path("library.bhead_index");
+  }
+
+  void TearDown() override
+  {
+    temp_dir.reset();
+    BlendfileLoadingBaseTest::TearDown();
+  }
+
+  /** Write a library that is large enough to be indexed. */
+  void write_library() const
+  {
+    Main *bmain = BKE_main_new();
+    for (const int i : IndexRange(4)) {
+      const std::string name = "Mesh" + std::to_string(i);
+      Mesh *mesh = BKE_id_new<Mesh>(bmain, name.c_str());
+      mesh->verts_num = 40000;
+      CustomData_add_layer_named(
+          &mesh->vert_data, CD_PROP_FLOAT3, CD_CONSTRUCT, mesh->verts_num, "position");
+      MutableSpan<float3> positions = mesh->vert_positions_for_write();
+      for (const int vert : positions.index_range()) {
+        positions[vert] = float3(float(vert), float(i), 0.0f);
+      }
+      id_fake_user_set(&mesh->id);
+    }
+    BlendFileWriteParams params{};
+    EXPECT_TRUE(BLO_write_file(bmain, library_filepath.c_str(), 0, &params, nullptr));
+    BKE_main_free(bmain);
+  }
+};
+
+struct BHeadInfo {
+  int code;
+  int64_t len;
+  int SDNAnr;
+  int64_t nr;
+
+  BLI_STRUCT_EQUALITY_OPERATORS_4(BHeadInfo, code, len, SDNAnr, nr)
+};
+
+static Vector<BHeadInfo> bhead_infos(FileData *fd)
+{
+  Vector<BHeadInfo> infos;
+  for (BHead *bhead = blo_bhead_first(fd); bhead; bhead = blo_bhead_next(fd, bhead)) {
+    infos.append({bhead->code, bhead->len, bhead->SDNAnr, bhead->nr});
+  }
+  return infos;
+}
+
+static Vector<std::string> mesh_names(FileData *fd)
+{
+  int names_num;
+  LinkNode *names = BLO_blendhandle_get_datablock_names(
+      reinterpret_cast<BlendHandle *>(fd), ID_ME, false, &names_num);
+  Vector<std::string> result;
+  for (LinkNode *link = names; link; link = link->next) {
+    result.append(static_cast<const char *>(link->link));
+  }
+  BLI_linklist_freeN(names);
+  return result;
+}
+
+TEST_F(LibraryIndexTest, index_matches_file)
+{
+  this->write_library();
+  ASSERT_TRUE(blo_library_index_write(library_filepath.c_str(), index_filepath.c_str()));
+
+  BlendFileReadReport reports{};
+  bool index_outdated = true;
+  FileData *fd_index = blo_filedata_from_library_file_with_index(
+      library_filepath.c_str(), index_filepath.c_str(), &reports, &index_outdated);
+  ASSERT_NE(fd_index, nullptr);
+  EXPECT_FALSE(index_outdated);
+  FileData *fd = blo_filedata_from_file(library_filepath.c_str(), &reports);
+  ASSERT_NE(fd, nullptr);
+
+  EXPECT_EQ(bhead_infos(fd_index), bhead_infos(fd));
+  const Vector<std::string> names = mesh_names(fd_index);
+  EXPECT_EQ(names.size(), 4);
+  EXPECT_EQ(names, mesh_names(fd));
+
+  blo_filedata_free(fd_index);
+  blo_filedata_free(fd);
+}
+
+TEST_F(LibraryIndexTest, missing_index)
+{
+  this->write_library();
+
+  BlendFileReadReport reports{};
+  bool index_outdated = false;
+  FileData *fd = blo_filedata_from_library_file_with_index(
+      library_filepath.c_str(), index_filepath.c_str(), &reports, &index_outdated);
+  ASSERT_NE(fd, nullptr);
+  EXPECT_TRUE(index_outdated);
+  EXPECT_EQ(mesh_names(fd).size(), 4);
+  blo_filedata_free(fd);
+  /* The index is only written in the background when opening a library the usual way. */
+  EXPECT_FALSE(BLI_exists(index_filepath.c_str()));
+}
+
+#ifndef WIN32
+/** Set the modification time of a file, to simulate changes that happen at the same time. */
+static void file_mtime_set(const char *filepath, const timespec &mtime)
+{
+  timespec times[2];
+  times[0].tv_sec = 0;
+  times[0].tv_nsec = UTIME_OMIT;
+  times[1] = mtime;
+  ASSERT_EQ(utimensat(AT_FDCWD, filepath, times, 0), 0);
+}
+
+static timespec file_mtime_get(const char *filepath)
+{
+  struct stat status;
+  EXPECT_EQ(stat(filepath, &status), 0);
+#  ifdef __APPLE__
+  return status.st_mtimespec;
+#  else
+  return status.st_mtim;
+#  endif
+}
+
+TEST_F(LibraryIndexTest, index_outdated_by_content_change)
+{
+  this->write_library();
+  ASSERT_TRUE(blo_library_index_write(library_filepath.c_str(), index_filepath.c_str()));
+
+  /* Change the file without changing its size and modification time. */
+  const timespec mtime = file_mtime_get(library_filepath.c_str());
+  const int64_t file_size = int64_t(BLI_file_size(library_filepath.c_str()));
+  {
+    fstream stream{library_filepath, std::ios::in | std::ios::out | std::ios::binary};
+    stream.seekg(file_size - 1);
+    char last_byte;
+    stream.read(&last_byte, 1);
+    last_byte = char(~last_byte);
+    stream.seekp(file_size - 1);
+    stream.write(&last_byte, 1);
+  }
+  file_mtime_set(library_filepath.c_str(), mtime);
+  EXPECT_EQ(int64_t(BLI_file_size(library_filepath.c_str())), file_size);
+
+  BlendFileReadReport reports{};
+  bool index_outdated = false;
+  FileData *fd = blo_filedata_from_library_file_with_index(
+      library_filepath.c_str(), index_filepath.c_str(), &reports, &index_outdated);
+  EXPECT_TRUE(index_outdated);
+  if (fd) {
+    blo_filedata_free(fd);
+  }
+}
+#endif
+
+TEST_F(LibraryIndexTest, dir_trim)
+{
+  const std::string index_dir = temp_dir->path();
+  const std::string other_filepath = temp_dir->file_path("other.txt");
+  const Vector<std::string> index_filepaths = {temp_dir->file_path("a.bhead_index"),
+                                               temp_dir->file_path("b.bhead_index"),
+                                               temp_dir->file_path("c.bhead_index"),
+                                               temp_dir->file_path("d.bhead_index")};
+  const std::string data(1000, 'x');
+  for (const std::string &filepath : index_filepaths) {
+    fstream stream{filepath, std::ios::out | std::ios::binary};
+    stream.write(data.data(), data.size());
+  }
+  {
+    fstream stream{other_filepath, std::ios::out | std::ios::binary};
+    stream.write(data.data(), data.size());
+  }
+#ifndef WIN32
+  /* The first files are the least recently used. */
+  for (const int i : index_filepaths.index_range()) {
+    file_mtime_set(index_filepaths[i].c_str(), timespec{1000 + i, 0});
+  }
+#endif
+
+  blo_library_index_dir_trim(index_dir.c_str(), 4000);
+  for (const std::string &filepath : index_filepaths) {
+    EXPECT_TRUE(BLI_exists(filepath.c_str()));
+  }
+
+  blo_library_index_dir_trim(index_dir.c_str(), 2500);
+  int remaining_num = 0;
+  for (const std::string &filepath : index_filepaths) {
+    remaining_num += BLI_exists(filepath.c_str()) ? 1 : 0;
+  }
+  EXPECT_EQ(remaining_num, 2);
+#ifndef WIN32
+  EXPECT_TRUE(BLI_exists(index_filepaths[2].c_str()));
+  EXPECT_TRUE(BLI_exists(index_filepaths[3].c_str()));
+#endif
+  /* Only index files are deleted. */
+  EXPECT_TRUE(BLI_exists(other_filepath.c_str()));
+}
+
+}  // namespace blender::blo::tests
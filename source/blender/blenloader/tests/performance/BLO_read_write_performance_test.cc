@@ -0,0 +1,180 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+#include "blendfile_loading_base_test.h"
+
+#include "testing/testing_temp_dir.h"
+
+#include <iostream>
+#include <sstream>
+
+#include "BLI_fileops.h"
+#include "BLI_math_vector_types.hh"
+#include "BLI_path_utils.hh"
+#include "BLI_string_ref.hh"
+#include "BLI_time.h"
+#include "BLI_vector.hh"
+
+#include "BKE_collection.hh"
+#include "BKE_customdata.hh"
+#include "BKE_global.hh"
+#include "BKE_lib_id.hh"
+#include "BKE_main.hh"
+#include "BKE_mesh.hh"
+#include "BKE_object.hh"
+#include "BKE_scene.hh"
+
+#include "BLO_io_stats.hh"
+#include "BLO_readfile.hh"
+#include "BLO_writefile.hh"
+
+#include "DNA_mesh_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+DEFINE_string(blend_files,
+              "",
+              "Semicolon separated list of blend-files (e.g. production files) to benchmark "
+              "reading. The `--test-assets-dir` files are used otherwise.");
+
+namespace blender::blo::tests {
+
+/** Every file is written and read this many times, the statistics are summed over all runs. */
+static constexpr int RUNS_NUM = 3;
+
+class BlendReadWritePerformanceTest : public BlendfileLoadingBaseTest {
+ protected:
+  std::unique_ptr<blender::tests::TempDirectory> temp_dir;
+
+  void SetUp() override
+  {
+    BlendfileLoadingBaseTest::SetUp();
+    temp_dir = std::make_unique<blender::tests::TempDirectory>("blo_performance");
+  }
+
+  void TearDown() override
+  {
+    temp_dir.reset();
+    BlendfileLoadingBaseTest::TearDown();
+  }
+
+  std::string temp_filepath(const StringRef filename) const
+  {
+    return temp_dir->file_path(filename);
+  }
+
+  static void benchmark_write(Main *bmain, const std::string &filepath, const int write_flags)
+  {
+    IOStats stats;
+    double duration = 0.0;
+    for (int i = 0; i < RUNS_NUM; i++) {
+      BlendFileWriteParams params{};
+      params.io_stats = &stats;
+      const double time_start = BLI_time_now_seconds();
+      const bool success = BLO_write_file(bmain, filepath.c_str(), write_flags, &params, nullptr);
+      duration += BLI_time_now_seconds() - time_start;
+      ASSERT_TRUE(success);
+    }
+    std::cout << "Writing '" << filepath << "' (" << BLI_file_size(filepath.c_str()) / 1024
+              << " KiB), " << RUNS_NUM << " runs in " << duration * 1000.0 << " ms\n"
+              << stats.report() << "\n";
+  }
+
+  static void benchmark_read(const std::string &filepath)
+  {
+    IOStats stats;
+    double duration = 0.0;
+    for (int i = 0; i < RUNS_NUM; i++) {
+      BlendFileReadReport bf_reports{};
+      bf_reports.io_stats = &stats;
+      const double time_start = BLI_time_now_seconds();
+      BlendFileData *bfd = BLO_read_from_file(filepath.c_str(), BLO_READ_SKIP_NONE, &bf_reports);
+      duration += BLI_time_now_seconds() - time_start;
+      ASSERT_NE(bfd, nullptr);
+      BLO_blendfiledata_free(bfd);
+    }
+    std::cout << "Reading '" << filepath << "', " << RUNS_NUM << " runs in "
+              << duration * 1000.0 << " ms\n"
+              << stats.report() << "\n";
+  }
+
+  /** Write \a bmain uncompressed and compressed, and read both files back. */
+  void benchmark_write_and_read(Main *bmain, const StringRef name)
+  {
+    const std::string filepath = this->temp_filepath(name + ".blend");
+    const std::string filepath_compressed = this->temp_filepath(name + "_compressed.blend");
+    benchmark_write(bmain, filepath, 0);
+    benchmark_write(bmain, filepath_compressed, G_FILE_COMPRESS);
+    benchmark_read(filepath);
+    benchmark_read(filepath_compressed);
+  }
+};
+
+/** A scene with \a objects_num mesh objects, each with its own mesh of \a verts_num points. */
+static Main *synthetic_main_create(const int objects_num, const int verts_num)
+{
+  Main *bmain = BKE_main_new();
+  Scene *scene = BKE_scene_add(bmain, "Scene");
+  for (const int i : IndexRange(objects_num)) {
+    const std::string name = "Mesh" + std::to_string(i);
+    Mesh *mesh = BKE_id_new<Mesh>(bmain, name.c_str());
+    mesh->verts_num = verts_num;
+    CustomData_add_layer_named(
+        &mesh->vert_data, CD_PROP_FLOAT3, CD_CONSTRUCT, verts_num, "position");
+    MutableSpan<float3> positions = mesh->vert_positions_for_write();
+    for (const int vert : positions.index_range()) {
+      positions[vert] = float3(float(vert % 1000), float(vert / 1000), float(i));
+    }
+
+    Object *ob = BKE_object_add_only_object(bmain, OB_MESH, name.c_str());
+    ob->data = mesh;
+    id_us_plus(&mesh->id);
+    BKE_collection_object_add(bmain, scene->master_collection, ob);
+  }
+  return bmain;
+}
+
+TEST_F(BlendReadWritePerformanceTest, synthetic_many_small_ids)
+{
+  Main *bmain = synthetic_main_create(20000, 8);
+  this->benchmark_write_and_read(bmain, "many_small_ids");
+  BKE_main_free(bmain);
+}
+
+TEST_F(BlendReadWritePerformanceTest, synthetic_large_arrays)
+{
+  Main *bmain = synthetic_main_create(16, 1000000);
+  this->benchmark_write_and_read(bmain, "large_arrays");
+  BKE_main_free(bmain);
+}
+
+TEST_F(BlendReadWritePerformanceTest, files)
+{
+  Vector<std::string> filepaths;
+  std::stringstream blend_files{FLAGS_blend_files};
+  std::string filepath_arg;
+  while (std::getline(blend_files, filepath_arg, ';')) {
+    if (!filepath_arg.empty()) {
+      filepaths.append(filepath_arg);
+    }
+  }
+  if (filepaths.is_empty()) {
+    const std::string &test_assets_dir = blender::tests::flags_test_asset_dir();
+    if (test_assets_dir.empty()) {
+      GTEST_SKIP() << "Neither --blend_files nor --test-assets-dir are set";
+    }
+    char filepath[FILE_MAX];
+    BLI_path_join(filepath,
+                  sizeof(filepath),
+                  test_assets_dir.c_str(),
+                  "modifier_stack",
+                  "array_test.blend");
+    filepaths.append(filepath);
+  }
+  for (const std::string &filepath : filepaths) {
+    benchmark_read(filepath);
+  }
+}
+
+}  // namespace blender::blo::tests
@@ -16,6 +16,7 @@
 #include "BLI_function_ref.hh"
 #include "BLI_gsqueue.h"
 #include "BLI_task.h"
+#include "BLI_task_trace.hh"
 #include "BLI_time.h"
 
 #include "BKE_global.hh"
@@ -406,6 +407,9 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
   graph->is_evaluating = true;
   depsgraph_ensure_view_layer(graph);
 
+  /* Attribute all tasks of the evaluation to the depsgraph when tracing. */
+  const blender::threading::trace::ScopedLabel trace_label{"Depsgraph evaluation"};
+
   /* Set up evaluation state. */
   DepsgraphEvalState state;
   state.graph = graph;
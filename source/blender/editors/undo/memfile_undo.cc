@@ -67,6 +67,22 @@ static bool memfile_undosys_poll(bContext *C)
   return true;
 }
 
+/**
+ * The memory used by memfile steps shrinks when their data is compressed in the background, and
+ * grows when data of a freed step is accounted to the next one. Update the sizes so that the
+ * undo memory limit uses the actual memory usage.
+ */
+static void memfile_undosys_data_sizes_update(UndoStack *ustack)
+{
+  LISTBASE_FOREACH (UndoStep *, us_iter, &ustack->steps) {
+    if (us_iter->type == BKE_UNDOSYS_TYPE_MEMFILE) {
+      MemFileUndoStep *us = reinterpret_cast<MemFileUndoStep *>(us_iter);
+      us->data->undo_size = BLO_memfile_size(&us->data->memfile);
+      us->step.data_size = us->data->undo_size;
+    }
+  }
+}
+
 static bool memfile_undosys_step_encode(bContext * /*C*/, Main *bmain, UndoStep *us_p)
 {
   MemFileUndoStep *us = (MemFileUndoStep *)us_p;
@@ -83,6 +99,7 @@ static bool memfile_undosys_step_encode(bContext * /*C*/, Main *bmain, UndoStep
       ustack, BKE_UNDOSYS_TYPE_MEMFILE);
   us->data = BKE_memfile_undo_encode(bmain, us_prev ? us_prev->data : nullptr);
   us->step.data_size = us->data->undo_size;
+  memfile_undosys_data_sizes_update(ustack);
 
   /* Store the fact that we should not re-use old data with that undo step, and reset the Main
    * flag. */
@@ -118,7 +118,40 @@ class GraphExecutor : public LazyFunction {
     int total_size;
   } init_buffer_info_;
 
+  /**
+   * Graphs in which every node needs all of its inputs don't need the dynamic scheduling which is
+   * necessary for lazy evaluation. Instead, the nodes can be executed in an order that is computed
+   * once, without tracking the state of every node. This mainly helps small graphs that are
+   * evaluated many times, e.g. the bodies of repeat zones.
+   *
+   * The plan is only used when all inputs of the graph are available on the first execution, all
+   * outputs are used and there are no nodes with side effects.
+   */
+  struct {
+    /** False when the graph has to be scheduled dynamically, e.g. because it contains cycles. */
+    bool is_available = false;
+    /** All function nodes that the graph outputs depend on in topological order. */
+    Vector<const FunctionNode *> nodes;
+    /**
+     * Index of the first socket value of every node in #value_offsets, or -1 if the node is not
+     * executed. The values of all inputs are followed by the values of all outputs.
+     */
+    Array<int> first_value_by_node;
+    /** Offset of every socket value in the buffer that is allocated for the execution. */
+    Array<int> value_offsets;
+    /**
+     * Number of node inputs and graph outputs that receive the value of every output. Outputs
+     * without targets are unused.
+     */
+    Array<int> targets_num_by_value;
+    /** Same as #targets_num_by_value but for the graph inputs. */
+    Array<int> targets_num_by_graph_input;
+    int buffer_size = 0;
+    int buffer_alignment = 1;
+  } static_plan_;
+
   friend class Executor;
+  friend class GraphExecutorStaticPlanLFParams;
 
  public:
   GraphExecutor(const Graph &graph,
@@ -140,6 +173,8 @@ class GraphExecutor : public LazyFunction {
   std::string output_name(int index) const override;
 
  private:
+  void prepare_static_plan();
+
   void execute_impl(Params &params, const Context &context) const override;
 };
 
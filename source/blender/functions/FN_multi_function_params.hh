@@ -134,6 +134,15 @@ class Params {
   void assert_correct_param(int param_index, StringRef name, ParamCategory category);
 };
 
+/**
+ * Adds all parameters of \a full_params to \a r_sliced_params, so that index zero of the sliced
+ * parameters corresponds to the start of \a slice_range. Vector parameters are not supported.
+ */
+void add_sliced_parameters(const Signature &signature,
+                           Params &full_params,
+                           IndexRange slice_range,
+                           ParamsBuilder &r_sliced_params);
+
 /* -------------------------------------------------------------------- */
 /** \name #Paramsbuilder Inline Methods
  * \{ */
@@ -262,6 +262,12 @@ class Procedure : NonCopyable, NonMovable {
   DummyInstruction &new_dummy_instruction();
   ReturnInstruction &new_return_instruction();
 
+  /**
+   * Deletes instructions that are not referenced by any other instruction anymore. Their
+   * successors and variables are unlinked automatically.
+   */
+  void delete_instructions(Span<Instruction *> instructions);
+
   void add_parameter(ParamType::InterfaceType interface_type, Variable &variable);
   Span<ConstParameter> params() const;
 
@@ -17,6 +17,11 @@ class ProcedureExecutor : public MultiFunction {
  private:
   Signature signature_;
   const Procedure &procedure_;
+  /**
+   * Large masks are split into tiles of this size, so that intermediate values stay in the CPU
+   * cache. Zero when the procedure is always executed for the entire mask at once.
+   */
+  int64_t tile_size_;
 
  public:
   ProcedureExecutor(const Procedure &procedure);
@@ -46,4 +46,37 @@ namespace blender::fn::multi_function::procedure_optimization {
  */
 void move_destructs_up(Procedure &procedure, Instruction &block_end_instr);
 
+/**
+ * Evaluates call instructions whose inputs are all constant at optimization time, and replaces
+ * them with calls to constant functions. The executor evaluates those for a single index only
+ * (see #CustomMF_GenericConstant), instead of recomputing the same value for every index.
+ *
+ * Only functions with single inputs and outputs are folded. They are called without any user
+ * data in the context, just like fields that don't depend on any input.
+ *
+ * The remaining passes below have the same limitations. They only change procedures that are a
+ * single chain of instructions, and only use variables that are assigned exactly once.
+ */
+void fold_constants(Procedure &procedure);
+
+/**
+ * Finds call instructions that call the same function (see #MultiFunction::equals) with the same
+ * input variables as an earlier call instruction. Their outputs are replaced with the outputs of
+ * the earlier call, so that the value is computed only once.
+ */
+void eliminate_common_subexpressions(Procedure &procedure);
+
+/**
+ * Removes call instructions whose outputs are not used, together with the destruct instructions
+ * of those outputs. Unused single outputs of functions that are still called are ignored, which
+ * allows the function to skip computing them. Calls without outputs or with mutable parameters
+ * are kept, because they exist for their side effects.
+ */
+void remove_dead_instructions(Procedure &procedure);
+
+/**
+ * Runs #fold_constants, #eliminate_common_subexpressions and #remove_dead_instructions.
+ */
+void optimize_instructions(Procedure &procedure);
+
 }  // namespace blender::fn::multi_function::procedure_optimization
@@ -272,6 +272,9 @@ static void build_multi_function_procedure_for_fields(mf::Procedure &procedure,
 
   mf::ReturnInstruction &return_instr = builder.add_return();
 
+  /* Field trees often contain the same operations multiple times, e.g. when node groups or
+   * inputs are reused. */
+  mf::procedure_optimization::optimize_instructions(procedure);
   mf::procedure_optimization::move_destructs_up(procedure, return_instr);
 
   // std::cout << procedure.to_dot() << "\n";
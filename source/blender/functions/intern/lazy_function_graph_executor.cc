@@ -39,6 +39,12 @@
  * When all tasks are completed, the executor gives back control to the caller which may later
  * provide new inputs to the graph which in turn leads to new nodes being scheduled and the process
  * starts again.
+ *
+ * Graphs in which every node needs all of its inputs are common when small graphs are evaluated
+ * many times (e.g. in the body of a repeat zone). For those, the topological order of the nodes
+ * and the memory layout of all socket values are computed once when the executor is created. If
+ * all inputs are available in advance, the nodes are then executed in that order without any of
+ * the bookkeeping described above.
  */
 
 #include <atomic>
@@ -212,6 +218,7 @@ struct LockedNode {
 
 class Executor;
 class GraphExecutorLFParams;
+class GraphExecutorStaticPlanLFParams;
 
 /**
  * Keeps track of nodes that are currently scheduled on a thread. A node can only be scheduled by
@@ -326,8 +333,14 @@ class Executor {
    * Set to false when the first execution ends.
    */
   bool is_first_execution_ = true;
+  /**
+   * Set to true when the graph has been evaluated with the static plan. In this case, no node
+   * states have been initialized and all outputs have been computed already.
+   */
+  bool executed_with_static_plan_ = false;
 
   friend GraphExecutorLFParams;
+  friend GraphExecutorStaticPlanLFParams;
 
   /**
    * Data that is local to the current thread. It is passed around in many places to avoid
@@ -382,10 +395,24 @@ class Executor {
     };
     BLI_SCOPED_DEFER(deferred_func);
 
+    if (executed_with_static_plan_) {
+      return;
+    }
+
     const LocalData local_data = this->get_local_data();
 
     CurrentTask current_task;
     if (is_first_execution_) {
+      Vector<const FunctionNode *> side_effect_nodes;
+      if (self_.side_effect_provider_ != nullptr) {
+        side_effect_nodes = self_.side_effect_provider_->get_nodes_with_side_effects(context);
+      }
+      if (side_effect_nodes.is_empty() && this->can_use_static_plan()) {
+        this->execute_with_static_plan(local_data);
+        executed_with_static_plan_ = true;
+        return;
+      }
+
       /* Allocate a single large buffer instead of making many smaller allocations below. */
       char *buffer = static_cast<char *>(
           local_data.allocator->allocate(self_.init_buffer_info_.total_size, alignof(void *)));
@@ -401,16 +428,12 @@ class Executor {
       this->set_always_unused_graph_inputs();
       this->set_defaulted_graph_outputs(local_data);
 
-      /* Retrieve and tag side effect nodes. */
-      Vector<const FunctionNode *> side_effect_nodes;
-      if (self_.side_effect_provider_ != nullptr) {
-        side_effect_nodes = self_.side_effect_provider_->get_nodes_with_side_effects(context);
-        for (const FunctionNode *node : side_effect_nodes) {
-          BLI_assert(self_.graph_.nodes().contains(node));
-          const int node_index = node->index_in_graph();
-          NodeState &node_state = *node_states_[node_index];
-          node_state.has_side_effects = true;
-        }
+      /* Tag side effect nodes. */
+      for (const FunctionNode *node : side_effect_nodes) {
+        BLI_assert(self_.graph_.nodes().contains(node));
+        const int node_index = node->index_in_graph();
+        NodeState &node_state = *node_states_[node_index];
+        node_state.has_side_effects = true;
       }
 
       this->initialize_static_value_usages(side_effect_nodes);
@@ -428,6 +451,85 @@ class Executor {
   }
 
  private:
+  /**
+   * Check if the graph can be executed in the precomputed order. That requires that all values
+   * which may be necessary are available already.
+   */
+  bool can_use_static_plan() const
+  {
+    if (!self_.static_plan_.is_available) {
+      return false;
+    }
+    for (const int graph_output_index : self_.graph_outputs_.index_range()) {
+      if (params_->get_output_usage(graph_output_index) != ValueUsage::Used) {
+        return false;
+      }
+    }
+    for (const int graph_input_index : self_.graph_inputs_.index_range()) {
+      if (self_.static_plan_.targets_num_by_graph_input[graph_input_index] == 0) {
+        continue;
+      }
+      if (params_->try_get_input_data_ptr(graph_input_index) == nullptr) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void execute_with_static_plan(const LocalData &local_data);
+
+  /**
+   * Copies the value to all sockets that use it. The value is moved into the last target but is
+   * not destructed.
+   */
+  void forward_value_with_static_plan(const OutputSocket &from_socket,
+                                      const GMutablePointer value,
+                                      const int targets_num,
+                                      char *buffer,
+                                      const Context &local_context)
+  {
+    const CPPType &type = *value.type();
+    if (self_.logger_ != nullptr) {
+      self_.logger_->log_socket_value(from_socket, value, local_context);
+    }
+    int remaining_targets = targets_num;
+    for (const InputSocket *target_socket : from_socket.targets()) {
+      const Node &target_node = target_socket->node();
+      int graph_output_index = -1;
+      void *dst_buffer;
+      if (target_node.is_interface()) {
+        graph_output_index = self_.graph_output_index_by_socket_index_[target_socket->index()];
+        if (graph_output_index == -1) {
+          continue;
+        }
+        dst_buffer = params_->get_output_data_ptr(graph_output_index);
+      }
+      else {
+        const auto &plan = self_.static_plan_;
+        const int first_value = plan.first_value_by_node[target_node.index_in_graph()];
+        if (first_value == -1) {
+          continue;
+        }
+        dst_buffer = buffer + plan.value_offsets[first_value + target_socket->index()];
+      }
+      if (self_.logger_ != nullptr) {
+        self_.logger_->log_socket_value(*target_socket, value, local_context);
+      }
+      remaining_targets--;
+      if (remaining_targets == 0) {
+        /* No need to make a copy if this is the last target. */
+        type.move_construct(value.get(), dst_buffer);
+      }
+      else {
+        type.copy_construct(value.get(), dst_buffer);
+      }
+      if (graph_output_index != -1) {
+        params_->output_set(graph_output_index);
+      }
+    }
+    BLI_assert(remaining_targets == 0);
+  }
+
   void initialize_node_states(char *buffer)
   {
     Span<const Node *> nodes = self_.graph_.nodes();
@@ -1459,6 +1561,180 @@ inline void Executor::execute_node(const FunctionNode &node,
   }
 }
 
+/**
+ * Parameters for a node that is executed with the static plan. All inputs of the node are
+ * available when it is executed.
+ */
+class GraphExecutorStaticPlanLFParams final : public Params {
+ private:
+  Executor &executor_;
+  const FunctionNode &node_;
+  char *buffer_;
+  const Context &local_context_;
+  /** Offsets and target counts of the socket values of this node in the static plan. */
+  Span<int> input_offsets_;
+  Span<int> output_offsets_;
+  Span<int> output_targets_num_;
+  Array<bool, 16> set_outputs_;
+
+ public:
+  GraphExecutorStaticPlanLFParams(const LazyFunction &fn,
+                                  Executor &executor,
+                                  const FunctionNode &node,
+                                  char *buffer,
+                                  const Context &local_context)
+      : Params(fn, false),
+        executor_(executor),
+        node_(node),
+        buffer_(buffer),
+        local_context_(local_context),
+        set_outputs_(node.outputs().size(), false)
+  {
+    const auto &plan = executor.self_.static_plan_;
+    const int first_value = plan.first_value_by_node[node.index_in_graph()];
+    const IndexRange input_values(first_value, node.inputs().size());
+    const IndexRange output_values = input_values.after(node.outputs().size());
+    input_offsets_ = plan.value_offsets.as_span().slice(input_values);
+    output_offsets_ = plan.value_offsets.as_span().slice(output_values);
+    output_targets_num_ = plan.targets_num_by_value.as_span().slice(output_values);
+  }
+
+ private:
+  void *try_get_input_data_ptr_impl(const int index) const override
+  {
+    return buffer_ + input_offsets_[index];
+  }
+
+  void *try_get_input_data_ptr_or_request_impl(const int index) override
+  {
+    return buffer_ + input_offsets_[index];
+  }
+
+  void *get_output_data_ptr_impl(const int index) override
+  {
+    BLI_assert(!set_outputs_[index]);
+    return buffer_ + output_offsets_[index];
+  }
+
+  void output_set_impl(const int index) override
+  {
+    BLI_assert(!set_outputs_[index]);
+    const OutputSocket &output_socket = node_.output(index);
+    const GMutablePointer value{output_socket.type(), buffer_ + output_offsets_[index]};
+    executor_.forward_value_with_static_plan(
+        output_socket, value, output_targets_num_[index], buffer_, local_context_);
+    output_socket.type().destruct(value.get());
+    set_outputs_[index] = true;
+  }
+
+  bool output_was_set_impl(const int index) const override
+  {
+    return set_outputs_[index];
+  }
+
+  ValueUsage get_output_usage_impl(const int index) const override
+  {
+    return output_targets_num_[index] > 0 ? ValueUsage::Used : ValueUsage::Unused;
+  }
+
+  void set_input_unused_impl(const int /*index*/) override
+  {
+    /* All inputs are destructed after the node has been executed anyway. */
+  }
+};
+
+/**
+ * Execute all nodes in the precomputed order. Unlike the dynamic scheduling, this does not keep
+ * track of the state of every node, because all inputs of a node are known to be available when
+ * it is executed.
+ */
+inline void Executor::execute_with_static_plan(const LocalData &local_data)
+{
+  const auto &plan = self_.static_plan_;
+  LinearAllocator<> &allocator = *local_data.allocator;
+  const Context local_context{context_->storage, context_->user_data, local_data.local_user_data};
+
+  /* All socket values are stored in a single buffer whose layout is known in advance. */
+  char *buffer = static_cast<char *>(allocator.allocate(plan.buffer_size, plan.buffer_alignment));
+
+  this->set_defaulted_graph_outputs(local_data);
+
+  for (const int graph_input_index : self_.graph_inputs_.index_range()) {
+    const int targets_num = plan.targets_num_by_graph_input[graph_input_index];
+    if (targets_num == 0) {
+      params_->set_input_unused(graph_input_index);
+      continue;
+    }
+    const OutputSocket &socket = *self_.graph_inputs_[graph_input_index];
+    void *input_data = params_->try_get_input_data_ptr(graph_input_index);
+    this->forward_value_with_static_plan(
+        socket, {socket.type(), input_data}, targets_num, buffer, local_context);
+  }
+
+  for (const FunctionNode *node : plan.nodes) {
+    const LazyFunction &fn = node->function();
+    const int first_value = plan.first_value_by_node[node->index_in_graph()];
+
+    /* Load unlinked inputs. */
+    for (const int input_index : node->inputs().index_range()) {
+      const InputSocket &input_socket = node->input(input_index);
+      if (input_socket.origin() != nullptr) {
+        continue;
+      }
+      const CPPType &type = input_socket.type();
+      const void *default_value = input_socket.default_value();
+      BLI_assert(default_value != nullptr);
+      if (self_.logger_ != nullptr) {
+        self_.logger_->log_socket_value(input_socket, {type, default_value}, local_context);
+      }
+      type.copy_construct(default_value, buffer + plan.value_offsets[first_value + input_index]);
+    }
+
+    GraphExecutorStaticPlanLFParams node_params{fn, *this, *node, buffer, local_context};
+    void *storage = fn.init_storage(allocator);
+    const Context fn_context{storage, context_->user_data, local_data.local_user_data};
+
+    if (self_.logger_ != nullptr) {
+      self_.logger_->log_before_node_execute(*node, node_params, fn_context);
+    }
+    if (self_.node_execute_wrapper_) {
+      self_.node_execute_wrapper_->execute_node(*node, node_params, fn_context);
+    }
+    else {
+      fn.execute(node_params, fn_context);
+    }
+    if (self_.logger_ != nullptr) {
+      self_.logger_->log_after_node_execute(*node, node_params, fn_context);
+    }
+
+    if (storage != nullptr) {
+      fn.destruct_storage(storage);
+    }
+
+#ifndef NDEBUG
+    Vector<const OutputSocket *> missing_outputs;
+    for (const int output_index : node->outputs().index_range()) {
+      if (node_params.get_output_usage(output_index) == ValueUsage::Used &&
+          !node_params.output_was_set(output_index))
+      {
+        missing_outputs.append(&node->output(output_index));
+      }
+    }
+    if (!missing_outputs.is_empty()) {
+      if (self_.logger_ != nullptr) {
+        self_.logger_->dump_when_outputs_are_missing(*node, missing_outputs, local_context);
+      }
+      BLI_assert_unreachable();
+    }
+#endif
+
+    for (const int input_index : node->inputs().index_range()) {
+      const CPPType &type = node->input(input_index).type();
+      type.destruct(buffer + plan.value_offsets[first_value + input_index]);
+    }
+  }
+}
+
 GraphExecutor::GraphExecutor(const Graph &graph,
                              const Logger *logger,
                              const SideEffectProvider *side_effect_provider,
@@ -1529,6 +1805,202 @@ GraphExecutor::GraphExecutor(const Graph &graph,
   }
 
   init_buffer_info_.total_size = offset;
+
+  this->prepare_static_plan();
+}
+
+void GraphExecutor::prepare_static_plan()
+{
+  /* Larger graphs may benefit from executing independent nodes on separate threads, which is only
+   * supported by the dynamic scheduling. */
+  const int max_nodes_num = 128;
+
+  const Span<const Node *> nodes = graph_.nodes();
+
+  /* Find all function nodes that the graph outputs depend on. */
+  Array<bool> is_reachable(nodes.size(), false);
+  Stack<const FunctionNode *> nodes_to_check;
+  const auto add_origin_node = [&](const OutputSocket &origin_socket) {
+    const Node &node = origin_socket.node();
+    if (node.is_function() && !is_reachable[node.index_in_graph()]) {
+      is_reachable[node.index_in_graph()] = true;
+      nodes_to_check.push(static_cast<const FunctionNode *>(&node));
+    }
+  };
+  for (const InputSocket *socket : graph_outputs_) {
+    if (const OutputSocket *origin_socket = socket->origin()) {
+      if (origin_socket->node().is_interface() &&
+          graph_input_index_by_socket_index_[origin_socket->index()] == -1)
+      {
+        return;
+      }
+      add_origin_node(*origin_socket);
+    }
+  }
+  Vector<const FunctionNode *> reachable_nodes;
+  while (!nodes_to_check.is_empty()) {
+    const FunctionNode &node = *nodes_to_check.pop();
+    reachable_nodes.append(&node);
+    if (reachable_nodes.size() > max_nodes_num) {
+      return;
+    }
+    const LazyFunction &fn = node.function();
+    if (fn.allow_missing_requested_inputs()) {
+      return;
+    }
+    for (const int input_index : node.inputs().index_range()) {
+      const OutputSocket *origin_socket = node.input(input_index).origin();
+      if (origin_socket == nullptr) {
+        continue;
+      }
+      if (origin_socket->node().is_interface()) {
+        /* Graph inputs are available in advance, so it does not matter if they are used. */
+        if (graph_input_index_by_socket_index_[origin_socket->index()] == -1) {
+          return;
+        }
+        continue;
+      }
+      /* Values that may not be used must not be computed in advance. */
+      if (fn.inputs()[input_index].usage != ValueUsage::Used) {
+        return;
+      }
+      add_origin_node(*origin_socket);
+    }
+  }
+
+  /* Sort the nodes topologically. */
+  Array<int> missing_inputs_num(nodes.size(), 0);
+  Vector<const FunctionNode *> sorted_nodes;
+  sorted_nodes.reserve(reachable_nodes.size());
+  for (const FunctionNode *node : reachable_nodes) {
+    for (const InputSocket *input_socket : node->inputs()) {
+      const OutputSocket *origin_socket = input_socket->origin();
+      if (origin_socket != nullptr && origin_socket->node().is_function()) {
+        missing_inputs_num[node->index_in_graph()]++;
+      }
+    }
+    if (missing_inputs_num[node->index_in_graph()] == 0) {
+      sorted_nodes.append(node);
+    }
+  }
+  for (int i = 0; i < sorted_nodes.size(); i++) {
+    for (const OutputSocket *output_socket : sorted_nodes[i]->outputs()) {
+      for (const InputSocket *target_socket : output_socket->targets()) {
+        const Node &target_node = target_socket->node();
+        if (!target_node.is_function() || !is_reachable[target_node.index_in_graph()]) {
+          continue;
+        }
+        missing_inputs_num[target_node.index_in_graph()]--;
+        if (missing_inputs_num[target_node.index_in_graph()] == 0) {
+          sorted_nodes.append(static_cast<const FunctionNode *>(&target_node));
+        }
+      }
+    }
+  }
+  if (sorted_nodes.size() < reachable_nodes.size()) {
+    /* The graph contains a cycle. */
+    return;
+  }
+
+  const auto count_targets = [&](const OutputSocket &socket) {
+    int count = 0;
+    for (const InputSocket *target_socket : socket.targets()) {
+      const Node &target_node = target_socket->node();
+      if (target_node.is_interface() ?
+              graph_output_index_by_socket_index_[target_socket->index()] != -1 :
+              is_reachable[target_node.index_in_graph()])
+      {
+        count++;
+      }
+    }
+    return count;
+  };
+
+  /* Compute the memory layout of all socket values. */
+  Vector<int> value_offsets;
+  Vector<int> targets_num_by_value;
+  int offset = 0;
+  int alignment = 1;
+  const auto add_value = [&](const CPPType &type, const int targets_num) {
+    const int type_alignment = int(type.alignment);
+    offset = (offset + type_alignment - 1) & ~(type_alignment - 1);
+    value_offsets.append(offset);
+    targets_num_by_value.append(targets_num);
+    offset += int(type.size);
+    alignment = std::max(alignment, type_alignment);
+  };
+  static_plan_.first_value_by_node.reinitialize(nodes.size());
+  static_plan_.first_value_by_node.fill(-1);
+  for (const FunctionNode *node : sorted_nodes) {
+    static_plan_.first_value_by_node[node->index_in_graph()] = value_offsets.size();
+    for (const InputSocket *input_socket : node->inputs()) {
+      add_value(input_socket->type(), 0);
+    }
+    for (const OutputSocket *output_socket : node->outputs()) {
+      add_value(output_socket->type(), count_targets(*output_socket));
+    }
+  }
+
+  static_plan_.targets_num_by_graph_input.reinitialize(graph_inputs_.size());
+  for (const int i : graph_inputs_.index_range()) {
+    static_plan_.targets_num_by_graph_input[i] = count_targets(*graph_inputs_[i]);
+  }
+
+  static_plan_.nodes = std::move(sorted_nodes);
+  static_plan_.value_offsets = value_offsets.as_span();
+  static_plan_.targets_num_by_value = targets_num_by_value.as_span();
+  static_plan_.buffer_size = offset;
+  static_plan_.buffer_alignment = alignment;
+  static_plan_.is_available = true;
+
+  /* Inputs that all outputs depend on are always requested by the plan. Declaring them as used
+   * allows the caller to provide them before the first execution, so that the plan can be used
+   * even when this graph is evaluated as part of another graph. If all inputs are used, partial
+   * execution is not useful anymore, because no output can be computed before all inputs are
+   * available. */
+  if (graph_outputs_.is_empty()) {
+    return;
+  }
+  Array<bool> used_by_all_outputs(graph_inputs_.size(), true);
+  for (const InputSocket *graph_output : graph_outputs_) {
+    Array<bool> used_inputs(graph_inputs_.size(), false);
+    Array<bool> visited_nodes(nodes.size(), false);
+    Stack<const InputSocket *> sockets_to_check;
+    sockets_to_check.push(graph_output);
+    while (!sockets_to_check.is_empty()) {
+      const OutputSocket *origin_socket = sockets_to_check.pop()->origin();
+      if (origin_socket == nullptr) {
+        continue;
+      }
+      const Node &origin_node = origin_socket->node();
+      if (origin_node.is_interface()) {
+        used_inputs[graph_input_index_by_socket_index_[origin_socket->index()]] = true;
+        continue;
+      }
+      if (!visited_nodes[origin_node.index_in_graph()]) {
+        visited_nodes[origin_node.index_in_graph()] = true;
+        /* Inputs that are only maybe used (e.g. the branches of a switch) are still requested
+         * lazily, so the graph inputs they depend on are not always used. */
+        const LazyFunction &fn = static_cast<const FunctionNode &>(origin_node).function();
+        for (const InputSocket *input_socket : origin_node.inputs()) {
+          if (fn.inputs()[input_socket->index()].usage == ValueUsage::Used) {
+            sockets_to_check.push(input_socket);
+          }
+        }
+      }
+    }
+    for (const int i : graph_inputs_.index_range()) {
+      used_by_all_outputs[i] &= used_inputs[i];
+    }
+  }
+  for (const int i : graph_inputs_.index_range()) {
+    if (used_by_all_outputs[i]) {
+      inputs_[i].usage = ValueUsage::Used;
+    }
+  }
+  if (!used_by_all_outputs.as_span().contains(false)) {
+    allow_missing_requested_inputs_ = false;
+  }
 }
 
 void GraphExecutor::execute_impl(Params &params, const Context &context) const
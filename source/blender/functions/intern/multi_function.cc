@@ -65,54 +65,6 @@ static int64_t compute_alignment(const int64_t grain_size)
   return 32;
 }
 
-static void add_sliced_parameters(const Signature &signature,
-                                  Params &full_params,
-                                  const IndexRange slice_range,
-                                  ParamsBuilder &r_sliced_params)
-{
-  for (const int param_index : signature.params.index_range()) {
-    const ParamType &param_type = signature.params[param_index].type;
-    switch (param_type.category()) {
-      case ParamCategory::SingleInput: {
-        const GVArray &varray = full_params.readonly_single_input(param_index);
-        r_sliced_params.add_readonly_single_input(varray.slice(slice_range));
-        break;
-      }
-      case ParamCategory::SingleMutable: {
-        const GMutableSpan span = full_params.single_mutable(param_index);
-        const GMutableSpan sliced_span = span.slice(slice_range);
-        r_sliced_params.add_single_mutable(sliced_span);
-        break;
-      }
-      case ParamCategory::SingleOutput: {
-        if (bool(signature.params[param_index].flag & ParamFlag::SupportsUnusedOutput)) {
-          const GMutableSpan span = full_params.uninitialized_single_output_if_required(
-              param_index);
-          if (span.is_empty()) {
-            r_sliced_params.add_ignored_single_output();
-          }
-          else {
-            const GMutableSpan sliced_span = span.slice(slice_range);
-            r_sliced_params.add_uninitialized_single_output(sliced_span);
-          }
-        }
-        else {
-          const GMutableSpan span = full_params.uninitialized_single_output(param_index);
-          const GMutableSpan sliced_span = span.slice(slice_range);
-          r_sliced_params.add_uninitialized_single_output(sliced_span);
-        }
-        break;
-      }
-      case ParamCategory::VectorInput:
-      case ParamCategory::VectorMutable:
-      case ParamCategory::VectorOutput: {
-        BLI_assert_unreachable();
-        break;
-      }
-    }
-  }
-}
-
 void MultiFunction::call_auto(const IndexMask &mask, Params params, Context context) const
 {
   if (mask.is_empty()) {
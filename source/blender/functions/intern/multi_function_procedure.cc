@@ -228,6 +228,65 @@ ReturnInstruction &Procedure::new_return_instruction()
   return instruction;
 }
 
+void Procedure::delete_instructions(const Span<Instruction *> instructions)
+{
+  if (instructions.is_empty()) {
+    return;
+  }
+  Set<const Instruction *> instructions_to_delete;
+  for (Instruction *instruction : instructions) {
+    BLI_assert(instruction->prev_.is_empty());
+    BLI_assert(instruction != entry_);
+    instructions_to_delete.add(instruction);
+    switch (instruction->type_) {
+      case InstructionType::Call: {
+        CallInstruction &call_instr = static_cast<CallInstruction &>(*instruction);
+        call_instr.set_next(nullptr);
+        for (const int param_index : call_instr.params_.index_range()) {
+          call_instr.set_param_variable(param_index, nullptr);
+        }
+        break;
+      }
+      case InstructionType::Branch: {
+        BranchInstruction &branch_instr = static_cast<BranchInstruction &>(*instruction);
+        branch_instr.set_condition(nullptr);
+        branch_instr.set_branch_true(nullptr);
+        branch_instr.set_branch_false(nullptr);
+        break;
+      }
+      case InstructionType::Destruct: {
+        DestructInstruction &destruct_instr = static_cast<DestructInstruction &>(*instruction);
+        destruct_instr.set_variable(nullptr);
+        destruct_instr.set_next(nullptr);
+        break;
+      }
+      case InstructionType::Dummy: {
+        static_cast<DummyInstruction &>(*instruction).set_next(nullptr);
+        break;
+      }
+      case InstructionType::Return: {
+        break;
+      }
+    }
+  }
+
+  auto remove_deleted = [&](auto &instructions_vector) {
+    instructions_vector.remove_if([&](auto *instruction) {
+      if (instructions_to_delete.contains(instruction)) {
+        using InstructionT = std::remove_pointer_t<std::decay_t<decltype(instruction)>>;
+        instruction->~InstructionT();
+        return true;
+      }
+      return false;
+    });
+  };
+  remove_deleted(call_instructions_);
+  remove_deleted(branch_instructions_);
+  remove_deleted(destruct_instructions_);
+  remove_deleted(dummy_instructions_);
+  remove_deleted(return_instructions_);
+}
+
 void Procedure::add_parameter(ParamType::InterfaceType interface_type, Variable &variable)
 {
   params_.append({interface_type, &variable});
@@ -4,11 +4,15 @@
 
 #include "FN_multi_function_procedure_executor.hh"
 
+#include "BLI_set.hh"
 #include "BLI_stack.hh"
 
 namespace blender::fn::multi_function {
 
-ProcedureExecutor::ProcedureExecutor(const Procedure &procedure) : procedure_(procedure)
+static int64_t compute_tile_size(const Procedure &procedure);
+
+ProcedureExecutor::ProcedureExecutor(const Procedure &procedure)
+    : procedure_(procedure), tile_size_(compute_tile_size(procedure))
 {
   SignatureBuilder builder("Procedure Executor", signature_);
 
@@ -129,6 +133,12 @@ class ValueAllocator : NonCopyable, NonMovable {
   /** All buffers in the free-lists below have been allocated with this allocator. */
   LinearAllocator<> &linear_allocator_;
 
+  /**
+   * Span buffers are reused for different masks when the procedure is executed in tiles. Then all
+   * of them are allocated with the size of the largest tile.
+   */
+  int64_t min_span_buffer_size_;
+
   /**
    * Use stacks so that the most recently used buffers are reused first. This improves cache
    * efficiency.
@@ -149,7 +159,10 @@ class ValueAllocator : NonCopyable, NonMovable {
   Map<const CPPType *, Stack<void *>> single_value_free_lists_;
 
  public:
-  ValueAllocator(LinearAllocator<> &linear_allocator) : linear_allocator_(linear_allocator) {}
+  ValueAllocator(LinearAllocator<> &linear_allocator, const int64_t min_span_buffer_size = 0)
+      : linear_allocator_(linear_allocator), min_span_buffer_size_(min_span_buffer_size)
+  {
+  }
 
   VariableValue_GVArray *obtain_GVArray(const GVArray &varray)
   {
@@ -166,16 +179,26 @@ class ValueAllocator : NonCopyable, NonMovable {
     return this->obtain<VariableValue_Span>(buffer, false);
   }
 
+  /** Number of bytes per element of the buffers allocated by #obtain_Span. */
+  static int64_t span_buffer_element_size(const CPPType &type)
+  {
+    if (type.alignment > min_alignment) {
+      return type.size;
+    }
+    return std::max<int64_t>(type.size, small_value_max_size);
+  }
+
   VariableValue_Span *obtain_Span(const CPPType &type, int size)
   {
     void *buffer = nullptr;
 
     const int64_t element_size = type.size;
     const int64_t alignment = type.alignment;
+    const int64_t buffer_size = std::max<int64_t>(size, min_span_buffer_size_);
 
     if (alignment > min_alignment) {
       /* In this rare case we fall back to not reusing existing buffers. */
-      buffer = linear_allocator_.allocate(element_size * size, alignment);
+      buffer = linear_allocator_.allocate(span_buffer_element_size(type) * buffer_size, alignment);
     }
     else {
       Stack<void *> *stack = type.can_exist_in_buffer(small_value_max_size,
@@ -183,8 +206,8 @@ class ValueAllocator : NonCopyable, NonMovable {
                                  &small_span_buffers_free_list_ :
                                  span_buffers_free_lists_.lookup_ptr(element_size);
       if (stack == nullptr || stack->is_empty()) {
-        buffer = linear_allocator_.allocate(
-            std::max<int64_t>(element_size, small_value_max_size) * size, min_alignment);
+        buffer = linear_allocator_.allocate(span_buffer_element_size(type) * buffer_size,
+                                            min_alignment);
       }
       else {
         /* Reuse existing buffer. */
@@ -299,6 +322,53 @@ class ValueAllocator : NonCopyable, NonMovable {
   }
 };
 
+/**
+ * Intermediate buffers are allocated for all indices that are processed at once. For large masks
+ * it's better to process the indices in tiles whose intermediate buffers fit into the CPU cache,
+ * instead of writing every intermediate value to main memory and reading it back afterwards.
+ *
+ * \return The number of indices in one tile, or zero if the procedure should not be tiled.
+ */
+static int64_t compute_tile_size(const Procedure &procedure)
+{
+  /* Approximate cache size that the intermediate buffers of one tile should fit into. */
+  const int64_t cache_size = 256 * 1024;
+  const int64_t min_tile_size = 1024;
+  const int64_t max_tile_size = 64 * 1024;
+
+  Set<const Variable *> parameter_variables;
+  for (const ConstParameter &param : procedure.params()) {
+    if (param.variable->data_type().is_vector()) {
+      /* Vector parameters can't be sliced. */
+      return 0;
+    }
+    parameter_variables.add(param.variable);
+  }
+  int64_t intermediate_bytes_per_index = 0;
+  for (const Variable *variable : procedure.variables()) {
+    if (parameter_variables.contains(variable)) {
+      continue;
+    }
+    const DataType data_type = variable->data_type();
+    if (data_type.is_single()) {
+      /* Use the same size as the buffers that are actually allocated, which may be larger than
+       * the type. */
+      intermediate_bytes_per_index += ValueAllocator::span_buffer_element_size(
+          data_type.single_type());
+    }
+  }
+  if (intermediate_bytes_per_index == 0) {
+    /* All values are written to the buffers provided by the caller directly. */
+    return 0;
+  }
+  int64_t tile_size = min_tile_size;
+  while (tile_size < max_tile_size && tile_size * 2 * intermediate_bytes_per_index <= cache_size)
+  {
+    tile_size *= 2;
+  }
+  return tile_size;
+}
+
 /**
  * This class keeps track of a single variable during evaluation.
  */
@@ -813,17 +883,17 @@ class VariableState : NonCopyable, NonMovable {
 /** Keeps track of the states of all variables during evaluation. */
 class VariableStates {
  private:
-  ValueAllocator value_allocator_;
+  ValueAllocator &value_allocator_;
   const Procedure &procedure_;
   /** The state of every variable, indexed by #Variable::index_in_procedure(). */
   Array<VariableState> variable_states_;
   const IndexMask &full_mask_;
 
  public:
-  VariableStates(LinearAllocator<> &linear_allocator,
+  VariableStates(ValueAllocator &value_allocator,
                  const Procedure &procedure,
                  const IndexMask &full_mask)
-      : value_allocator_(linear_allocator),
+      : value_allocator_(value_allocator),
         procedure_(procedure),
         variable_states_(procedure.variables().size()),
         full_mask_(full_mask)
@@ -1157,19 +1227,18 @@ class InstructionScheduler {
   }
 };
 
-void ProcedureExecutor::call(const IndexMask &full_mask, Params params, Context context) const
+static void execute_procedure(const ProcedureExecutor &fn,
+                              const Procedure &procedure,
+                              const IndexMask &full_mask,
+                              Params params,
+                              const Context &context,
+                              ValueAllocator &value_allocator)
 {
-  BLI_assert(procedure_.validate());
-
-  AlignedBuffer<512, 64> local_buffer;
-  LinearAllocator<> linear_allocator;
-  linear_allocator.provide_buffer(local_buffer);
-
-  VariableStates variable_states{linear_allocator, procedure_, full_mask};
-  variable_states.add_initial_variable_states(*this, procedure_, params);
+  VariableStates variable_states{value_allocator, procedure, full_mask};
+  variable_states.add_initial_variable_states(fn, procedure, params);
 
   InstructionScheduler scheduler;
-  scheduler.add_referenced_indices(*procedure_.entry(), full_mask);
+  scheduler.add_referenced_indices(*procedure.entry(), full_mask);
 
   /* Loop until all indices got to a return instruction. */
   while (!scheduler.is_done()) {
@@ -1218,9 +1287,9 @@ void ProcedureExecutor::call(const IndexMask &full_mask, Params params, Context
     }
   }
 
-  for (const int param_index : this->param_indices()) {
-    const ParamType param_type = this->param_type(param_index);
-    const Variable *variable = procedure_.params()[param_index].variable;
+  for (const int param_index : fn.param_indices()) {
+    const ParamType param_type = fn.param_type(param_index);
+    const Variable *variable = procedure.params()[param_index].variable;
     VariableState &variable_state = variable_states.get_variable_state(*variable);
     switch (param_type.interface_type()) {
       case ParamType::Input: {
@@ -1241,6 +1310,41 @@ void ProcedureExecutor::call(const IndexMask &full_mask, Params params, Context
   }
 }
 
+void ProcedureExecutor::call(const IndexMask &full_mask, Params params, Context context) const
+{
+  BLI_assert(procedure_.validate());
+
+  AlignedBuffer<512, 64> local_buffer;
+  LinearAllocator<> linear_allocator;
+  linear_allocator.provide_buffer(local_buffer);
+
+  if (tile_size_ == 0 || full_mask.size() <= tile_size_) {
+    ValueAllocator value_allocator{linear_allocator};
+    execute_procedure(*this, procedure_, full_mask, params, context, value_allocator);
+    return;
+  }
+
+  /* Execute the procedure for one tile of indices after another, so that intermediate values
+   * stay in the CPU cache for the next instruction. The buffers are reused for all tiles. */
+  ValueAllocator value_allocator{linear_allocator, tile_size_};
+  const IndexRange bounds = full_mask.bounds();
+  for (int64_t tile_start = bounds.start(); tile_start < bounds.one_after_last();
+       tile_start += tile_size_)
+  {
+    const IndexRange tile_range(tile_start,
+                                std::min(tile_size_, bounds.one_after_last() - tile_start));
+    const IndexMask tile_mask = full_mask.slice_content(tile_range);
+    if (tile_mask.is_empty()) {
+      continue;
+    }
+    IndexMaskMemory memory;
+    const IndexMask shifted_tile_mask = tile_mask.shift(-tile_start, memory);
+    ParamsBuilder tile_params{*this, &shifted_tile_mask};
+    add_sliced_parameters(signature_, params, tile_range, tile_params);
+    execute_procedure(*this, procedure_, shifted_tile_mask, tile_params, context, value_allocator);
+  }
+}
+
 MultiFunction::ExecutionHints ProcedureExecutor::get_execution_hints() const
 {
   ExecutionHints hints;
@@ -2,6 +2,10 @@
  *
  * SPDX-License-Identifier: GPL-2.0-or-later */
 
+#include "BLI_multi_value_map.hh"
+#include "BLI_resource_scope.hh"
+
+#include "FN_multi_function_builder.hh"
 #include "FN_multi_function_procedure_optimization.hh"
 
 namespace blender::fn::multi_function::procedure_optimization {
@@ -74,4 +78,541 @@ void move_destructs_up(Procedure &procedure, Instruction &block_end_instr)
   }
 }
 
+/**
+ * \return All instructions from the entry to the return instruction, or nothing when the procedure
+ * is not a single chain of instructions.
+ */
+static Vector<Instruction *> find_instruction_chain(Procedure &procedure)
+{
+  Vector<Instruction *> chain;
+  Instruction *current_instr = procedure.entry();
+  while (current_instr != nullptr) {
+    chain.append(current_instr);
+    switch (current_instr->type()) {
+      case InstructionType::Call: {
+        current_instr = static_cast<CallInstruction *>(current_instr)->next();
+        break;
+      }
+      case InstructionType::Destruct: {
+        current_instr = static_cast<DestructInstruction *>(current_instr)->next();
+        break;
+      }
+      case InstructionType::Dummy: {
+        current_instr = static_cast<DummyInstruction *>(current_instr)->next();
+        break;
+      }
+      case InstructionType::Return: {
+        return chain;
+      }
+      case InstructionType::Branch: {
+        return {};
+      }
+    }
+  }
+  return {};
+}
+
+namespace {
+
+/**
+ * Knowing that a variable is assigned only once allows replacing it with another variable or a
+ * constant without having to check which instructions come between its uses.
+ */
+struct VariableAssignments {
+  /** Number of instructions and parameters that initialize or modify each variable. */
+  Array<int> assignments_num;
+  /** True for variables that are passed into or out of the procedure. */
+  Array<bool> is_parameter;
+
+  VariableAssignments(const Procedure &procedure, const Span<Instruction *> chain)
+      : assignments_num(procedure.variables().size(), 0),
+        is_parameter(procedure.variables().size(), false)
+  {
+    for (const ConstParameter &param : procedure.params()) {
+      const int variable_i = param.variable->index_in_procedure();
+      is_parameter[variable_i] = true;
+      if (ELEM(param.type, ParamType::Input, ParamType::Mutable)) {
+        assignments_num[variable_i]++;
+      }
+    }
+    for (const Instruction *instr : chain) {
+      if (instr->type() != InstructionType::Call) {
+        continue;
+      }
+      const CallInstruction &call_instr = static_cast<const CallInstruction &>(*instr);
+      const MultiFunction &fn = call_instr.fn();
+      for (const int param_index : fn.param_indices()) {
+        const Variable *variable = call_instr.params()[param_index];
+        if (variable == nullptr) {
+          continue;
+        }
+        if (fn.param_type(param_index).interface_type() != ParamType::Input) {
+          assignments_num[variable->index_in_procedure()]++;
+        }
+      }
+    }
+  }
+
+  bool is_assigned_once(const Variable &variable) const
+  {
+    return assignments_num[variable.index_in_procedure()] == 1;
+  }
+};
+
+}  // namespace
+
+static InstructionCursor cursor_after_instruction(Instruction &instr)
+{
+  switch (instr.type()) {
+    case InstructionType::Call:
+      return InstructionCursor(static_cast<CallInstruction &>(instr));
+    case InstructionType::Destruct:
+      return InstructionCursor(static_cast<DestructInstruction &>(instr));
+    case InstructionType::Dummy:
+      return InstructionCursor(static_cast<DummyInstruction &>(instr));
+    case InstructionType::Branch:
+    case InstructionType::Return:
+      break;
+  }
+  BLI_assert_unreachable();
+  return {};
+}
+
+/**
+ * Unlinks the instruction from the chain and from its variables. The instruction is added to
+ * \a r_instructions_to_delete, so that it can be deleted when it is not accessed anymore.
+ */
+static void remove_instruction(Procedure &procedure,
+                               Instruction &instr,
+                               Vector<Instruction *> &r_instructions_to_delete)
+{
+  const InstructionCursor cursor = cursor_after_instruction(instr);
+  Instruction *next_instr = cursor.next(procedure);
+  while (!instr.prev().is_empty()) {
+    /* Copy the cursor, because #set_next removes it from the previous cursors. */
+    const InstructionCursor prev_cursor = instr.prev()[0];
+    prev_cursor.set_next(procedure, next_instr);
+  }
+  cursor.set_next(procedure, nullptr);
+
+  if (instr.type() == InstructionType::Call) {
+    CallInstruction &call_instr = static_cast<CallInstruction &>(instr);
+    for (const int param_index : call_instr.params().index_range()) {
+      call_instr.set_param_variable(param_index, nullptr);
+    }
+  }
+  else if (instr.type() == InstructionType::Destruct) {
+    static_cast<DestructInstruction &>(instr).set_variable(nullptr);
+  }
+  r_instructions_to_delete.append(&instr);
+}
+
+static DestructInstruction *find_destruct_instruction(Variable &variable)
+{
+  for (Instruction *user : variable.users()) {
+    if (user->type() == InstructionType::Destruct) {
+      return static_cast<DestructInstruction *>(user);
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * \return True if the function can be evaluated at optimization time, because it only uses single
+ * values and all inputs are known already.
+ */
+static bool can_fold_call(const CallInstruction &call_instr,
+                          const Map<const Variable *, GPointer> &constant_values,
+                          const VariableAssignments &assignments)
+{
+  const MultiFunction &fn = call_instr.fn();
+  bool has_input = false;
+  for (const int param_index : fn.param_indices()) {
+    const Variable *variable = call_instr.params()[param_index];
+    switch (fn.param_type(param_index).category()) {
+      case ParamCategory::SingleInput: {
+        if (!constant_values.contains(variable)) {
+          return false;
+        }
+        has_input = true;
+        break;
+      }
+      case ParamCategory::SingleOutput: {
+        if (variable != nullptr && !assignments.is_assigned_once(*variable)) {
+          return false;
+        }
+        break;
+      }
+      default: {
+        return false;
+      }
+    }
+  }
+  return has_input;
+}
+
+void fold_constants(Procedure &procedure)
+{
+  const Vector<Instruction *> chain = find_instruction_chain(procedure);
+  const VariableAssignments assignments(procedure, chain);
+
+  /* Owns the computed values until they are copied into the new constant functions. */
+  ResourceScope scope;
+  Map<const Variable *, GPointer> constant_values;
+  Vector<Instruction *> instructions_to_delete;
+
+  for (Instruction *instr : chain) {
+    if (instr->type() != InstructionType::Call) {
+      continue;
+    }
+    CallInstruction &call_instr = static_cast<CallInstruction &>(*instr);
+    const MultiFunction &fn = call_instr.fn();
+    /* Constants that exist already are evaluated as well to get their values, but they don't have
+     * to be replaced. */
+    const bool is_constant = dynamic_cast<const CustomMF_GenericConstant *>(&fn) != nullptr;
+    if (is_constant) {
+      const Variable *variable = call_instr.params()[0];
+      if (variable == nullptr || !assignments.is_assigned_once(*variable)) {
+        continue;
+      }
+    }
+    else if (!can_fold_call(call_instr, constant_values, assignments)) {
+      continue;
+    }
+
+    const IndexMask mask(1);
+    ParamsBuilder params{fn, &mask};
+    ContextBuilder context;
+    Vector<std::pair<Variable *, GPointer>> outputs;
+    for (const int param_index : fn.param_indices()) {
+      const ParamType param_type = fn.param_type(param_index);
+      Variable *variable = call_instr.params()[param_index];
+      if (param_type.interface_type() == ParamType::Input) {
+        params.add_readonly_single_input(constant_values.lookup(variable));
+      }
+      else if (variable == nullptr) {
+        params.add_ignored_single_output();
+      }
+      else {
+        const CPPType &type = param_type.data_type().single_type();
+        void *buffer = scope.allocate_owned(type);
+        params.add_uninitialized_single_output(GMutableSpan(type, buffer, 1));
+        outputs.append({variable, GPointer(type, buffer)});
+      }
+    }
+    fn.call(mask, params, context);
+
+    for (const auto &[variable, value] : outputs) {
+      constant_values.add_new(variable, value);
+    }
+    if (is_constant) {
+      continue;
+    }
+
+    /* Replace the call with one constant function for every used output. */
+    for (const auto &[variable, value] : outputs) {
+      const MultiFunction &constant_fn = procedure.construct_function<CustomMF_GenericConstant>(
+          *value.type(), value.get(), true);
+      CallInstruction &constant_instr = procedure.new_call_instruction(constant_fn);
+      constant_instr.set_next(call_instr.next());
+      call_instr.set_next(&constant_instr);
+      constant_instr.set_param_variable(0, variable);
+    }
+    remove_instruction(procedure, call_instr, instructions_to_delete);
+  }
+
+  procedure.delete_instructions(instructions_to_delete);
+}
+
+/**
+ * \return True if the call computes its outputs only from its inputs, and all variables that it
+ * uses are assigned only once. Calls with equal functions and inputs compute the same outputs.
+ */
+static bool is_pure_call(const CallInstruction &call_instr, const VariableAssignments &assignments)
+{
+  const MultiFunction &fn = call_instr.fn();
+  bool has_output = false;
+  for (const int param_index : fn.param_indices()) {
+    const Variable *variable = call_instr.params()[param_index];
+    switch (fn.param_type(param_index).interface_type()) {
+      case ParamType::Input: {
+        if (!assignments.is_assigned_once(*variable)) {
+          return false;
+        }
+        break;
+      }
+      case ParamType::Output: {
+        if (variable != nullptr) {
+          if (!assignments.is_assigned_once(*variable)) {
+            return false;
+          }
+          has_output = true;
+        }
+        break;
+      }
+      case ParamType::Mutable: {
+        return false;
+      }
+    }
+  }
+  return has_output;
+}
+
+static uint64_t call_hash(const CallInstruction &call_instr)
+{
+  const MultiFunction &fn = call_instr.fn();
+  uint64_t hash = fn.hash();
+  for (const int param_index : fn.param_indices()) {
+    if (fn.param_type(param_index).interface_type() == ParamType::Input) {
+      hash = get_default_hash(hash, call_instr.params()[param_index]);
+    }
+  }
+  return hash;
+}
+
+static bool calls_compute_same_values(const CallInstruction &a, const CallInstruction &b)
+{
+  const MultiFunction &fn = a.fn();
+  if (&fn != &b.fn() && !fn.equals(b.fn())) {
+    return false;
+  }
+  if (fn.param_amount() != b.fn().param_amount()) {
+    return false;
+  }
+  for (const int param_index : fn.param_indices()) {
+    if (fn.param_type(param_index).interface_type() == ParamType::Input) {
+      if (a.params()[param_index] != b.params()[param_index]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * \return True if an output of the call is an output of the procedure as well. Such a call can't
+ * be removed, because the parameter variables of the procedure can't be replaced.
+ */
+static bool has_output_parameter(const CallInstruction &call_instr,
+                                 const VariableAssignments &assignments)
+{
+  const MultiFunction &fn = call_instr.fn();
+  for (const int param_index : fn.param_indices()) {
+    const Variable *variable = call_instr.params()[param_index];
+    if (variable == nullptr || fn.param_type(param_index).interface_type() != ParamType::Output) {
+      continue;
+    }
+    if (assignments.is_parameter[variable->index_in_procedure()]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Replaces all uses of \a old_variable with \a new_variable. Only one of the destruct instructions
+ * is kept, the one that comes later in the chain.
+ */
+static void replace_variable(Procedure &procedure,
+                             Variable &old_variable,
+                             Variable &new_variable,
+                             const Map<const Instruction *, int> &chain_indices,
+                             Vector<Instruction *> &r_instructions_to_delete)
+{
+  DestructInstruction *old_destruct = find_destruct_instruction(old_variable);
+  DestructInstruction *new_destruct = find_destruct_instruction(new_variable);
+
+  /* Copy the users, because they are modified in the loop. */
+  const Vector<Instruction *> users = old_variable.users();
+  for (Instruction *user : users) {
+    if (user->type() != InstructionType::Call) {
+      continue;
+    }
+    CallInstruction &call_instr = static_cast<CallInstruction &>(*user);
+    for (const int param_index : call_instr.params().index_range()) {
+      if (call_instr.params()[param_index] == &old_variable) {
+        call_instr.set_param_variable(param_index, &new_variable);
+      }
+    }
+  }
+
+  if (old_destruct == nullptr) {
+    return;
+  }
+  if (new_destruct == nullptr) {
+    /* The new variable is an output of the procedure. */
+    remove_instruction(procedure, *old_destruct, r_instructions_to_delete);
+  }
+  else if (chain_indices.lookup(old_destruct) > chain_indices.lookup(new_destruct)) {
+    remove_instruction(procedure, *new_destruct, r_instructions_to_delete);
+    old_destruct->set_variable(&new_variable);
+  }
+  else {
+    remove_instruction(procedure, *old_destruct, r_instructions_to_delete);
+  }
+}
+
+void eliminate_common_subexpressions(Procedure &procedure)
+{
+  const Vector<Instruction *> chain = find_instruction_chain(procedure);
+  const VariableAssignments assignments(procedure, chain);
+
+  Map<const Instruction *, int> chain_indices;
+  for (const int i : chain.index_range()) {
+    chain_indices.add_new(chain[i], i);
+  }
+
+  MultiValueMap<uint64_t, CallInstruction *> calls_by_hash;
+  Vector<Instruction *> instructions_to_delete;
+
+  for (Instruction *instr : chain) {
+    if (instr->type() != InstructionType::Call) {
+      continue;
+    }
+    CallInstruction &call_instr = static_cast<CallInstruction &>(*instr);
+    if (!is_pure_call(call_instr, assignments)) {
+      continue;
+    }
+    const uint64_t hash = call_hash(call_instr);
+    CallInstruction *earlier_call_instr = nullptr;
+    for (CallInstruction *other_call_instr : calls_by_hash.lookup(hash)) {
+      if (calls_compute_same_values(*other_call_instr, call_instr)) {
+        earlier_call_instr = other_call_instr;
+        break;
+      }
+    }
+    if (earlier_call_instr == nullptr || has_output_parameter(call_instr, assignments)) {
+      calls_by_hash.add(hash, &call_instr);
+      continue;
+    }
+
+    const MultiFunction &fn = call_instr.fn();
+
+    for (const int param_index : fn.param_indices()) {
+      if (fn.param_type(param_index).interface_type() != ParamType::Output) {
+        continue;
+      }
+      Variable *variable = call_instr.params()[param_index];
+      if (variable == nullptr) {
+        continue;
+      }
+      call_instr.set_param_variable(param_index, nullptr);
+      Variable *earlier_variable = earlier_call_instr->params()[param_index];
+      if (earlier_variable == nullptr) {
+        /* The output was ignored by the earlier call, so it can just compute it as well. */
+        earlier_call_instr->set_param_variable(param_index, variable);
+        continue;
+      }
+      replace_variable(
+          procedure, *variable, *earlier_variable, chain_indices, instructions_to_delete);
+    }
+    remove_instruction(procedure, call_instr, instructions_to_delete);
+  }
+
+  procedure.delete_instructions(instructions_to_delete);
+}
+
+/**
+ * \return True if the variable is used by any instruction other than \a defining_instr and
+ * destruct instructions.
+ */
+static bool variable_is_used(Variable &variable,
+                             const Instruction &defining_instr,
+                             const VariableAssignments &assignments)
+{
+  if (assignments.is_parameter[variable.index_in_procedure()]) {
+    return true;
+  }
+  for (const Instruction *user : variable.users()) {
+    if (user != &defining_instr && user->type() != InstructionType::Destruct) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void remove_destruct_instructions(Procedure &procedure,
+                                         Variable &variable,
+                                         Vector<Instruction *> &r_instructions_to_delete)
+{
+  while (DestructInstruction *destruct_instr = find_destruct_instruction(variable)) {
+    remove_instruction(procedure, *destruct_instr, r_instructions_to_delete);
+  }
+}
+
+void remove_dead_instructions(Procedure &procedure)
+{
+  const Vector<Instruction *> chain = find_instruction_chain(procedure);
+  const VariableAssignments assignments(procedure, chain);
+
+  Vector<Instruction *> instructions_to_delete;
+
+  /* Iterate backwards, so that removing an instruction can make earlier instructions unused. */
+  for (int64_t i = chain.size() - 1; i >= 0; i--) {
+    if (chain[i]->type() != InstructionType::Call) {
+      continue;
+    }
+    CallInstruction &call_instr = static_cast<CallInstruction &>(*chain[i]);
+    const MultiFunction &fn = call_instr.fn();
+    bool has_output = false;
+    bool has_used_output = false;
+    bool has_mutable = false;
+    Vector<int> unused_output_params;
+    for (const int param_index : fn.param_indices()) {
+      Variable *variable = call_instr.params()[param_index];
+      switch (fn.param_type(param_index).interface_type()) {
+        case ParamType::Input: {
+          break;
+        }
+        case ParamType::Output: {
+          has_output = true;
+          if (variable == nullptr) {
+            break;
+          }
+          if (variable_is_used(*variable, call_instr, assignments)) {
+            has_used_output = true;
+          }
+          else {
+            unused_output_params.append(param_index);
+          }
+          break;
+        }
+        case ParamType::Mutable: {
+          has_mutable = true;
+          break;
+        }
+      }
+    }
+    if (has_mutable || !has_output) {
+      continue;
+    }
+    if (!has_used_output) {
+      for (const int param_index : unused_output_params) {
+        remove_destruct_instructions(
+            procedure, *call_instr.params()[param_index], instructions_to_delete);
+      }
+      remove_instruction(procedure, call_instr, instructions_to_delete);
+      continue;
+    }
+    for (const int param_index : unused_output_params) {
+      if (fn.param_type(param_index).category() != ParamCategory::SingleOutput) {
+        /* Only single outputs are optional. */
+        continue;
+      }
+      remove_destruct_instructions(
+          procedure, *call_instr.params()[param_index], instructions_to_delete);
+      call_instr.set_param_variable(param_index, nullptr);
+    }
+  }
+
+  procedure.delete_instructions(instructions_to_delete);
+}
+
+void optimize_instructions(Procedure &procedure)
+{
+  fold_constants(procedure);
+  eliminate_common_subexpressions(procedure);
+  remove_dead_instructions(procedure);
+}
+
 }  // namespace blender::fn::multi_function::procedure_optimization
@@ -4,7 +4,10 @@
 
 #include "testing/testing.h"
 
+#include <atomic>
+
 #include "BLI_cpp_type.hh"
+#include "BLI_timeit.hh"
 #include "FN_field.hh"
 #include "FN_multi_function_builder.hh"
 #include "FN_multi_function_test_common.hh"
@@ -280,4 +283,71 @@ TEST(field, IgnoredOutput)
   EXPECT_EQ(results.get(3), 5);
 }
 
+TEST(field, DuplicateOperations)
+{
+  /* Separate operations that compute the same values are only evaluated once. */
+  GField index_field{std::make_shared<IndexFieldInput>()};
+
+  std::atomic<int> add_calls_num = 0;
+  auto add_fn = mf::build::SI2_SO<int, int, int>("add", [&](int a, int b) {
+    add_calls_num++;
+    return a + b;
+  });
+  GField double_field_1{FieldOperation::from(add_fn, {index_field, index_field}), 0};
+  GField double_field_2{FieldOperation::from(add_fn, {index_field, index_field}), 0};
+  GField output_field{FieldOperation::from(add_fn, {double_field_1, double_field_2}), 0};
+
+  Array<int> result(10);
+  FieldContext context;
+  FieldEvaluator evaluator{context, 10};
+  evaluator.add_with_destination(output_field, result.as_mutable_span());
+  evaluator.evaluate();
+  EXPECT_EQ(add_calls_num, 20);
+  EXPECT_EQ(result[0], 0);
+  EXPECT_EQ(result[3], 12);
+  EXPECT_EQ(result[9], 36);
+}
+
+/* Disable benchmark by default. */
+#if 0
+TEST(field, ElementWiseChainBenchmark)
+{
+  /* A chain of simple math operations, like the ones built by math nodes. */
+  class FloatIndexFieldInput final : public FieldInput {
+   public:
+    FloatIndexFieldInput() : FieldInput(CPPType::get<float>(), "Float Index") {}
+
+    GVArray get_varray_for_context(const FieldContext & /*context*/,
+                                   const IndexMask &mask,
+                                   ResourceScope & /*scope*/) const final
+    {
+      return VArray<float>::from_func(mask.min_array_size(),
+                                      [](const int64_t i) { return float(i) * 0.001f; });
+    }
+  };
+  static auto add_fn = mf::build::SI2_SO<float, float, float>(
+      "add", [](float a, float b) { return a + b; });
+  static auto mul_fn = mf::build::SI2_SO<float, float, float>(
+      "mul", [](float a, float b) { return a * b; });
+
+  Field<float> field{std::make_shared<FloatIndexFieldInput>()};
+  for (const int i : IndexRange(8)) {
+    const Field<float> constant_field = fn::make_constant_field<float>(float(i) * 0.5f);
+    const mf::MultiFunction &fn = (i % 2) ? static_cast<const mf::MultiFunction &>(add_fn) :
+                                            mul_fn;
+    field = Field<float>(FieldOperation::from(fn, {field, constant_field}));
+  }
+
+  const int size = 10'000'000;
+  Array<float> result(size);
+  FieldContext context;
+  for ([[maybe_unused]] const int run : IndexRange(5)) {
+    SCOPED_TIMER_AVERAGED("evaluate chain");
+    FieldEvaluator evaluator{context, size};
+    evaluator.add_with_destination(field, result.as_mutable_span());
+    evaluator.evaluate();
+  }
+}
+#endif
+
 }  // namespace blender::fn::tests
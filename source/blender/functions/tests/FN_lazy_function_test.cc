@@ -9,6 +9,7 @@
 #include "FN_lazy_function_graph_executor.hh"
 
 #include "BLI_task.h"
+#include "BLI_timeit.hh"
 
 namespace blender::fn::lazy_function::tests {
 
@@ -178,4 +179,189 @@ TEST(lazy_function, GraphWithCycle)
   EXPECT_EQ(result, 10 * 2 * 5);
 }
 
+TEST(lazy_function, StaticExecutionPlan)
+{
+  const AddLazyFunction add_fn;
+
+  /* Nodes are added in an order that is different from the topological order. */
+  Graph graph;
+  FunctionNode &add_node_3 = graph.add_function(add_fn);
+  FunctionNode &add_node_2 = graph.add_function(add_fn);
+  FunctionNode &add_node_1 = graph.add_function(add_fn);
+  GraphInputSocket &graph_input_1 = graph.add_input(CPPType::get<int>());
+  GraphInputSocket &graph_input_2 = graph.add_input(CPPType::get<int>());
+  GraphInputSocket &unused_graph_input = graph.add_input(CPPType::get<int>());
+  GraphOutputSocket &graph_output_1 = graph.add_output(CPPType::get<int>());
+  GraphOutputSocket &graph_output_2 = graph.add_output(CPPType::get<int>());
+
+  graph.add_link(graph_input_1, add_node_1.input(0));
+  graph.add_link(graph_input_2, add_node_1.input(1));
+  graph.add_link(add_node_1.output(0), add_node_2.input(0));
+  graph.add_link(add_node_1.output(0), add_node_3.input(0));
+  graph.add_link(add_node_2.output(0), add_node_3.input(1));
+  graph.add_link(add_node_3.output(0), graph_output_1);
+  graph.add_link(graph_input_1, graph_output_2);
+
+  const int value_100 = 100;
+  add_node_2.input(1).set_default_value(&value_100);
+
+  graph.update_node_indices();
+
+  GraphExecutor executor_fn{graph,
+                            {&graph_input_1, &graph_input_2, &unused_graph_input},
+                            {&graph_output_1, &graph_output_2},
+                            nullptr,
+                            nullptr,
+                            nullptr};
+  /* Inputs that every output depends on are always used. */
+  EXPECT_EQ(executor_fn.inputs()[0].usage, ValueUsage::Used);
+  EXPECT_EQ(executor_fn.inputs()[1].usage, ValueUsage::Maybe);
+  EXPECT_EQ(executor_fn.inputs()[2].usage, ValueUsage::Maybe);
+
+  int result_1 = 0;
+  int result_2 = 0;
+  execute_lazy_function_eagerly(executor_fn,
+                                nullptr,
+                                nullptr,
+                                std::make_tuple(3, 4, 5),
+                                std::make_tuple(&result_1, &result_2));
+  EXPECT_EQ(result_1, (3 + 4) + ((3 + 4) + 100));
+  EXPECT_EQ(result_2, 3);
+}
+
+class SwitchLazyFunction : public LazyFunction {
+ public:
+  SwitchLazyFunction()
+  {
+    debug_name_ = "Switch";
+    inputs_.append({"Condition", CPPType::get<bool>()});
+    inputs_.append({"False", CPPType::get<int>(), ValueUsage::Maybe});
+    inputs_.append({"True", CPPType::get<int>(), ValueUsage::Maybe});
+    outputs_.append({"Result", CPPType::get<int>()});
+  }
+
+  void execute_impl(Params &params, const Context & /*context*/) const override
+  {
+    const bool condition = params.get_input<bool>(0);
+    if (const int *value = params.try_get_input_data_ptr_or_request<int>(condition ? 2 : 1)) {
+      params.set_output(0, *value);
+    }
+  }
+};
+
+TEST(lazy_function, StaticExecutionPlanMaybeInputs)
+{
+  const SwitchLazyFunction switch_fn;
+
+  Graph graph;
+  FunctionNode &switch_node = graph.add_function(switch_fn);
+  GraphInputSocket &condition_input = graph.add_input(CPPType::get<bool>());
+  GraphInputSocket &false_input = graph.add_input(CPPType::get<int>());
+  GraphInputSocket &true_input = graph.add_input(CPPType::get<int>());
+  GraphOutputSocket &graph_output = graph.add_output(CPPType::get<int>());
+
+  graph.add_link(condition_input, switch_node.input(0));
+  graph.add_link(false_input, switch_node.input(1));
+  graph.add_link(true_input, switch_node.input(2));
+  graph.add_link(switch_node.output(0), graph_output);
+  graph.update_node_indices();
+
+  GraphExecutor executor_fn{graph,
+                            {&condition_input, &false_input, &true_input},
+                            {&graph_output},
+                            nullptr,
+                            nullptr,
+                            nullptr};
+  /* The branches of the switch are still requested lazily. */
+  EXPECT_EQ(executor_fn.inputs()[0].usage, ValueUsage::Used);
+  EXPECT_EQ(executor_fn.inputs()[1].usage, ValueUsage::Maybe);
+  EXPECT_EQ(executor_fn.inputs()[2].usage, ValueUsage::Maybe);
+
+  int result = 0;
+  execute_lazy_function_eagerly(
+      executor_fn, nullptr, nullptr, std::make_tuple(true, 3, 4), std::make_tuple(&result));
+  EXPECT_EQ(result, 4);
+}
+
+/* Disable benchmark by default. */
+#if 0
+/**
+ * Same as #AddLazyFunction but it requests its inputs lazily, so that a graph using it can't be
+ * executed in a static order.
+ */
+class LazyAddLazyFunction : public LazyFunction {
+ public:
+  LazyAddLazyFunction()
+  {
+    debug_name_ = "Lazy Add";
+    inputs_.append({"A", CPPType::get<int>(), ValueUsage::Maybe});
+    inputs_.append({"B", CPPType::get<int>(), ValueUsage::Maybe});
+    outputs_.append({"Result", CPPType::get<int>()});
+  }
+
+  void execute_impl(Params &params, const Context & /*context*/) const override
+  {
+    const int *a = params.try_get_input_data_ptr_or_request<int>(0);
+    const int *b = params.try_get_input_data_ptr_or_request<int>(1);
+    if (a && b) {
+      params.set_output(0, *a + *b);
+    }
+  }
+};
+
+static void benchmark_repeated_body(const LazyFunction &add_fn, const char *name)
+{
+  /* Build a small body graph similar to the body of a repeat zone. */
+  const int body_nodes_num = 8;
+  const int iterations_num = 10000;
+  const int value_1 = 1;
+
+  Graph body_graph;
+  GraphInputSocket &body_input = body_graph.add_input(CPPType::get<int>());
+  GraphOutputSocket &body_output = body_graph.add_output(CPPType::get<int>());
+  OutputSocket *prev_socket = &body_input;
+  for ([[maybe_unused]] const int i : IndexRange(body_nodes_num)) {
+    FunctionNode &node = body_graph.add_function(add_fn);
+    body_graph.add_link(*prev_socket, node.input(0));
+    node.input(1).set_default_value(&value_1);
+    prev_socket = &node.output(0);
+  }
+  body_graph.add_link(*prev_socket, body_output);
+  body_graph.update_node_indices();
+  const GraphExecutor body_fn{body_graph, nullptr, nullptr, nullptr};
+
+  /* The repeat zone creates a node for every iteration, all of which evaluate the body. */
+  Graph graph;
+  GraphInputSocket &graph_input = graph.add_input(CPPType::get<int>());
+  GraphOutputSocket &graph_output = graph.add_output(CPPType::get<int>());
+  prev_socket = &graph_input;
+  for ([[maybe_unused]] const int i : IndexRange(iterations_num)) {
+    FunctionNode &node = graph.add_function(body_fn);
+    graph.add_link(*prev_socket, node.input(0));
+    prev_socket = &node.output(0);
+  }
+  graph.add_link(*prev_socket, graph_output);
+  graph.update_node_indices();
+  const GraphExecutor executor_fn{graph, nullptr, nullptr, nullptr};
+
+  for ([[maybe_unused]] const int i : IndexRange(5)) {
+    int result = 0;
+    {
+      SCOPED_TIMER(name);
+      execute_lazy_function_eagerly(
+          executor_fn, nullptr, nullptr, std::make_tuple(0), std::make_tuple(&result));
+    }
+    EXPECT_EQ(result, body_nodes_num * iterations_num);
+  }
+}
+
+TEST(lazy_function, RepeatedBodyBenchmark)
+{
+  const LazyAddLazyFunction lazy_add_fn;
+  const AddLazyFunction add_fn;
+  benchmark_repeated_body(lazy_add_fn, "dynamic");
+  benchmark_repeated_body(add_fn, "static plan");
+}
+#endif
+
 }  // namespace blender::fn::lazy_function::tests
@@ -4,11 +4,16 @@
 
 #include "testing/testing.h"
 
+#include <cmath>
+
 #include "FN_multi_function_builder.hh"
 #include "FN_multi_function_procedure_builder.hh"
 #include "FN_multi_function_procedure_executor.hh"
+#include "FN_multi_function_procedure_optimization.hh"
 #include "FN_multi_function_test_common.hh"
 
+#include "BLI_timeit.hh"
+
 namespace blender::fn::multi_function::tests {
 
 TEST(multi_function_procedure, ConstantOutput)
@@ -423,4 +428,327 @@ TEST(multi_function_procedure, OutputBufferReplaced)
   EXPECT_EQ(output[2], output_value);
 }
 
+static int count_call_instructions(const Procedure &procedure)
+{
+  int count = 0;
+  for (const Instruction *instr = procedure.entry(); instr->type() != InstructionType::Return;) {
+    if (instr->type() == InstructionType::Call) {
+      instr = static_cast<const CallInstruction *>(instr)->next();
+      count++;
+    }
+    else {
+      instr = static_cast<const DestructInstruction *>(instr)->next();
+    }
+  }
+  return count;
+}
+
+TEST(multi_function_procedure, EliminateCommonSubexpressions)
+{
+  /**
+   * procedure(int var1, int *var5) {
+   *   var2 = var1 + var1;
+   *   var3 = var1 + var1;
+   *   var4 = var2 * var3;
+   *   var5 = var4 + var4;
+   * }
+   */
+
+  int add_calls_num = 0;
+  auto add_fn = build::SI2_SO<int, int, int>("add", [&](int a, int b) {
+    add_calls_num++;
+    return a + b;
+  });
+  auto mul_fn = build::SI2_SO<int, int, int>("mul", [](int a, int b) { return a * b; });
+
+  Procedure procedure;
+  ProcedureBuilder builder{procedure};
+
+  Variable *var1 = &builder.add_single_input_parameter<int>();
+  auto [var2] = builder.add_call<1>(add_fn, {var1, var1});
+  auto [var3] = builder.add_call<1>(add_fn, {var1, var1});
+  auto [var4] = builder.add_call<1>(mul_fn, {var2, var3});
+  auto [var5] = builder.add_call<1>(add_fn, {var4, var4});
+  builder.add_destruct({var1, var2, var3, var4});
+  builder.add_return();
+  builder.add_output_parameter(*var5);
+
+  EXPECT_TRUE(procedure.validate());
+  procedure_optimization::eliminate_common_subexpressions(procedure);
+  EXPECT_TRUE(procedure.validate());
+  EXPECT_EQ(count_call_instructions(procedure), 3);
+
+  ProcedureExecutor executor{procedure};
+
+  const IndexMask mask(3);
+  ParamsBuilder params{executor, &mask};
+  ContextBuilder context;
+
+  Array<int> input_array = {1, 2, 3};
+  params.add_readonly_single_input(input_array.as_span());
+  Array<int> output_array(3);
+  params.add_uninitialized_single_output(output_array.as_mutable_span());
+
+  executor.call(mask, params, context);
+
+  EXPECT_EQ(add_calls_num, 6);
+  EXPECT_EQ(output_array[0], 8);
+  EXPECT_EQ(output_array[1], 32);
+  EXPECT_EQ(output_array[2], 72);
+}
+
+TEST(multi_function_procedure, FoldConstants)
+{
+  /**
+   * procedure(int var1, int *var5) {
+   *   var2 = 5;
+   *   var3 = var2 + var2;
+   *   var4 = var3 + var3;
+   *   var5 = var1 + var4;
+   * }
+   */
+
+  int add_calls_num = 0;
+  auto add_fn = build::SI2_SO<int, int, int>("add", [&](int a, int b) {
+    add_calls_num++;
+    return a + b;
+  });
+  const int value = 5;
+  CustomMF_GenericConstant constant_fn(CPPType::get<int>(), &value, false);
+
+  Procedure procedure;
+  ProcedureBuilder builder{procedure};
+
+  Variable *var1 = &builder.add_single_input_parameter<int>();
+  auto [var2] = builder.add_call<1>(constant_fn);
+  auto [var3] = builder.add_call<1>(add_fn, {var2, var2});
+  auto [var4] = builder.add_call<1>(add_fn, {var3, var3});
+  auto [var5] = builder.add_call<1>(add_fn, {var1, var4});
+  builder.add_destruct({var1, var2, var3, var4});
+  builder.add_return();
+  builder.add_output_parameter(*var5);
+
+  procedure_optimization::fold_constants(procedure);
+  EXPECT_TRUE(procedure.validate());
+  EXPECT_EQ(add_calls_num, 2);
+  procedure_optimization::remove_dead_instructions(procedure);
+  EXPECT_TRUE(procedure.validate());
+  /* Only the constant that is used by the last call remains. */
+  EXPECT_EQ(count_call_instructions(procedure), 2);
+
+  ProcedureExecutor executor{procedure};
+
+  const IndexMask mask(3);
+  ParamsBuilder params{executor, &mask};
+  ContextBuilder context;
+
+  Array<int> input_array = {1, 2, 3};
+  params.add_readonly_single_input(input_array.as_span());
+  Array<int> output_array(3);
+  params.add_uninitialized_single_output(output_array.as_mutable_span());
+
+  executor.call(mask, params, context);
+
+  EXPECT_EQ(add_calls_num, 5);
+  EXPECT_EQ(output_array[0], 21);
+  EXPECT_EQ(output_array[1], 22);
+  EXPECT_EQ(output_array[2], 23);
+}
+
+TEST(multi_function_procedure, RemoveDeadInstructions)
+{
+  /**
+   * procedure(int var1, int *var4) {
+   *   var2 = var1 + var1;
+   *   var3, var4 = optional_outputs();
+   *   var5 = var2 + var3;
+   * }
+   */
+
+  auto add_fn = build::SI2_SO<int, int, int>("add", [](int a, int b) { return a + b; });
+  OptionalOutputsFunction optional_outputs_fn;
+
+  Procedure procedure;
+  ProcedureBuilder builder{procedure};
+
+  Variable *var1 = &builder.add_single_input_parameter<int>();
+  auto [var2] = builder.add_call<1>(add_fn, {var1, var1});
+  auto [var3, var4] = builder.add_call<2>(optional_outputs_fn);
+  auto [var5] = builder.add_call<1>(add_fn, {var2, var3});
+  builder.add_destruct({var1, var2, var3, var5});
+  builder.add_return();
+  builder.add_output_parameter(*var4);
+
+  procedure_optimization::remove_dead_instructions(procedure);
+  EXPECT_TRUE(procedure.validate());
+  EXPECT_EQ(count_call_instructions(procedure), 1);
+
+  ProcedureExecutor executor{procedure};
+
+  const IndexMask mask(2);
+  ParamsBuilder params{executor, &mask};
+  ContextBuilder context;
+
+  Array<int> input_array = {1, 2};
+  params.add_readonly_single_input(input_array.as_span());
+  Array<std::string> output_array(2);
+  params.add_uninitialized_single_output(output_array.as_mutable_span());
+
+  executor.call(mask, params, context);
+
+  EXPECT_EQ(output_array[0], "hello, this is a long string");
+  EXPECT_EQ(output_array[1], "hello, this is a long string");
+}
+
+TEST(multi_function_procedure, OptimizeReassignedVariable)
+{
+  /* Variables that are assigned more than once are not changed. */
+  Procedure procedure;
+  ProcedureBuilder builder{procedure};
+
+  const int value = 42;
+  CustomMF_GenericConstant constant_fn(CPPType::get<int>(), &value, false);
+  Variable &var_o = procedure.new_variable(DataType::ForSingle<int>());
+  builder.add_output_parameter(var_o);
+  builder.add_call_with_all_variables(constant_fn, {&var_o});
+  builder.add_destruct(var_o);
+  builder.add_call_with_all_variables(constant_fn, {&var_o});
+  builder.add_return();
+
+  procedure_optimization::optimize_instructions(procedure);
+  EXPECT_TRUE(procedure.validate());
+  EXPECT_EQ(count_call_instructions(procedure), 2);
+}
+
+TEST(multi_function_procedure, TiledExecution)
+{
+  /**
+   * procedure(int var1, int *var3) {
+   *   var2 = var1 + var1;
+   *   var3 = var1 * var2;
+   * }
+   */
+
+  auto add_fn = build::SI2_SO<int, int, int>("add", [](int a, int b) { return a + b; });
+  auto mul_fn = build::SI2_SO<int, int, int>("mul", [](int a, int b) { return a * b; });
+
+  Procedure procedure;
+  ProcedureBuilder builder{procedure};
+
+  Variable *var1 = &builder.add_single_input_parameter<int>();
+  auto [var2] = builder.add_call<1>(add_fn, {var1, var1});
+  auto [var3] = builder.add_call<1>(mul_fn, {var1, var2});
+  builder.add_destruct({var1, var2});
+  builder.add_return();
+  builder.add_output_parameter(*var3);
+
+  EXPECT_TRUE(procedure.validate());
+
+  ProcedureExecutor executor{procedure};
+
+  /* The mask is large enough to be split into multiple tiles, which are not all full. */
+  const int size = 300'000;
+  IndexMaskMemory memory;
+  const IndexMask mask = IndexMask::from_predicate(
+      IndexRange(size), GrainSize(4096), memory, [](const int64_t i) {
+        return i % 3 != 0 && !IndexRange(40'000, 100'000).contains(i);
+      });
+  ParamsBuilder params{executor, &mask};
+  ContextBuilder context;
+
+  Array<int> input_array(size);
+  for (const int i : input_array.index_range()) {
+    input_array[i] = i % 1000;
+  }
+  params.add_readonly_single_input(input_array.as_span());
+  Array<int> output_array(size, -1);
+  params.add_uninitialized_single_output(output_array.as_mutable_span());
+
+  executor.call(mask, params, context);
+
+  for (const int i : output_array.index_range()) {
+    const int expected = mask.contains(i) ? 2 * input_array[i] * input_array[i] : -1;
+    if (output_array[i] != expected) {
+      EXPECT_EQ(output_array[i], expected);
+      break;
+    }
+  }
+}
+
+/* Disable benchmark by default. */
+#if 0
+/**
+ * Builds a procedure like the ones created for field trees that use the same node group multiple
+ * times. Every group instance recomputes the same values from the input and its own constants.
+ */
+static void build_repeated_groups_procedure(Procedure &procedure, const int groups_num)
+{
+  static auto add_fn = build::SI2_SO<float, float, float>(
+      "add", [](float a, float b) { return a + b; });
+  static auto mul_fn = build::SI2_SO<float, float, float>(
+      "mul", [](float a, float b) { return a * b; });
+  static auto sin_fn = build::SI1_SO<float, float>("sin", [](float a) { return std::sin(a); });
+  const float scale = 3.0f;
+
+  ProcedureBuilder builder{procedure};
+  Variable *var_in = &builder.add_single_input_parameter<float>();
+  Vector<Variable *> variables_to_destruct = {var_in};
+  Variable *var_sum = nullptr;
+  for ([[maybe_unused]] const int i : IndexRange(groups_num)) {
+    const MultiFunction &scale_fn = procedure.construct_function<CustomMF_GenericConstant>(
+        CPPType::get<float>(), &scale, true);
+    auto [var_scale] = builder.add_call<1>(scale_fn);
+    auto [var_scale_2] = builder.add_call<1>(mul_fn, {var_scale, var_scale});
+    auto [var_scaled] = builder.add_call<1>(mul_fn, {var_in, var_scale_2});
+    auto [var_sin] = builder.add_call<1>(sin_fn, {var_scaled});
+    variables_to_destruct.extend({var_scale, var_scale_2, var_scaled});
+    if (var_sum == nullptr) {
+      var_sum = var_sin;
+    }
+    else {
+      auto [var_new_sum] = builder.add_call<1>(add_fn, {var_sum, var_sin});
+      variables_to_destruct.extend({var_sum, var_sin});
+      var_sum = var_new_sum;
+    }
+  }
+  builder.add_destruct(variables_to_destruct);
+  builder.add_return();
+  builder.add_output_parameter(*var_sum);
+}
+
+static void benchmark_repeated_groups_procedure(const bool optimize)
+{
+  Procedure procedure;
+  build_repeated_groups_procedure(procedure, 10);
+  if (optimize) {
+    SCOPED_TIMER("optimize");
+    procedure_optimization::optimize_instructions(procedure);
+  }
+  BLI_assert(procedure.validate());
+  ProcedureExecutor executor{procedure};
+
+  const int size = 1'000'000;
+  Array<float> inputs(size);
+  for (const int i : inputs.index_range()) {
+    inputs[i] = float(i) * 0.001f;
+  }
+  Array<float> outputs(size);
+  const IndexMask mask(size);
+  for ([[maybe_unused]] const int run : IndexRange(3)) {
+    ParamsBuilder params{executor, &mask};
+    params.add_readonly_single_input(inputs.as_span());
+    params.add_uninitialized_single_output(outputs.as_mutable_span());
+    ContextBuilder context;
+    SCOPED_TIMER(optimize ? "execute optimized" : "execute");
+    executor.call_auto(mask, params, context);
+  }
+}
+
+TEST(multi_function_procedure, OptimizeBenchmark)
+{
+  benchmark_repeated_groups_procedure(false);
+  benchmark_repeated_groups_procedure(true);
+}
+#endif
+
 }  // namespace blender::fn::multi_function::tests
@@ -7571,6 +7571,14 @@ static void rna_def_userdef_experimental(BlenderRNA *brna)
       "Use file format used before Blender 5.0. This format is more limited "
       "but it may have better compatibility with tools that don't support the new format yet");
 
+  prop = RNA_def_property(srna, "use_mapped_file_data", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_boolean_sdna(prop, nullptr, "use_mapped_file_data", 1);
+  RNA_def_property_ui_text(
+      prop,
+      "Use Mapped File Data",
+      "Reference large arrays directly from memory-mapped uncompressed .blend files instead of "
+      "copying them when loading, memory is only copied once the data is modified");
+
   prop = RNA_def_property(srna, "use_all_linked_data_direct", PROP_BOOLEAN, PROP_NONE);
   RNA_def_property_ui_text(
       prop,
@@ -7597,6 +7605,12 @@ static void rna_def_userdef_experimental(BlenderRNA *brna)
       "Node Structure Types",
       "Enables new visualization of socket data compatibility in Geometry Nodes");
 
+  prop = RNA_def_property(srna, "use_geometry_nodes_evaluation_cache", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_ui_text(prop,
+                           "Geometry Nodes Evaluation Cache",
+                           "Reuse the outputs of node groups whose inputs did not change since "
+                           "they were evaluated before");
+
   prop = RNA_def_property(srna, "use_extensions_debug", PROP_BOOLEAN, PROP_NONE);
   RNA_def_property_ui_text(
       prop,
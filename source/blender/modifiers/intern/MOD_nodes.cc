@@ -1038,45 +1038,6 @@ static BakeFrameIndices get_bake_frame_indices(
   return frame_indices;
 }
 
-static void ensure_bake_loaded(bake::NodeBakeCache &bake_cache, bake::FrameCache &frame_cache)
-{
-  if (!frame_cache.state.items_by_id.is_empty()) {
-    return;
-  }
-  if (!frame_cache.meta_data_source.has_value()) {
-    return;
-  }
-  if (bake_cache.memory_blob_reader) {
-    if (const auto *meta_buffer = std::get_if<Span<std::byte>>(&*frame_cache.meta_data_source)) {
-      const std::string meta_str{reinterpret_cast<const char *>(meta_buffer->data()),
-                                 size_t(meta_buffer->size())};
-      std::istringstream meta_stream{meta_str};
-      std::optional<bake::BakeState> bake_state = bake::deserialize_bake(
-          meta_stream, *bake_cache.memory_blob_reader, *bake_cache.blob_sharing);
-      if (!bake_state.has_value()) {
-        return;
-      }
-      frame_cache.state = std::move(*bake_state);
-      return;
-    }
-  }
-  if (!bake_cache.blobs_dir) {
-    return;
-  }
-  const auto *meta_path = std::get_if<std::string>(&*frame_cache.meta_data_source);
-  if (!meta_path) {
-    return;
-  }
-  bake::DiskBlobReader blob_reader{*bake_cache.blobs_dir};
-  fstream meta_file{*meta_path};
-  std::optional<bake::BakeState> bake_state = bake::deserialize_bake(
-      meta_file, blob_reader, *bake_cache.blob_sharing);
-  if (!bake_state.has_value()) {
-    return;
-  }
-  frame_cache.state = std::move(*bake_state);
-}
-
 static bool try_find_baked_data(const NodesModifierBake &bake,
                                 bake::NodeBakeCache &bake_cache,
                                 const Main &bmain,
@@ -1460,10 +1421,12 @@ class NodesModifierSimulationParams : public nodes::GeoNodesSimulationParams {
                    bake::SimulationNodeCache &node_cache,
                    nodes::SimulationZoneBehavior &zone_behavior) const
   {
-    bake::FrameCache &frame_cache = *node_cache.bake.frames[frame_index];
-    ensure_bake_loaded(node_cache.bake, frame_cache);
+    std::shared_ptr<const bake::BakeState> state = bake::load_frame_state(node_cache.bake,
+                                                                           frame_index);
     auto &read_single_info = zone_behavior.output.emplace<sim_output::ReadSingle>();
-    read_single_info.state = frame_cache.state;
+    if (state) {
+      read_single_info.state = std::move(state);
+    }
   }
 
   void read_interpolated(const int prev_frame_index,
@@ -1473,14 +1436,20 @@ class NodesModifierSimulationParams : public nodes::GeoNodesSimulationParams {
   {
     bake::FrameCache &prev_frame_cache = *node_cache.bake.frames[prev_frame_index];
     bake::FrameCache &next_frame_cache = *node_cache.bake.frames[next_frame_index];
-    ensure_bake_loaded(node_cache.bake, prev_frame_cache);
-    ensure_bake_loaded(node_cache.bake, next_frame_cache);
+    std::shared_ptr<const bake::BakeState> prev_state = bake::load_frame_state(node_cache.bake,
+                                                                                prev_frame_index);
+    std::shared_ptr<const bake::BakeState> next_state = bake::load_frame_state(node_cache.bake,
+                                                                                next_frame_index);
     auto &read_interpolated_info = zone_behavior.output.emplace<sim_output::ReadInterpolated>();
     read_interpolated_info.mix_factor = (float(current_frame_) - float(prev_frame_cache.frame)) /
                                         (float(next_frame_cache.frame) -
                                          float(prev_frame_cache.frame));
-    read_interpolated_info.prev_state = prev_frame_cache.state;
-    read_interpolated_info.next_state = next_frame_cache.state;
+    if (prev_state) {
+      read_interpolated_info.prev_state = std::move(prev_state);
+    }
+    if (next_state) {
+      read_interpolated_info.next_state = std::move(next_state);
+    }
   }
 };
 
@@ -1603,13 +1572,13 @@ class NodesModifierBakeParams : public nodes::GeoNodesBakeParams {
                    bake::BakeNodeCache &node_cache,
                    nodes::BakeNodeBehavior &behavior) const
   {
-    bake::FrameCache &frame_cache = *node_cache.bake.frames[frame_index];
-    ensure_bake_loaded(node_cache.bake, frame_cache);
-    if (this->check_read_error(frame_cache, behavior)) {
+    std::shared_ptr<const bake::BakeState> state = bake::load_frame_state(node_cache.bake,
+                                                                           frame_index);
+    if (this->check_read_error(state, behavior)) {
       return;
     }
     auto &read_single_info = behavior.behavior.emplace<sim_output::ReadSingle>();
-    read_single_info.state = frame_cache.state;
+    read_single_info.state = std::move(state);
   }
 
   void read_interpolated(const int prev_frame_index,
@@ -1619,10 +1588,12 @@ class NodesModifierBakeParams : public nodes::GeoNodesBakeParams {
   {
     bake::FrameCache &prev_frame_cache = *node_cache.bake.frames[prev_frame_index];
     bake::FrameCache &next_frame_cache = *node_cache.bake.frames[next_frame_index];
-    ensure_bake_loaded(node_cache.bake, prev_frame_cache);
-    ensure_bake_loaded(node_cache.bake, next_frame_cache);
-    if (this->check_read_error(prev_frame_cache, behavior) ||
-        this->check_read_error(next_frame_cache, behavior))
+    std::shared_ptr<const bake::BakeState> prev_state = bake::load_frame_state(node_cache.bake,
+                                                                                prev_frame_index);
+    std::shared_ptr<const bake::BakeState> next_state = bake::load_frame_state(node_cache.bake,
+                                                                                next_frame_index);
+    if (this->check_read_error(prev_state, behavior) ||
+        this->check_read_error(next_state, behavior))
     {
       return;
     }
@@ -1630,14 +1601,14 @@ class NodesModifierBakeParams : public nodes::GeoNodesBakeParams {
     read_interpolated_info.mix_factor = (float(current_frame_) - float(prev_frame_cache.frame)) /
                                         (float(next_frame_cache.frame) -
                                          float(prev_frame_cache.frame));
-    read_interpolated_info.prev_state = prev_frame_cache.state;
-    read_interpolated_info.next_state = next_frame_cache.state;
+    read_interpolated_info.prev_state = std::move(prev_state);
+    read_interpolated_info.next_state = std::move(next_state);
   }
 
-  [[nodiscard]] bool check_read_error(const bake::FrameCache &frame_cache,
+  [[nodiscard]] bool check_read_error(const std::shared_ptr<const bake::BakeState> &state,
                                       nodes::BakeNodeBehavior &behavior) const
   {
-    if (frame_cache.meta_data_source && frame_cache.state.items_by_id.is_empty()) {
+    if (!state) {
       auto &read_error_info = behavior.behavior.emplace<sim_output::ReadError>();
       read_error_info.message = RPT_("Cannot load the baked data");
       return true;
@@ -0,0 +1,116 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+#pragma once
+
+/** \file
+ * \ingroup nodes
+ *
+ * The evaluation cache allows reusing the outputs of node groups when they are evaluated again
+ * with the same inputs, e.g. after changing an unrelated modifier input or the current frame.
+ *
+ * The key of a cached evaluation consists of the node group, the compute context and the input
+ * values. Geometries are identified by the #ImplicitSharingInfo and its version of every stored
+ * array, so that geometries that share all their data compare equal even if they are different
+ * instances. The cached outputs are stored in the global #memory_cache, which also enforces the
+ * memory budget.
+ *
+ * Only node groups whose result depends on nothing but their inputs can be cached, see
+ * #node_tree_supports_evaluation_cache. Groups are also not cached while the evaluation is logged,
+ * because the nodes inside of them would not log anything when the cached outputs are used. The
+ * cache is opt-in with an experimental option.
+ */
+
+#include <optional>
+
+#include "BLI_compute_context.hh"
+#include "BLI_generic_key.hh"
+#include "BLI_generic_pointer.hh"
+#include "BLI_implicit_sharing_ptr.hh"
+#include "BLI_struct_equality_utils.hh"
+#include "BLI_vector.hh"
+
+#include "BKE_node_socket_value.hh"
+
+#include "FN_lazy_function.hh"
+
+struct bNodeTree;
+
+namespace blender::nodes {
+
+struct GeometryNodesLazyFunctionGraphInfo;
+
+/**
+ * Identifies the data of a geometry without looking at the data itself. Every array is identified
+ * by its #ImplicitSharingInfo and the version of the shared data, which changes when the data is
+ * modified.
+ */
+struct GeometryIdentity {
+  /** Weak users make sure that the sharing infos are not freed and reused for other data. */
+  Vector<WeakImplicitSharingPtr> sharing_infos;
+  Vector<int64_t> versions;
+  /** Hash of everything that is not stored in shared arrays, like attribute names and sizes. */
+  uint64_t meta_hash = 0;
+
+  uint64_t hash() const;
+
+  BLI_STRUCT_EQUALITY_OPERATORS_3(GeometryIdentity, sharing_infos, versions, meta_hash);
+};
+
+/**
+ * Identifies the evaluation of a node group in a specific compute context with specific inputs.
+ */
+class GroupEvaluationKey : public GenericKey {
+ public:
+  uint64_t graph_id;
+  ComputeContextHash context_hash;
+  /** Single values of the main inputs, in the order of the inputs. */
+  Vector<bke::SocketValueVariant> values;
+  /** Geometries of the main inputs, in the order of the inputs. */
+  Vector<GeometryIdentity> geometries;
+  uint64_t precomputed_hash = 0;
+
+  uint64_t hash() const override;
+  bool equal_to(const GenericKey &other) const override;
+  std::unique_ptr<GenericKey> to_storable() const override;
+};
+
+/**
+ * Build the key for evaluating a node group with the given main input values, which have to be
+ * geometries or socket values. Returns none if an input can't be part of a key, e.g. a field.
+ */
+std::optional<GroupEvaluationKey> build_group_evaluation_key(
+    uint64_t graph_id, const ComputeContextHash &context_hash, Span<GPointer> inputs);
+
+/**
+ * True when the user enabled the evaluation cache.
+ */
+bool group_evaluation_cache_enabled();
+
+/**
+ * Check if evaluating the nodes in the tree only depends on the group inputs. Nested node groups
+ * are not checked.
+ */
+bool node_tree_supports_evaluation_cache(const bNodeTree &tree);
+
+/**
+ * Evaluates the node group and stores its outputs in the cache, or reuses outputs that have been
+ * cached before. Unlike the lazy evaluation of the group, this requests all inputs and computes
+ * all outputs. Inputs that can't be part of a cache key (e.g. fields) are still supported, but
+ * the group is not cached then.
+ *
+ * \param context: The context for the evaluation of the node group itself. Its storage has to be
+ * created by the group's lazy-function and must not have been used before.
+ */
+void execute_group_with_evaluation_cache(const GeometryNodesLazyFunctionGraphInfo &group_info,
+                                         lf::Params &params,
+                                         const lf::Context &context);
+
+/**
+ * Free all cached evaluations of the given graph, see
+ * #GeometryNodesLazyFunctionGraphInfo::memory_cache_id.
+ */
+void remove_cached_group_evaluations(uint64_t memory_cache_id);
+
+}  // namespace blender::nodes
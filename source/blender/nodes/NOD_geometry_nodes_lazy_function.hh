@@ -20,6 +20,7 @@
  * #lazy_function::Graph is build that can be used when evaluating the graph (e.g. for logging).
  */
 
+#include <atomic>
 #include <variant>
 
 #include "FN_lazy_function_graph.hh"
@@ -428,6 +429,21 @@ struct GeometryNodesLazyFunctionGraphInfo {
    * This can be used as a simple heuristic for the complexity of the node group.
    */
   int num_inline_nodes_approximate = 0;
+  /**
+   * True if the outputs of the node group only depend on its inputs, including the nodes in
+   * nested node groups. Only then the evaluation cache can be used for the group.
+   */
+  bool supports_evaluation_cache = true;
+  /**
+   * Identifies the evaluations of this graph in the global #memory_cache. Unlike the pointer to
+   * this struct, it is not reused once the graph has been freed.
+   */
+  uint64_t memory_cache_id;
+  /** True if any evaluation of this graph has been added to the cache. */
+  mutable std::atomic<bool> has_cached_evaluations = false;
+
+  GeometryNodesLazyFunctionGraphInfo();
+  ~GeometryNodesLazyFunctionGraphInfo();
 };
 
 std::unique_ptr<LazyFunction> get_simulation_output_lazy_function(
@@ -835,6 +835,7 @@ void draw_common_bake_settings(bContext *C, BakeDrawContext &ctx, uiLayout *layo
                     IFACE_("Path"),
                     ICON_NONE,
                     placeholder_path);
+    col->prop(&ctx.bake_rna, "use_compression", UI_ITEM_NONE, std::nullopt, ICON_NONE);
   }
   {
     uiLayout *col = &settings_col->column(true);
@@ -106,22 +106,26 @@ static void raycast_to_mesh(const IndexMask &mask,
     return;
   }
 
+  const VArraySpan<float3> origins_span{ray_origins};
+  const VArraySpan<float3> directions_span{ray_directions};
+  Array<BVHTreeRayHit> hits(mask.min_array_size());
   mask.foreach_index([&](const int i) {
-    const float ray_length = ray_lengths[i];
-    const float3 ray_origin = ray_origins[i];
-    const float3 ray_direction = ray_directions[i];
-
-    BVHTreeRayHit hit;
-    hit.index = -1;
-    hit.dist = ray_length;
-    if (BLI_bvhtree_ray_cast(tree_data.tree,
-                             ray_origin,
-                             ray_direction,
+    hits[i].index = -1;
+    hits[i].dist = ray_lengths[i];
+  });
+  BLI_bvhtree_ray_cast_batch(*tree_data.tree,
+                             mask,
+                             origins_span,
+                             directions_span,
                              0.0f,
-                             &hit,
+                             hits,
                              tree_data.raycast_callback,
-                             &tree_data) != -1)
-    {
+                             &tree_data);
+
+  mask.foreach_index([&](const int i) {
+    const float ray_length = ray_lengths[i];
+    const BVHTreeRayHit &hit = hits[i];
+    if (hit.index != -1) {
       if (!r_hit.is_empty()) {
         r_hit[i] = hit.index >= 0;
       }
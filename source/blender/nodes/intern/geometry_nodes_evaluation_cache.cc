@@ -0,0 +1,513 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup nodes
+ */
+
+#include "BLI_memory_cache.hh"
+#include "BLI_memory_counter.hh"
+#include "BLI_set.hh"
+
+#include "DNA_curves_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_node_types.h"
+#include "DNA_pointcloud_types.h"
+#include "DNA_userdef_types.h"
+
+#include "BKE_anonymous_attribute_id.hh"
+#include "BKE_curves.hh"
+#include "BKE_geometry_nodes_reference_set.hh"
+#include "BKE_geometry_set.hh"
+#include "BKE_instances.hh"
+#include "BKE_mesh_types.hh"
+#include "BKE_node_runtime.hh"
+#include "BKE_node_socket_value.hh"
+
+#include "FN_lazy_function_execute.hh"
+
+#include "NOD_geometry_nodes_evaluation_cache.hh"
+#include "NOD_geometry_nodes_lazy_function.hh"
+
+namespace blender::nodes {
+
+bool group_evaluation_cache_enabled()
+{
+  return U.experimental.use_geometry_nodes_evaluation_cache;
+}
+
+/* -------------------------------------------------------------------- */
+/** \name Node Tree Support
+ * \{ */
+
+static bool socket_type_is_id(const eNodeSocketDatatype type)
+{
+  switch (type) {
+    case SOCK_OBJECT:
+    case SOCK_IMAGE:
+    case SOCK_COLLECTION:
+    case SOCK_TEXTURE:
+    case SOCK_MATERIAL:
+      return true;
+    default:
+      return false;
+  }
+}
+
+static bool node_depends_on_context(const bNode &node)
+{
+  const StringRef idname = node.idname;
+  /* Tool nodes depend on the operator, import nodes on files and gizmos have to be logged. */
+  if (idname.startswith("GeometryNodeTool") || idname.startswith("GeometryNodeImport") ||
+      idname.startswith("GeometryNodeGizmo"))
+  {
+    return true;
+  }
+  static const Set<StringRef> context_dependent_nodes = {
+      "GeometryNodeBake",
+      "GeometryNodeCameraInfo",
+      "GeometryNodeDeformCurvesOnSurface",
+      "GeometryNodeImageInfo",
+      "GeometryNodeImageTexture",
+      "GeometryNodeInputActiveCamera",
+      "GeometryNodeInputSceneTime",
+      "GeometryNodeIsViewport",
+      "GeometryNodeSelfObject",
+      "GeometryNodeSimulationInput",
+      "GeometryNodeSimulationOutput",
+      "GeometryNodeViewer",
+      "GeometryNodeViewportTransform",
+      "GeometryNodeWarning",
+  };
+  if (context_dependent_nodes.contains(idname)) {
+    return true;
+  }
+  /* Data-blocks can change without an update of the node tree. This includes data-blocks that
+   * are referenced by the node itself, like the font of the String to Curves node. Nested node
+   * groups are checked separately. */
+  if (node.id != nullptr && !node.is_group()) {
+    return true;
+  }
+  for (const bNodeSocket *socket : node.input_sockets()) {
+    if (socket_type_is_id(eNodeSocketDatatype(socket->type))) {
+      return true;
+    }
+  }
+  for (const bNodeSocket *socket : node.output_sockets()) {
+    if (socket_type_is_id(eNodeSocketDatatype(socket->type))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool node_tree_supports_evaluation_cache(const bNodeTree &tree)
+{
+  tree.ensure_topology_cache();
+  for (const bNode *node : tree.all_nodes()) {
+    if (node->is_muted()) {
+      continue;
+    }
+    if (node_depends_on_context(*node)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Geometry Identity
+ * \{ */
+
+uint64_t GeometryIdentity::hash() const
+{
+  uint64_t hash = this->meta_hash;
+  for (const int i : this->sharing_infos.index_range()) {
+    hash = get_default_hash(hash, this->sharing_infos[i].get(), this->versions[i]);
+  }
+  return hash;
+}
+
+static bool add_shared_data(const ImplicitSharingInfo *sharing_info, GeometryIdentity &identity)
+{
+  if (!sharing_info) {
+    return false;
+  }
+  sharing_info->add_weak_user();
+  identity.sharing_infos.append(WeakImplicitSharingPtr(sharing_info));
+  identity.versions.append(sharing_info->version());
+  return true;
+}
+
+static bool add_attributes(const bke::AttributeAccessor &attributes, GeometryIdentity &identity)
+{
+  bool success = true;
+  attributes.foreach_attribute([&](const bke::AttributeIter &iter) {
+    const bke::GAttributeReader attribute = iter.get();
+    /* Some attributes are not stored in shared arrays, e.g. vertex groups. */
+    if (!add_shared_data(attribute.sharing_info, identity)) {
+      success = false;
+      iter.stop();
+      return;
+    }
+    identity.meta_hash = get_default_hash(identity.meta_hash,
+                                          StringRef(iter.name),
+                                          iter.data_type,
+                                          attributes.domain_size(iter.domain));
+    identity.meta_hash = get_default_hash(identity.meta_hash, iter.domain);
+  });
+  return success;
+}
+
+static void add_materials(const Span<Material *> materials, GeometryIdentity &identity)
+{
+  for (const Material *material : materials) {
+    identity.meta_hash = get_default_hash(identity.meta_hash, material);
+  }
+}
+
+static bool add_geometry(const bke::GeometrySet &geometry, GeometryIdentity &identity)
+{
+  using bke::GeometryComponent;
+  identity.meta_hash = get_default_hash(identity.meta_hash, StringRef(geometry.name));
+  for (const GeometryComponent *component : geometry.get_components()) {
+    identity.meta_hash = get_default_hash(identity.meta_hash, component->type());
+    switch (component->type()) {
+      case GeometryComponent::Type::Mesh: {
+        const Mesh &mesh = *geometry.get_mesh();
+        if (mesh.faces_num > 0 &&
+            !add_shared_data(mesh.runtime->face_offsets_sharing_info, identity))
+        {
+          return false;
+        }
+        add_materials({mesh.mat, mesh.totcol}, identity);
+        break;
+      }
+      case GeometryComponent::Type::Curve: {
+        const Curves &curves_id = *geometry.get_curves();
+        if (curves_id.surface) {
+          return false;
+        }
+        const bke::CurvesGeometry &curves = curves_id.geometry.wrap();
+        if (curves.curves_num() > 0 &&
+            !add_shared_data(curves.runtime->curve_offsets_sharing_info, identity))
+        {
+          return false;
+        }
+        if (curves.nurbs_has_custom_knots() &&
+            !add_shared_data(curves.runtime->custom_knots_sharing_info, identity))
+        {
+          return false;
+        }
+        add_materials({curves_id.mat, curves_id.totcol}, identity);
+        break;
+      }
+      case GeometryComponent::Type::PointCloud: {
+        const PointCloud &pointcloud = *geometry.get_pointcloud();
+        add_materials({pointcloud.mat, pointcloud.totcol}, identity);
+        break;
+      }
+      case GeometryComponent::Type::Instance: {
+        const bke::Instances &instances = *geometry.get_instances();
+        for (const bke::InstanceReference &reference : instances.references()) {
+          identity.meta_hash = get_default_hash(identity.meta_hash, reference.type());
+          switch (reference.type()) {
+            case bke::InstanceReference::Type::None:
+              break;
+            case bke::InstanceReference::Type::GeometrySet:
+              if (!add_geometry(reference.geometry_set(), identity)) {
+                return false;
+              }
+              break;
+            case bke::InstanceReference::Type::Object:
+            case bke::InstanceReference::Type::Collection:
+              /* Data-blocks can change without changing the instances. */
+              return false;
+          }
+        }
+        break;
+      }
+      default: {
+        /* Identifying other components is not implemented yet. */
+        return false;
+      }
+    }
+    if (!add_attributes(*component->attributes(), identity)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void gather_anonymous_attribute_names(const bke::GeometrySet &geometry,
+                                             Set<std::string> &r_names)
+{
+  for (const bke::GeometryComponent *component : geometry.get_components()) {
+    if (const std::optional<bke::AttributeAccessor> attributes = component->attributes()) {
+      attributes->foreach_attribute([&](const bke::AttributeIter &iter) {
+        if (bke::attribute_name_is_anonymous(iter.name)) {
+          r_names.add(iter.name);
+        }
+      });
+    }
+  }
+  if (const bke::Instances *instances = geometry.get_instances()) {
+    for (const bke::InstanceReference &reference : instances->references()) {
+      if (reference.type() == bke::InstanceReference::Type::GeometrySet) {
+        gather_anonymous_attribute_names(reference.geometry_set(), r_names);
+      }
+    }
+  }
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Evaluation Keys
+ * \{ */
+
+uint64_t GroupEvaluationKey::hash() const
+{
+  return this->precomputed_hash;
+}
+
+bool GroupEvaluationKey::equal_to(const GenericKey &other) const
+{
+  if (const auto *other_typed = dynamic_cast<const GroupEvaluationKey *>(&other)) {
+    if (this->graph_id != other_typed->graph_id ||
+        this->context_hash != other_typed->context_hash ||
+        this->geometries != other_typed->geometries ||
+        this->values.size() != other_typed->values.size())
+    {
+      return false;
+    }
+    for (const int i : this->values.index_range()) {
+      const GPointer a = this->values[i].get_single_ptr();
+      const GPointer b = other_typed->values[i].get_single_ptr();
+      if (a.type() != b.type() || !a.type()->is_equal(a.get(), b.get())) {
+        return false;
+      }
+    }
+    return true;
+  }
+  return false;
+}
+
+std::unique_ptr<GenericKey> GroupEvaluationKey::to_storable() const
+{
+  return std::make_unique<GroupEvaluationKey>(*this);
+}
+
+std::optional<GroupEvaluationKey> build_group_evaluation_key(
+    const uint64_t graph_id, const ComputeContextHash &context_hash, const Span<GPointer> inputs)
+{
+  GroupEvaluationKey key;
+  key.graph_id = graph_id;
+  key.context_hash = context_hash;
+  uint64_t hash = get_default_hash(graph_id, context_hash);
+  for (const GPointer input : inputs) {
+    const CPPType &type = *input.type();
+    if (type.is<bke::GeometrySet>()) {
+      GeometryIdentity identity;
+      if (!add_geometry(*static_cast<const bke::GeometrySet *>(input.get()), identity)) {
+        return std::nullopt;
+      }
+      hash = get_default_hash(hash, identity.hash());
+      key.geometries.append(std::move(identity));
+    }
+    else if (type.is<bke::SocketValueVariant>()) {
+      const auto &value_variant = *static_cast<const bke::SocketValueVariant *>(input.get());
+      /* Fields and grids would have to be compared structurally. */
+      if (!value_variant.is_single()) {
+        return std::nullopt;
+      }
+      const GPointer single_value = value_variant.get_single_ptr();
+      const CPPType &single_type = *single_value.type();
+      if (!single_type.is_hashable() || !single_type.is_equality_comparable()) {
+        return std::nullopt;
+      }
+      hash = get_default_hash(hash, single_type.hash(single_value.get()));
+      key.values.append(value_variant);
+    }
+    else {
+      return std::nullopt;
+    }
+  }
+  key.precomputed_hash = hash;
+  return key;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Cached Evaluations
+ * \{ */
+
+namespace {
+
+/** The main outputs of an evaluated node group. */
+class CachedGroupOutputs : public memory_cache::CachedValue {
+ public:
+  LinearAllocator<> allocator;
+  Vector<GMutablePointer> values;
+
+  ~CachedGroupOutputs() override
+  {
+    for (GMutablePointer &value : this->values) {
+      value.destruct();
+    }
+  }
+
+  void count_memory(MemoryCounter &memory) const override
+  {
+    for (const GMutablePointer &value : this->values) {
+      if (value.type()->is<bke::GeometrySet>()) {
+        static_cast<const bke::GeometrySet *>(value.get())->count_memory(memory);
+      }
+      else {
+        memory.add(value.type()->size);
+      }
+    }
+  }
+};
+
+}  // namespace
+
+/**
+ * Evaluate the node group eagerly, with all main inputs available and all main outputs used.
+ */
+static std::unique_ptr<CachedGroupOutputs> evaluate_group(
+    const GeometryNodesGroupFunction &function, lf::Params &params, const lf::Context &context)
+{
+  const lf::LazyFunction &fn = *function.function;
+  const int inputs_num = fn.inputs().size();
+  const int outputs_num = fn.outputs().size();
+
+  Array<GMutablePointer> inputs(inputs_num);
+  Array<GMutablePointer> outputs(outputs_num);
+  Array<std::optional<lf::ValueUsage>> input_usages(inputs_num);
+  Array<lf::ValueUsage> output_usages(outputs_num, lf::ValueUsage::Unused);
+  Array<bool> set_outputs(outputs_num, false);
+
+  Set<std::string> anonymous_attribute_names;
+  for (const int i : function.inputs.main) {
+    const CPPType &type = *fn.inputs()[i].type;
+    void *value = params.try_get_input_data_ptr(i);
+    inputs[i] = {type, value};
+    if (type.is<bke::GeometrySet>()) {
+      gather_anonymous_attribute_names(*static_cast<const bke::GeometrySet *>(value),
+                                       anonymous_attribute_names);
+    }
+  }
+
+  /* All outputs are computed, so that the cached outputs can be used regardless of which outputs
+   * the caller needs. */
+  Array<bool> output_used_inputs(function.inputs.output_usages.size(), true);
+  for (const int i : function.inputs.output_usages.index_range()) {
+    inputs[function.inputs.output_usages[i]] = &output_used_inputs[i];
+  }
+
+  /* Which anonymous attributes the caller needs is only known once the usages of other nodes have
+   * been computed. Waiting for that could result in a cyclic dependency, so all the anonymous
+   * attributes of the inputs are propagated instead. */
+  bke::GeometryNodesReferenceSet references_to_propagate;
+  references_to_propagate.names = std::make_shared<Set<std::string>>(
+      std::move(anonymous_attribute_names));
+  for (const int i : function.inputs.references_to_propagate.range) {
+    inputs[i] = &references_to_propagate;
+  }
+
+  auto result = std::make_unique<CachedGroupOutputs>();
+  LinearAllocator<> allocator;
+  for (const int i : IndexRange(outputs_num)) {
+    const CPPType &type = *fn.outputs()[i].type;
+    if (function.outputs.main.contains(i)) {
+      outputs[i] = {type, result->allocator.allocate(type)};
+      output_usages[i] = lf::ValueUsage::Used;
+    }
+    else {
+      outputs[i] = {type, allocator.allocate(type)};
+    }
+  }
+
+  lf::BasicParams eager_params{fn, inputs, outputs, input_usages, output_usages, set_outputs};
+  fn.execute(eager_params, context);
+
+  for (const int i : IndexRange(outputs_num)) {
+    if (function.outputs.main.contains(i)) {
+      BLI_assert(set_outputs[i]);
+      if (!set_outputs[i]) {
+        outputs[i].type()->value_initialize(outputs[i].get());
+      }
+      result->values.append(outputs[i]);
+    }
+    else if (set_outputs[i]) {
+      outputs[i].destruct();
+    }
+  }
+  return result;
+}
+
+void execute_group_with_evaluation_cache(const GeometryNodesLazyFunctionGraphInfo &group_info,
+                                         lf::Params &params,
+                                         const lf::Context &context)
+{
+  const GeometryNodesGroupFunction &function = group_info.function;
+
+  /* All inputs are requested below, so they are all used. Outputting the usages right away also
+   * avoids waiting for inputs whose computation depends on these usages. */
+  for (const int i : function.outputs.input_usages) {
+    if (!params.output_was_set(i)) {
+      params.set_output(i, true);
+    }
+  }
+
+  bool all_inputs_available = true;
+  for (const int i : function.inputs.main) {
+    if (params.try_get_input_data_ptr_or_request(i) == nullptr) {
+      all_inputs_available = false;
+    }
+  }
+  if (!all_inputs_available) {
+    return;
+  }
+
+  const GeoNodesUserData &user_data = *static_cast<const GeoNodesUserData *>(context.user_data);
+  std::shared_ptr<const CachedGroupOutputs> outputs;
+  Vector<GPointer, 16> inputs;
+  for (const int i : function.inputs.main) {
+    inputs.append({function.function->inputs()[i].type, params.try_get_input_data_ptr(i)});
+  }
+  if (const std::optional<GroupEvaluationKey> key = build_group_evaluation_key(
+          group_info.memory_cache_id, user_data.compute_context->hash(), inputs))
+  {
+    group_info.has_cached_evaluations.store(true, std::memory_order_relaxed);
+    outputs = memory_cache::get<CachedGroupOutputs>(
+        *key, [&]() { return evaluate_group(function, params, context); });
+  }
+  else {
+    outputs = evaluate_group(function, params, context);
+  }
+
+  for (const int i : function.outputs.main.index_range()) {
+    const int output_index = function.outputs.main[i];
+    const GMutablePointer value = outputs->values[i];
+    value.type()->copy_construct(value.get(), params.get_output_data_ptr(output_index));
+    params.output_set(output_index);
+  }
+}
+
+void remove_cached_group_evaluations(const uint64_t memory_cache_id)
+{
+  memory_cache::remove_if([&](const GenericKey &key) {
+    const auto *evaluation_key = dynamic_cast<const GroupEvaluationKey *>(&key);
+    return evaluation_key && evaluation_key->graph_id == memory_cache_id;
+  });
+}
+
+/** \} */
+
+}  // namespace blender::nodes
@@ -0,0 +1,204 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+#include "testing/testing.h"
+
+#include "CLG_log.h"
+
+#include "BLI_math_vector_types.hh"
+#include "BLI_memory_cache.hh"
+#include "BLI_memory_counter.hh"
+
+#include "DNA_pointcloud_types.h"
+
+#include "BKE_geometry_fields.hh"
+#include "BKE_geometry_set.hh"
+#include "BKE_idtype.hh"
+#include "BKE_pointcloud.hh"
+
+#include "NOD_geometry_nodes_evaluation_cache.hh"
+
+namespace blender::nodes::tests {
+
+class EvaluationCacheTest : public ::testing::Test {
+ protected:
+  static void SetUpTestSuite()
+  {
+    CLG_init();
+    BKE_idtype_init();
+  }
+
+  static void TearDownTestSuite()
+  {
+    CLG_exit();
+  }
+};
+
+/** Actual graphs use small increasing identifiers, so this does not collide with them. */
+static constexpr uint64_t test_graph_id = uint64_t(1) << 62;
+
+static bke::GeometrySet create_points(const int points_num)
+{
+  PointCloud *pointcloud = BKE_pointcloud_new_nomain(points_num);
+  pointcloud->positions_for_write().fill(float3(1.0f));
+  return bke::GeometrySet::from_pointcloud(pointcloud);
+}
+
+static std::optional<GroupEvaluationKey> geometry_key(const bke::GeometrySet &geometry)
+{
+  return build_group_evaluation_key(test_graph_id, {}, {GPointer(&geometry)});
+}
+
+static std::optional<GroupEvaluationKey> value_key(const bke::SocketValueVariant &value)
+{
+  return build_group_evaluation_key(test_graph_id, {}, {GPointer(&value)});
+}
+
+static bool keys_equal(const GroupEvaluationKey &a, const GroupEvaluationKey &b)
+{
+  return a.hash() == b.hash() && a.equal_to(b) && b.equal_to(a);
+}
+
+TEST_F(EvaluationCacheTest, GeometryKeyEqualWhenDataIsShared)
+{
+  const bke::GeometrySet geometry = create_points(10);
+  bke::GeometrySet copy = geometry;
+  /* Creates a new point cloud that shares all its arrays with the original. */
+  copy.get_pointcloud_for_write();
+  EXPECT_NE(geometry.get_pointcloud(), copy.get_pointcloud());
+
+  const std::optional<GroupEvaluationKey> key_a = geometry_key(geometry);
+  const std::optional<GroupEvaluationKey> key_b = geometry_key(copy);
+  ASSERT_TRUE(key_a.has_value());
+  ASSERT_TRUE(key_b.has_value());
+  EXPECT_TRUE(keys_equal(*key_a, *key_b));
+}
+
+TEST_F(EvaluationCacheTest, GeometryKeyChangesWithVersion)
+{
+  bke::GeometrySet geometry = create_points(10);
+  const std::optional<GroupEvaluationKey> key_a = geometry_key(geometry);
+  ASSERT_TRUE(key_a.has_value());
+
+  /* The positions are not shared, so they are modified in place and only the version changes. */
+  geometry.get_pointcloud_for_write()->positions_for_write().first() = float3(2.0f);
+  const std::optional<GroupEvaluationKey> key_b = geometry_key(geometry);
+  ASSERT_TRUE(key_b.has_value());
+  EXPECT_EQ(key_a->geometries[0].sharing_infos, key_b->geometries[0].sharing_infos);
+  EXPECT_NE(key_a->geometries[0].versions, key_b->geometries[0].versions);
+  EXPECT_FALSE(key_a->equal_to(*key_b));
+}
+
+TEST_F(EvaluationCacheTest, GeometryKeyChangesWithCopiedData)
+{
+  const bke::GeometrySet geometry = create_points(10);
+  bke::GeometrySet copy = geometry;
+  /* The positions are shared with the original, so they are copied before they are modified. */
+  copy.get_pointcloud_for_write()->positions_for_write().first() = float3(2.0f);
+
+  const std::optional<GroupEvaluationKey> key_a = geometry_key(geometry);
+  const std::optional<GroupEvaluationKey> key_b = geometry_key(copy);
+  ASSERT_TRUE(key_a.has_value());
+  ASSERT_TRUE(key_b.has_value());
+  EXPECT_FALSE(key_a->equal_to(*key_b));
+}
+
+TEST_F(EvaluationCacheTest, GeometryKeyChangesWithSize)
+{
+  const std::optional<GroupEvaluationKey> key_a = geometry_key(create_points(10));
+  const std::optional<GroupEvaluationKey> key_b = geometry_key(create_points(20));
+  ASSERT_TRUE(key_a.has_value());
+  ASSERT_TRUE(key_b.has_value());
+  EXPECT_FALSE(key_a->equal_to(*key_b));
+}
+
+TEST_F(EvaluationCacheTest, SingleValueKey)
+{
+  const std::optional<GroupEvaluationKey> key_a = value_key(bke::SocketValueVariant(1.0f));
+  const std::optional<GroupEvaluationKey> key_b = value_key(bke::SocketValueVariant(1.0f));
+  const std::optional<GroupEvaluationKey> key_c = value_key(bke::SocketValueVariant(2.0f));
+  const std::optional<GroupEvaluationKey> key_d = value_key(bke::SocketValueVariant(1));
+  ASSERT_TRUE(key_a.has_value());
+  ASSERT_TRUE(key_b.has_value());
+  ASSERT_TRUE(key_c.has_value());
+  ASSERT_TRUE(key_d.has_value());
+  EXPECT_TRUE(keys_equal(*key_a, *key_b));
+  EXPECT_FALSE(key_a->equal_to(*key_c));
+  /* Values of different types never compare equal. */
+  EXPECT_FALSE(key_a->equal_to(*key_d));
+}
+
+TEST_F(EvaluationCacheTest, KeyChangesWithContext)
+{
+  const bke::SocketValueVariant value(1.0f);
+  const ComputeContextHash context_hash{1, 2};
+  const std::optional<GroupEvaluationKey> key_a = build_group_evaluation_key(
+      test_graph_id, {}, {GPointer(&value)});
+  const std::optional<GroupEvaluationKey> key_b = build_group_evaluation_key(
+      test_graph_id, context_hash, {GPointer(&value)});
+  const std::optional<GroupEvaluationKey> key_c = build_group_evaluation_key(
+      test_graph_id + 1, {}, {GPointer(&value)});
+  ASSERT_TRUE(key_a.has_value());
+  ASSERT_TRUE(key_b.has_value());
+  ASSERT_TRUE(key_c.has_value());
+  EXPECT_FALSE(key_a->equal_to(*key_b));
+  EXPECT_FALSE(key_a->equal_to(*key_c));
+}
+
+TEST_F(EvaluationCacheTest, FieldHasNoKey)
+{
+  bke::SocketValueVariant value;
+  value.set(bke::AttributeFieldInput::from<float>("a"));
+  EXPECT_FALSE(value_key(value).has_value());
+}
+
+namespace {
+
+class CachedInt : public memory_cache::CachedValue {
+ public:
+  int value;
+
+  explicit CachedInt(const int value) : value(value) {}
+
+  void count_memory(MemoryCounter &memory) const override
+  {
+    memory.add(sizeof(int));
+  }
+};
+
+}  // namespace
+
+TEST_F(EvaluationCacheTest, CacheHitAndMiss)
+{
+  bke::GeometrySet geometry = create_points(10);
+  int compute_count = 0;
+  const auto lookup = [&](const bke::GeometrySet &input) {
+    const std::optional<GroupEvaluationKey> key = geometry_key(input);
+    EXPECT_TRUE(key.has_value());
+    return memory_cache::get<CachedInt>(*key, [&]() {
+      compute_count++;
+      return std::make_unique<CachedInt>(compute_count);
+    });
+  };
+
+  EXPECT_EQ(lookup(geometry)->value, 1);
+  /* A copy that shares all data hits the cache. */
+  bke::GeometrySet copy = geometry;
+  copy.get_pointcloud_for_write();
+  EXPECT_EQ(lookup(copy)->value, 1);
+  EXPECT_EQ(compute_count, 1);
+
+  /* Modified data does not hit the cache. */
+  copy.get_pointcloud_for_write()->positions_for_write().first() = float3(2.0f);
+  EXPECT_EQ(lookup(copy)->value, 2);
+  EXPECT_EQ(lookup(geometry)->value, 1);
+  EXPECT_EQ(compute_count, 2);
+
+  /* Removed evaluations are computed again. */
+  remove_cached_group_evaluations(test_graph_id);
+  EXPECT_EQ(lookup(geometry)->value, 3);
+  EXPECT_EQ(compute_count, 3);
+  remove_cached_group_evaluations(test_graph_id);
+}
+
+}  // namespace blender::nodes::tests
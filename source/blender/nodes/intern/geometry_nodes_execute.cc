@@ -9,6 +9,7 @@
 #include "BLI_listbase.h"
 #include "BLI_math_euler.hh"
 #include "BLI_string.h"
+#include "BLI_task_trace.hh"
 
 #include "NOD_geometry.hh"
 #include "NOD_geometry_nodes_execute.hh"
@@ -866,6 +867,7 @@ bke::GeometrySet execute_geometry_nodes_on_geometry(const bNodeTree &btree,
                                                     GeoNodesCallData &call_data,
                                                     bke::GeometrySet input_geometry)
 {
+  const threading::trace::ScopedLabel trace_label{"Geometry Nodes"};
   const GeometryNodesLazyFunctionGraphInfo &lf_graph_info =
       *ensure_geometry_nodes_lazy_function_graph(btree);
   const GeometryNodesGroupFunction &function = lf_graph_info.function;
@@ -21,6 +21,7 @@
  */
 
 #include "NOD_geometry_exec.hh"
+#include "NOD_geometry_nodes_evaluation_cache.hh"
 #include "NOD_geometry_nodes_lazy_function.hh"
 #include "NOD_multi_function.hh"
 #include "NOD_node_declaration.hh"
@@ -1186,18 +1187,23 @@ bool should_log_socket_values_for_context(const GeoNodesUserData &user_data,
 class LazyFunctionForGroupNode : public LazyFunction {
  private:
   const bNode &group_node_;
+  const GeometryNodesLazyFunctionGraphInfo &group_lf_graph_info_;
   const LazyFunction &group_lazy_function_;
   bool has_many_nodes_ = false;
 
   struct Storage {
     void *group_storage = nullptr;
+    /** Decided when the group is executed for the first time. */
+    std::optional<bool> use_evaluation_cache;
   };
 
  public:
   LazyFunctionForGroupNode(const bNode &group_node,
                            const GeometryNodesLazyFunctionGraphInfo &group_lf_graph_info,
                            GeometryNodesLazyFunctionGraphInfo &own_lf_graph_info)
-      : group_node_(group_node), group_lazy_function_(*group_lf_graph_info.function.function)
+      : group_node_(group_node),
+        group_lf_graph_info_(group_lf_graph_info),
+        group_lazy_function_(*group_lf_graph_info.function.function)
   {
     debug_name_ = group_node.name;
     allow_missing_requested_inputs_ = true;
@@ -1256,10 +1262,42 @@ class LazyFunctionForGroupNode : public LazyFunction {
     GeoNodesLocalUserData group_local_user_data{group_user_data};
     lf::Context group_context{storage->group_storage, &group_user_data, &group_local_user_data};
 
+    if (!storage->use_evaluation_cache.has_value()) {
+      storage->use_evaluation_cache = this->use_evaluation_cache(group_user_data);
+    }
+
     ScopedComputeContextTimer timer(group_context);
+    if (*storage->use_evaluation_cache) {
+      execute_group_with_evaluation_cache(group_lf_graph_info_, params, group_context);
+      return;
+    }
     group_lazy_function_.execute(params, group_context);
   }
 
+  bool use_evaluation_cache(const GeoNodesUserData &group_user_data) const
+  {
+    if (!group_lf_graph_info_.supports_evaluation_cache) {
+      return false;
+    }
+    if (!group_evaluation_cache_enabled()) {
+      return false;
+    }
+    if (group_user_data.log_socket_values || group_user_data.call_data->eval_log) {
+      /* Nodes inside of the group don't log socket values, warnings, used named attributes or
+       * execution times when the cached outputs are used. */
+      return false;
+    }
+    if (const GeoNodesSideEffectNodes *side_effect_nodes =
+            group_user_data.call_data->side_effect_nodes)
+    {
+      const ComputeContextHash context_hash = group_user_data.compute_context->hash();
+      if (!side_effect_nodes->nodes_by_context.lookup(context_hash).is_empty()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
   void *init_storage(LinearAllocator<> &allocator) const override
   {
     Storage *s = allocator.construct<Storage>().release();
@@ -2021,6 +2059,7 @@ struct GeometryNodesLazyFunctionBuilder {
     mapping_ = &lf_graph_info_->mapping;
     conversions_ = &bke::get_implicit_type_conversions();
     tree_zones_ = btree_.zones();
+    lf_graph_info_->supports_evaluation_cache = node_tree_supports_evaluation_cache(btree_);
 
     this->initialize_mapping_arrays();
     this->build_zone_functions();
@@ -3124,6 +3163,9 @@ struct GeometryNodesLazyFunctionBuilder {
     mapping_->group_node_map.add(&bnode, &lf_node);
     lf_graph_info_->num_inline_nodes_approximate +=
         group_lf_graph_info->num_inline_nodes_approximate;
+    if (!group_lf_graph_info->supports_evaluation_cache) {
+      lf_graph_info_->supports_evaluation_cache = false;
+    }
     static const bool static_false = false;
     for (const bNodeSocket *bsocket : bnode.output_sockets()) {
       {
@@ -4287,6 +4329,20 @@ const GeometryNodesLazyFunctionGraphInfo *ensure_geometry_nodes_lazy_function_gr
   return lf_graph_info_ptr.get();
 }
 
+GeometryNodesLazyFunctionGraphInfo::GeometryNodesLazyFunctionGraphInfo()
+{
+  static std::atomic<uint64_t> next_id = 0;
+  this->memory_cache_id = next_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+GeometryNodesLazyFunctionGraphInfo::~GeometryNodesLazyFunctionGraphInfo()
+{
+  if (this->has_cached_evaluations) {
+    /* Cached evaluations of this graph can't be used anymore, so free them right away. */
+    remove_cached_group_evaluations(this->memory_cache_id);
+  }
+}
+
 destruct_ptr<fn::LocalUserData> GeoNodesUserData::get_local(LinearAllocator<> &allocator)
 {
   return allocator.construct<GeoNodesLocalUserData>(*this);
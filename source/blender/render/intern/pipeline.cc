@@ -2402,6 +2402,23 @@ static void re_movie_free_all(Render *re)
   re->movie_writers.clear_and_shrink();
 }
 
+/**
+ * Print the memory usage per allocation name after a frame has been rendered, see
+ * #G_DEBUG_MEMORY_SUMMARY. Only the changes since the previous frame are printed, which makes it
+ * easy to find memory that accumulates over the course of an animation.
+ */
+static void render_print_memory_summary(const int frame, MEM_NameUsageSnapshot **r_previous)
+{
+  if (!(G.debug & G_DEBUG_MEMORY_SUMMARY) || !MEM_get_name_usage_tracking()) {
+    return;
+  }
+  MEM_NameUsageSnapshot *snapshot = MEM_name_usage_snapshot();
+  printf("\nMemory summary after frame %d\n", frame);
+  MEM_name_usage_print(snapshot, *r_previous, *r_previous ? 20 : 30);
+  MEM_name_usage_snapshot_free(*r_previous);
+  *r_previous = snapshot;
+}
+
 void RE_RenderAnim(Render *re,
                    Main *bmain,
                    Scene *scene,
@@ -2482,6 +2499,8 @@ void RE_RenderAnim(Render *re,
   re->flag |= R_ANIMATION;
   DEG_graph_id_tag_update(re->main, re->pipeline_depsgraph, &re->scene->id, ID_RECALC_AUDIO_MUTE);
 
+  MEM_NameUsageSnapshot *memory_summary = nullptr;
+
   scene->r.subframe = 0.0f;
   for (nfra = sfra, scene->r.cfra = sfra; scene->r.cfra <= efra; scene->r.cfra++) {
     char filepath[FILE_MAX];
@@ -2669,8 +2688,12 @@ void RE_RenderAnim(Render *re,
         render_callback_exec_id(re, re->main, &scene->id, BKE_CB_EVT_RENDER_WRITE);
       }
     }
+
+    render_print_memory_summary(scene->r.cfra, &memory_summary);
   }
 
+  MEM_name_usage_snapshot_free(memory_summary);
+
   /* end movie */
   if (is_movie && do_write_file) {
     re_movie_free_all(re);
@@ -1782,6 +1782,7 @@ enum eWM_JobType {
   WM_JOB_TYPE_CALCULATE_SIMULATION_NODES,
   WM_JOB_TYPE_BAKE_GEOMETRY_NODES,
   WM_JOB_TYPE_UV_PACK,
+  WM_JOB_TYPE_AUTOSAVE,
   /* Add as needed, bake, seq proxy build
    * if having hard coded values is a problem. */
 };
@@ -1964,7 +1965,10 @@ int WM_main_playanim(int argc, const char **argv);
 bool write_crash_blend();
 
 bool WM_autosave_is_scheduled(wmWindowManager *wm);
-/** Flushes all changes from edit modes and stores the auto-save file. */
+/**
+ * Flushes all changes from edit modes and stores the auto-save file.
+ * The file is written to disk in a background job.
+ */
 void WM_autosave_write(wmWindowManager *wm, Main *bmain);
 
 /**
@@ -13,6 +13,7 @@
 #include <cerrno>
 #include <cstddef>
 #include <cstring>
+#include <optional>
 #include <fcntl.h> /* For open flags (#O_BINARY, #O_RDONLY). */
 
 #ifdef WIN32
@@ -47,6 +48,7 @@
 #include "BLI_utildefines.h"
 #include BLI_SYSTEM_PID_H
 
+#include "BLO_io_stats.hh"
 #include "BLO_readfile.hh"
 #include "BLT_translation.hh"
 
@@ -961,6 +963,14 @@ static void file_read_reports_finalize(BlendFileReadReport *bf_reports)
 
   CLOG_INFO(
       &LOG, "Blender file read in %.0fm%.2fs", duration_whole_minutes, duration_whole_seconds);
+  CLOG_INFO(&LOG,
+            " * Reading blocks: %.3fs, reconstructing structs: %.3fs",
+            bf_reports->duration.bhead_index,
+            bf_reports->duration.struct_reconstruct);
+  CLOG_INFO(&LOG,
+            " * Reading data-blocks: %.3fs, versioning: %.3fs",
+            bf_reports->duration.read_ids,
+            bf_reports->duration.versioning);
   CLOG_INFO(&LOG,
             " * Loading libraries: %.0fm%.2fs",
             duration_libraries_minutes,
@@ -977,6 +987,9 @@ static void file_read_reports_finalize(BlendFileReadReport *bf_reports)
             bf_reports->count.resynced_lib_overrides,
             duration_lib_override_recursive_resync_minutes,
             duration_lib_override_recursive_resync_seconds);
+  if (bf_reports->io_stats) {
+    printf("Blender file read phases:\n%s", bf_reports->io_stats->report().c_str());
+  }
 
   if (bf_reports->resynced_lib_overrides_libraries_count != 0) {
     for (LinkNode *node_lib = bf_reports->resynced_lib_overrides_libraries; node_lib != nullptr;
@@ -1080,6 +1093,10 @@ bool WM_file_read(bContext *C,
 
     BlendFileReadReport bf_reports{};
     bf_reports.reports = reports;
+    std::optional<blender::blo::IOStats> io_stats;
+    if (G.debug & G_DEBUG_IO) {
+      bf_reports.io_stats = &io_stats.emplace();
+    }
     bf_reports.duration.whole = BLI_time_now_seconds();
     BlendFileData *bfd = BKE_blendfile_read(filepath, &params, &bf_reports);
     if (bfd != nullptr) {
@@ -2238,8 +2255,15 @@ static bool wm_file_write(bContext *C,
   blend_write_params.use_save_versions = true;
   blend_write_params.use_save_as_copy = use_save_as_copy;
   blend_write_params.thumb = thumb;
+  std::optional<blender::blo::IOStats> io_stats;
+  if (G.debug & G_DEBUG_IO) {
+    blend_write_params.io_stats = &io_stats.emplace();
+  }
 
   const bool success = BLO_write_file(bmain, filepath, fileflags, &blend_write_params, reports);
+  if (io_stats) {
+    printf("Blender file write phases:\n%s", io_stats->report().c_str());
+  }
 
   if (success) {
     const bool do_history_file_update = (G.background == false) &&
@@ -2334,8 +2358,46 @@ bool WM_autosave_is_scheduled(wmWindowManager *wm)
   return wm->autosave_scheduled;
 }
 
+struct AutosaveJob {
+  BlendFileSnapshot *snapshot;
+  char filepath[FILE_MAX];
+  bool success;
+};
+
+static void wm_autosave_job_startjob(void *customdata, wmJobWorkerStatus *worker_status)
+{
+  AutosaveJob *job = static_cast<AutosaveJob *>(customdata);
+  job->success = BLO_write_snapshot_to_file(
+      job->snapshot, worker_status->reports, &worker_status->stop, &worker_status->progress);
+  worker_status->do_update = true;
+}
+
+static void wm_autosave_job_endjob(void *customdata)
+{
+  AutosaveJob *job = static_cast<AutosaveJob *>(customdata);
+  if (job->success) {
+    /* Same as #BLO_write_file, it is used to reload Blender after a crash on Windows OS. */
+    STRNCPY(G.filepath_last_blend, job->filepath);
+  }
+}
+
+static void wm_autosave_job_free(void *customdata)
+{
+  AutosaveJob *job = static_cast<AutosaveJob *>(customdata);
+  BLO_write_snapshot_free(job->snapshot);
+  MEM_delete(job);
+}
+
 void WM_autosave_write(wmWindowManager *wm, Main *bmain)
 {
+  /* The previous auto-save is still being written, skip this one. */
+  if (WM_jobs_test(wm, wm, WM_JOB_TYPE_AUTOSAVE)) {
+    wm_autosave_timer_end(wm);
+    wm_autosave_timer_begin(wm);
+    wm->autosave_scheduled = false;
+    return;
+  }
+
   ED_editors_flush_edits(bmain);
 
   char filepath[FILE_MAX];
@@ -2344,9 +2406,24 @@ void WM_autosave_write(wmWindowManager *wm, Main *bmain)
    */
   const int fileflags = G.fileflags | G_FILE_RECOVER_WRITE | G_FILE_COMPRESS;
 
-  /* Error reporting into console. */
+  /* Only the snapshot of the data blocks the interface, compressing and writing the file to disk
+   * is done by a job. Error reporting into console. */
   BlendFileWriteParams params{};
-  BLO_write_file(bmain, filepath, fileflags, &params, nullptr);
+  if (BlendFileSnapshot *snapshot = BLO_write_snapshot(
+          bmain, filepath, fileflags, &params, nullptr))
+  {
+    AutosaveJob *job = MEM_new<AutosaveJob>(__func__);
+    job->snapshot = snapshot;
+    STRNCPY(job->filepath, filepath);
+    job->success = false;
+
+    wmJob *wm_job = WM_jobs_get(
+        wm, nullptr, wm, "Auto-Saving", WM_JOB_PROGRESS, WM_JOB_TYPE_AUTOSAVE);
+    WM_jobs_customdata_set(wm_job, job, wm_autosave_job_free);
+    WM_jobs_timer(wm_job, 0.1, 0, 0);
+    WM_jobs_callbacks(wm_job, wm_autosave_job_startjob, nullptr, nullptr, wm_autosave_job_endjob);
+    WM_jobs_start(wm, wm_job);
+  }
 
   /* Restart auto-save timer. */
   wm_autosave_timer_end(wm);
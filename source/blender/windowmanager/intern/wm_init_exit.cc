@@ -29,6 +29,7 @@
 #include "BLI_timer.h"
 #include "BLI_utildefines.h"
 
+#include "BLO_readfile.hh"
 #include "BLO_undofile.hh"
 #include "BLO_writefile.hh"
 
@@ -455,6 +456,19 @@ void WM_exit_ex(bContext *C, const bool do_python_exit, const bool do_user_exit_
    * Saving #BLENDER_QUIT_FILE is also not likely to be desired either. */
   BLI_assert(G.background ? (do_user_exit_actions == false) : true);
 
+  /* Show what is still allocated before everything is freed. */
+  if (G.debug & G_DEBUG_MEMORY_SUMMARY) {
+    if (MEM_get_name_usage_tracking()) {
+      MEM_NameUsageSnapshot *snapshot = MEM_name_usage_snapshot();
+      printf("\nMemory summary on exit\n");
+      MEM_name_usage_print(snapshot, nullptr, 30);
+      MEM_name_usage_snapshot_free(snapshot);
+    }
+    else {
+      printf("\nMemory summary is not supported by the fully guarded memory allocator\n");
+    }
+  }
+
   /* First wrap up running stuff, we assume only the active WM is running. */
   /* Modal handlers are on window level freed, others too? */
   /* NOTE: same code copied in `wm_files.cc`. */
@@ -566,6 +580,9 @@ void WM_exit_ex(bContext *C, const bool do_python_exit, const bool do_user_exit_
   ED_preview_restart_queue_free();
   ed::asset::list::storage_exit();
 
+  /* Indices of libraries that were read may still be written in the background. */
+  BLO_library_index_exit();
+
   BKE_tracking_clipboard_free();
   BKE_mask_clipboard_free();
   BKE_vfont_clipboard_free();
@@ -662,6 +679,9 @@ void WM_exit_ex(bContext *C, const bool do_python_exit, const bool do_user_exit_
 
   DNA_sdna_current_free();
 
+  /* Undo steps are freed, but compressing their data in the background may not be finished. */
+  BLO_memfile_chunk_store_exit();
+
   BLI_threadapi_exit();
   BLI_task_scheduler_exit();
 
@@ -361,6 +361,13 @@ int main(int argc,
         MEM_use_guarded_allocator();
         break;
       }
+      if (STREQ(argv[i], "--memory-size-classes")) {
+        MEM_use_size_class_allocator();
+      }
+      if (STREQ(argv[i], "--debug-memory-summary")) {
+        /* Track as many allocations as possible. */
+        MEM_set_name_usage_tracking(true);
+      }
       if (STR_ELEM(argv[i], "--", "-c", "--command")) {
         break;
       }
@@ -28,6 +28,7 @@
 #  include "BLI_string.h"
 #  include "BLI_string_utf8.h"
 #  include "BLI_system.h"
+#  include "BLI_task_trace.hh"
 #  include "BLI_threads.h"
 #  include "BLI_utildefines.h"
 #  ifndef NDEBUG
@@ -734,6 +735,8 @@ static void print_help(bArgs *ba, bool all)
     BLI_args_print_arg_doc(ba, "--debug-libmv");
   }
   BLI_args_print_arg_doc(ba, "--debug-memory");
+  BLI_args_print_arg_doc(ba, "--debug-memory-summary");
+  BLI_args_print_arg_doc(ba, "--memory-size-classes");
   BLI_args_print_arg_doc(ba, "--debug-jobs");
   BLI_args_print_arg_doc(ba, "--debug-python");
   BLI_args_print_arg_doc(ba, "--debug-depsgraph");
@@ -763,6 +766,7 @@ static void print_help(bArgs *ba, bool all)
   }
   BLI_args_print_arg_doc(ba, "--debug-all");
   BLI_args_print_arg_doc(ba, "--debug-io");
+  BLI_args_print_arg_doc(ba, "--profile-tasks");
 
   PRINT("\n");
   BLI_args_print_arg_doc(ba, "--debug-fpe");
@@ -1353,6 +1357,11 @@ static const char arg_handle_debug_mode_generic_set_doc_xr[] =
 static const char arg_handle_debug_mode_generic_set_doc_xr_time[] =
     "\n\t"
     "Enable debug messages for virtual reality frame rendering times.";
+static const char arg_handle_debug_mode_generic_set_doc_memory_summary[] =
+    "\n\t"
+    "Print the memory usage per allocation name after every rendered frame and on exit.\n"
+    "\tAfter the first frame, the changes since the previous frame are printed instead.\n"
+    "\tNot supported by the fully guarded memory allocator (used with '--debug-memory').";
 static const char arg_handle_debug_mode_generic_set_doc_jobs[] =
     "\n\t"
     "Enable time profiling for background jobs.";
@@ -1397,7 +1406,8 @@ static int arg_handle_debug_mode_generic_set(int /*argc*/, const char ** /*argv*
 
 static const char arg_handle_debug_mode_io_doc[] =
     "\n\t"
-    "Enable debug messages for I/O.";
+    "Enable debug messages for I/O.\n"
+    "\tAlso prints the time and memory used by each phase of reading and writing blend-files.";
 static int arg_handle_debug_mode_io(int /*argc*/, const char ** /*argv*/, void * /*data*/)
 {
   G.debug |= G_DEBUG_IO;
@@ -1446,6 +1456,19 @@ static int arg_handle_debug_mode_memory_set(int /*argc*/, const char ** /*argv*/
   return 0;
 }
 
+static const char arg_handle_memory_size_classes_set_doc[] =
+    "\n\t"
+    "Allocate small memory blocks from thread-local pools of fixed size blocks.\n"
+    "\tThe usage of these pools is printed with the memory statistics.";
+static int arg_handle_memory_size_classes_set(int /*argc*/,
+                                              const char ** /*argv*/,
+                                              void * /*data*/)
+{
+  /* The allocator is switched in `main()` already, because it has to happen before any memory is
+   * allocated. */
+  return 0;
+}
+
 static const char arg_handle_debug_value_set_doc[] =
     "<value>\n"
     "\tSet debug value of <value> on startup.";
@@ -2561,6 +2584,37 @@ static int arg_handle_profile_gpu_set(int /*argc*/, const char ** /*argv*/, void
   return 0;
 }
 
+static char profile_tasks_filepath[FILE_MAX] = "";
+
+static void profile_tasks_write_atexit(void * /*user_data*/)
+{
+  blender::threading::trace::stop();
+  if (!blender::threading::trace::write_trace_event_json(profile_tasks_filepath)) {
+    fprintf(stderr, "Error: could not write task profile to '%s'\n", profile_tasks_filepath);
+  }
+}
+
+static const char arg_handle_profile_tasks_set_doc[] =
+    "<filepath>\n"
+    "\tRecord the parallel ranges, tasks and task graph nodes executed by all threads.\n"
+    "\tThe trace is written to the file in the Trace Event Format on exit,\n"
+    "\tit can be viewed with https://ui.perfetto.dev or 'chrome://tracing'.";
+static int arg_handle_profile_tasks_set(int argc, const char **argv, void * /*data*/)
+{
+  const char *arg_id = "--profile-tasks";
+  if (argc > 1) {
+    if (profile_tasks_filepath[0] == '\0') {
+      BKE_blender_atexit_register(profile_tasks_write_atexit, nullptr);
+    }
+    STRNCPY(profile_tasks_filepath, argv[1]);
+    BLI_path_abs_from_cwd(profile_tasks_filepath, sizeof(profile_tasks_filepath));
+    blender::threading::trace::start();
+    return 1;
+  }
+  fprintf(stderr, "\nError: '%s' no args given.\n", arg_id);
+  return 0;
+}
+
 /**
  * Implementation for #arg_handle_load_last_file, also used by `--open-last`.
  * \return true on success.
@@ -2733,6 +2787,7 @@ void main_args_setup(bContext *C, bArgs *ba, bool all)
                nullptr);
 #  endif
   BLI_args_add(ba, nullptr, "--profile-gpu", CB(arg_handle_profile_gpu_set), nullptr);
+  BLI_args_add(ba, nullptr, "--profile-tasks", CB(arg_handle_profile_tasks_set), nullptr);
 
   /* Pass: Background Mode & Settings
    *
@@ -2846,6 +2901,13 @@ void main_args_setup(bContext *C, bArgs *ba, bool all)
     BLI_args_add(ba, nullptr, "--debug-cycles", CB(arg_handle_debug_mode_cycles), nullptr);
   }
   BLI_args_add(ba, nullptr, "--debug-memory", CB(arg_handle_debug_mode_memory_set), nullptr);
+  BLI_args_add(ba,
+               nullptr,
+               "--debug-memory-summary",
+               CB_EX(arg_handle_debug_mode_generic_set, memory_summary),
+               (void *)G_DEBUG_MEMORY_SUMMARY);
+  BLI_args_add(
+      ba, nullptr, "--memory-size-classes", CB(arg_handle_memory_size_classes_set), nullptr);
 
   BLI_args_add(ba, nullptr, "--debug-value", CB(arg_handle_debug_value_set), nullptr);
   BLI_args_add(ba,
@@ -0,0 +1,85 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "testing/testing.h"
+
+#include "BLI_fileops.h"
+#include "BLI_path_utils.hh"
+#include "BLI_string_ref.hh"
+#include "BLI_system.h"
+#include "BLI_tempfile.h"
+
+#include BLI_SYSTEM_PID_H
+
+namespace blender::tests {
+
+/**
+ * A directory for temporary files that is deleted with all its contents when it is destructed.
+ * The name is unique for the process, so that tests can run in parallel.
+ */
+class TempDirectory {
+ private:
+  std::string path_;
+
+ public:
+  explicit TempDirectory(const StringRef name)
+  {
+    char temp_dir[FILE_MAX];
+    BLI_temp_directory_path_get(temp_dir, sizeof(temp_dir));
+    path_ = std::string(temp_dir) + SEP_STR + "blender_" + name + "_" + std::to_string(getpid());
+    BLI_dir_create_recursive(path_.c_str());
+  }
+
+  ~TempDirectory()
+  {
+    if (BLI_exists(path_.c_str())) {
+      BLI_delete(path_.c_str(), true, true);
+    }
+  }
+
+  TempDirectory(const TempDirectory &other) = delete;
+  TempDirectory &operator=(const TempDirectory &other) = delete;
+
+  const std::string &path() const
+  {
+    return path_;
+  }
+
+  std::string file_path(const StringRef filename) const
+  {
+    return path_ + SEP_STR + filename;
+  }
+};
+
+/**
+ * Fixture for tests that write files. Every test gets a new empty directory, named after the test
+ * suite.
+ */
+class TempDirTest : public testing::Test {
+ protected:
+  std::unique_ptr<TempDirectory> temp_dir_;
+
+  void SetUp() override
+  {
+    temp_dir_ = std::make_unique<TempDirectory>(
+        testing::UnitTest::GetInstance()->current_test_info()->test_suite_name());
+  }
+
+  void TearDown() override
+  {
+    temp_dir_.reset();
+  }
+
+  const std::string &temp_dir() const
+  {
+    return temp_dir_->path();
+  }
+};
+
+}  // namespace blender::tests
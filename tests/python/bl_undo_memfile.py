@@ -0,0 +1,44 @@
+# SPDX-FileCopyrightText: 2025 Blender Authors
+#
+# SPDX-License-Identifier: GPL-2.0-or-later */
+
+import unittest
+
+import bpy
+
+
+class MemfileUndoPushTest(unittest.TestCase):
+    def setUp(self):
+        bpy.ops.wm.read_factory_settings(use_empty=True)
+        # Explicitly initialize the undo-system, it is disabled at startup in background-mode.
+        self.assertEqual({'FINISHED'}, bpy.ops.ed.undo_push(message="Initial"))
+
+    def test_push_memfile_steps(self):
+        """Test that pushing memfile undo steps that share unchanged data succeeds."""
+        for i in range(5):
+            mesh = bpy.data.meshes.new("Mesh{:d}".format(i))
+            mesh.vertices.add(1000)
+            bpy.context.scene.collection.objects.link(bpy.data.objects.new(mesh.name, mesh))
+            self.assertEqual({'FINISHED'}, bpy.ops.ed.undo_push(message="Add {:d}".format(i)))
+
+        self.assertEqual(len(bpy.data.meshes), 5)
+        self.assertEqual(len(bpy.context.scene.objects), 5)
+
+    def test_push_with_steps_limit(self):
+        """Test that pushing more memfile undo steps than the limit frees the oldest steps."""
+        undo_steps = bpy.context.preferences.edit.undo_steps
+        bpy.context.preferences.edit.undo_steps = 2
+        try:
+            for i in range(5):
+                bpy.data.meshes.new("Mesh{:d}".format(i)).vertices.add(1000)
+                self.assertEqual({'FINISHED'}, bpy.ops.ed.undo_push(message="Add {:d}".format(i)))
+        finally:
+            bpy.context.preferences.edit.undo_steps = undo_steps
+
+        self.assertEqual(len(bpy.data.meshes), 5)
+
+
+if __name__ == '__main__':
+    import sys
+    sys.argv = [__file__] + (sys.argv[sys.argv.index("--") + 1:] if "--" in sys.argv else [])
+    unittest.main()